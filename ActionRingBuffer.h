@@ -101,6 +101,10 @@ class ActionRingBuffer {
     byte ElementsNb(void) const { return _elementsCurrentNb; }
 
 
+    // Return TRUE when the buffer is full, i.e. when the next Append() overwrites the oldest data
+    boolean IsFull(void) const { return (_elementsCurrentNb == _size); }
+
+
     #ifdef ACTIONRINGBUFFER_STAT
     // Return Stat information
     void Info(String& str)
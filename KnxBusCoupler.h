@@ -20,7 +20,8 @@
 // File : KnxBusCoupler.h
 // Author : Franz Auernigg
 // Description : Interface two select between TpUart and StKnxCoupler Chip
-// Module dependencies : KnxTelegram, KnxComObject
+// Module dependencies : KnxTelegram, KnxComObject, ActionRingBuffer, KnxClock, KnxGroupStats, KnxBusHealth, KnxTraceRing,
+//                       KnxProbes
 
 #ifndef KNXBUSCOUPLER_H
 #define KNXBUSCOUPLER_H
@@ -28,6 +29,12 @@
 #include "Arduino.h"
 #include "KnxTelegram.h"
 #include "KnxComObject.h"
+#include "ActionRingBuffer.h"
+#include "KnxClock.h"
+#include "KnxGroupStats.h"
+#include "KnxBusHealth.h"
+#include "KnxTraceRing.h"
+#include "KnxProbes.h"
 
 
 
@@ -54,6 +61,58 @@ typedef struct {
   byte dataByte;  // Last data retrieved on the bus (valid when isEOP is false)
 } type_MonitorData;
 
+// Whole frame retrieved on the bus (BUS MONITORING mode)
+#define KNX_MONITOR_FRAME_VALID         0x01 // standard frame whose length matches its routing field
+#define KNX_MONITOR_FRAME_CHECKSUM_OK   0x02 // the last byte is the frame checksum
+#define KNX_MONITOR_FRAME_ACK           0x04 // single byte frame : ACK, NACK or BUSY acknowledge
+#define KNX_MONITOR_FRAME_TRUNCATED     0x08 // more than KNX_TELEGRAM_MAX_SIZE bytes, the next bytes are dropped
+typedef struct {
+  unsigned long startTimeMicros;    // Reception time of the frame 1st byte
+  byte length;                      // Nb of bytes in data
+  byte status;                      // KNX_MONITOR_FRAME_xxx flags
+  byte data[KNX_TELEGRAM_MAX_SIZE]; // Frame bytes
+} type_MonitorFrame;
+
+
+
+// Size of the queue of received telegrams (shall be <= 255)
+// The queue absorbs bus bursts (e.g. central commands) when the application does not drain it at each telegram
+#ifndef BUSCOUPLER_RX_QUEUE_SIZE
+#define BUSCOUPLER_RX_QUEUE_SIZE 8
+#endif
+
+// Received telegram as stored in the RX queue
+typedef struct buscoupler_rx_telegram {
+  KnxTelegram telegram;       // Received telegram
+  byte comObjectIndex;        // Index of the com object targeted by the telegram
+  unsigned long timeMicros;   // Reception time (in usec) of the telegram 1st byte
+} type_buscoupler_rx_telegram;
+
+
+// --- Definitions for the RECEPTION part ----
+// RX states
+enum e_BusCouplerRxState {
+  RX_RESET = 0,                             // The RX part is awaiting reset execution
+  RX_STOPPED,                               // TPUART reset event received, RX activity is stopped
+  RX_INIT,                                  // The RX part is awaiting init execution
+  RX_IDLE_WAITING_FOR_CTRL_FIELD,           // Idle, no reception ongoing
+  RX_EIB_TELEGRAM_RECEPTION_STARTED,        // Telegram reception started (address evaluation not done yet)
+  RX_EIB_TELEGRAM_RECEPTION_ADDRESSED,      // Addressed telegram reception ongoing
+  RX_EIB_TELEGRAM_RECEPTION_LENGTH_INVALID, // The telegram being received is too long
+  RX_EIB_TELEGRAM_RECEPTION_NOT_ADDRESSED   // Tegram reception ongoing but not addressed
+};
+
+
+typedef struct {
+  e_BusCouplerRxState state;        // Current TPUART RX state
+  KnxTelegram receivedTelegram; // Where each received telegram is stored (the content is overwritten on each telegram reception)
+                                // A BUSCOUPLER_EVENT_RECEIVED_EIB_TELEGRAM event notifies each content change
+  byte addressedComObjectIndex; // Where the index to the targeted com object is stored (the value is overwritten on each telegram reception)
+                                // A BUSCOUPLER_EVENT_RECEIVED_EIB_TELEGRAM event notifies each content change
+  ActionRingBuffer<type_buscoupler_rx_telegram, BUSCOUPLER_RX_QUEUE_SIZE> queue; // Queue of the received telegrams
+                                // A BUSCOUPLER_EVENT_RECEIVED_EIB_TELEGRAM event notifies each new telegram in the queue
+  word overflowsNb;             // Nb of telegrams lost because of queue overflow (the oldest telegram is overwritten)
+} type_buscoupler_rx;
 
 
 // Definition of the TP-UART working modes
@@ -64,6 +123,9 @@ enum type_KnxBusCouplerMode { NORMAL,
 typedef void (*type_EventCallbackFctPtr) (e_KnxBusCouplerEvent);
 // Typedef for TX acknowledge callback function
 typedef void (*type_AckCallbackFctPtr) (e_BusCouplerTxAck);
+// Typedef for the callback function of the frames seen on the bus
+// "length" is the nb of received bytes, it differs from the telegram length for an incomplete or too long frame
+typedef void (*type_FrameCallbackFctPtr) (const KnxTelegram& frame, byte length, unsigned long timeMicros);
 
 // Typedef for external transmit callback function
 typedef unsigned char (*type_TransmitCallbackFctPtr) (KnxTelegram *telegram);
@@ -81,9 +143,15 @@ class KnxBusCoupler {
     virtual byte GetTargetedComObjectIndex(void) const = 0;
     virtual boolean IsActive(void) const = 0;
 
+    // Pop the oldest telegram from the RX queue
+    // return false when no received telegram is pending
+    virtual boolean PopReceivedTelegram(type_buscoupler_rx_telegram&) = 0;
+    // Get the nb of received telegrams lost because of RX queue overflow
+    virtual word GetRxOverflowsNb(void) const = 0;
+
 #if defined(KNXTPUART_DEBUG_INFO) || defined(KNXTPUART_DEBUG_ERROR)
-    // Set the string used for debug traces
-    virtual void SetDebugString(String *strPtr) = 0;
+    // Set the ring recording the debug traces (the ring is not owned by the bus coupler)
+    virtual void SetTraceRing(KnxTraceRing *traceRing) = 0;
 #endif
 
     virtual byte Reset(void) = 0;
@@ -100,33 +168,44 @@ class KnxBusCoupler {
 
     virtual boolean GetMonitoringData(type_MonitorData&) = 0;
 
-    virtual void DEBUG_SendResetCommand(void) = 0;
-    virtual void DEBUG_SendStateReqCommand(void) = 0;
-};
+    // Get up to "maxNb" whole frames retrieved on the bus (BUS MONITORING mode), oldest first
+    // return the nb of frames copied, 0 when the coupler does not support the frame monitoring
+    virtual word GetMonitoringFrames(type_MonitorFrame frames[], word maxNb) { return 0; }
+    // Get the nb of monitored frames lost because they were not got in time
+    virtual word GetMonitoringOverflowsNb(void) const { return 0; }
 
+    // Record the traffic statistics per target address of the telegrams seen on the bus (NULL to stop)
+    // return false when the coupler does not record traffic statistics
+    virtual boolean SetGroupStats(KnxGroupStats *groupStats) { return false; }
 
+    // Maintain the bus health and load counters (NULL to stop)
+    // return false when the coupler does not maintain them
+    virtual boolean SetBusHealth(KnxBusHealth *busHealth) { return false; }
 
-// --- Definitions for the RECEPTION part ----
-// RX states
-enum e_BusCouplerRxState {
-  RX_RESET = 0,                             // The RX part is awaiting reset execution
-  RX_STOPPED,                               // TPUART reset event received, RX activity is stopped
-  RX_INIT,                                  // The RX part is awaiting init execution
-  RX_IDLE_WAITING_FOR_CTRL_FIELD,           // Idle, no reception ongoing
-  RX_EIB_TELEGRAM_RECEPTION_STARTED,        // Telegram reception started (address evaluation not done yet)
-  RX_EIB_TELEGRAM_RECEPTION_ADDRESSED,      // Addressed telegram reception ongoing
-  RX_EIB_TELEGRAM_RECEPTION_LENGTH_INVALID, // The telegram being received is too long
-  RX_EIB_TELEGRAM_RECEPTION_NOT_ADDRESSED   // Tegram reception ongoing but not addressed
-};
+    // Call "frameFct" for every frame seen on the bus at its end (addressed to the device or not, valid or not),
+    // with the reception time of its 1st byte (NULL to stop). The callback is run by the RX task.
+    // return false when the coupler does not see the frames not addressed to the device
+    virtual boolean SetFrameCallback(type_FrameCallbackFctPtr frameFct) { return false; }
 
+    // Get the time when the last byte of the last sent telegram was written to the bus coupler device
+    // return false when the coupler does not provide it
+    virtual boolean GetTxEndMicros(unsigned long& timeMicros) const { return false; }
+
+    // Return true while the coupler cannot accept a new telegram (SendTelegram() would fail)
+    virtual boolean IsTxBusy(void) const { return false; }
+
+    virtual void DEBUG_SendResetCommand(void) = 0;
+    virtual void DEBUG_SendStateReqCommand(void) = 0;
+
+  protected:
+    // Store a received telegram in the RX queue of a bus coupler
+    // In case of queue full, the oldest telegram is lost and the overflow is counted
+    // Inline functions (definition later in this file)
+    static void QueueReceivedTelegram(type_buscoupler_rx& rx, const type_buscoupler_rx_telegram& rxTelegram);
+    static void QueueReceivedTelegram(type_buscoupler_rx& rx, const KnxTelegram& telegram, byte index,
+                                      unsigned long timeMicros);
+};
 
-typedef struct {
-  e_BusCouplerRxState state;        // Current TPUART RX state
-  KnxTelegram receivedTelegram; // Where each received telegram is stored (the content is overwritten on each telegram reception)
-                                // A BUSCOUPLER_EVENT_RECEIVED_EIB_TELEGRAM event notifies each content change
-  byte addressedComObjectIndex; // Where the index to the targeted com object is stored (the value is overwritten on each telegram reception)
-                                // A BUSCOUPLER_EVENT_RECEIVED_EIB_TELEGRAM event notifies each content change
-} type_buscoupler_rx;
 
 
 // --- Definitions for the TRANSMISSION  part ----
@@ -147,6 +226,7 @@ typedef struct buscoupler_tx {
   type_AckCallbackFctPtr ackFctPtr; // Pointer to callback function for TX ack
   byte nbRemainingBytes;            // Nb of bytes remaining to be transmitted
   byte txByteIndex;                 // Index of the byte to be sent
+  unsigned long endMicros;          // Time when the last byte of the telegram was written
 } type_buscoupler_tx;
 
 
@@ -160,4 +240,24 @@ typedef struct buscoupler_tx {
 
 
 
+// --------------- Definition of the INLINED functions -----------------
+
+inline void KnxBusCoupler::QueueReceivedTelegram(type_buscoupler_rx& rx, const type_buscoupler_rx_telegram& rxTelegram)
+{
+  if (rx.queue.IsFull()) { rx.overflowsNb++; KNX_PROBE_QUEUE_OVERFLOW(KNX_PROBE_QUEUE_RX_TELEGRAMS); }
+  rx.queue.Append(rxTelegram);
+}
+
+
+inline void KnxBusCoupler::QueueReceivedTelegram(type_buscoupler_rx& rx, const KnxTelegram& telegram, byte index,
+                                                 unsigned long timeMicros)
+{
+  type_buscoupler_rx_telegram rxTelegram;
+
+  telegram.Copy(rxTelegram.telegram);
+  rxTelegram.comObjectIndex = index;
+  rxTelegram.timeMicros = timeMicros;
+  QueueReceivedTelegram(rx, rxTelegram);
+}
+
 #endif // KNXBUSCOUPLER_H
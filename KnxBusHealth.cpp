@@ -0,0 +1,124 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxBusHealth.cpp
+// Author : Franck Marini
+// Description : Bus health and load counters
+// Module dependencies : KnxSeqLock, KnxClock
+
+#include "KnxBusHealth.h"
+#include "KnxClock.h"
+
+KnxBusHealth::KnxBusHealth() { Clear(); }
+
+
+void KnxBusHealth::RecordFrame(byte length, boolean ownFrame, boolean complete)
+{
+  _lock.WriteBegin();
+  _windowBusyMicros += KNX_BUS_HEALTH_FRAME_MICROS(length);
+  if (!ownFrame)
+  {
+    if (complete) { _health.rxTelegramsNb++; _windowRxNb++; }
+    else _health.rxErrorsNb++;
+  }
+  _lock.WriteEnd();
+}
+
+
+void KnxBusHealth::RecordTxTelegram(void)
+{
+  _lock.WriteBegin();
+  _health.txTelegramsNb++;
+  _windowTxNb++;
+  _lock.WriteEnd();
+}
+
+
+void KnxBusHealth::RecordTxOutcome(byte outcome)
+{
+  if (outcome >= KNX_BUS_HEALTH_TX_OUTCOMES_NB) return;
+  _lock.WriteBegin();
+  _health.txOutcomesNb[outcome]++;
+  _lock.WriteEnd();
+}
+
+
+void KnxBusHealth::RecordStateErrors(byte errors)
+{
+  if (!errors) return;
+  _lock.WriteBegin();
+  for (byte i = 0; i < KNX_BUS_HEALTH_STATE_ERRORS_NB; i++) if (errors & (1 << i)) _health.stateErrorsNb[i]++;
+  _lock.WriteEnd();
+}
+
+
+void KnxBusHealth::RecordCouplerReset(void)
+{
+  _lock.WriteBegin();
+  _health.couplerResetsNb++;
+  _lock.WriteEnd();
+}
+
+
+// The gauges are averaged over the elapsed time, which may be longer than the window when Update() is not called
+// often enough (e.g. coupler stopped)
+void KnxBusHealth::Update(void)
+{
+  unsigned long nowMillis = KnxMillis(), elapsed = nowMillis - _windowStartMillis;
+  unsigned long load;
+
+  if (elapsed < KNX_BUS_HEALTH_WINDOW_MILLIS) return;
+  load = _windowBusyMicros / elapsed; // usec per msec = per mille
+  _lock.WriteBegin();
+  _health.rxTelegramsPerSecond = (word)((_windowRxNb * 1000) / elapsed);
+  _health.txTelegramsPerSecond = (word)((_windowTxNb * 1000) / elapsed);
+  _health.busLoadPerMille = (load > 1000) ? 1000 : (word)load;
+  _lock.WriteEnd();
+  _windowStartMillis = nowMillis;
+  _windowRxNb = 0;
+  _windowTxNb = 0;
+  _windowBusyMicros = 0;
+}
+
+
+void KnxBusHealth::GetSnapshot(type_bus_health& health) const
+{
+  word sequence;
+  do
+  { // copy again if an update occurred meanwhile
+    sequence = _lock.ReadBegin();
+    health = _health;
+  } while (_lock.ReadRetry(sequence));
+}
+
+
+// NB : to be called from the coupler task context, or while the coupler is stopped
+void KnxBusHealth::Clear(void)
+{
+  _lock.WriteBegin();
+  memset(&_health, 0, sizeof(_health));
+  _lock.WriteEnd();
+  _windowStartMillis = KnxMillis();
+  _windowRxNb = 0;
+  _windowTxNb = 0;
+  _windowBusyMicros = 0;
+}
+
+// EOF
@@ -0,0 +1,104 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxBusHealth.h
+// Author : Franck Marini
+// Description : Bus health and load counters, maintained by the bus coupler tasks
+//               - counters : telegrams received and sent, reception errors, transmission outcomes
+//                 (ACK/NACK/timeout/reset), state indication errors per bit, coupler resets
+//               - gauges computed over 1s windows : telegrams per second (RX/TX) and bus occupancy, estimated
+//                 from the frames length at the TP1 bit rate
+//               The counters are updated by the coupler tasks only, GetSnapshot() gets a consistent copy of all of
+//               them from any thread (sequence lock) in order to watch the line degradation.
+// Module dependencies : KnxSeqLock, KnxClock
+
+#ifndef KNXBUSHEALTH_H
+#define KNXBUSHEALTH_H
+
+#include "Arduino.h"
+#include "KnxSeqLock.h"
+
+// Gauges window
+#define KNX_BUS_HEALTH_WINDOW_MILLIS    1000
+
+// TP1 bus occupancy of a frame : 13 bits per byte, plus the acknowledge (15 bits gap and 13 bits char)
+#define KNX_BUS_HEALTH_BIT_MICROS       104   // 9600 bit/s
+#define KNX_BUS_HEALTH_FRAME_MICROS(length) ((unsigned long)(length) * 13 * KNX_BUS_HEALTH_BIT_MICROS + 28 * KNX_BUS_HEALTH_BIT_MICROS)
+
+// State indication errors (index in the stateErrorsNb table)
+enum e_KnxBusHealthStateError {
+  KNX_BUS_HEALTH_SLAVE_COLLISION = 0,
+  KNX_BUS_HEALTH_RECEIVE_ERROR,
+  KNX_BUS_HEALTH_TRANSMIT_ERROR,
+  KNX_BUS_HEALTH_PROTOCOL_ERROR,
+  KNX_BUS_HEALTH_TEMPERATURE_WARNING,
+  KNX_BUS_HEALTH_STATE_ERRORS_NB
+};
+
+// Transmission outcomes (index in the txOutcomesNb table, same values as e_BusCouplerTxAck)
+#define KNX_BUS_HEALTH_TX_OUTCOMES_NB   4
+
+typedef struct {
+  unsigned long rxTelegramsNb;                                  // frames received from the other devices
+  unsigned long rxErrorsNb;                                     // addressed telegrams reception errors
+  unsigned long txTelegramsNb;                                  // telegrams given to the coupler for sending
+  unsigned long txOutcomesNb[KNX_BUS_HEALTH_TX_OUTCOMES_NB];    // ACK, NACK, timeout, reset answers (e_BusCouplerTxAck)
+  unsigned long stateErrorsNb[KNX_BUS_HEALTH_STATE_ERRORS_NB];  // state indications with the error bit set
+  unsigned long couplerResetsNb;                                // coupler resets notified while running
+  word rxTelegramsPerSecond;                                    // last complete window gauges
+  word txTelegramsPerSecond;
+  word busLoadPerMille;                                         // estimated bus occupancy
+} type_bus_health;
+
+
+class KnxBusHealth {
+    KnxSeqLock _lock;
+    type_bus_health _health;
+    unsigned long _windowStartMillis;   // current window
+    unsigned long _windowRxNb;
+    unsigned long _windowTxNb;
+    unsigned long _windowBusyMicros;
+
+  public:
+    KnxBusHealth();
+
+    // --- Coupler side ---
+    // A frame has been received on the bus, "ownFrame" is true for the echo of the telegrams sent by the coupler
+    // "complete" is false for a reception error
+    void RecordFrame(byte length, boolean ownFrame, boolean complete);
+    // A telegram has been given to the coupler for sending (the occupancy is counted at its echo if any)
+    void RecordTxTelegram(void);
+    // Transmission outcome (e_BusCouplerTxAck value)
+    void RecordTxOutcome(byte outcome);
+    // State indication received, the errors are flagged in "errors" (bit n for e_KnxBusHealthStateError value n)
+    void RecordStateErrors(byte errors);
+    // The coupler notified a reset while running
+    void RecordCouplerReset(void);
+    // Close the gauges window when elapsed, shall be called periodically (e.g. by the RX task)
+    void Update(void);
+
+    // --- Reader side (any thread) ---
+    void GetSnapshot(type_bus_health& health) const;
+    void Clear(void);
+};
+
+#endif // KNXBUSHEALTH_H
+
+// EOF
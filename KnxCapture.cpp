@@ -0,0 +1,160 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxCapture.cpp
+// Author : Franck Marini
+// Description : Capture of the bus traffic seen by the device (see KnxCapture.h)
+// Module dependencies : KnxBusCoupler
+
+#include "KnxCapture.h"
+
+const byte KnxCaptureHeader[KNX_CAPTURE_HEADER_SIZE] = { 'K', 'N', 'X', 'C', 'A', 'P', KNX_CAPTURE_VERSION, 0 };
+
+KnxCaptureCoupler *KnxCaptureCoupler::_instance = NULL;
+
+
+byte KnxCaptureBuildRecord(byte record[], e_KnxCaptureRecordType type, unsigned long timeMicros,
+                           const byte data[], byte dataLength)
+{
+  record[0] = KNX_CAPTURE_RECORD_HEADER_SIZE - 1 + dataLength;
+  record[1] = type;
+  record[2] = (byte)timeMicros;
+  record[3] = (byte)(timeMicros >> 8);
+  record[4] = (byte)(timeMicros >> 16);
+  record[5] = (byte)(timeMicros >> 24);
+  memcpy(record + KNX_CAPTURE_RECORD_HEADER_SIZE, data, dataLength);
+  return KNX_CAPTURE_RECORD_HEADER_SIZE + dataLength;
+}
+
+
+KnxCaptureCoupler::KnxCaptureCoupler(KnxBusCoupler *coupler, KnxCaptureSink& sink, boolean allFrames)
+: _coupler(coupler), _sink(sink), _evtCallbackFct(NULL), _ackCallbackFct(NULL), _enabled(true), _allFrames(false),
+  _recordsNb(0), _lostRecordsNb(0)
+{
+  _instance = this;
+  if (allFrames) _allFrames = _coupler->SetFrameCallback(&KnxCaptureCoupler::CaptureFrame);
+}
+
+
+KnxCaptureCoupler::~KnxCaptureCoupler()
+{
+  delete _coupler;
+  if (_instance == this) _instance = NULL;
+}
+
+
+byte KnxCaptureCoupler::SetEvtCallback(type_EventCallbackFctPtr evtCallbackFct)
+{
+  byte result;
+
+  if (evtCallbackFct == NULL) return KNX_BUSCOUPLER_ERROR;
+  result = _coupler->SetEvtCallback(&KnxCaptureCoupler::CaptureEvent);
+  if (result == KNX_BUSCOUPLER_OK) _evtCallbackFct = evtCallbackFct;
+  return result;
+}
+
+
+byte KnxCaptureCoupler::SetAckCallback(type_AckCallbackFctPtr ackFctPtr)
+{
+  byte result;
+
+  if (ackFctPtr == NULL) return KNX_BUSCOUPLER_ERROR;
+  result = _coupler->SetAckCallback(&KnxCaptureCoupler::CaptureAck);
+  if (result == KNX_BUSCOUPLER_OK) _ackCallbackFct = ackFctPtr;
+  return result;
+}
+
+
+// The telegram is captured when the coupler user gets it, with its reception time
+boolean KnxCaptureCoupler::PopReceivedTelegram(type_buscoupler_rx_telegram& rxTelegram)
+{
+  byte data[1 + KNX_TELEGRAM_MAX_SIZE];
+
+  if (!_coupler->PopReceivedTelegram(rxTelegram)) return false;
+  data[0] = rxTelegram.comObjectIndex;
+  for (byte i = 0; i < rxTelegram.telegram.GetTelegramLength(); i++) data[1 + i] = rxTelegram.telegram.ReadRawByte(i);
+  WriteRecord(KNX_CAPTURE_RX_TELEGRAM, rxTelegram.timeMicros, data, 1 + rxTelegram.telegram.GetTelegramLength());
+  return true;
+}
+
+
+// The telegram is captured once accepted by the wrapped coupler (i.e. with the source address it will be sent with)
+byte KnxCaptureCoupler::SendTelegram(KnxTelegram& sentTelegram)
+{
+  byte data[KNX_TELEGRAM_MAX_SIZE];
+  unsigned long timeMicros = KnxMicros();
+  byte result = _coupler->SendTelegram(sentTelegram);
+
+  if (result != KNX_BUSCOUPLER_OK) return result;
+  for (byte i = 0; i < sentTelegram.GetTelegramLength(); i++) data[i] = sentTelegram.ReadRawByte(i);
+  WriteRecord(KNX_CAPTURE_TX_TELEGRAM, timeMicros, data, sentTelegram.GetTelegramLength());
+  return result;
+}
+
+
+void KnxCaptureCoupler::WriteRecord(e_KnxCaptureRecordType type, unsigned long timeMicros, const byte data[],
+                                    byte dataLength)
+{
+  byte record[KNX_CAPTURE_RECORD_MAX_SIZE];
+  byte length;
+
+  if (!_enabled) return;
+  length = KnxCaptureBuildRecord(record, type, timeMicros, data, dataLength);
+  if (_sink.Write(record, length)) _recordsNb++;
+  else _lostRecordsNb++;
+}
+
+
+// Static callbacks of the wrapped coupler
+void KnxCaptureCoupler::CaptureEvent(e_KnxBusCouplerEvent event)
+{
+  byte data[2];
+
+  if (!_instance) return;
+  data[0] = event;
+  data[1] = _instance->_coupler->GetStateIndication();
+  // the received telegrams are captured when popped from the RX queue
+  if (event != BUSCOUPLER_EVENT_RECEIVED_EIB_TELEGRAM) _instance->WriteRecord(KNX_CAPTURE_EVENT, KnxMicros(), data, 2);
+  _instance->_evtCallbackFct(event);
+}
+
+
+void KnxCaptureCoupler::CaptureAck(e_BusCouplerTxAck value)
+{
+  byte data = value;
+
+  if (!_instance) return;
+  _instance->WriteRecord(KNX_CAPTURE_TX_ACK, KnxMicros(), &data, 1);
+  _instance->_ackCallbackFct(value);
+}
+
+
+// Called by the RX task of the wrapped coupler at the end of every frame seen on the bus
+void KnxCaptureCoupler::CaptureFrame(const KnxTelegram& frame, byte length, unsigned long timeMicros)
+{
+  byte data[KNX_TELEGRAM_MAX_SIZE];
+
+  if (!_instance) return;
+  if (length > KNX_TELEGRAM_MAX_SIZE) length = KNX_TELEGRAM_MAX_SIZE;
+  for (byte i = 0; i < length; i++) data[i] = frame.ReadRawByte(i);
+  _instance->WriteRecord(KNX_CAPTURE_BUS_FRAME, timeMicros, data, length);
+}
+
+// EOF
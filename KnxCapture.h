@@ -0,0 +1,156 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxCapture.h
+// Author : Franck Marini
+// Description : Capture of the bus traffic seen by the device, for offline analysis and replay
+//               KnxCaptureCoupler is a bus coupler wrapping the real one : everything is forwarded to the wrapped
+//               coupler, and each received telegram (popped from the RX queue), sent telegram, TX acknowledge and
+//               coupler event (reset, reception error, state indication) is appended to a capture sink as a record.
+//               Capture format (append-only, little endian, no padding, can be memory-mapped) :
+//               - header : "KNXCAP" + format version + 0
+//               - records : length (nb of bytes following the length byte), type, time (4 bytes, usec), data
+//                 KNX_CAPTURE_RX_TELEGRAM : com object index + raw telegram, time of the telegram 1st byte
+//                 KNX_CAPTURE_TX_TELEGRAM : raw telegram, time of the SendTelegram() call
+//                 KNX_CAPTURE_TX_ACK : e_BusCouplerTxAck value
+//                 KNX_CAPTURE_EVENT : e_KnxBusCouplerEvent value + bus coupler state indication
+//                 KNX_CAPTURE_BUS_FRAME : raw frame as received (possibly incomplete or invalid), time of the frame 1st
+//                 byte (all frames capture only, see below)
+//               The time is KnxMicros() : it wraps around every 71 minutes (32 bits), a reader shall consider the
+//               time difference between consecutive records as signed (a received telegram record is written when
+//               the telegram is popped, with the older time of its 1st byte), i.e. less than 35 minutes apart.
+//               NB : only the telegrams addressed to the device are received by the coupler, hence captured as
+//               KNX_CAPTURE_RX_TELEGRAM. With the "all frames" option, every frame seen on the bus by the wrapped
+//               coupler is also captured as KNX_CAPTURE_BUS_FRAME at its end (the readers skip the unknown types,
+//               e.g. KnxReplayCoupler ignores these records).
+// Module dependencies : KnxBusCoupler
+
+#ifndef KNXCAPTURE_H
+#define KNXCAPTURE_H
+
+#include "Arduino.h"
+#include "KnxBusCoupler.h"
+
+#define KNX_CAPTURE_VERSION      1
+#define KNX_CAPTURE_HEADER_SIZE  8
+#define KNX_CAPTURE_RECORD_HEADER_SIZE 6 // length, type, time
+#define KNX_CAPTURE_RECORD_MAX_SIZE (KNX_CAPTURE_RECORD_HEADER_SIZE + 1 + KNX_TELEGRAM_MAX_SIZE)
+
+// Capture file header
+extern const byte KnxCaptureHeader[KNX_CAPTURE_HEADER_SIZE];
+
+// Record types
+enum e_KnxCaptureRecordType {
+  KNX_CAPTURE_RX_TELEGRAM = 1,
+  KNX_CAPTURE_TX_TELEGRAM,
+  KNX_CAPTURE_TX_ACK,
+  KNX_CAPTURE_EVENT,
+  KNX_CAPTURE_BUS_FRAME
+};
+
+
+// Storage of the capture records (e.g. a file, a SD card, a RAM buffer)
+class KnxCaptureSink {
+  public:
+    virtual ~KnxCaptureSink() {}
+
+    // Append a record, return false if the record could not be stored
+    virtual boolean Write(const byte record[], byte length) = 0;
+};
+
+
+// Build a record, return its size
+byte KnxCaptureBuildRecord(byte record[], e_KnxCaptureRecordType type, unsigned long timeMicros,
+                           const byte data[], byte dataLength);
+
+
+// Capturing bus coupler
+// The capture coupler takes the ownership of the wrapped coupler (deleted with the capture coupler),
+// it is passed to Knx.begin() instead of the wrapped one.
+// NB : only one capture coupler may exist at a time (the callbacks are static functions)
+class KnxCaptureCoupler : public KnxBusCoupler {
+    static KnxCaptureCoupler *_instance;
+    KnxBusCoupler *_coupler;                  // wrapped coupler
+    KnxCaptureSink& _sink;
+    type_EventCallbackFctPtr _evtCallbackFct; // callbacks of the coupler user
+    type_AckCallbackFctPtr _ackCallbackFct;
+    boolean _enabled;
+    boolean _allFrames;                       // true when the frames seen on the bus are captured
+    unsigned long _recordsNb;                 // nb of records written
+    unsigned long _lostRecordsNb;             // nb of records the sink could not store
+
+  public:
+    // "allFrames" : capture all the frames seen on the bus, addressed to the device or not, if the wrapped coupler
+    // supports it (see IsCapturingAllFrames()). NB : these records are written by the RX task of the wrapped coupler
+    KnxCaptureCoupler(KnxBusCoupler *coupler, KnxCaptureSink& sink, boolean allFrames = false);
+    ~KnxCaptureCoupler();
+
+    // Suspend/resume the capture (enabled by default)
+    void Enable(boolean enabled) { _enabled = enabled; }
+
+    unsigned long GetRecordsNb(void) const { return _recordsNb; }
+    unsigned long GetLostRecordsNb(void) const { return _lostRecordsNb; }
+    KnxBusCoupler* GetWrappedCoupler(void) const { return _coupler; }
+    boolean IsCapturingAllFrames(void) const { return _allFrames; }
+
+    // KnxBusCoupler interface
+    byte SetEvtCallback(type_EventCallbackFctPtr);
+    void SetReceivedTelegram(KnxTelegram &telegram) { _coupler->SetReceivedTelegram(telegram); }
+    byte SetAckCallback(type_AckCallbackFctPtr);
+    byte GetStateIndication(void) const { return _coupler->GetStateIndication(); }
+    KnxTelegram& GetReceivedTelegram(void) { return _coupler->GetReceivedTelegram(); }
+    byte GetTargetedComObjectIndex(void) const { return _coupler->GetTargetedComObjectIndex(); }
+    boolean IsActive(void) const { return _coupler->IsActive(); }
+    boolean PopReceivedTelegram(type_buscoupler_rx_telegram&);
+    word GetRxOverflowsNb(void) const { return _coupler->GetRxOverflowsNb(); }
+#if defined(KNXTPUART_DEBUG_INFO) || defined(KNXTPUART_DEBUG_ERROR)
+    void SetTraceRing(KnxTraceRing *traceRing) { _coupler->SetTraceRing(traceRing); }
+#endif
+    byte Reset(void) { return _coupler->Reset(); }
+    byte AttachComObjectsList(KnxComObject comObjectsList[], byte listSize)
+    { return _coupler->AttachComObjectsList(comObjectsList, listSize); }
+    byte AttachComObjectsList(KnxComObject** comObjectsList, byte listSize)
+    { return _coupler->AttachComObjectsList(comObjectsList, listSize); }
+    byte Init(void) { return _coupler->Init(); }
+    byte SendTelegram(KnxTelegram& sentTelegram);
+    void RXTask(void) { _coupler->RXTask(); }
+    void TXTask(void) { _coupler->TXTask(); }
+    boolean GetMonitoringData(type_MonitorData& data) { return _coupler->GetMonitoringData(data); }
+    word GetMonitoringFrames(type_MonitorFrame frames[], word maxNb) { return _coupler->GetMonitoringFrames(frames, maxNb); }
+    word GetMonitoringOverflowsNb(void) const { return _coupler->GetMonitoringOverflowsNb(); }
+    boolean SetGroupStats(KnxGroupStats *groupStats) { return _coupler->SetGroupStats(groupStats); }
+    boolean SetBusHealth(KnxBusHealth *busHealth) { return _coupler->SetBusHealth(busHealth); }
+    // not available when the capture coupler uses it (all frames capture)
+    boolean SetFrameCallback(type_FrameCallbackFctPtr frameFct) { return !_allFrames && _coupler->SetFrameCallback(frameFct); }
+    boolean GetTxEndMicros(unsigned long& timeMicros) const { return _coupler->GetTxEndMicros(timeMicros); }
+    boolean IsTxBusy(void) const { return _coupler->IsTxBusy(); }
+    void DEBUG_SendResetCommand(void) { _coupler->DEBUG_SendResetCommand(); }
+    void DEBUG_SendStateReqCommand(void) { _coupler->DEBUG_SendStateReqCommand(); }
+
+  private:
+    void WriteRecord(e_KnxCaptureRecordType type, unsigned long timeMicros, const byte data[], byte dataLength);
+    static void CaptureEvent(e_KnxBusCouplerEvent event);
+    static void CaptureAck(e_BusCouplerTxAck value);
+    static void CaptureFrame(const KnxTelegram& frame, byte length, unsigned long timeMicros);
+};
+
+#endif // KNXCAPTURE_H
+
+// EOF
@@ -0,0 +1,76 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxCemi.cpp
+// Author : Franck Marini
+// Description : Conversion between the KnxTelegram (TP1 raw layout) and the cEMI L_Data frames
+// Module dependencies : KnxTelegram
+
+#include "KnxCemi.h"
+
+// TP1 control field "FFR1 PP00" and cEMI control field 1 "FrRB PPAC" share the frame format, repeat
+// and priority bits. The TP1 fixed "1" bit position is the cEMI broadcast bit (1 = normal broadcast).
+#define CTRL_COMMON_MASK (CONTROL_FIELD_STANDARD_FRAME_FORMAT | CONTROL_FIELD_REPEATED_MASK | CONTROL_FIELD_PRIORITY_MASK)
+
+
+byte KnxTelegramToCemi(const KnxTelegram& telegram, byte messageCode, byte cemi[])
+{
+  byte routing = telegram.ReadRawByte(5);
+  byte npduLength = routing & ROUTING_FIELD_PAYLOAD_LENGTH_MASK;
+
+  cemi[0] = messageCode;
+  cemi[1] = 0; // no additional info
+  cemi[2] = (telegram.ReadRawByte(0) & CTRL_COMMON_MASK) | KNX_CEMI_CTRL1_BROADCAST_MASK;
+  cemi[3] = routing & (ROUTING_FIELD_TARGET_ADDRESS_TYPE_MASK | ROUTING_FIELD_COUNTER_MASK);
+  cemi[4] = telegram.ReadRawByte(1);
+  cemi[5] = telegram.ReadRawByte(2);
+  cemi[6] = telegram.ReadRawByte(3);
+  cemi[7] = telegram.ReadRawByte(4);
+  cemi[8] = npduLength;
+  // TPCI/APCI and data : TP1 bytes 6 up to 6 + payload length
+  for (byte i = 0; i <= npduLength; i++) cemi[KNX_CEMI_HEADER_SIZE + i] = telegram.ReadRawByte(KNX_TELEGRAM_HEADER_SIZE + i);
+  return KNX_CEMI_HEADER_SIZE + npduLength + 1;
+}
+
+
+byte KnxCemiToTelegram(const byte cemi[], word length, KnxTelegram& telegram)
+{
+  const byte *frame;
+  byte npduLength;
+
+  if ((length < 2) || (length < (word)cemi[1] + KNX_CEMI_MIN_SIZE)) return KNX_CEMI_ERROR;
+  frame = cemi + cemi[1]; // skip the additional info, frame[2] is then control field 1
+  length -= cemi[1];
+  if ((frame[2] & CONTROL_FIELD_FRAME_FORMAT_MASK) != CONTROL_FIELD_STANDARD_FRAME_FORMAT) return KNX_CEMI_ERROR;
+  npduLength = frame[8];
+  if ((npduLength > KNX_TELEGRAM_PAYLOAD_MAX_SIZE - 1) || (length < (word)KNX_CEMI_HEADER_SIZE + npduLength + 1))
+    return KNX_CEMI_ERROR;
+
+  telegram.WriteRawByte((frame[2] & CTRL_COMMON_MASK) | CONTROL_FIELD_VALID_PATTERN, 0);
+  telegram.WriteRawByte(frame[4], 1);
+  telegram.WriteRawByte(frame[5], 2);
+  telegram.WriteRawByte(frame[6], 3);
+  telegram.WriteRawByte(frame[7], 4);
+  telegram.WriteRawByte((frame[3] & (ROUTING_FIELD_TARGET_ADDRESS_TYPE_MASK | ROUTING_FIELD_COUNTER_MASK)) | npduLength, 5);
+  for (byte i = 0; i <= npduLength; i++) telegram.WriteRawByte(frame[KNX_CEMI_HEADER_SIZE + i], KNX_TELEGRAM_HEADER_SIZE + i);
+  telegram.UpdateChecksum();
+  return KNX_CEMI_OK;
+}
+
+// EOF
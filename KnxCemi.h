@@ -0,0 +1,84 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxCemi.h
+// Author : Franck Marini
+// Description : Conversion between the KnxTelegram (TP1 raw layout) and the cEMI L_Data frames
+//               used by KNXnet/IP (routing, tunneling) and by the cEMI serial interfaces (FT1.2)
+// Module dependencies : KnxTelegram
+
+// ---------- cEMI L_Data frame description (standard frame, no additional info) -----------
+//        Byte 0 | Message code (L_Data.req / L_Data.con / L_Data.ind)
+//        Byte 1 | Additional info length (0)
+//        Byte 2 | Control field 1 "FrR BPPAC" : F = standard frame, r = reserved, R = do not repeat,
+//               |   B = broadcast, PP = priority, A = ACK request, C = confirm (1 = error)
+//        Byte 3 | Control field 2 "TCCC EEEE" : T = target address type, CCC = hop count, EEEE = extended format
+//        Byte 4 | Source Address High byte
+//        Byte 5 | Source Address Low byte
+//        Byte 6 | Destination Address High byte
+//        Byte 7 | Destination Address Low byte
+//        Byte 8 | NPDU length (= TP1 payload length)
+//        Byte 9 | TPCI / APCI high (= TP1 byte 6)
+//        Byte 10 up to 24 | APCI low + data (= TP1 bytes 7 to 21)
+// The TP1 checksum is not part of the cEMI frame.
+
+#ifndef KNXCEMI_H
+#define KNXCEMI_H
+
+#include "Arduino.h"
+#include "KnxTelegram.h"
+
+// cEMI message codes
+#define KNX_CEMI_L_DATA_REQ  0x11
+#define KNX_CEMI_L_DATA_CON  0x2E
+#define KNX_CEMI_L_DATA_IND  0x29
+#define KNX_CEMI_M_PROPWRITE_REQ 0xF6
+#define KNX_CEMI_M_PROPWRITE_CON 0xF5
+#define KNX_CEMI_M_RESET_IND     0xF0
+
+// cEMI server object communication mode property (M_PropWrite, interface object 8, instance 1, PID 52)
+#define KNX_CEMI_SERVER_OBJECT_TYPE   0x0008
+#define KNX_CEMI_PID_COMM_MODE        52
+#define KNX_CEMI_COMM_MODE_LINK_LAYER 0x00
+#define KNX_CEMI_COMM_MODE_BUSMONITOR 0x01
+
+// cEMI control field 1 masks
+#define KNX_CEMI_CTRL1_CONFIRM_ERROR_MASK 0x01
+#define KNX_CEMI_CTRL1_ACK_REQUEST_MASK   0x02
+#define KNX_CEMI_CTRL1_BROADCAST_MASK     0x10
+
+#define KNX_CEMI_HEADER_SIZE    9  // Message code up to NPDU length
+#define KNX_CEMI_MIN_SIZE      11  // Header + TPCI/APCI (2 bytes)
+#define KNX_CEMI_MAX_SIZE      (KNX_CEMI_HEADER_SIZE + KNX_TELEGRAM_PAYLOAD_MAX_SIZE)
+
+// Values returned by the cEMI conversion functions :
+#define KNX_CEMI_OK      0
+#define KNX_CEMI_ERROR 255
+
+// Write the cEMI L_Data frame of a telegram with the given message code
+// The frame is written directly into "cemi" (KNX_CEMI_MAX_SIZE bytes max)
+// return the frame length
+byte KnxTelegramToCemi(const KnxTelegram& telegram, byte messageCode, byte cemi[]);
+
+// Read a cEMI L_Data frame (any message code) into a telegram, the TP1 checksum is computed
+// The additional info, if any, is skipped
+// return KNX_CEMI_ERROR if the frame is not a valid standard L_Data frame, else KNX_CEMI_OK
+byte KnxCemiToTelegram(const byte cemi[], word length, KnxTelegram& telegram);
+
+#endif // KNXCEMI_H
@@ -0,0 +1,106 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxClock.h
+// Author : Franck Marini
+// Description : Time source of the library
+//               All the library timings read the time through KnxMillis() and KnxMicros(). By default they are
+//               the Arduino millis() and micros(). A test or a simulation can install another clock with
+//               KnxSetClock(), e.g. a KnxVirtualClock advanced explicitly, so that the timings are deterministic
+//               and the simulated time runs faster than the real time.
+// Module dependencies : none
+
+#ifndef KNXCLOCK_H
+#define KNXCLOCK_H
+
+#include "Arduino.h"
+
+class KnxClock {
+  public:
+    virtual ~KnxClock() {}
+
+    // Same units and type as the Arduino millis() and micros()
+    virtual unsigned long Millis(void) = 0;
+    virtual unsigned long Micros(void) = 0;
+};
+
+
+// Clock that only moves when advanced by its owner
+// Optionally, every time read moves the clock forward by a few usec, so that a code waiting in a loop for a time
+// or an event (e.g. a reset answer) makes progress
+class KnxVirtualClock : public KnxClock {
+    unsigned long long _timeMicros;
+    unsigned long _readStepMicros; // time step of every read (0 by default)
+
+  public:
+    KnxVirtualClock(unsigned long long startMicros = 0) : _timeMicros(startMicros), _readStepMicros(0) {}
+
+  // INLINED functions (see definitions later in this file)
+    unsigned long Millis(void);
+    unsigned long Micros(void);
+
+    // Get/set the time (in usec)
+    unsigned long long GetTime(void) const;
+    void SetTime(unsigned long long timeMicros);
+
+    // Move the time forward
+    void Advance(unsigned long durationMicros);
+    void AdvanceMillis(unsigned long durationMillis);
+
+    // Set the time step of every time read
+    void SetReadStep(unsigned long stepMicros);
+};
+
+
+// Clock in use, NULL for the Arduino millis() and micros()
+extern KnxClock *KnxActiveClock;
+
+// Install a clock (NULL to get back to the Arduino time)
+// NB : the clock shall be installed before Knx.begin(), changing the time source on the run would
+// disturb the timings in progress
+void KnxSetClock(KnxClock *clock);
+
+// Time reads of the library
+unsigned long KnxMillis(void);
+unsigned long KnxMicros(void);
+
+
+// --------------- Definition of the INLINED functions -----------------
+inline unsigned long KnxVirtualClock::Millis(void) { _timeMicros += _readStepMicros; return (unsigned long)(_timeMicros / 1000); }
+
+inline unsigned long KnxVirtualClock::Micros(void) { _timeMicros += _readStepMicros; return (unsigned long)_timeMicros; }
+
+inline unsigned long long KnxVirtualClock::GetTime(void) const { return _timeMicros; }
+
+inline void KnxVirtualClock::SetTime(unsigned long long timeMicros) { _timeMicros = timeMicros; }
+
+inline void KnxVirtualClock::Advance(unsigned long durationMicros) { _timeMicros += durationMicros; }
+
+inline void KnxVirtualClock::AdvanceMillis(unsigned long durationMillis) { _timeMicros += (unsigned long long)durationMillis * 1000; }
+
+inline void KnxVirtualClock::SetReadStep(unsigned long stepMicros) { _readStepMicros = stepMicros; }
+
+inline void KnxSetClock(KnxClock *clock) { KnxActiveClock = clock; }
+
+inline unsigned long KnxMillis(void) { return KnxActiveClock ? KnxActiveClock->Millis() : millis(); }
+
+inline unsigned long KnxMicros(void) { return KnxActiveClock ? KnxActiveClock->Micros() : micros(); }
+
+#endif // KNXCLOCK_H
@@ -126,9 +126,7 @@ byte length = GetLength();
 	else 
         {
 		str+="\nLongValue=";
-		byte *longValue = (byte *) malloc(length- 1);
-                GetValue(longValue);
-		for (byte i = 0; i < length-1; i++) str+=String(longValue[i], HEX)+' ';
+		for (byte i = 0; i < length-1; i++) str+=String(_longValue[i], HEX)+' ';
 	}
 }
 
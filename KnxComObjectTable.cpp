@@ -0,0 +1,141 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxComObjectTable.cpp
+// Author : Franck Marini
+// Description : Table of the com objects attached to a bus coupler, ordered by group address
+// Module dependencies : KnxComObject, KnxTraceRing
+
+#include "KnxComObjectTable.h"
+
+KnxComObjectTable::KnxComObjectTable()
+: _comObjectsList(NULL), _ownedList(NULL), _assignedComObjectsNb(0), _orderedIndexTable(NULL) {}
+
+
+KnxComObjectTable::~KnxComObjectTable() { Detach(); }
+
+
+// Attach an array of com objects : the table is built on a list of pointers to the array items
+void KnxComObjectTable::Attach(KnxComObject comObjectsList[], byte listSize, KnxTraceRing *traceRing)
+{
+  KnxComObject **pointersList = NULL;
+
+  if (comObjectsList && listSize)
+  {
+    pointersList = (KnxComObject **) malloc(listSize * sizeof(KnxComObject *));
+    if (!pointersList) listSize = 0; // considered as an empty list
+    for (byte i = 0; i < listSize; i++) pointersList[i] = &comObjectsList[i];
+  }
+  Attach(pointersList, listSize, traceRing);
+  _ownedList = pointersList; // NB : set after the attachment which detaches the previous list
+}
+
+
+void KnxComObjectTable::Attach(KnxComObject** comObjectsList, byte listSize, KnxTraceRing *traceRing)
+{
+#define IS_COM(index) (comObjectsList[index]->GetIndicator() & KNX_COM_OBJ_C_INDICATOR)
+#define ADDR(index) (comObjectsList[index]->GetAddr())
+
+  Detach();
+  if ((!comObjectsList) || (!listSize))
+  {
+    if (traceRing) traceRing->Record(KNX_TRACE_COUPLER_ATTACH_EMPTY_LIST);
+    return;
+  }
+  // Count all the com objects with communication indicator
+  for (byte i=0; i < listSize ; i++) if (IS_COM(i)) _assignedComObjectsNb++;
+  if (!_assignedComObjectsNb)
+  {
+    if (traceRing) traceRing->Record(KNX_TRACE_COUPLER_ATTACH_NO_COM_OBJECT);
+    return;
+  }
+  // Deduct the duplicate addresses
+  for (byte i=0; i < listSize ; i++)
+  {
+    if (!IS_COM(i)) continue;
+    for (byte j=0; j < listSize ; j++)
+    {
+      if ( (i!=j) && (ADDR(j) == ADDR(i)) && (IS_COM(j)) )
+      { // duplicate address found
+        if (j<i) break; // duplicate address already treated
+        else
+        {
+          _assignedComObjectsNb--;
+          if (traceRing) traceRing->Record(KNX_TRACE_COUPLER_ATTACH_DUPLICATE, ADDR(i));
+        }
+      }
+    }
+  }
+  // Creation of the ordered index table
+  _orderedIndexTable = (byte*) malloc(_assignedComObjectsNb);
+  if (!_orderedIndexTable) { _assignedComObjectsNb = 0; return; }
+  _comObjectsList = comObjectsList;
+  word minMin = 0x0000;   // minimum min value searched
+  word foundMin = 0xFFFF; // min value found so far
+  for (byte i=0; i < _assignedComObjectsNb; i++)
+  { // NB : in case of identical addresses, the object with highest index is the last found
+    for (byte j=0; j < listSize ; j++)
+    {
+      if ( (IS_COM(j)) && (ADDR(j)>=minMin) && (ADDR(j)<=foundMin) )
+      {
+        foundMin = ADDR(j);
+        _orderedIndexTable[i] = j;
+      }
+    }
+    minMin = foundMin + 1;
+    foundMin = 0xFFFF;
+  }
+  if (traceRing) traceRing->Record(KNX_TRACE_COUPLER_ATTACH_OK, _assignedComObjectsNb);
+}
+
+
+void KnxComObjectTable::Detach(void)
+{
+  if (_orderedIndexTable) free(_orderedIndexTable);
+  if (_ownedList) free(_ownedList);
+  _orderedIndexTable = NULL;
+  _ownedList = NULL;
+  _comObjectsList = NULL;
+  _assignedComObjectsNb = 0;
+}
+
+
+// Binary search of the address in the ordered index table
+boolean KnxComObjectTable::IsAddressAssigned(word addr, byte &index) const
+{
+  byte first = 0, last = _assignedComObjectsNb; // the address is searched in [first, last[
+  byte middle;
+  word middleAddr;
+
+  while (first < last)
+  {
+    middle = (first + last) >> 1;
+    middleAddr = _comObjectsList[_orderedIndexTable[middle]]->GetAddr();
+    if (middleAddr == addr)
+    { // Address is part of the assigned addresses
+      index = _orderedIndexTable[middle];
+      return true;
+    }
+    if (middleAddr < addr) first = middle + 1;
+    else last = middle;
+  }
+  return false; // Address is NOT part of the assigned addresses
+}
+
+// EOF
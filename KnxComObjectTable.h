@@ -0,0 +1,69 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxComObjectTable.h
+// Author : Franck Marini
+// Description : Table of the com objects attached to a bus coupler, ordered by group address
+//               Only the objects with "communication" attribute are considered. In case of objects with identical
+//               address, the object with highest index only is considered.
+//               The bus coupler RX task looks the target address of each received telegram up with a binary search.
+// Module dependencies : KnxComObject, KnxTraceRing
+
+#ifndef KNXCOMOBJECTTABLE_H
+#define KNXCOMOBJECTTABLE_H
+
+#include "Arduino.h"
+#include "KnxComObject.h"
+#include "KnxTraceRing.h"
+
+class KnxComObjectTable {
+    KnxComObject **_comObjectsList;   // Attached list of com objects
+    KnxComObject **_ownedList;        // List of pointers allocated for an attached array of com objects (else NULL)
+    byte _assignedComObjectsNb;       // Nb of assigned com objects
+    byte *_orderedIndexTable;         // Table containing the assigned com objects indexes ordered by increasing @
+
+  public:
+    KnxComObjectTable();
+    ~KnxComObjectTable();
+
+    // Attach a list of com objects (array of objects or array of pointers), the list previously attached is detached
+    // The attach events are recorded in the trace ring if any (KNX_TRACE_COUPLER_ATTACH_xxx)
+    void Attach(KnxComObject comObjectsList[], byte listSize, KnxTraceRing *traceRing = NULL);
+    void Attach(KnxComObject** comObjectsList, byte listSize, KnxTraceRing *traceRing = NULL);
+
+    // Detach the list of com objects
+    void Detach(void);
+
+    // Check if the target address points to an assigned com object (i.e. the target address equals a com object address)
+    // if yes, then update index parameter with the index (in the list) of the targeted com object and return true
+    // else return false
+    boolean IsAddressAssigned(word addr, byte &index) const;
+
+  // INLINED functions (see definitions later in this file)
+    // Nb of com objects with communication attribute and distinct addresses
+    byte GetAssignedNb(void) const;
+};
+
+
+// --------------- Definition of the INLINED functions -----------------
+inline byte KnxComObjectTable::GetAssignedNb(void) const { return _assignedComObjectsNb; }
+
+#endif // KNXCOMOBJECTTABLE_H
+
+// EOF
@@ -130,7 +130,7 @@ const byte KnxDPTFormatToLengthBit[] PROGMEM = {
  112, //  KNX_DPT_FORMAT_A112,
   8 , //  KNX_DPT_FORMAT_R2U6, 
   8 , //  KNX_DPT_FORMAT_B1R1U6,
-  56, //  KNX_DPT_FORMAT_U8R4U4R3U5U3U5R2U6B16,
+  64, //  KNX_DPT_FORMAT_U8R4U4R3U5U3U5R2U6B16, (DPT 19.001 : the seconds R2U6 field is not in the name)
   8 , //  KNX_DPT_FORMAT_N8,
   8 , //  KNX_DPT_FORMAT_B8,
   16, //  KNX_DPT_FORMAT_B16,
@@ -142,7 +142,7 @@ const byte KnxDPTFormatToLengthBit[] PROGMEM = {
   64, //  KNX_DPT_FORMAT_V64,
   24, //  KNX_DPT_FORMAT_B24,
   3 , //  KNX_DPT_FORMAT_N3,
-  2 , //  KNX_DPT_FORMAT_B1Z8,
+  16, //  KNX_DPT_FORMAT_B1Z8,
   16, //  KNX_DPT_FORMAT_N8Z8,
   16, //  KNX_DPT_FORMAT_U8Z8,
   24, //  KNX_DPT_FORMAT_U16Z8,
@@ -169,7 +169,7 @@ const byte KnxDPTFormatToLengthBit[] PROGMEM = {
   24, //  KNX_DPT_FORMAT_U16U8,
   48, //  KNX_DPT_FORMAT_V32N8Z8,
   64, //  KNX_DPT_FORMAT_U16U32U8N8,
-  24, //  KNX_DPT_FORMAT_A8A8A8A8,
+  32, //  KNX_DPT_FORMAT_A8A8A8A8,
   24, //  KNX_DPT_FORMAT_U8U8U8,
   16 //  KNX_DPT_FORMAT_A8A8
 };
@@ -0,0 +1,430 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+
+// File : KnxDPTCodec.cpp
+// Author : Franck Marini
+// Description : Table driven encoding/decoding of the KNX Datapoint values
+// Module dependencies : KnxDPT
+
+#include "KnxDPTCodec.h"
+
+#define F_U   KNX_DPT_FIELD_U
+#define F_V   KNX_DPT_FIELD_V
+#define F_F16 KNX_DPT_FIELD_F16
+#define F_F32 KNX_DPT_FIELD_F32
+
+// Layout of the fields of all the DPT formats : bit offset, bit width, field type
+// NB : table is stored in flash program memory to save RAM
+const byte KnxDPTFormatFields[] PROGMEM = {
+  7,1,F_U, // B1
+  6,1,F_U, 7,1,F_U, // B2
+  4,1,F_U, 5,3,F_U, // B1U3
+  0,8,F_U, // A8
+  0,8,F_U, // U8
+  0,8,F_V, // V8
+  0,5,F_U, 5,3,F_U, // B5N3
+  0,16,F_U, // U16
+  0,16,F_V, // V16
+  0,16,F_F16, // F16
+  0,3,F_U, 3,5,F_U, 10,6,F_U, 18,6,F_U, // N3N5R2N6R2N6
+  3,5,F_U, 12,4,F_U, 17,7,F_U, // R3N5R4N4R1U7
+  0,32,F_U, // U32
+  0,32,F_V, // V32
+  0,32,F_F32, // F32
+  0,4,F_U, 4,4,F_U, 8,4,F_U, 12,4,F_U, 16,4,F_U, 20,4,F_U, 24,4,F_U, 28,4,F_U, // U4U4U4U4U4U4B4N4
+  0,8,F_U, 8,8,F_U, 16,8,F_U, 24,8,F_U, 32,8,F_U, 40,8,F_U, 48,8,F_U, 56,8,F_U, 64,8,F_U, 72,8,F_U, 80,8,F_U, 88,8,F_U, 96,8,F_U, 104,8,F_U, // A112
+  2,6,F_U, // R2U6
+  0,1,F_U, 2,6,F_U, // B1R1U6
+  0,8,F_U, 12,4,F_U, 19,5,F_U, 24,3,F_U, 27,5,F_U, 34,6,F_U, 42,6,F_U, 48,16,F_U, // U8R4U4R3U5U3U5R2U6R2U6B16 (DPT 19)
+  0,8,F_U, // N8
+  0,8,F_U, // B8
+  0,16,F_U, // B16
+  6,2,F_U, // N2
+  0,8,F_U, 8,8,F_U, 16,8,F_U, 24,8,F_U, 32,8,F_U, 40,8,F_U, 48,8,F_U, 56,8,F_U, 64,8,F_U, 72,8,F_U, 80,8,F_U, 88,8,F_U, 96,8,F_U, 104,8,F_U, // AN
+  0,4,F_U, 4,4,F_U, // U4U4
+  1,1,F_U, 2,6,F_U, // R1B1U6
+  0,32,F_U, // B32
+  0,32,F_V, 32,32,F_U, // V64
+  0,24,F_U, // B24
+  5,3,F_U, // N3
+  7,1,F_U, 8,8,F_U, // B1Z8
+  0,8,F_U, 8,8,F_U, // N8Z8
+  0,8,F_U, 8,8,F_U, // U8Z8
+  0,16,F_U, 16,8,F_U, // U16Z8
+  0,8,F_V, 8,8,F_U, // V8Z8
+  0,16,F_V, 16,8,F_U, // V16Z8
+  0,16,F_U, 16,8,F_U, // U16N8
+  0,8,F_U, 8,8,F_U, // U8B8
+  0,16,F_V, 16,8,F_U, // V16B8
+  0,16,F_V, 16,16,F_U, // V16B16
+  0,8,F_U, 8,8,F_U, // U8N8
+  0,16,F_V, 16,16,F_V, 32,16,F_V, // V16V16V16
+  0,16,F_V, 16,16,F_V, 32,16,F_V, 48,16,F_V, // V16V16V16V16
+  0,16,F_V, 16,8,F_U, 24,8,F_U, // V16U8B8
+  0,16,F_V, 16,8,F_U, 24,16,F_U, // V16U8B16
+  0,16,F_U, 16,8,F_U, 24,8,F_U, 32,8,F_U, 40,8,F_U, // U16U8N8N8P8
+  0,5,F_U, 5,5,F_U, 10,6,F_U, // U5U5U16
+  0,32,F_V, 32,8,F_U, // V32Z8
+  0,8,F_U, 8,8,F_U, 16,8,F_U, 24,8,F_U, 32,8,F_U, 40,8,F_U, // U8N8N8N8B8B8
+  0,16,F_U, 16,16,F_V, // U16V16
+  0,16,F_U, 16,32,F_U, // N16U32
+  0,16,F_F16, 16,16,F_F16, 32,16,F_F16, // F16F16F16
+  0,8,F_V, 8,8,F_U, 16,8,F_U, // V8N8N8
+  0,16,F_V, 16,16,F_V, 32,8,F_U, 40,8,F_U, // V16V16N8N8
+  0,16,F_U, 16,8,F_U, // U16U8
+  0,32,F_V, 32,8,F_U, 40,8,F_U, // V32N8Z8
+  0,16,F_U, 16,32,F_U, 48,8,F_U, 56,8,F_U, // U16U32U8N8
+  0,8,F_U, 8,8,F_U, 16,8,F_U, 24,8,F_U, // A8A8A8A8
+  0,8,F_U, 8,8,F_U, 16,8,F_U, // U8U8U8
+  0,8,F_U, 8,8,F_U, // A8A8
+};
+
+// Index of the first field in KnxDPTFormatFields table (in fields nb), and nb of fields, according to the format
+// NB : table is stored in flash program memory to save RAM
+const byte KnxDPTFormatToFields[] PROGMEM = {
+    0,  1, //  KNX_DPT_FORMAT_B1
+    1,  2, //  KNX_DPT_FORMAT_B2
+    3,  2, //  KNX_DPT_FORMAT_B1U3
+    5,  1, //  KNX_DPT_FORMAT_A8
+    6,  1, //  KNX_DPT_FORMAT_U8
+    7,  1, //  KNX_DPT_FORMAT_V8
+    8,  2, //  KNX_DPT_FORMAT_B5N3
+   10,  1, //  KNX_DPT_FORMAT_U16
+   11,  1, //  KNX_DPT_FORMAT_V16
+   12,  1, //  KNX_DPT_FORMAT_F16
+   13,  4, //  KNX_DPT_FORMAT_N3N5R2N6R2N6
+   17,  3, //  KNX_DPT_FORMAT_R3N5R4N4R1U7
+   20,  1, //  KNX_DPT_FORMAT_U32
+   21,  1, //  KNX_DPT_FORMAT_V32
+   22,  1, //  KNX_DPT_FORMAT_F32
+   23,  8, //  KNX_DPT_FORMAT_U4U4U4U4U4U4B4N4
+   31, 14, //  KNX_DPT_FORMAT_A112
+   45,  1, //  KNX_DPT_FORMAT_R2U6
+   46,  2, //  KNX_DPT_FORMAT_B1R1U6
+   48,  8, //  KNX_DPT_FORMAT_U8R4U4R3U5U3U5R2U6B16
+   56,  1, //  KNX_DPT_FORMAT_N8
+   57,  1, //  KNX_DPT_FORMAT_B8
+   58,  1, //  KNX_DPT_FORMAT_B16
+   59,  1, //  KNX_DPT_FORMAT_N2
+   60, 14, //  KNX_DPT_FORMAT_AN
+   74,  2, //  KNX_DPT_FORMAT_U4U4
+   76,  2, //  KNX_DPT_FORMAT_R1B1U6
+   78,  1, //  KNX_DPT_FORMAT_B32
+   79,  2, //  KNX_DPT_FORMAT_V64
+   81,  1, //  KNX_DPT_FORMAT_B24
+   82,  1, //  KNX_DPT_FORMAT_N3
+   83,  2, //  KNX_DPT_FORMAT_B1Z8
+   85,  2, //  KNX_DPT_FORMAT_N8Z8
+   87,  2, //  KNX_DPT_FORMAT_U8Z8
+   89,  2, //  KNX_DPT_FORMAT_U16Z8
+   91,  2, //  KNX_DPT_FORMAT_V8Z8
+   93,  2, //  KNX_DPT_FORMAT_V16Z8
+   95,  2, //  KNX_DPT_FORMAT_U16N8
+   97,  2, //  KNX_DPT_FORMAT_U8B8
+   99,  2, //  KNX_DPT_FORMAT_V16B8
+  101,  2, //  KNX_DPT_FORMAT_V16B16
+  103,  2, //  KNX_DPT_FORMAT_U8N8
+  105,  3, //  KNX_DPT_FORMAT_V16V16V16
+  108,  4, //  KNX_DPT_FORMAT_V16V16V16V16
+  112,  3, //  KNX_DPT_FORMAT_V16U8B8
+  115,  3, //  KNX_DPT_FORMAT_V16U8B16
+  118,  5, //  KNX_DPT_FORMAT_U16U8N8N8P8
+  123,  3, //  KNX_DPT_FORMAT_U5U5U16
+  126,  2, //  KNX_DPT_FORMAT_V32Z8
+  128,  6, //  KNX_DPT_FORMAT_U8N8N8N8B8B8
+  134,  2, //  KNX_DPT_FORMAT_U16V16
+  136,  2, //  KNX_DPT_FORMAT_N16U32
+  138,  3, //  KNX_DPT_FORMAT_F16F16F16
+  141,  3, //  KNX_DPT_FORMAT_V8N8N8
+  144,  4, //  KNX_DPT_FORMAT_V16V16N8N8
+  148,  2, //  KNX_DPT_FORMAT_U16U8
+  150,  3, //  KNX_DPT_FORMAT_V32N8Z8
+  153,  4, //  KNX_DPT_FORMAT_U16U32U8N8
+  157,  4, //  KNX_DPT_FORMAT_A8A8A8A8
+  161,  3, //  KNX_DPT_FORMAT_U8U8U8
+  164,  2, //  KNX_DPT_FORMAT_A8A8
+};
+
+#define KNX_DPT_FORMATS_NB (sizeof(KnxDPTFormatToFields) / 2)
+
+
+// Extract a field (up to 32 bits) from a DPT value
+static unsigned long ExtractField(const byte dpt[], byte offset, byte width)
+{
+  byte lastByte = (offset + width - 1) >> 3;
+  unsigned long value = 0;
+
+  for (byte i = offset >> 3; i <= lastByte; i++) value = (value << 8) | dpt[i];
+  value >>= ((lastByte + 1) << 3) - offset - width; // right align the field
+  if (width < 32) value &= (1UL << width) - 1;
+  return value;
+}
+
+
+// Insert a field (up to 32 bits) into a DPT value, the other bits are kept unchanged
+static void InsertField(byte dpt[], byte offset, byte width, unsigned long value)
+{
+  byte i = (offset + width - 1) >> 3; // start with the byte containing the field LSB
+  byte shift = ((i + 1) << 3) - offset - width; // position of the field LSB in that byte
+  unsigned long mask = (width < 32) ? ((1UL << width) - 1) : 0xFFFFFFFF;
+
+  value &= mask;
+  while (mask)
+  {
+    byte byteMask = (byte)(mask << shift);
+    dpt[i] = (dpt[i] & ~byteMask) | ((byte)(value << shift) & byteMask);
+    mask >>= 8 - shift; value >>= 8 - shift;
+    shift = 0; i--;
+  }
+}
+
+
+// Get the fields layout of a DPT format
+// return NULL in case of unknown format
+static const byte* GetFields(byte dptFormat, byte& fieldsNb)
+{
+  if (dptFormat >= KNX_DPT_FORMATS_NB) return NULL;
+  fieldsNb = pgm_read_byte(&KnxDPTFormatToFields[2*dptFormat+1]);
+  return &KnxDPTFormatFields[3 * pgm_read_byte(&KnxDPTFormatToFields[2*dptFormat])];
+}
+
+
+static float F16ToFloat(word raw)
+{
+  // value = 0.01 * mantissa * 2^exponent, with mantissa being a 12 bits 2's complement value (sign + 11 bits)
+  long mantissa = raw & 0x07FF;
+  if (raw & 0x8000) mantissa -= 2048;
+  return 0.01 * (mantissa * (1L << ((raw >> 11) & 0x0F)));
+}
+
+
+static float F32ToFloat(unsigned long raw)
+{
+  union { unsigned long raw; float value; } f32;
+  f32.raw = raw;
+  return f32.value;
+}
+
+
+static unsigned long FloatToF32(float value)
+{
+  union { unsigned long raw; float value; } f32;
+  f32.value = value;
+  return f32.raw;
+}
+
+
+byte KnxDptFieldsNb(byte dptFormat)
+{
+  byte fieldsNb = 0;
+  GetFields(dptFormat, fieldsNb);
+  return fieldsNb;
+}
+
+
+byte KnxDptLength(byte dptFormat)
+{
+  if (dptFormat >= KNX_DPT_FORMATS_NB) return 0;
+  return (pgm_read_byte(&KnxDPTFormatToLengthBit[dptFormat]) + 7) >> 3;
+}
+
+
+byte KnxDptFieldType(byte dptFormat, byte fieldIndex)
+{
+  byte fieldsNb = 0;
+  const byte *field = GetFields(dptFormat, fieldsNb);
+  if (fieldIndex >= fieldsNb) return KNX_DPT_CODEC_ERROR;
+  return pgm_read_byte(field + 3 * fieldIndex + 2);
+}
+
+
+byte KnxDptDecode(const byte dpt[], byte dptFormat, long fields[])
+{
+  byte fieldsNb;
+  const byte *field = GetFields(dptFormat, fieldsNb);
+  if (!field) return KNX_DPT_CODEC_ERROR;
+
+  for (byte i = 0; i < fieldsNb; i++, field += 3)
+  {
+    byte width = pgm_read_byte(field + 1);
+    unsigned long value = ExtractField(dpt, pgm_read_byte(field), width);
+    // sign extension of the 2's complement values
+    if ((pgm_read_byte(field + 2) == KNX_DPT_FIELD_V) && (width < 32) && (value & (1UL << (width - 1))))
+      value |= ~((1UL << width) - 1);
+    fields[i] = (long)value;
+  }
+  return KNX_DPT_CODEC_OK;
+}
+
+
+byte KnxDptDecode(const byte dpt[], byte dptFormat, float fields[])
+{
+  long rawFields[KNX_DPT_FIELDS_MAX_NB];
+  byte fieldsNb;
+  const byte *field = GetFields(dptFormat, fieldsNb);
+  if (!field) return KNX_DPT_CODEC_ERROR;
+
+  KnxDptDecode(dpt, dptFormat, rawFields);
+  for (byte i = 0; i < fieldsNb; i++, field += 3)
+  {
+    switch (pgm_read_byte(field + 2))
+    {
+      case KNX_DPT_FIELD_U : fields[i] = (unsigned long)rawFields[i]; break;
+      case KNX_DPT_FIELD_F16 : fields[i] = F16ToFloat((word)rawFields[i]); break;
+      case KNX_DPT_FIELD_F32 : fields[i] = F32ToFloat((unsigned long)rawFields[i]); break;
+      default : fields[i] = rawFields[i]; break;
+    }
+  }
+  return KNX_DPT_CODEC_OK;
+}
+
+
+byte KnxDptEncode(const long fields[], byte dptFormat, byte dpt[])
+{
+  byte fieldsNb;
+  const byte *field = GetFields(dptFormat, fieldsNb);
+  if (!field) return KNX_DPT_CODEC_ERROR;
+
+  memset(dpt, 0, KnxDptLength(dptFormat)); // reserved bits are set to 0
+  for (byte i = 0; i < fieldsNb; i++, field += 3)
+    InsertField(dpt, pgm_read_byte(field), pgm_read_byte(field + 1), (unsigned long)fields[i]);
+  return KNX_DPT_CODEC_OK;
+}
+
+
+byte KnxDptEncode(const float fields[], byte dptFormat, byte dpt[])
+{
+  long rawFields[KNX_DPT_FIELDS_MAX_NB];
+  byte f16[2];
+  byte fieldsNb;
+  const byte *field = GetFields(dptFormat, fieldsNb);
+  if (!field) return KNX_DPT_CODEC_ERROR;
+
+  for (byte i = 0; i < fieldsNb; i++, field += 3)
+  {
+    switch (pgm_read_byte(field + 2))
+    {
+      case KNX_DPT_FIELD_U : rawFields[i] = (long)(unsigned long)fields[i]; break;
+      case KNX_DPT_FIELD_F16 :
+        KnxDptEncodeF16((long)(100.0 * fields[i]), f16);
+        rawFields[i] = ((word)f16[0] << 8) | f16[1];
+        break;
+      case KNX_DPT_FIELD_F32 : rawFields[i] = (long)FloatToF32(fields[i]); break;
+      default : rawFields[i] = (long)fields[i]; break;
+    }
+  }
+  return KnxDptEncode(rawFields, dptFormat, dpt);
+}
+
+
+float KnxDptDecodeF16(const byte dpt[]) { return F16ToFloat(((word)dpt[0] << 8) | dpt[1]); }
+
+
+// Encode a value (multiplied by 100) into a F16 DPT
+void KnxDptEncodeF16(long longValuex100, byte dpt[])
+{
+  boolean negativeSign = (longValuex100 & 0x80000000)? true : false;
+  byte exponent = 0;
+  byte round = 0;
+
+  if (negativeSign)
+  {
+    while(longValuex100 < (long)(-2048))
+    {
+       exponent++; round = (byte)(longValuex100) & 1 ; longValuex100>>=1; longValuex100|=0x80000000;
+    }
+  }
+  else
+  {
+    while(longValuex100 > (long)(2047))
+    {
+      exponent++; round = (byte)(longValuex100) & 1 ; longValuex100>>=1;
+    }
+
+  }
+  if (round) longValuex100++;
+  dpt[1] = (byte)longValuex100;
+  dpt[0] = (byte)(longValuex100>>8) & 0x7 ;
+  dpt[0] += exponent<<3;
+  if (negativeSign) dpt[0] += 0x80;
+}
+
+
+float KnxDptDecodeF32(const byte dpt[]) { return F32ToFloat(ExtractField(dpt, 0, 32)); }
+
+void KnxDptEncodeF32(float value, byte dpt[]) { InsertField(dpt, 0, 32, FloatToF32(value)); }
+
+
+byte KnxDptDecodeTimeOfDay(const byte dpt[], type_KnxTimeOfDay& time)
+{
+  long fields[4];
+  KnxDptDecode(dpt, KNX_DPT_FORMAT_N3N5R2N6R2N6, fields);
+  time.weekDay = fields[0]; time.hour = fields[1]; time.minute = fields[2]; time.second = fields[3];
+  if ((time.hour > 23) || (time.minute > 59) || (time.second > 59)) return KNX_DPT_CODEC_ERROR;
+  return KNX_DPT_CODEC_OK;
+}
+
+
+byte KnxDptEncodeTimeOfDay(const type_KnxTimeOfDay& time, byte dpt[])
+{
+  if ((time.weekDay > 7) || (time.hour > 23) || (time.minute > 59) || (time.second > 59)) return KNX_DPT_CODEC_ERROR;
+  long fields[4] = { time.weekDay, time.hour, time.minute, time.second };
+  return KnxDptEncode(fields, KNX_DPT_FORMAT_N3N5R2N6R2N6, dpt);
+}
+
+
+// DPT 11.001 year field : 90..99 means 1990..1999, 0..89 means 2000..2089
+byte KnxDptDecodeDate(const byte dpt[], type_KnxDate& date)
+{
+  long fields[3];
+  KnxDptDecode(dpt, KNX_DPT_FORMAT_R3N5R4N4R1U7, fields);
+  date.day = fields[0]; date.month = fields[1];
+  date.year = (fields[2] >= 90) ? 1900 + fields[2] : 2000 + fields[2];
+  if ((!date.day) || (!date.month) || (date.month > 12) || (fields[2] > 99)) return KNX_DPT_CODEC_ERROR;
+  return KNX_DPT_CODEC_OK;
+}
+
+
+byte KnxDptEncodeDate(const type_KnxDate& date, byte dpt[])
+{
+  if ((!date.day) || (date.day > 31) || (!date.month) || (date.month > 12) || (date.year < 1990) || (date.year > 2089))
+    return KNX_DPT_CODEC_ERROR;
+  long fields[3] = { date.day, date.month, date.year % 100 };
+  return KnxDptEncode(fields, KNX_DPT_FORMAT_R3N5R4N4R1U7, dpt);
+}
+
+
+byte KnxDptDecodeColorRGB(const byte dpt[], type_KnxColorRGB& color)
+{
+  long fields[3];
+  KnxDptDecode(dpt, KNX_DPT_FORMAT_U8U8U8, fields);
+  color.red = fields[0]; color.green = fields[1]; color.blue = fields[2];
+  return KNX_DPT_CODEC_OK;
+}
+
+
+byte KnxDptEncodeColorRGB(const type_KnxColorRGB& color, byte dpt[])
+{
+  long fields[3] = { color.red, color.green, color.blue };
+  return KnxDptEncode(fields, KNX_DPT_FORMAT_U8U8U8, dpt);
+}
+
+// EOF
@@ -0,0 +1,111 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxDPTCodec.h
+// Author : Franck Marini
+// Description : Table driven encoding/decoding of the KNX Datapoint values
+// Module dependencies : KnxDPT
+
+// Each DPT format of "eKnxDPT_Format" is described by a list of fields (reserved bits are not listed).
+// A field is defined by its bit offset (counted from the MSB of the 1st DPT byte), its width in bits and its type.
+// All the formats are then decoded/encoded with the same generic shift & mask kernels :
+//  - Integer kernels work on "long" fields : unsigned fields (U, B, N, A...) are zero extended,
+//    signed fields (V) are sign extended, F16/F32 fields are provided as raw bits
+//  - Floating point kernels work on "float" fields : F16 and F32 fields are converted into their real value
+// NB1 : DPT formats shorter than 8 bits (B1, B2, B1U3, N2, N3...) are right aligned in one single byte
+// NB2 : the V64 format is split into 2 fields (signed high 32 bits, unsigned low 32 bits)
+
+#ifndef KNXDPTCODEC_H
+#define KNXDPTCODEC_H
+
+#include "Arduino.h"
+#include "KnxDPT.h"
+
+// Types of DPT fields
+enum e_KnxDptFieldType {
+  KNX_DPT_FIELD_U = 0, // Unsigned value or bit set (U, B, N, A, Z...)
+  KNX_DPT_FIELD_V,     // 2's complement signed value
+  KNX_DPT_FIELD_F16,   // 16 bits KNX floating value (0.01 * M * 2^E)
+  KNX_DPT_FIELD_F32    // 32 bits IEEE 754 floating value
+};
+
+#define KNX_DPT_FIELDS_MAX_NB 14 // max nb of fields of a DPT format (A112 and AN formats)
+
+// Values returned by the codec functions
+#define KNX_DPT_CODEC_OK        0
+#define KNX_DPT_CODEC_ERROR   255
+
+// DPT 10.001 DPT_TimeOfDay
+typedef struct {
+  byte weekDay; // 0 = no day, 1 = Monday ... 7 = Sunday
+  byte hour;    // 0..23
+  byte minute;  // 0..59
+  byte second;  // 0..59
+} type_KnxTimeOfDay;
+
+// DPT 11.001 DPT_Date
+typedef struct {
+  byte day;   // 1..31
+  byte month; // 1..12
+  word year;  // 1990..2089
+} type_KnxDate;
+
+// DPT 232.600 DPT_Colour_RGB
+typedef struct {
+  byte red;
+  byte green;
+  byte blue;
+} type_KnxColorRGB;
+
+
+// Return the number of fields of a DPT format (0 if the format is unknown)
+byte KnxDptFieldsNb(byte dptFormat);
+
+// Return the length in bytes of a DPT value (formats shorter than 8 bits take 1 byte)
+byte KnxDptLength(byte dptFormat);
+
+// Return the type (e_KnxDptFieldType) of a field of a DPT format
+// return KNX_DPT_CODEC_ERROR in case of unknown format or field
+byte KnxDptFieldType(byte dptFormat, byte fieldIndex);
+
+// Decode all the fields of a DPT value ("fields" shall be able to contain KnxDptFieldsNb() values)
+// return KNX_DPT_CODEC_ERROR in case of unknown format, else KNX_DPT_CODEC_OK
+byte KnxDptDecode(const byte dpt[], byte dptFormat, long fields[]);
+byte KnxDptDecode(const byte dpt[], byte dptFormat, float fields[]);
+
+// Encode all the fields of a DPT value, reserved bits are cleared
+// return KNX_DPT_CODEC_ERROR in case of unknown format, else KNX_DPT_CODEC_OK
+byte KnxDptEncode(const long fields[], byte dptFormat, byte dpt[]);
+byte KnxDptEncode(const float fields[], byte dptFormat, byte dpt[]);
+
+// F16 and F32 single value helpers
+float KnxDptDecodeF16(const byte dpt[]);
+void KnxDptEncodeF16(long valuex100, byte dpt[]); // value shall be provided multiplied by 100
+float KnxDptDecodeF32(const byte dpt[]);
+void KnxDptEncodeF32(float value, byte dpt[]);
+
+// Time, date and color helpers
+byte KnxDptDecodeTimeOfDay(const byte dpt[], type_KnxTimeOfDay& time);
+byte KnxDptEncodeTimeOfDay(const type_KnxTimeOfDay& time, byte dpt[]);
+byte KnxDptDecodeDate(const byte dpt[], type_KnxDate& date);
+byte KnxDptEncodeDate(const type_KnxDate& date, byte dpt[]);
+byte KnxDptDecodeColorRGB(const byte dpt[], type_KnxColorRGB& color);
+byte KnxDptEncodeColorRGB(const type_KnxColorRGB& color, byte dpt[]);
+
+#endif // KNXDPTCODEC_H
@@ -19,17 +19,14 @@
 // File : KnxDevice.cpp
 // Author : Franck Marini
 // Description : KnxDevice Abstraction Layer
-// Module dependencies : HardwareSerial, KnxTelegram, KnxComObject, KnxTpUart, ActionRingBuffer
+// Module dependencies : HardwareSerial, KnxTelegram, KnxComObject, KnxTpUart, ActionRingBuffer, KnxTxLatency,
+//                       KnxProfiler, KnxProbes
 
 #include "KnxDevice.h"
 
 
 static inline word TimeDeltaWord(word now, word before) { return (word)(now - before); }
 
-#ifdef KNXDEVICE_DEBUG_INFO
-const char KnxDevice::_debugInfoText[] = "KNXDEVICE INFO: ";
-#endif
-
 // KnxDevice unique instance creation
 KnxDevice KnxDevice::Knx;
 KnxDevice& Knx = KnxDevice::Knx;
@@ -43,15 +40,24 @@ KnxDevice::KnxDevice()
   _txActionList= ActionRingBuffer<type_tx_action, ACTIONS_QUEUE_SIZE>();
   _initCompleted = false;
   _initIndex = 0;
-  _rxTelegram = NULL;
 #if defined(KNXDEVICE_DEBUG_INFO)
    _nbOfInits = 0;
-   _debugStrPtr = NULL;
+   _traceRing = NULL;
 #endif
     _comObjectsNb = 0;
     dynComObjects = 0;
 	_lastBusTime = 0;
 	_busWriteTime = 0;
+	_telegramCallbackFct = NULL;
+#if !defined(KNXDEVICE_NO_FAST_READ)
+  _readResponsesNb = 0;
+  _mergedReadsNb = 0;
+#endif
+#if !defined(KNXDEVICE_NO_REPEAT_FILTER)
+  _repeatFilterNb = 0;
+  _repeatFilterIndex = 0;
+  _suppressedRepeatsNb = 0;
+#endif
 }
 
 
@@ -60,7 +66,16 @@ e_KnxDeviceStatus KnxDevice::begin(HardwareSerial& serial, word physicalAddr,
                             KnxComObject** dynComObjects_, byte numberObjects)
 {
   _knxBus = new KnxTpUart(serial ,physicalAddr, NORMAL);
-  _rxTelegram = &_knxBus->GetReceivedTelegram();
+  _state = INIT;
+
+  return commonInit(dynComObjects_, numberObjects);
+}
+
+
+e_KnxDeviceStatus KnxDevice::begin(KnxSerialTransport& transport, word physicalAddr,
+                            KnxComObject** dynComObjects_, byte numberObjects)
+{
+  _knxBus = new KnxTpUart(transport, physicalAddr, NORMAL);
   _state = INIT;
 
   return commonInit(dynComObjects_, numberObjects);
@@ -86,6 +101,15 @@ void KnxDevice::setReceivedTelegram(KnxTelegram &telegram)
 }
 #endif
 
+e_KnxDeviceStatus KnxDevice::begin(KnxBusCoupler *busCoupler, KnxComObject** dynComObjects_, byte numberObjects)
+{
+  _knxBus = busCoupler;
+  _state = INIT;
+
+  return commonInit(dynComObjects_, numberObjects);
+}
+
+
 e_KnxDeviceStatus KnxDevice::commonInit(KnxComObject** dynComObjects_, byte numberObjects)
 {
 	dynComObjects = dynComObjects_;
@@ -102,7 +126,7 @@ e_KnxDeviceStatus KnxDevice::checkInitBus()
 
   if (!_knxBus) {
 #if defined(KNXDEVICE_DEBUG_INFO)
-	Knx.DebugInfo("!_knxBus\n");
+	Knx.DebugInfo(KNX_TRACE_DEVICE_NO_BUS_COUPLER);
 #endif
   	return KNX_DEVICE_ERROR;
   }
@@ -113,12 +137,8 @@ e_KnxDeviceStatus KnxDevice::checkInitBus()
   if(e == KNX_BUSCOUPLER_ERROR_ATTEMPT_EXCEED) {
 	delete(_knxBus);
 	_knxBus = NULL;
-	_rxTelegram = NULL;
-#if defined(KNXDEVICE_DEBUG_INFO)
-	DebugInfo("Init Error!\n");
-#endif
 #if defined(KNXDEVICE_DEBUG_INFO)
-	Knx.DebugInfo("!knx bus init attempt exceeded\n");
+	DebugInfo(KNX_TRACE_DEVICE_INIT_ERROR);
 #endif
 	return KNX_DEVICE_BUSSERIAL_RESET;
   }
@@ -136,15 +156,15 @@ e_KnxDeviceStatus KnxDevice::checkInitBus()
 
   _state = IDLE;
 #if defined(KNXDEVICE_DEBUG_INFO)
-  DebugInfo("Init successful\n");
+  DebugInfo(KNX_TRACE_DEVICE_INIT_OK);
 #endif
-  _lastInitTimeMillis = millis();
-  _lastTXTimeMicros = micros();
+  _lastInitTimeMillis = KnxMillis();
+  _lastTXTimeMicros = KnxMicros();
 #if defined(KNXDEVICE_DEBUG_INFO)
    _nbOfInits = 0;
 #endif
 
-  _lastBusTime = millis();
+  _lastBusTime = KnxMillis();
 
   return KNX_DEVICE_OK;
 }
@@ -157,9 +177,14 @@ type_tx_action action;
 
   _state = INIT;
   while(_txActionList.Pop(action)); // empty ring buffer
+#if !defined(KNXDEVICE_NO_FAST_READ)
+  _readResponsesNb = 0;
+#endif
+#if !defined(KNXDEVICE_NO_REPEAT_FILTER)
+  _repeatFilterNb = 0;
+#endif
   _initCompleted = false;
   _initIndex = 0;
-  _rxTelegram = NULL;
   delete(_knxBus);
   _knxBus = NULL;
 }
@@ -170,18 +195,20 @@ type_tx_action action;
 void KnxDevice::task(void)
 {
   type_tx_action action;
+  type_buscoupler_rx_telegram rxTelegram;
   word nowTimeMillis, nowTimeMicros;
 
-  if (_busWriteTime && (millis() - _busWriteTime) > KNX_WRITE_TIMEOUT) {
+  if (_busWriteTime && (KnxMillis() - _busWriteTime) > KNX_WRITE_TIMEOUT) {
     _busWriteTime = 0;
     _state = INIT;
 	return;
   }
 
   // STEP 1 : Initialize Com Objects having Init Read attribute
+  KNX_PROFILE_BEGIN(stepStartTicks);
   if(!_initCompleted)
   {
-    nowTimeMillis = millis();
+    nowTimeMillis = KnxMillis();
     // To avoid EIB bus overloading, we wait for 500 ms between each Init read request
     if (TimeDeltaWord(nowTimeMillis, _lastInitTimeMillis) > 500 )
     {
@@ -190,39 +217,75 @@ void KnxDevice::task(void)
       if (_initIndex == _comObjectsNb)
       {
         _initCompleted = true; // All the Com Object initialization have been performed
-      //  DebugInfo(String("KNXDevice INFO: Com Object init completed, ")+ String( _nbOfInits) + String("objs initialized.\n"));
+#if defined(KNXDEVICE_DEBUG_INFO)
+        DebugInfo(KNX_TRACE_DEVICE_INIT_COMPLETED, _nbOfInits);
+#endif
       }
       else
       { // Com Object to be initialised has been found
         // Add a READ request in the TX action list
 #if defined(KNXDEVICE_DEBUG_INFO) || defined(KNXDEVICE_DEBUG_INFO_VERBOSE)
         _nbOfInits++;
+#endif
+#if defined(KNXDEVICE_DEBUG_INFO)
+        DebugInfo(KNX_TRACE_DEVICE_INIT_READ, _initIndex);
 #endif
         // init read request
         action.command = EIB_READ_REQUEST;
         action.index = _initIndex;
 
         _initIndex = _comObjectsNb;
-        _txActionList.Append(action);
-        _lastInitTimeMillis = millis(); // Update the timer
+        AppendTxAction(action);
+        _lastInitTimeMillis = KnxMillis(); // Update the timer
       }
     }
   }
+  KNX_PROFILE_END(KNX_PROFILE_TASK_INIT, stepStartTicks);
 
   // STEP 2 : Get new received EIB messages from the TPUART
   // The TPUART RX task is executed every 400 us
-  nowTimeMicros = micros();
+  KNX_PROFILE_BEGIN(rxStartTicks);
+  nowTimeMicros = KnxMicros();
   if (TimeDeltaWord(nowTimeMicros, _lastRXTimeMicros) > 400)
   {
     _lastRXTimeMicros = nowTimeMicros;
     _knxBus->RXTask();
   }
+  // The received telegrams are queued by the bus coupler, let's process them in a batch
+  // NB : the loop is bounded by the RX queue size since the queue is not filled meanwhile
+  while (_knxBus->PopReceivedTelegram(rxTelegram))
+  {
+    KNX_PROBE_TELEGRAM_RECEIVED(rxTelegram.telegram.GetSourceAddress(), rxTelegram.telegram.GetTargetAddress(),
+                                rxTelegram.telegram.GetCommand(), rxTelegram.comObjectIndex);
+#if !defined(KNXDEVICE_NO_REPEAT_FILTER)
+    if (IsRepetition(rxTelegram))
+    { // already processed, the repetition is not dispatched again (e.g. a toggle would be applied twice)
+#if defined(KNXDEVICE_DEBUG_INFO)
+      DebugInfo(KNX_TRACE_DEVICE_REPEAT_SUPPRESSED, rxTelegram.comObjectIndex, rxTelegram.telegram.GetSourceAddress());
+#endif
+      continue;
+    }
+#endif
+    if (_telegramCallbackFct) _telegramCallbackFct(rxTelegram.telegram);
+    ProcessReceivedTelegram(rxTelegram);
+  }
+  KNX_PROFILE_END(KNX_PROFILE_TASK_RX, rxStartTicks);
 
   // STEP 3 : Send KNX messages following TX actions
-  if(_state == IDLE)
+  KNX_PROFILE_BEGIN(txActionStartTicks);
+#if !defined(KNXDEVICE_NO_FAST_READ)
+  // The read responses go ahead of the TX action list (the device is then TX_ONGOING with the response)
+  if ((_state == IDLE) && !_knxBus->IsTxBusy()) SendReadResponse();
+#endif
+  // NB : a received telegram sets the state back to IDLE, the bus coupler may still be busy with the last telegram
+  if((_state == IDLE) && !_knxBus->IsTxBusy())
   {
     if( _txActionList.Pop(action))
     { // Data to be transmitted
+#if defined(KNXDEVICE_TX_LATENCY)
+      _txTrace.queuedMicros = action.queuedMicros;
+      _txTrace.dequeuedMicros = KnxMicros();
+#endif
       switch (action.command)
       {
         case EIB_READ_REQUEST: // a read operation of a Com Object on the EIB network is required
@@ -231,8 +294,7 @@ void KnxDevice::task(void)
           _txTelegram.ClearLongPayload(); _txTelegram.ClearFirstPayloadByte(); // Is it required to have a clean payload ??
           _txTelegram.SetCommand(KNX_COMMAND_VALUE_READ);
           _txTelegram.UpdateChecksum();
-          _knxBus->SendTelegram(_txTelegram);
-          _state = TX_ONGOING;
+          SendTxTelegram(action.index);
           break;
 
         case EIB_RESPONSE_REQUEST: // a response operation of a Com Object on the EIB network is required
@@ -240,8 +302,7 @@ void KnxDevice::task(void)
           dynComObjects[action.index]->CopyValue(_txTelegram);
           _txTelegram.SetCommand(KNX_COMMAND_VALUE_RESPONSE);
           _txTelegram.UpdateChecksum();
-          _knxBus->SendTelegram(_txTelegram);
-          _state = TX_ONGOING;
+          SendTxTelegram(action.index);
           break;
 
         case EIB_WRITE_REQUEST: // a write operation of a Com Object on the EIB network is required
@@ -260,24 +321,32 @@ void KnxDevice::task(void)
             dynComObjects[action.index]->CopyValue(_txTelegram);
             _txTelegram.SetCommand(KNX_COMMAND_VALUE_WRITE);
             _txTelegram.UpdateChecksum();
-            _knxBus->SendTelegram(_txTelegram);
-            _state = TX_ONGOING;
+            SendTxTelegram(action.index);
           }
           break;
 
+        case EIB_TELEGRAM_REQUEST: // a telegram built by the application shall be sent as is
+          for (byte i = 0; i < KNX_TELEGRAM_MAX_SIZE; i++) _txTelegram.WriteRawByte(action.valuePtr[i], i);
+          free(action.valuePtr);
+          SendTxTelegram(KNX_TX_LATENCY_NO_OBJECT);
+          break;
+
         default : break;
       }
     }
   }
+  KNX_PROFILE_END(KNX_PROFILE_TASK_TX_ACTION, txActionStartTicks);
 
   // STEP 4 : LET THE TP-UART TRANSMIT EIB MESSAGES
   // The TPUART TX task is executed every 800 us
-  nowTimeMicros = micros();
+  KNX_PROFILE_BEGIN(txStartTicks);
+  nowTimeMicros = KnxMicros();
   if (TimeDeltaWord(nowTimeMicros, _lastTXTimeMicros) > 800)
   {
     _lastTXTimeMicros = nowTimeMicros;
     _knxBus->TXTask();
   }
+  KNX_PROFILE_END(KNX_PROFILE_TASK_TX, txStartTicks);
 }
 
 
@@ -290,7 +359,7 @@ byte KnxDevice::read(byte objectIndex)
 
 
 // Read an usual format com object
-// Supported DPT formats are short com object, U16, V16, U32, V32, F16 and F32 (not implemented yet)
+// Supported DPT formats are short com object, U16, V16, U32, V32, F16 and F32
 template <typename T>  e_KnxDeviceStatus KnxDevice::read(byte objectIndex, T& returnedValue)
 {
   // Short com object case
@@ -337,7 +406,7 @@ template <typename T>  e_KnxDeviceStatus KnxDevice::write(byte objectIndex, T va
   byte *destValue;
   byte length = dynComObjects[objectIndex]->GetLength();
 
-  _busWriteTime = millis();
+  _busWriteTime = KnxMillis();
 
   if (length <= 2 ) action.byteValue = (byte) value; // short object case
   else
@@ -354,7 +423,7 @@ template <typename T>  e_KnxDeviceStatus KnxDevice::write(byte objectIndex, T va
   // add WRITE action in the TX action queue
   action.command = EIB_WRITE_REQUEST;
   action.index = objectIndex;
-  _txActionList.Append(action);
+  AppendTxAction(action);
   return KNX_DEVICE_OK;
 }
 
@@ -378,7 +447,7 @@ type_tx_action action;
 byte *dptValue;
 byte length = dynComObjects[objectIndex]->GetLength();
 
-_busWriteTime = millis();
+_busWriteTime = KnxMillis();
 
   if (length>2) // check we are in long object case
   { // add WRITE action in the TX action queue
@@ -387,7 +456,7 @@ _busWriteTime = millis();
     dptValue = (byte *) malloc(length-1); // allocate the memory for long value
     for (byte i=0; i<length-1; i++) dptValue[i] = valuePtr[i]; // copy value
     action.valuePtr = (byte *) dptValue;
-    _txActionList.Append(action);
+    AppendTxAction(action);
     return KNX_DEVICE_OK;
   }
   return KNX_DEVICE_ERROR;
@@ -402,16 +471,162 @@ void KnxDevice::update(byte objectIndex)
 type_tx_action action;
   action.command = EIB_READ_REQUEST;
   action.index = objectIndex;
+  AppendTxAction(action);
+}
+
+
+// Send a telegram built by the application
+e_KnxDeviceStatus KnxDevice::sendTelegram(const KnxTelegram& telegram)
+{
+type_tx_action action;
+type_buscoupler_rx_telegram localTelegram;
+
+  // The bus coupler does not receive its own telegrams, the local com objects are updated here
+  if ( telegram.IsMulticast() && (telegram.GetCommand() != KNX_COMMAND_VALUE_READ) )
+  {
+    for (byte i = 0; i < _comObjectsNb; i++)
+    {
+      if (dynComObjects[i]->GetAddr() != telegram.GetTargetAddress()) continue;
+      telegram.Copy(localTelegram.telegram);
+      localTelegram.comObjectIndex = i;
+      localTelegram.timeMicros = KnxMicros();
+      ProcessReceivedTelegram(localTelegram);
+    }
+  }
+
+  action.command = EIB_TELEGRAM_REQUEST;
+  action.index = KNX_TX_LATENCY_NO_OBJECT; // no com object
+  action.valuePtr = (byte *) malloc(KNX_TELEGRAM_MAX_SIZE);
+  if (action.valuePtr == NULL) return KNX_DEVICE_ERROR;
+  for (byte i = 0; i < KNX_TELEGRAM_MAX_SIZE; i++) action.valuePtr[i] = telegram.ReadRawByte(i);
+  AppendTxAction(action);
+  return KNX_DEVICE_OK;
+}
+
+
+// Append an action to the TX action list
+void KnxDevice::AppendTxAction(type_tx_action& action)
+{
+#if defined(KNXDEVICE_TX_LATENCY)
+  action.queuedMicros = KnxMicros();
+#endif
+  if (_txActionList.IsFull()) KNX_PROBE_QUEUE_OVERFLOW(KNX_PROBE_QUEUE_TX_ACTIONS);
   _txActionList.Append(action);
+  KNX_PROBE_TELEGRAM_QUEUED(action.command, action.index, _txActionList.ElementsNb());
 }
 
 
+// Hand the TX telegram over to the bus coupler
+void KnxDevice::SendTxTelegram(byte objectIndex)
+{
+#if defined(KNXDEVICE_TX_LATENCY)
+  _txTrace.objectIndex = objectIndex;
+  _txTrace.priority = _txTelegram.GetPriority();
+  _txTrace.handoffMicros = KnxMicros();
+#endif
+  KNX_PROBE_TELEGRAM_SENT(_txTelegram.GetTargetAddress(), _txTelegram.GetCommand(), _txTelegram.GetPriority(), objectIndex);
+  _knxBus->SendTelegram(_txTelegram);
+  _state = TX_ONGOING;
+}
+
+
+// Answer a read request of a com object with R attribute
+void KnxDevice::RespondToRead(byte objectIndex, unsigned long receivedMicros)
+{
+type_tx_action action;
+
+#if !defined(KNXDEVICE_NO_FAST_READ)
+  for (byte i = 0; i < _readResponsesNb; i++)
+  {
+    if (_readResponses[i].index != objectIndex) continue;
+    _mergedReadsNb++; // the waiting response will carry the current value anyway
+    return;
+  }
+  if (_readResponsesNb < READ_RESPONSES_NB)
+  {
+    _readResponses[_readResponsesNb].index = objectIndex;
+    _readResponses[_readResponsesNb].receivedMicros = receivedMicros;
+    _readResponsesNb++;
+    return;
+  }
+#endif
+  // add RESPONSE action in the TX action list
+  action.command = EIB_RESPONSE_REQUEST;
+  action.index = objectIndex;
+  AppendTxAction(action);
+}
+
+
+#if !defined(KNXDEVICE_NO_FAST_READ)
+// Send the oldest waiting read response, return false if there is none
+boolean KnxDevice::SendReadResponse(void)
+{
+byte index;
+
+  if (!_readResponsesNb) return false;
+  index = _readResponses[0].index;
+#if defined(KNXDEVICE_TX_LATENCY)
+  // the latency of a response is counted from the read request reception
+  _txTrace.queuedMicros = _readResponses[0].receivedMicros;
+  _txTrace.dequeuedMicros = KnxMicros();
+#endif
+  _readResponsesNb--;
+  for (byte i = 0; i < _readResponsesNb; i++) _readResponses[i] = _readResponses[i + 1];
+
+  dynComObjects[index]->CopyAttributes(_txTelegram);
+  dynComObjects[index]->CopyValue(_txTelegram);
+  _txTelegram.SetCommand(KNX_COMMAND_VALUE_RESPONSE);
+  _txTelegram.UpdateChecksum();
+  SendTxTelegram(index);
+  return true;
+}
+#endif
+
+
+#if !defined(KNXDEVICE_NO_REPEAT_FILTER)
+// Return true if the telegram is the repetition of a telegram processed less than REPEAT_FILTER_WINDOW_MICROS ago
+boolean KnxDevice::IsRepetition(const type_buscoupler_rx_telegram& rxTelegram)
+{
+const KnxTelegram& telegram = rxTelegram.telegram;
+type_repeat_filter_record record;
+byte checksumIndex = telegram.GetTelegramLength() - 1;
+
+  record.source = telegram.GetSourceAddress();
+  record.target = telegram.GetTargetAddress();
+  record.receivedMicros = rxTelegram.timeMicros;
+  // the control field (repeat flag) and the checksum differ between a telegram and its repetition, they are not hashed
+  record.hash = telegram.GetPayloadLength();
+  for (byte i = KNX_TELEGRAM_HEADER_SIZE; i < checksumIndex; i++) record.hash = (record.hash * 31) + telegram.ReadRawByte(i);
+
+  if (telegram.IsRepeated())
+  {
+    for (byte i = 0; i < _repeatFilterNb; i++)
+    {
+      if ((_repeatFilter[i].source != record.source) || (_repeatFilter[i].target != record.target)
+          || (_repeatFilter[i].hash != record.hash)) continue;
+      if ((record.receivedMicros - _repeatFilter[i].receivedMicros) >= REPEAT_FILTER_WINDOW_MICROS) continue;
+      _suppressedRepeatsNb++;
+      return true;
+    }
+  }
+  // a repetition whose original was missed is processed and remembered as well (against the next repetitions)
+  _repeatFilter[_repeatFilterIndex] = record;
+  if (++_repeatFilterIndex == REPEAT_FILTER_NB) _repeatFilterIndex = 0;
+  if (_repeatFilterNb < REPEAT_FILTER_NB) _repeatFilterNb++;
+  return false;
+}
+#endif
+
+
 // The function returns true if there is rx/tx activity ongoing, else false
 boolean KnxDevice::isActive(void) const
 {
   if (_knxBus->IsActive()) return true; // TPUART is active
   if (_state == TX_ONGOING) return true; // the Device is sending a request
   if(_txActionList.ElementsNb()) return true; // there is at least one tx action in the queue
+#if !defined(KNXDEVICE_NO_FAST_READ)
+  if (_readResponsesNb) return true; // there is at least one read response waiting
+#endif
   return false;
 }
 
@@ -419,126 +634,137 @@ boolean KnxDevice::isActive(void) const
 // Static GetTpUartEvents() function called by the KnxTpUart layer (callback)
 void KnxDevice::GetTpUartEvents(e_KnxBusCouplerEvent event)
 {
-type_tx_action action;
-byte targetedComObjIndex; // index of the Com Object targeted by the event
-
+  KNX_PROFILE_BEGIN(startTicks);
   // Manage RECEIVED MESSAGES
-  if (event == BUSCOUPLER_EVENT_RECEIVED_EIB_TELEGRAM)
+  // NB : the received telegram is queued by the bus coupler and processed later on by the task() function
+  if (event == BUSCOUPLER_EVENT_RECEIVED_EIB_TELEGRAM) Knx._state = IDLE;
+
+  // Manage RESET events
+  if (event == BUSCOUPLER_EVENT_RESET)
   {
+    KNX_PROBE_COUPLER_RESET();
+    while(Knx._knxBus->Reset()==KNX_BUSCOUPLER_ERROR);
+    Knx._knxBus->Init();
     Knx._state = IDLE;
-    targetedComObjIndex = Knx._knxBus->GetTargetedComObjectIndex();
+  }
+  KNX_PROFILE_END(KNX_PROFILE_BUSCOUPLER_EVENTS, startTicks);
+}
 
-    switch(Knx._rxTelegram->GetCommand())
-    {
-      case KNX_COMMAND_VALUE_READ :
-	  	Knx._lastBusTime = millis();
+// Process a telegram popped from the bus coupler RX queue
+void KnxDevice::ProcessReceivedTelegram(const type_buscoupler_rx_telegram& rxTelegram)
+{
+byte targetedComObjIndex = rxTelegram.comObjectIndex; // index of the Com Object targeted by the telegram
+
+  switch(rxTelegram.telegram.GetCommand())
+  {
+    case KNX_COMMAND_VALUE_READ :
+      _lastBusTime = KnxMillis();
 #if defined(KNXDEVICE_DEBUG_INFO)
-    	Knx.DebugInfo("READ req.\n");
+      DebugInfo(KNX_TRACE_DEVICE_READ_REQ, targetedComObjIndex, rxTelegram.telegram.GetSourceAddress());
 #endif
-        // READ command coming from the bus
-        // if the Com Object has read attribute, then add RESPONSE action in the TX action list
-        if ( (Knx.dynComObjects[targetedComObjIndex]->GetIndicator()) & KNX_COM_OBJ_R_INDICATOR)
-        { // The targeted Com Object can indeed be read
-          action.command = EIB_RESPONSE_REQUEST;
-          action.index = targetedComObjIndex;
-          Knx._txActionList.Append(action);
-        }
-        break;
-
-      case KNX_COMMAND_VALUE_RESPONSE :
-	    Knx._lastBusTime = millis();
+      // READ command coming from the bus
+      // if the Com Object has read attribute, then a RESPONSE is sent
+      if ( (dynComObjects[targetedComObjIndex]->GetIndicator()) & KNX_COM_OBJ_R_INDICATOR)
+      { // The targeted Com Object can indeed be read
+        RespondToRead(targetedComObjIndex, rxTelegram.timeMicros);
+      }
+      break;
+
+    case KNX_COMMAND_VALUE_RESPONSE :
+      _lastBusTime = KnxMillis();
 #if defined(KNXDEVICE_DEBUG_INFO)
-      	Knx.DebugInfo("RESP req.\n");
+      DebugInfo(KNX_TRACE_DEVICE_RESPONSE_REQ, targetedComObjIndex, rxTelegram.telegram.GetSourceAddress());
 #endif
-        // RESPONSE command coming from EIB network, we update the value of the corresponding Com Object.
-        // We 1st check that the corresponding Com Object has UPDATE attribute
-        if((Knx.dynComObjects[targetedComObjIndex]->GetIndicator()) & KNX_COM_OBJ_U_INDICATOR)
-        {
-          Knx.dynComObjects[targetedComObjIndex]->UpdateValue(*(Knx._rxTelegram));
-          //We notify the upper layer of the update
-          knxEvents(targetedComObjIndex);
-        }
-        break;
-
-
-      case KNX_COMMAND_VALUE_WRITE :
-	    Knx._lastBusTime = millis();
+      // RESPONSE command coming from EIB network, we update the value of the corresponding Com Object.
+      // We 1st check that the corresponding Com Object has UPDATE attribute
+      if((dynComObjects[targetedComObjIndex]->GetIndicator()) & KNX_COM_OBJ_U_INDICATOR)
+      {
+        dynComObjects[targetedComObjIndex]->UpdateValue(rxTelegram.telegram);
+        //We notify the upper layer of the update
+        NotifyKnxEvents(targetedComObjIndex);
+      }
+      break;
+
+    case KNX_COMMAND_VALUE_WRITE :
+      _lastBusTime = KnxMillis();
 #if defined(KNXDEVICE_DEBUG_INFO)
-    	Knx.DebugInfo("WRITE req.\n");
+      DebugInfo(KNX_TRACE_DEVICE_WRITE_REQ, targetedComObjIndex, rxTelegram.telegram.GetSourceAddress());
 #endif
-        // WRITE command coming from EIB network, we update the value of the corresponding Com Object.
-        // We 1st check that the corresponding Com Object has WRITE attribute
-        if((Knx.dynComObjects[targetedComObjIndex]->GetIndicator()) & KNX_COM_OBJ_W_INDICATOR)
-        {
-          Knx.dynComObjects[targetedComObjIndex]->UpdateValue(*(Knx._rxTelegram));
-          //We notify the upper layer of the update
-          knxEvents(targetedComObjIndex);
-        }
-        break;
-
-      // case KNX_COMMAND_MEMORY_WRITE : break; // Memory Write not handled
-
-      default : break; // not supposed to happen
-    }
-  }
+      // WRITE command coming from EIB network, we update the value of the corresponding Com Object.
+      // We 1st check that the corresponding Com Object has WRITE attribute
+      if((dynComObjects[targetedComObjIndex]->GetIndicator()) & KNX_COM_OBJ_W_INDICATOR)
+      {
+        dynComObjects[targetedComObjIndex]->UpdateValue(rxTelegram.telegram);
+        //We notify the upper layer of the update
+        NotifyKnxEvents(targetedComObjIndex);
+      }
+      break;
 
-  // Manage RESET events
-  if (event == BUSCOUPLER_EVENT_RESET)
-  {
-    while(Knx._knxBus->Reset()==KNX_BUSCOUPLER_ERROR);
-    Knx._knxBus->Init();
-    Knx._state = IDLE;
+    // case KNX_COMMAND_MEMORY_WRITE : break; // Memory Write not handled
+
+    default : break; // not supposed to happen
   }
 }
 
+
 unsigned long KnxDevice::timeSinceBus()
 {
 	if (!_lastBusTime)
 		return 0;
 
-	return millis() - _lastBusTime;
+	return KnxMillis() - _lastBusTime;
 }
 
 // Static TxTelegramAck() function called by the KnxTpUart layer (callback)
 void KnxDevice::TxTelegramAck(e_BusCouplerTxAck value)
 {
-  Knx._lastBusTime = millis();
+  Knx._lastBusTime = KnxMillis();
   Knx._busWriteTime = 0;
+  KNX_PROBE_TELEGRAM_ACKED(value);
 
-  Knx._state = IDLE;
-#ifdef KNXDevice_DEBUG
-  if(value != ACK_RESPONSE)
+#if defined(KNXDEVICE_TX_LATENCY)
+  // Only the acknowledged transmissions are counted
+  if ((value == ACK_RESPONSE) && (Knx._state == TX_ONGOING))
   {
-    switch(value)
-    {
-      case NACK_RESPONSE: DebugInfo("NACK RESPONSE!!\n"); break;
-      case NO_ANSWER_TIMEOUT: DebugInfo("NO ANSWER TIMEOUT RESPONSE!!\n");; break;
-      case BUSCOUPLER_RESET_RESPONSE: DebugInfo("RESET RESPONSE!!\n");; break;
-    }
+    unsigned long txEndMicros;
+    boolean txEndKnown = Knx._knxBus->GetTxEndMicros(txEndMicros);
+    Knx._txLatency.Record(Knx._txTrace, txEndKnown, txEndMicros, KnxMicros());
   }
-#endif // KNXDevice_DEBUG
+#endif
+  Knx._state = IDLE;
+#if defined(KNXDEVICE_DEBUG_INFO)
+  if (value != ACK_RESPONSE) Knx.DebugInfo(KNX_TRACE_DEVICE_TX_FAILED, value);
+#endif
 }
 
 
 // Functions to convert a standard C type to a DPT format
-// NB : only the usual DPT formats are supported (U16, V16, U32, V32, F16 and F32 (not yet implemented)
+// NB : the usual DPT formats are supported (U16, V16, U32, V32, F16 and F32),
+// any other single field format is converted by the generic DPT codec
 template <typename T> e_KnxDeviceStatus ConvertFromDpt(const byte dptOriginValue[], T& resultValue, byte dptFormat)
 {
   switch (dptFormat)
   {
+    // NB : the value is assembled as an integer and converted once, the signed formats are sign extended
     case KNX_DPT_FORMAT_U16:
+      resultValue = (T)(word)(((word)dptOriginValue[0] << 8) | dptOriginValue[1]);
+      return KNX_DEVICE_OK;
+    break;
+
     case KNX_DPT_FORMAT_V16:
-      resultValue = (T)((unsigned int)dptOriginValue[0] << 8);
-      resultValue += (T)(dptOriginValue[1]);
+      resultValue = (T)(int16_t)(((word)dptOriginValue[0] << 8) | dptOriginValue[1]);
       return KNX_DEVICE_OK;
     break;
 
     case KNX_DPT_FORMAT_U32:
+      resultValue = (T)(  ((uint32_t)dptOriginValue[0] << 24) | ((uint32_t)dptOriginValue[1] << 16)
+                        | ((uint32_t)dptOriginValue[2] << 8) | (uint32_t)dptOriginValue[3]);
+      return KNX_DEVICE_OK;
+    break;
+
     case KNX_DPT_FORMAT_V32:
-      resultValue = (T)((unsigned long)dptOriginValue[0] << 24);
-      resultValue += (T)((unsigned long)dptOriginValue[1] << 16);
-      resultValue += (T)((unsigned long)dptOriginValue[2] << 8);
-      resultValue += (T)(dptOriginValue[3]);
+      resultValue = (T)(int32_t)(  ((uint32_t)dptOriginValue[0] << 24) | ((uint32_t)dptOriginValue[1] << 16)
+                                 | ((uint32_t)dptOriginValue[2] << 8) | (uint32_t)dptOriginValue[3]);
       return KNX_DEVICE_OK;
     break;
 
@@ -560,22 +786,26 @@ template <typename T> e_KnxDeviceStatus ConvertFromDpt(const byte dptOriginValue
     break;
 
     // support 24 bit values (e.g. for 3 byte color rgb/hsl )
-    case KNX_DPT_FORMAT_B24: {
-      unsigned int resU = 0;
-      ((byte*)&resU)[0] = dptOriginValue[0];
-      ((byte*)&resU)[1] = dptOriginValue[1];
-      ((byte*)&resU)[2] = dptOriginValue[2];
-      resultValue = resU;
+    // NB : the 1st DPT byte is the lowest byte of the result
+    case KNX_DPT_FORMAT_B24:
+      resultValue = (T)((uint32_t)dptOriginValue[0] | ((uint32_t)dptOriginValue[1] << 8)
+                        | ((uint32_t)dptOriginValue[2] << 16));
       return KNX_DEVICE_OK;
-    }
     break;
 
     case KNX_DPT_FORMAT_F32 :
-      return KNX_DEVICE_NOT_IMPLEMENTED;
+      resultValue = (T) KnxDptDecodeF32(dptOriginValue);
+      return KNX_DEVICE_OK;
     break;
 
     default :
-      return KNX_DEVICE_ERROR;
+    {
+      long field;
+      if (KnxDptFieldsNb(dptFormat) != 1) return KNX_DEVICE_ERROR;
+      KnxDptDecode(dptOriginValue, dptFormat, &field);
+      resultValue = (T) field;
+      return KNX_DEVICE_OK;
+    }
     break;
   }
 }
@@ -591,64 +821,62 @@ template e_KnxDeviceStatus ConvertFromDpt <double>(const byte dptOriginValue[],
 
 
 // Functions to convert a standard C type to a DPT format
-// NB : only the usual DPT formats are supported (U16, V16, U32, V32, F16 and F32 (not yet implemented)
+// NB : the usual DPT formats are supported (U16, V16, U32, V32, F16 and F32),
+// any other single field format is converted by the generic DPT codec
 template <typename T> e_KnxDeviceStatus ConvertToDpt(T originValue, byte dptDestValue[], byte dptFormat)
 {
   switch (dptFormat)
   {
+    // NB : the value is converted once to an integer (a float value is truncated), then split into bytes
     case KNX_DPT_FORMAT_U16:
     case KNX_DPT_FORMAT_V16:
-      dptDestValue[0] = (byte)((unsigned int)originValue>>8);
-      dptDestValue[1] = (byte)(originValue);
+    {
+      unsigned long value = (unsigned long)(long)originValue;
+      dptDestValue[0] = (byte)(value>>8);
+      dptDestValue[1] = (byte)(value);
       return KNX_DEVICE_OK;
+    }
     break;
 
     case KNX_DPT_FORMAT_U32:
     case KNX_DPT_FORMAT_V32:
-      dptDestValue[0] = (byte)((unsigned long)originValue>>24);
-      dptDestValue[1] = (byte)((unsigned long)originValue>>16);
-      dptDestValue[2] = (byte)((unsigned long)originValue>>8);
-      dptDestValue[3] = (byte)(originValue);
+    {
+      unsigned long value = (unsigned long)(long)originValue;
+      dptDestValue[0] = (byte)(value>>24);
+      dptDestValue[1] = (byte)(value>>16);
+      dptDestValue[2] = (byte)(value>>8);
+      dptDestValue[3] = (byte)(value);
       return KNX_DEVICE_OK;
+    }
     break;
 
     case KNX_DPT_FORMAT_F16 :
-    {
-      long longValuex100 = (long)(100.0 * originValue);
-      boolean negativeSign = (longValuex100 & 0x80000000)? true : false;
-      byte exponent = 0;
-      byte round = 0;
-
-      if (negativeSign)
-      {
-        while(longValuex100 < (long)(-2048))
-        {
-           exponent++; round = (byte)(longValuex100) & 1 ; longValuex100>>=1; longValuex100|=0x80000000;
-        }
-      }
-      else
-      {
-        while(longValuex100 > (long)(2047))
-        {
-          exponent++; round = (byte)(longValuex100) & 1 ; longValuex100>>=1;
-        }
-
-      }
-      if (round) longValuex100++;
-      dptDestValue[1] = (byte)longValuex100;
-      dptDestValue[0] = (byte)(longValuex100>>8) & 0x7 ;
-      dptDestValue[0] += exponent<<3;
-      if (negativeSign) dptDestValue[0] += 0x80;
+      KnxDptEncodeF16((long)(100.0 * originValue), dptDestValue);
       return KNX_DEVICE_OK;
-    }
     break;
 
     case KNX_DPT_FORMAT_F32 :
-      return KNX_DEVICE_NOT_IMPLEMENTED;
+      KnxDptEncodeF32((float)originValue, dptDestValue);
+      return KNX_DEVICE_OK;
+    break;
+
+    case KNX_DPT_FORMAT_B24: // same byte order as ConvertFromDpt()
+    {
+      unsigned long value = (unsigned long)(long)originValue;
+      dptDestValue[0] = (byte)(value);
+      dptDestValue[1] = (byte)(value>>8);
+      dptDestValue[2] = (byte)(value>>16);
+      return KNX_DEVICE_OK;
+    }
     break;
 
     default :
-      return KNX_DEVICE_ERROR;
+    {
+      long field = (long)originValue;
+      if (KnxDptFieldsNb(dptFormat) != 1) return KNX_DEVICE_ERROR;
+      KnxDptEncode(&field, dptFormat, dptDestValue);
+      return KNX_DEVICE_OK;
+    }
     break;
   }
 }
@@ -662,4 +890,145 @@ template e_KnxDeviceStatus ConvertToDpt <long>(long, byte dptDestValue[], byte d
 template e_KnxDeviceStatus ConvertToDpt <float>(float, byte dptDestValue[], byte dptFormat);
 template e_KnxDeviceStatus ConvertToDpt <double>(double, byte dptDestValue[], byte dptFormat);
 
+
+// Functions to convert an array of DPT values to an array of standard C types (bulk decoding)
+// Each loop body is branch free and works on independent values, this allows the compiler to vectorize it
+// (e.g. with -O3 on 32/64 bits targets). On 8 bits targets, the gain comes from the single format evaluation
+template <typename T> e_KnxDeviceStatus ConvertFromDptArray(const byte dpt[], T result[], word count, byte dptFormat)
+{
+  word i;
+
+  switch (dptFormat)
+  {
+    case KNX_DPT_FORMAT_U16:
+      for (i=0; i < count; i++) result[i] = (T)(word)((dpt[2*i] << 8) | dpt[2*i+1]);
+      return KNX_DEVICE_OK;
+    break;
+
+    case KNX_DPT_FORMAT_V16:
+      for (i=0; i < count; i++) result[i] = (T)(int16_t)((dpt[2*i] << 8) | dpt[2*i+1]);
+      return KNX_DEVICE_OK;
+    break;
+
+    case KNX_DPT_FORMAT_U32:
+      for (i=0; i < count; i++)
+        result[i] = (T)(  ((uint32_t)dpt[4*i] << 24) | ((uint32_t)dpt[4*i+1] << 16)
+                        | ((uint32_t)dpt[4*i+2] << 8) | (uint32_t)dpt[4*i+3]);
+      return KNX_DEVICE_OK;
+    break;
+
+    case KNX_DPT_FORMAT_V32:
+      for (i=0; i < count; i++)
+        result[i] = (T)(int32_t)(  ((uint32_t)dpt[4*i] << 24) | ((uint32_t)dpt[4*i+1] << 16)
+                                 | ((uint32_t)dpt[4*i+2] << 8) | (uint32_t)dpt[4*i+3]);
+      return KNX_DEVICE_OK;
+    break;
+
+    case KNX_DPT_FORMAT_F16 :
+      // value = 0.01 * mantissa * 2^exponent, with mantissa being a 12 bits 2's complement value (sign + 11 bits)
+      for (i=0; i < count; i++)
+      {
+        int32_t mantissa = ((dpt[2*i] & 0x07) << 8) | dpt[2*i+1];
+        mantissa -= (dpt[2*i] & 0x80) << 4; // remove 2048 in case of negative sign
+        result[i] = (T)(float)(0.01 * (mantissa * ((int32_t)1 << ((dpt[2*i] & 0x78) >> 3)))); // same rounding as scalar
+      }
+      return KNX_DEVICE_OK;
+    break;
+
+    case KNX_DPT_FORMAT_B24:
+      // same byte order as ConvertFromDpt() : 1st DPT byte is the lowest byte of the result
+      for (i=0; i < count; i++)
+        result[i] = (T)((uint32_t)dpt[3*i] | ((uint32_t)dpt[3*i+1] << 8) | ((uint32_t)dpt[3*i+2] << 16));
+      return KNX_DEVICE_OK;
+    break;
+
+    case KNX_DPT_FORMAT_F32 :
+      for (i=0; i < count; i++) result[i] = (T) KnxDptDecodeF32(&dpt[4*i]);
+      return KNX_DEVICE_OK;
+    break;
+
+    default :
+      return KNX_DEVICE_ERROR;
+    break;
+  }
+}
+
+template e_KnxDeviceStatus ConvertFromDptArray <unsigned char>(const byte dpt[], unsigned char result[], word count, byte dptFormat);
+template e_KnxDeviceStatus ConvertFromDptArray <char>(const byte dpt[], char result[], word count, byte dptFormat);
+template e_KnxDeviceStatus ConvertFromDptArray <unsigned int>(const byte dpt[], unsigned int result[], word count, byte dptFormat);
+template e_KnxDeviceStatus ConvertFromDptArray <int>(const byte dpt[], int result[], word count, byte dptFormat);
+template e_KnxDeviceStatus ConvertFromDptArray <unsigned long>(const byte dpt[], unsigned long result[], word count, byte dptFormat);
+template e_KnxDeviceStatus ConvertFromDptArray <long>(const byte dpt[], long result[], word count, byte dptFormat);
+template e_KnxDeviceStatus ConvertFromDptArray <float>(const byte dpt[], float result[], word count, byte dptFormat);
+template e_KnxDeviceStatus ConvertFromDptArray <double>(const byte dpt[], double result[], word count, byte dptFormat);
+
+
+// Functions to convert an array of standard C types to an array of DPT values (bulk encoding)
+// NB : the integer formats are vectorizable, F16 encoding needs a normalization loop per value
+template <typename T> e_KnxDeviceStatus ConvertToDptArray(const T values[], byte dpt[], word count, byte dptFormat)
+{
+  word i;
+
+  switch (dptFormat)
+  {
+    case KNX_DPT_FORMAT_U16:
+    case KNX_DPT_FORMAT_V16:
+      for (i=0; i < count; i++)
+      {
+        uint32_t value = (uint32_t)(long)values[i];
+        dpt[2*i] = (byte)(value >> 8);
+        dpt[2*i+1] = (byte)value;
+      }
+      return KNX_DEVICE_OK;
+    break;
+
+    case KNX_DPT_FORMAT_U32:
+    case KNX_DPT_FORMAT_V32:
+      for (i=0; i < count; i++)
+      {
+        uint32_t value = (uint32_t)(long)values[i];
+        dpt[4*i] = (byte)(value >> 24);
+        dpt[4*i+1] = (byte)(value >> 16);
+        dpt[4*i+2] = (byte)(value >> 8);
+        dpt[4*i+3] = (byte)value;
+      }
+      return KNX_DEVICE_OK;
+    break;
+
+    case KNX_DPT_FORMAT_F16 :
+      for (i=0; i < count; i++) KnxDptEncodeF16((long)(100.0 * values[i]), &dpt[2*i]);
+      return KNX_DEVICE_OK;
+    break;
+
+    case KNX_DPT_FORMAT_B24:
+      for (i=0; i < count; i++)
+      {
+        uint32_t value = (uint32_t)(long)values[i];
+        dpt[3*i] = (byte)value;
+        dpt[3*i+1] = (byte)(value >> 8);
+        dpt[3*i+2] = (byte)(value >> 16);
+      }
+      return KNX_DEVICE_OK;
+    break;
+
+    case KNX_DPT_FORMAT_F32 :
+      for (i=0; i < count; i++) KnxDptEncodeF32((float)values[i], &dpt[4*i]);
+      return KNX_DEVICE_OK;
+    break;
+
+    default :
+      return KNX_DEVICE_ERROR;
+    break;
+  }
+}
+
+template e_KnxDeviceStatus ConvertToDptArray <unsigned char>(const unsigned char values[], byte dpt[], word count, byte dptFormat);
+template e_KnxDeviceStatus ConvertToDptArray <char>(const char values[], byte dpt[], word count, byte dptFormat);
+template e_KnxDeviceStatus ConvertToDptArray <unsigned int>(const unsigned int values[], byte dpt[], word count, byte dptFormat);
+template e_KnxDeviceStatus ConvertToDptArray <int>(const int values[], byte dpt[], word count, byte dptFormat);
+template e_KnxDeviceStatus ConvertToDptArray <unsigned long>(const unsigned long values[], byte dpt[], word count, byte dptFormat);
+template e_KnxDeviceStatus ConvertToDptArray <long>(const long values[], byte dpt[], word count, byte dptFormat);
+template e_KnxDeviceStatus ConvertToDptArray <float>(const float values[], byte dpt[], word count, byte dptFormat);
+template e_KnxDeviceStatus ConvertToDptArray <double>(const double values[], byte dpt[], word count, byte dptFormat);
+
 // EOF
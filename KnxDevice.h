@@ -19,7 +19,8 @@
 // File : KnxDevice.h
 // Author : Franck Marini
 // Description : KnxDevice Abstraction Layer
-// Module dependencies : HardwareSerial, KnxTelegram, KnxComObject, KnxTpUart, ActionRingBuffer
+// Module dependencies : HardwareSerial, KnxTelegram, KnxComObject, KnxTpUart, ActionRingBuffer, KnxTxLatency,
+//                       KnxProfiler, KnxProbes
 
 #ifndef KNXDEVICE_H
 #define KNXDEVICE_H
@@ -27,8 +28,12 @@
 #include "Arduino.h"
 #include "KnxTelegram.h"
 #include "KnxComObject.h"
+#include "KnxDPTCodec.h"
 #include "ActionRingBuffer.h"
 #include "KnxBusCoupler.h"
+#include "KnxTxLatency.h"
+#include "KnxProfiler.h"
+#include "KnxProbes.h"
 
 
 #define HAVE_TPUART
@@ -46,6 +51,12 @@
 // !!!!!!!!!!!!!!! FLAG OPTIONS !!!!!!!!!!!!!!!!!
 // DEBUG :
 // #define KNXDEVICE_DEBUG_INFO   // Uncomment to activate info traces
+// TX LATENCY :
+// #define KNXDEVICE_TX_LATENCY    // Uncomment to activate the TX latency histograms (about 1,9KB of RAM + 4 bytes per TX action)
+// READ RESPONSES :
+// #define KNXDEVICE_NO_FAST_READ  // Uncomment to queue the read responses in the TX action list (behind the writes)
+// REPEATED TELEGRAMS :
+// #define KNXDEVICE_NO_REPEAT_FILTER // Uncomment to dispatch the repetitions of the telegrams already processed
 
 // Values returned by the KnxDevice member functions :
 enum e_KnxDeviceStatus {
@@ -70,6 +81,14 @@ inline word G_ADDR(byte maingrp, byte subgrp)
 
 #define ACTIONS_QUEUE_SIZE 16
 
+// Max nb of read responses waiting on the fast path (beyond, the responses are queued in the TX action list)
+#define READ_RESPONSES_NB 8
+
+// Nb of processed telegrams remembered to detect their repetitions, and time during which they are remembered
+// NB : a repetition is sent by the source when it did not get the ACK of the telegram (in less than 100ms normally)
+#define REPEAT_FILTER_NB 8
+#define REPEAT_FILTER_WINDOW_MICROS 500000
+
 // KnxDevice internal state
 enum e_KnxDeviceState {
   INIT,
@@ -81,7 +100,8 @@ enum e_KnxDeviceState {
 enum e_KnxDeviceTxActionType {
   EIB_READ_REQUEST,
   EIB_WRITE_REQUEST,
-  EIB_RESPONSE_REQUEST
+  EIB_RESPONSE_REQUEST,
+  EIB_TELEGRAM_REQUEST // telegram built by the application (e.g. forwarded by the KNXnet/IP tunneling server)
 };
 
 struct struct_tx_action{
@@ -94,26 +114,60 @@ struct struct_tx_action{
       byte notUsed;
     };
     byte *valuePtr; // Field used in case of long value (width > 1 byte), space is allocated dynamically
+                    // or in case of EIB_TELEGRAM_REQUEST (raw telegram bytes)
   };
+#if defined(KNXDEVICE_TX_LATENCY)
+  unsigned long queuedMicros; // Time (in usec) when the action was queued
+#endif
 };// type_tx_action;
 
 typedef struct struct_tx_action type_tx_action;
 
+// Read response waiting on the fast path
+typedef struct {
+  byte index;                  // Index of the read ComObject
+  unsigned long receivedMicros; // Time (in usec) when the (first) read request was received
+} type_read_response;
+
+// Telegram remembered by the repeat filter
+typedef struct {
+  word source;                  // Source address
+  word target;                  // Target address
+  word hash;                    // Hash of the command and payload
+  unsigned long receivedMicros; // Time (in usec) when the telegram was received
+} type_repeat_filter_record;
+
 
 // Callback function to catch and treat KNX events
 // The definition shall be provided by the end-user
 extern void knxEvents(byte);
 
+// Callback function called with the telegrams received from the bus (see setTelegramCallback())
+typedef void (*type_KnxTelegramCallbackFctPtr) (const KnxTelegram& telegram);
+
 
 // --------------- Definition of the functions for DPT translation --------------------
 // Functions to convert a DPT format to a standard C type
-// NB : only the usual DPT formats are supported (U16, V16, U32, V32, F16 and F32)
+// NB : the usual DPT formats are supported (U16, V16, U32, V32, F16 and F32) plus B24,
+// any other single field format is converted by the generic DPT codec (see KnxDPTCodec.h)
+// The signed formats (V16, V32) are sign extended, the results are the same as with ConvertFromDptArray()
 template <typename T> e_KnxDeviceStatus ConvertFromDpt(const byte dpt[], T& result, byte dptFormat);
 
 // Functions to convert a standard C type to a DPT format
-// NB : only the usual DPT formats are supported (U16, V16, U32, V32, F16 and F32)
+// NB : the usual DPT formats are supported (U16, V16, U32, V32, F16 and F32),
+// any other single field format is converted by the generic DPT codec (see KnxDPTCodec.h)
 template <typename T> e_KnxDeviceStatus ConvertToDpt(T value, byte dpt[], byte dptFormat);
 
+// Functions to convert an array of DPT values to an array of standard C types (bulk decoding)
+// The 'count' DPT values shall be packed one after the other in 'dpt' (2, 3 or 4 bytes each depending on the format)
+// The format is evaluated once per call, so that the per value loops can be vectorized by the compiler
+// NB : supported DPT formats are U16, V16, U32, V32, F16, F32 and B24
+template <typename T> e_KnxDeviceStatus ConvertFromDptArray(const byte dpt[], T result[], word count, byte dptFormat);
+
+// Functions to convert an array of standard C types to an array of DPT values (bulk encoding)
+// NB : supported DPT formats are U16, V16, U32, V32, F16, F32 and B24
+template <typename T> e_KnxDeviceStatus ConvertToDptArray(const T values[], byte dpt[], word count, byte dptFormat);
+
 
 class KnxDevice {
                                                     // The value shall be provided by the end-user
@@ -126,14 +180,28 @@ class KnxDevice {
     word _lastRXTimeMicros;                         // Time (in msec) of the last Tpuart Rx activity;
     word _lastTXTimeMicros;                         // Time (in msec) of the last Tpuart Tx activity;
     KnxTelegram _txTelegram;                        // Telegram object used for telegrams sending
-    KnxTelegram *_rxTelegram;                       // Reference to the telegram received by the TPUART
 	unsigned long _lastBusTime;						// Last bus response (read or write ack)
 	unsigned long _busWriteTime;					// Last time written to bus
+    type_KnxTelegramCallbackFctPtr _telegramCallbackFct; // Called with the received telegrams (NULL if none)
+#if defined(KNXDEVICE_TX_LATENCY)
+    type_tx_latency_trace _txTrace;                 // Time stamps of the transmission in progress
+    KnxTxLatency _txLatency;                        // Latency histograms of the acknowledged transmissions
+#endif
+#if !defined(KNXDEVICE_NO_FAST_READ)
+    type_read_response _readResponses[READ_RESPONSES_NB]; // Read responses to be sent ahead of the TX action list
+    byte _readResponsesNb;                          // Nb of read responses waiting (oldest first)
+    unsigned long _mergedReadsNb;                   // Nb of read requests merged into an already waiting response
+#endif
+#if !defined(KNXDEVICE_NO_REPEAT_FILTER)
+    type_repeat_filter_record _repeatFilter[REPEAT_FILTER_NB]; // Last processed telegrams
+    byte _repeatFilterNb;                           // Nb of valid records
+    byte _repeatFilterIndex;                        // Index of the next record to be written (the oldest one)
+    unsigned long _suppressedRepeatsNb;             // Nb of repetitions not dispatched
+#endif
 
 #if defined(KNXDEVICE_DEBUG_INFO)
     byte _nbOfInits;                                // Nb of Initialized Com Objects
-    String *_debugStrPtr;
-    static const char _debugInfoText[];
+    KnxTraceRing *_traceRing;                       // Ring of the debug traces (NULL if not traced)
 #endif
 
   // Constructor, Destructor
@@ -152,6 +220,9 @@ class KnxDevice {
 #ifdef HAVE_TPUART
     e_KnxDeviceStatus begin(HardwareSerial& serial, word physicalAddr,
                           KnxComObject** dynComObjects_, byte numberObjects);
+    // TPUART connected through a byte stream transport (e.g. KnxPosixSerialTransport on Linux)
+    e_KnxDeviceStatus begin(KnxSerialTransport& transport, word physicalAddr,
+                          KnxComObject** dynComObjects_, byte numberObjects);
 #endif
 
 #ifdef HAVE_STKNX
@@ -160,6 +231,10 @@ class KnxDevice {
     void setReceivedTelegram(KnxTelegram &telegram);
 #endif
 
+    // Any other bus coupler (e.g. KnxIpRoutingCoupler on Linux)
+    // The coupler shall be allocated with new, the device takes its ownership (deleted by end())
+    e_KnxDeviceStatus begin(KnxBusCoupler *busCoupler, KnxComObject** dynComObjects_, byte numberObjects);
+
     e_KnxDeviceStatus commonInit(KnxComObject** dynComObjects_,
                           byte numberObjects);
 
@@ -200,17 +275,56 @@ class KnxDevice {
     // NB : the function is asynchroneous, the update completion is notified by the knxEvents() callback
     void update(byte objectIndex);
 
+    // Send a telegram built by the application (any target address and command)
+    // When the telegram writes (or responds to) a local com object with W (or U) attribute, the local value is
+    // updated and notified as if the telegram was received from the bus
+    // NB : the function is asynchroneous, the telegram is queued in the TX action list
+    e_KnxDeviceStatus sendTelegram(const KnxTelegram& telegram);
+
+    // Set the function called with every telegram received from the bus and addressed to the device
+    // (repetitions filtered), before the telegram is processed, NULL to remove it
+    // e.g. a function calling KnxIpTunnelingServer::IndicateTelegram() so that the tunneling clients see the bus
+    // NB : the whole bus traffic is available through the SetFrameCallback() function of the bus coupler
+    void setTelegramCallback(type_KnxTelegramCallbackFctPtr telegramFct);
+
     // The function returns true if there is rx/tx activity ongoing, else false
     boolean isActive(void) const;
 
     // Inline Debug function (definition later in this file)
-    // Set the string used for debug traces
+    // Set the ring recording the debug traces (the ring is not owned by the device)
 #if defined(KNXDEVICE_DEBUG_INFO)
-    void SetDebugString(String *strPtr);
+    void SetTraceRing(KnxTraceRing *traceRing);
 #endif
 
     unsigned long timeSinceBus();
 
+#if defined(KNXDEVICE_TX_LATENCY)
+    // TX latency percentiles (in usec), from the write()/update() request to the bus ACK
+    // Only the acknowledged transmissions are counted, 0 is returned when no transmission has been counted
+    // "percentile" in 0..100 (e.g. 99 for the latency below which 99% of the transmissions are)
+    // NB : the histograms are log-scale, the returned value is the upper limit of the bucket holding the percentile
+    unsigned long getTxLatencyPercentile(e_KnxTxLatencyStage stage, e_KnxPriority priority, byte percentile) const;
+
+    // TOTAL stage percentile of a com object (only the first KNX_TX_LATENCY_OBJECTS_NB com objects are tracked)
+    unsigned long getTxObjectLatencyPercentile(byte objectIndex, byte percentile) const;
+
+    // Access to the whole histograms, and reset of them
+    const KnxTxLatency& getTxLatency(void) const;
+    void clearTxLatency(void);
+#endif
+
+#if !defined(KNXDEVICE_NO_FAST_READ)
+    // Nb of read requests answered by the response of a previous read of the same com object
+    // (read received while the response was still waiting for the bus)
+    unsigned long getMergedReadsNb(void) const;
+#endif
+
+#if !defined(KNXDEVICE_NO_REPEAT_FILTER)
+    // Nb of repeated telegrams not dispatched because the original telegram was already processed
+    // (the repetitions are acknowledged by the bus coupler anyway)
+    unsigned long getSuppressedRepeatsNb(void) const;
+#endif
+
   private:
     // Static GetTpUartEvents() function called by the KnxTpUart layer (callback)
     static void GetTpUartEvents(e_KnxBusCouplerEvent event);
@@ -218,22 +332,90 @@ class KnxDevice {
     // Static TxTelegramAck() function called by the KnxTpUart layer (callback)
     static void TxTelegramAck(e_BusCouplerTxAck);
 
+    // Process a telegram popped from the bus coupler RX queue (READ/RESPONSE/WRITE commands)
+    void ProcessReceivedTelegram(const type_buscoupler_rx_telegram& rxTelegram);
+
+    // Append an action to the TX action list (time stamped for the TX latency histograms)
+    void AppendTxAction(type_tx_action& action);
+
+    // Hand the TX telegram over to the bus coupler, "objectIndex" is the index of the com object
+    // (KNX_TX_LATENCY_NO_OBJECT for a telegram built by the application)
+    void SendTxTelegram(byte objectIndex);
+
+    // Answer a read request of a com object with R attribute
+    // The response is sent ahead of the TX action list, with the value of the com object when the bus is free.
+    // The reads of a com object whose response is still waiting are merged into this response.
+    void RespondToRead(byte objectIndex, unsigned long receivedMicros);
+#if !defined(KNXDEVICE_NO_FAST_READ)
+    // Send the oldest waiting read response, return false if there is none
+    // NB : the response is built when the bus is free, not prepared at the read reception, so that it carries
+    // the value written meanwhile (e.g. by a telegram received from the bus)
+    boolean SendReadResponse(void);
+#endif
+
+#if !defined(KNXDEVICE_NO_REPEAT_FILTER)
+    // Return true if the telegram is the repetition of a telegram processed less than REPEAT_FILTER_WINDOW_MICROS ago
+    // (same source, target, command and payload), else remember the telegram and return false
+    boolean IsRepetition(const type_buscoupler_rx_telegram& rxTelegram);
+#endif
+
+    // Call the user knxEvents() callback (profiled with KNX_PROFILING)
+    // Inline function (definition later in this file)
+    void NotifyKnxEvents(byte objectIndex);
+
 #if defined(KNXDEVICE_DEBUG_INFO)
     // Inline Debug function (definition later in this file)
-    void DebugInfo(const char[]) const;
+    void DebugInfo(e_KnxTraceEvent event, word arg0 = 0, word arg1 = 0) const;
 #endif
 };
 
+#if defined(KNXDEVICE_TX_LATENCY)
+inline unsigned long KnxDevice::getTxLatencyPercentile(e_KnxTxLatencyStage stage, e_KnxPriority priority,
+                                                       byte percentile) const
+{ return _txLatency.GetStageHistogram(stage, priority).GetPercentile(percentile); }
+
+inline unsigned long KnxDevice::getTxObjectLatencyPercentile(byte objectIndex, byte percentile) const
+{
+  const KnxLatencyHistogram *histogram = _txLatency.GetObjectHistogram(objectIndex);
+  return (histogram != NULL) ? histogram->GetPercentile(percentile) : 0;
+}
+
+inline const KnxTxLatency& KnxDevice::getTxLatency(void) const { return _txLatency; }
+
+inline void KnxDevice::clearTxLatency(void) { _txLatency.Clear(); }
+#endif
+
+#if !defined(KNXDEVICE_NO_FAST_READ)
+inline unsigned long KnxDevice::getMergedReadsNb(void) const { return _mergedReadsNb; }
+#endif
+
+#if !defined(KNXDEVICE_NO_REPEAT_FILTER)
+inline unsigned long KnxDevice::getSuppressedRepeatsNb(void) const { return _suppressedRepeatsNb; }
+#endif
+
+
+inline void KnxDevice::setTelegramCallback(type_KnxTelegramCallbackFctPtr telegramFct)
+{ _telegramCallbackFct = telegramFct; }
+
+
+inline void KnxDevice::NotifyKnxEvents(byte objectIndex)
+{
+  KNX_PROFILE_BEGIN(startTicks);
+  knxEvents(objectIndex);
+  KNX_PROFILE_EVENT_END(objectIndex, startTicks);
+}
+
+
 #if defined(KNXDEVICE_DEBUG_INFO)
-// Set the string used for debug traces
-inline void KnxDevice::SetDebugString(String *strPtr) {_debugStrPtr = strPtr;}
+// Set the ring recording the debug traces
+inline void KnxDevice::SetTraceRing(KnxTraceRing *traceRing) {_traceRing = traceRing;}
 #endif
 
 
 #if defined(KNXDEVICE_DEBUG_INFO)
-inline void KnxDevice::DebugInfo(const char comment[]) const
+inline void KnxDevice::DebugInfo(e_KnxTraceEvent event, word arg0, word arg1) const
 {
-	if (_debugStrPtr != NULL) *_debugStrPtr += String(_debugInfoText) + String(comment);
+	if (_traceRing != NULL) _traceRing->Record(event, arg0, arg1);
 }
 #endif
 
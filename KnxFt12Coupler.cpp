@@ -0,0 +1,442 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxFt12Coupler.cpp
+// Author : Franck Marini
+// Description : Communication with a cEMI interface module over FT1.2 serial framing
+// Module dependencies : KnxSerialTransport, KnxCemi, KnxTelegram, KnxComObject, KnxComObjectTable
+
+#include "KnxFt12Coupler.h"
+
+// Reset sequence steps
+enum e_Ft12ResetStep {
+  FT12_RESET_NOT_STARTED = 0,
+  FT12_RESET_WAITING_ACK,          // FT1.2 reset request sent, waiting for the acknowledge
+  FT12_RESET_WAITING_PROPWRITE_CON, // Link layer mode setting sent, waiting for the M_PropWrite.con
+  FT12_RESET_DONE
+};
+
+// M_PropWrite.req setting the cEMI server communication mode to link layer
+static const byte commModeRequest[] = { KNX_CEMI_M_PROPWRITE_REQ,
+  (byte)(KNX_CEMI_SERVER_OBJECT_TYPE >> 8), (byte)KNX_CEMI_SERVER_OBJECT_TYPE,
+  0x01,                      // object instance
+  KNX_CEMI_PID_COMM_MODE,
+  0x10, 0x01,                // 1 element, start index 1
+  KNX_CEMI_COMM_MODE_LINK_LAYER };
+
+static const byte resetRequest[FT12_FIXED_FRAME_SIZE] = { FT12_START_FIXED, FT12_CTRL_RESET_REQ, FT12_CTRL_RESET_REQ, FT12_END };
+
+// true if "duration" msec are elapsed since "startTime"
+static inline boolean IsElapsed(unsigned long startTime, unsigned long duration) { return (KnxMillis() - startTime >= duration); }
+
+
+#if defined(ESP32)
+KnxFt12Coupler::KnxFt12Coupler(HardwareSerial &serial, word physicalAddr, unsigned long baudRate) :
+  KnxFt12Coupler(*new KnxArduinoSerialTransport(serial, KNX_SERIAL_TRANSPORT_ESP32_RX_PIN,
+                                                 KNX_SERIAL_TRANSPORT_ESP32_TX_PIN, baudRate), physicalAddr)
+#else
+KnxFt12Coupler::KnxFt12Coupler(HardwareSerial &serial, word physicalAddr, unsigned long baudRate) :
+  KnxFt12Coupler(*new KnxArduinoSerialTransport(serial, baudRate), physicalAddr)
+#endif
+{
+  _ownedTransport = &_transport;
+}
+
+
+KnxFt12Coupler::KnxFt12Coupler(KnxSerialTransport &transport, word physicalAddr) :
+  _ownedTransport(NULL),
+  _transport(transport),
+  _physicalAddr(physicalAddr)
+{
+  _rx.state = RX_RESET;
+  _rx.addressedComObjectIndex = 0;
+  _rx.overflowsNb = 0;
+  _tx.state = TX_RESET;
+  _tx.sentTelegram = NULL;
+  _tx.ackFctPtr = NULL;
+  _tx.nbRemainingBytes = 0;
+  _tx.txByteIndex = 0;
+  _evtCallbackFct = NULL;
+  _resetRespTimeout = 0;
+  _resetAttempts = KNX_FT12_RESET_ATTEMPTS;
+  _resetStep = FT12_RESET_NOT_STARTED;
+  _rxIndex = 0;
+  _rxFrameSize = 0;
+  _rxByteTimeMillis = 0;
+  _rxLastCtrl = 0;
+  _txFrameSize = 0;
+  _txFcb = true;
+  _txFrameWritten = false;
+  _txRepeatsNb = 0;
+  _txTimeMillis = 0;
+  _txRepeatedFramesNb = 0;
+  _resetIndicated = false;
+#if defined(KNXTPUART_DEBUG_INFO) || defined(KNXTPUART_DEBUG_ERROR)
+  _traceRing = NULL;
+#endif
+}
+
+
+// Destructor
+KnxFt12Coupler::~KnxFt12Coupler()
+{
+  if ( (_rx.state > RX_RESET) || (_tx.state > TX_RESET) || (_resetStep != FT12_RESET_NOT_STARTED) ) _transport.End();
+  if (_ownedTransport) delete _ownedTransport;
+}
+
+
+// Reset the interface module
+// Each call goes on with the sequence : FT1.2 reset request -> acknowledge -> link layer mode setting -> confirmation
+// The sequence is restarted every KNX_FT12_RESETRESP_TIMEOUT msec as long as it is not completed
+byte KnxFt12Coupler::Reset(void)
+{
+  if ( (_resetStep == FT12_RESET_NOT_STARTED) || (_resetStep == FT12_RESET_DONE)
+    || ((long)(KnxMillis() - _resetRespTimeout) >= 0) )
+  {
+    if (!_resetAttempts)
+    {
+      _resetAttempts = KNX_FT12_RESET_ATTEMPTS;
+      _resetStep = FT12_RESET_NOT_STARTED;
+#if defined(KNXTPUART_DEBUG_ERROR)
+      DebugError(KNX_TRACE_COUPLER_RESET_FAILED);
+#endif
+      return KNX_BUSCOUPLER_ERROR_ATTEMPT_EXCEED;
+    }
+    --_resetAttempts;
+    if (_tx.state > TX_IDLE) EndTransmission(BUSCOUPLER_RESET_RESPONSE);
+    _rx.state = RX_RESET; _tx.state = TX_RESET;
+    // (re)start the serial communication
+    if (_resetStep != FT12_RESET_NOT_STARTED) _transport.End();
+    _resetStep = FT12_RESET_WAITING_ACK;
+    _resetRespTimeout = KnxMillis() + KNX_FT12_RESETRESP_TIMEOUT;
+    _rxIndex = 0;
+    _rxLastCtrl = 0;
+    if (_transport.Begin() != KNX_SERIAL_TRANSPORT_OK)
+    {
+#if defined(KNXTPUART_DEBUG_ERROR)
+      DebugError(KNX_TRACE_COUPLER_TRANSPORT_ERROR);
+#endif
+      return KNX_BUSCOUPLER_ERROR;
+    }
+    _transport.Write(resetRequest, sizeof(resetRequest));
+  }
+
+  ReceiveBytes(); // the parser goes on with the reset sequence
+  _transport.Yield();
+
+  if (_resetStep != FT12_RESET_DONE) return KNX_BUSCOUPLER_ERROR;
+  _rx.state = RX_INIT; _tx.state = TX_INIT;
+  _resetAttempts = KNX_FT12_RESET_ATTEMPTS;
+#if defined(KNXTPUART_DEBUG_INFO)
+  DebugInfo(KNX_TRACE_COUPLER_RESET_OK);
+#endif
+  return KNX_BUSCOUPLER_OK;
+}
+
+
+byte KnxFt12Coupler::AttachComObjectsList(KnxComObject comObjectsList[], byte listSize)
+{
+  if ((_rx.state!=RX_INIT) || (_tx.state!=TX_INIT)) return KNX_BUSCOUPLER_ERROR_NOT_INIT_STATE;
+#if defined(KNXTPUART_DEBUG_INFO)
+  _comObjects.Attach(comObjectsList, listSize, _traceRing);
+#else
+  _comObjects.Attach(comObjectsList, listSize);
+#endif
+  return KNX_BUSCOUPLER_OK;
+}
+
+// Attach a list of com objects
+// NB1 : only the objects with "communication" attribute are considered by the coupler
+// NB2 : In case of objects with identical address, the object with highest index only is considered
+// return KNX_BUSCOUPLER_ERROR_NOT_INIT_STATE (254) if the coupler is not in Init state
+// The function must be called prior to Init() execution
+byte KnxFt12Coupler::AttachComObjectsList(KnxComObject** comObjectsList, byte listSize)
+{
+  if ((_rx.state!=RX_INIT) || (_tx.state!=TX_INIT)) return KNX_BUSCOUPLER_ERROR_NOT_INIT_STATE;
+#if defined(KNXTPUART_DEBUG_INFO)
+  _comObjects.Attach(comObjectsList, listSize, _traceRing);
+#else
+  _comObjects.Attach(comObjectsList, listSize);
+#endif
+  return KNX_BUSCOUPLER_OK;
+}
+
+
+// Init
+// Init must be called after every reset() execution
+byte KnxFt12Coupler::Init(void)
+{
+  if ((_rx.state!=RX_INIT) || (_tx.state!=TX_INIT)) return KNX_BUSCOUPLER_ERROR_NOT_INIT_STATE;
+  if (_evtCallbackFct == NULL) return KNX_BUSCOUPLER_ERROR_NULL_EVT_CALLBACK_FCT;
+  if (_tx.ackFctPtr == NULL) return KNX_BUSCOUPLER_ERROR_NULL_ACK_CALLBACK_FCT;
+  _rx.state = RX_IDLE_WAITING_FOR_CTRL_FIELD;
+  _tx.state = TX_IDLE;
+#if defined(KNXTPUART_DEBUG_INFO)
+  if (!_comObjects.GetAssignedNb()) DebugInfo(KNX_TRACE_COUPLER_INIT_EMPTY_LIST);
+  DebugInfo(KNX_TRACE_COUPLER_INIT_NORMAL);
+#endif
+  return KNX_BUSCOUPLER_OK;
+}
+
+
+// Send a KNX telegram
+// The telegram is converted straight into the FT1.2 frame buffer (L_Data.req), the frame is written by the TX task
+// returns ERROR (255) if TX is not available, else returns OK (0)
+// NB : the source address is forced to the coupler physical address value
+byte KnxFt12Coupler::SendTelegram(KnxTelegram& sentTelegram)
+{
+  if (_tx.state != TX_IDLE) return KNX_BUSCOUPLER_ERROR; // TX not initialized or busy
+
+  if (sentTelegram.GetSourceAddress() != _physicalAddr)
+  {
+    sentTelegram.SetSourceAddress(_physicalAddr);
+    sentTelegram.UpdateChecksum();
+  }
+  BuildFrame(KnxTelegramToCemi(sentTelegram, KNX_CEMI_L_DATA_REQ, _txFrame + FT12_HEADER_SIZE));
+  _txFrameWritten = false;
+  _txRepeatsNb = 0;
+  _tx.sentTelegram = &sentTelegram;
+  _tx.state = TX_TELEGRAM_SENDING_ONGOING;
+  return KNX_BUSCOUPLER_OK;
+}
+
+
+// The telegrams are received from the interface module by the RX task
+void KnxFt12Coupler::SetReceivedTelegram(KnxTelegram &telegram) {}
+
+
+// Reception task
+// The module sends whole frames, the task period only impacts the latency (no byte level timing constraint)
+void KnxFt12Coupler::RXTask(void)
+{
+  ReceiveBytes();
+  if (_resetIndicated)
+  { // the module has reset, the application restarts the coupler (see BUSCOUPLER_EVENT_RESET)
+    _resetIndicated = false;
+    if (_evtCallbackFct) _evtCallbackFct(BUSCOUPLER_EVENT_RESET);
+  }
+}
+
+
+// Transmission task
+void KnxFt12Coupler::TXTask(void)
+{
+  switch (_tx.state)
+  {
+    case TX_TELEGRAM_SENDING_ONGOING :
+      if (!_txFrameWritten)
+      { // the whole frame is written in one go, as soon as the transport has room for it
+        if (_transport.AvailableForWrite() >= _txFrameSize) WriteFrame();
+      }
+      else if (IsElapsed(_txTimeMillis, FT12_ACK_TIMEOUT))
+      { // no acknowledge, the frame is repeated with the same frame count bit
+        if (_txRepeatsNb < FT12_REPEATS_NB)
+        {
+          _txRepeatsNb++;
+          _txRepeatedFramesNb++;
+#if defined(KNXTPUART_DEBUG_INFO)
+          DebugInfo(KNX_TRACE_COUPLER_REPEATED_FRAME, _txRepeatsNb);
+#endif
+          WriteFrame();
+        }
+        else EndTransmission(NO_ANSWER_TIMEOUT);
+      }
+      break;
+
+    case TX_WAITING_ACK : // frame acknowledged, waiting for the L_Data.con
+      if (IsElapsed(_txTimeMillis, FT12_CONFIRM_TIMEOUT)) EndTransmission(NO_ANSWER_TIMEOUT);
+      break;
+
+    default : break;
+  }
+}
+
+
+boolean KnxFt12Coupler::WaitForRxData(unsigned long timeoutMicros) { return _transport.WaitForData(timeoutMicros); }
+
+
+boolean KnxFt12Coupler::GetMonitoringData(type_MonitorData&) { return false; }
+
+
+void KnxFt12Coupler::ReceiveBytes(void)
+{
+  byte chunk[KNXFT12_RX_CHUNK_SIZE];
+  word nb;
+
+  // a frame interrupted for too long is dropped
+  if (_rxIndex && IsElapsed(_rxByteTimeMillis, FT12_INTER_CHAR_TIMEOUT)) _rxIndex = 0;
+  while ((nb = _transport.ReadBytes(chunk, sizeof(chunk))) > 0)
+  {
+    _rxByteTimeMillis = KnxMillis();
+    for (word i = 0; i < nb; i++) ParseByte(chunk[i]);
+  }
+}
+
+
+void KnxFt12Coupler::ParseByte(byte data)
+{
+  if (!_rxIndex)
+  { // waiting for a frame start or an acknowledge
+    switch (data)
+    {
+      case FT12_ACK :
+        if (_resetStep == FT12_RESET_WAITING_ACK)
+        { // reset acknowledged, the module is set to link layer mode
+          _txFcb = true; // the frame count bit restarts after a reset
+          memcpy(_txFrame + FT12_HEADER_SIZE, commModeRequest, sizeof(commModeRequest));
+          BuildFrame(sizeof(commModeRequest));
+          WriteFrame();
+          _resetStep = FT12_RESET_WAITING_PROPWRITE_CON;
+        }
+        else if ((_tx.state == TX_TELEGRAM_SENDING_ONGOING) && _txFrameWritten)
+        { // L_Data.req frame acknowledged, the confirmation follows once the telegram is sent on the bus
+          _tx.state = TX_WAITING_ACK;
+          _txTimeMillis = KnxMillis();
+        }
+        break;
+
+      case FT12_START_VARIABLE :
+        _rxFrame[0] = data; _rxIndex = 1; _rxFrameSize = FT12_HEADER_SIZE;
+        break;
+
+      case FT12_START_FIXED :
+        _rxFrame[0] = data; _rxIndex = 1; _rxFrameSize = FT12_FIXED_FRAME_SIZE;
+        break;
+
+      default : break; // garbage
+    }
+    return;
+  }
+
+  _rxFrame[_rxIndex++] = data;
+  if ((_rxFrame[0] == FT12_START_VARIABLE) && (_rxIndex == 4))
+  { // variable frame header : 0x68 L L 0x68
+    if ( (_rxFrame[1] != _rxFrame[2]) || (_rxFrame[3] != FT12_START_VARIABLE) || (_rxFrame[1] < 2)
+      || (_rxFrame[1] + 6 > FT12_FRAME_MAX_SIZE) )
+    { _rxIndex = 0; return; } // invalid header, resynchronization
+    _rxFrameSize = _rxFrame[1] + 6;
+  }
+  if (_rxIndex < _rxFrameSize) return;
+
+  // complete frame
+  _rxIndex = 0;
+  if ((_rxFrame[0] == FT12_START_VARIABLE) && (_rxFrame[_rxFrameSize - 1] == FT12_END)) ProcessFrame();
+  // NB : fixed length frames are not expected from the module, they are ignored
+}
+
+
+void KnxFt12Coupler::ProcessFrame(void)
+{
+  byte length = _rxFrame[1], checksum = 0;
+  byte ctrl = _rxFrame[FT12_HEADER_SIZE - 1];
+
+  for (byte i = 0; i < length; i++) checksum += _rxFrame[FT12_HEADER_SIZE - 1 + i];
+  if (checksum != _rxFrame[FT12_HEADER_SIZE - 1 + length]) return; // no acknowledge, the module repeats the frame
+
+  _transport.Write(FT12_ACK);
+  // a frame with the same frame count bit as the previous one is a repetition (our acknowledge got lost)
+  if ((ctrl & FT12_CTRL_FCV_MASK) && (ctrl == _rxLastCtrl)) return;
+  _rxLastCtrl = ctrl;
+  ProcessCemi(_rxFrame + FT12_HEADER_SIZE, length - 1);
+}
+
+
+void KnxFt12Coupler::ProcessCemi(const byte cemi[], byte length)
+{
+  type_buscoupler_rx_telegram rxTelegram;
+  byte index;
+
+  switch (cemi[0])
+  {
+    case KNX_CEMI_L_DATA_IND :
+      if (_rx.state < RX_IDLE_WAITING_FOR_CTRL_FIELD) break;
+      // the cEMI frame is converted straight from the reception buffer into the queued structure
+      if (KnxCemiToTelegram(cemi, length, rxTelegram.telegram) != KNX_CEMI_OK) break;
+      if (!rxTelegram.telegram.IsMulticast() || !_comObjects.IsAddressAssigned(rxTelegram.telegram.GetTargetAddress(), index)) break;
+      rxTelegram.comObjectIndex = index;
+      rxTelegram.timeMicros = KnxMicros();
+      rxTelegram.telegram.Copy(_rx.receivedTelegram);
+      _rx.addressedComObjectIndex = index;
+      QueueReceivedTelegram(_rx, rxTelegram);
+      _evtCallbackFct(BUSCOUPLER_EVENT_RECEIVED_EIB_TELEGRAM);
+      break;
+
+    case KNX_CEMI_L_DATA_CON :
+      // the confirmation may come before the TX task has seen the acknowledge
+      if ((_tx.state != TX_WAITING_ACK) && !((_tx.state == TX_TELEGRAM_SENDING_ONGOING) && _txFrameWritten)) break;
+      if (length < (word)cemi[1] + 3) break;
+      EndTransmission((cemi[2 + cemi[1]] & KNX_CEMI_CTRL1_CONFIRM_ERROR_MASK) ? NACK_RESPONSE : ACK_RESPONSE);
+      break;
+
+    case KNX_CEMI_M_PROPWRITE_CON :
+      // a confirmation with 0 element means the property writing failed, the reset sequence is then restarted
+      if ((_resetStep == FT12_RESET_WAITING_PROPWRITE_CON) && (length >= sizeof(commModeRequest) - 1) && (cemi[5] >> 4))
+        _resetStep = FT12_RESET_DONE;
+      break;
+
+    case KNX_CEMI_M_RESET_IND :
+      if (_resetStep != FT12_RESET_DONE) break; // reset sequence ongoing
+      if (_tx.state > TX_IDLE) EndTransmission(BUSCOUPLER_RESET_RESPONSE);
+      _rx.state = RX_RESET; _tx.state = TX_RESET;
+      _resetIndicated = true;
+      break;
+
+    default : break;
+  }
+}
+
+
+void KnxFt12Coupler::BuildFrame(byte cemiLength)
+{
+  byte checksum = 0;
+
+  _txFrame[0] = FT12_START_VARIABLE;
+  _txFrame[1] = cemiLength + 1;
+  _txFrame[2] = cemiLength + 1;
+  _txFrame[3] = FT12_START_VARIABLE;
+  _txFrame[4] = FT12_CTRL_SEND_UDATA | (_txFcb ? FT12_CTRL_FCB_MASK : 0);
+  _txFcb = !_txFcb;
+  for (byte i = FT12_HEADER_SIZE - 1; i < FT12_HEADER_SIZE + cemiLength; i++) checksum += _txFrame[i];
+  _txFrame[FT12_HEADER_SIZE + cemiLength] = checksum;
+  _txFrame[FT12_HEADER_SIZE + cemiLength + 1] = FT12_END;
+  _txFrameSize = FT12_HEADER_SIZE + cemiLength + 2;
+}
+
+
+void KnxFt12Coupler::WriteFrame(void)
+{
+  _transport.Write(_txFrame, _txFrameSize);
+  _txFrameWritten = true;
+  _txTimeMillis = KnxMillis();
+}
+
+
+void KnxFt12Coupler::EndTransmission(e_BusCouplerTxAck ack)
+{
+  _tx.state = TX_IDLE;
+  if (_tx.ackFctPtr) _tx.ackFctPtr(ack);
+}
+
+
+// DEBUG purpose functions
+void KnxFt12Coupler::DEBUG_SendResetCommand(void) { _transport.Write(resetRequest, sizeof(resetRequest)); }
+
+void KnxFt12Coupler::DEBUG_SendStateReqCommand(void) {}
+
+// EOF
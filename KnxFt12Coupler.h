@@ -0,0 +1,269 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxFt12Coupler.h
+// Author : Franck Marini
+// Description : Communication with a cEMI interface module over FT1.2 serial framing
+// Module dependencies : KnxSerialTransport, KnxCemi, KnxTelegram, KnxComObject, KnxComObjectTable
+
+// ---------- FT1.2 framing (IEC 60870-5-2, as used by the KNX serial interface modules) -----------
+// Variable length frame : 0x68 L L 0x68 C <cEMI frame> CS 0x16
+//   L = nb of bytes from C up to the end of the cEMI frame, CS = sum of these bytes (modulo 256)
+//   C = 0x53/0x73 (host -> module) or 0xD3/0xF3 (module -> host), bit 0x20 is the frame count bit (FCB)
+//   toggled for each new frame, a repeated frame keeps the same FCB.
+// Fixed length frame : 0x10 C C 0x16, the host sends the reset request (C = 0x40)
+// Acknowledge : 0xE5, sent by the receiver of each frame
+//
+// The module exchanges whole cEMI frames : a telegram is sent with a single serial write (L_Data.req) and
+// confirmed by the module with a single L_Data.con frame once sent on the bus, instead of the TPUART byte by byte
+// pacing. The received L_Data.ind are converted straight from the reception buffer.
+// The module is set to the cEMI link layer mode during Reset().
+
+#ifndef KNXFT12COUPLER_H
+#define KNXFT12COUPLER_H
+
+#include "Arduino.h"
+#include "KnxSerialTransport.h"
+#include "KnxTelegram.h"
+#include "KnxComObject.h"
+#include "KnxComObjectTable.h"
+#include "KnxBusCoupler.h"
+#include "KnxCemi.h"
+
+// !!!!!!!!!!!!!!! FLAG OPTIONS !!!!!!!!!!!!!!!!!
+// RX : max nb of bytes pulled from the serial in a single bulk read by the RX task
+#ifndef KNXFT12_RX_CHUNK_SIZE
+#define KNXFT12_RX_CHUNK_SIZE 32
+#endif
+
+// DEBUG :
+// #define KNXTPUART_DEBUG_INFO   // Uncomment to activate info traces
+// #define KNXTPUART_DEBUG_ERROR  // Uncomment to activate error traces
+
+// FT1.2 framing
+#define FT12_START_VARIABLE         0x68
+#define FT12_START_FIXED            0x10
+#define FT12_END                    0x16
+#define FT12_ACK                    0xE5
+#define FT12_CTRL_RESET_REQ         0x40
+#define FT12_CTRL_SEND_UDATA        0x53
+#define FT12_CTRL_FCB_MASK          0x20
+#define FT12_CTRL_FCV_MASK          0x10
+#define FT12_CTRL_DIR_MASK          0x80 // set in the frames sent by the module
+#define FT12_HEADER_SIZE            5    // 0x68 L L 0x68 C
+#define FT12_FIXED_FRAME_SIZE       4
+#define FT12_FRAME_MAX_SIZE         (FT12_HEADER_SIZE + 64 + 2) // cEMI frames with additional info included
+
+// Timings (in msec)
+#define FT12_ACK_TIMEOUT            100  // Max wait time for the 0xE5 acknowledge
+#define FT12_CONFIRM_TIMEOUT        3000 // Max wait time for the L_Data.con (bus repetitions included)
+#define FT12_INTER_CHAR_TIMEOUT     50   // Max gap between 2 bytes of a frame
+#define FT12_REPEATS_NB             3    // Nb of repetitions when the acknowledge is missing
+
+#define KNX_FT12_RESETRESP_TIMEOUT  1000
+#define KNX_FT12_RESET_ATTEMPTS     100
+
+
+class KnxFt12Coupler : public KnxBusCoupler {
+    KnxSerialTransport *_ownedTransport;      // Transport allocated by the coupler object (NULL if provided by the user)
+    KnxSerialTransport& _transport;           // Byte stream transport connected to the interface module
+    const word _physicalAddr;                 // Individual address of the device
+    type_buscoupler_rx _rx;                   // Reception structure
+    type_buscoupler_tx _tx;                   // Transmission structure
+    type_EventCallbackFctPtr _evtCallbackFct; // Pointer to the EVENTS callback function
+    KnxComObjectTable _comObjects;            // Attached com objects, ordered by address
+    unsigned long _resetRespTimeout;          // End of the current reset sequence attempt
+    word _resetAttempts;                      // Nb of remaining reset sequence attempts
+    byte _resetStep;                          // Reset sequence step
+    byte _rxFrame[FT12_FRAME_MAX_SIZE];       // Frame being received
+    byte _rxIndex;                            // Nb of bytes of the frame being received (0 = waiting for a frame start)
+    byte _rxFrameSize;                        // Size of the frame being received (known after the header)
+    unsigned long _rxByteTimeMillis;          // Reception time of the last byte
+    byte _rxLastCtrl;                         // Control field of the last received frame (repetition detection)
+    byte _txFrame[FT12_FRAME_MAX_SIZE];       // Frame being sent
+    byte _txFrameSize;                        // Size of the frame being sent
+    boolean _txFcb;                           // Frame count bit of the next new frame
+    boolean _txFrameWritten;                  // True once the frame has been written to the transport
+    byte _txRepeatsNb;                        // Nb of repetitions of the frame being sent
+    unsigned long _txTimeMillis;              // Writing time of the frame being sent
+    word _txRepeatedFramesNb;                 // Total nb of repeated frames (missing acknowledge)
+    boolean _resetIndicated;                  // True when a M_Reset.ind has been received and not notified yet
+
+#if defined(KNXTPUART_DEBUG_INFO) || defined(KNXTPUART_DEBUG_ERROR)
+    KnxTraceRing *_traceRing;                 // Ring of the debug traces (NULL if not traced)
+#endif
+
+  public:
+    // Constructor / Destructor
+    // Arduino : interface module connected to a HW serial port (19200 baud by default)
+    KnxFt12Coupler(HardwareSerial& serial, word physicalAddr, unsigned long baudRate = 19200);
+    // Interface module connected through any byte stream transport (e.g. KnxPosixSerialTransport on Linux)
+    KnxFt12Coupler(KnxSerialTransport& transport, word physicalAddr);
+    ~KnxFt12Coupler();
+
+  // INLINED functions (see definitions later in this file)
+    // Set EVENTs / ACK callback functions
+    // return KNX_BUSCOUPLER_ERROR (255) if the parameter is NULL
+    // return KNX_BUSCOUPLER_ERROR_NOT_INIT_STATE (254) if the coupler is not in Init state
+    // else return OK
+    byte SetEvtCallback(type_EventCallbackFctPtr);
+    byte SetAckCallback(type_AckCallbackFctPtr);
+
+    byte GetStateIndication(void) const;
+    KnxTelegram& GetReceivedTelegram(void);
+    byte GetTargetedComObjectIndex(void) const;
+    boolean IsActive(void) const;
+    boolean IsTxBusy(void) const;
+    boolean PopReceivedTelegram(type_buscoupler_rx_telegram&);
+    word GetRxOverflowsNb(void) const;
+
+    // Nb of frames repeated because of a missing FT1.2 acknowledge
+    word GetRepeatedFramesNb(void) const;
+
+#if defined(KNXTPUART_DEBUG_INFO) || defined(KNXTPUART_DEBUG_ERROR)
+    void SetTraceRing(KnxTraceRing *traceRing);
+#endif
+
+  // Functions NOT INLINED
+    // Reset the interface module : FT1.2 reset, then cEMI link layer mode setting
+    // The function shall be called until it returns KNX_BUSCOUPLER_OK, each call waits for the module answers
+    // without blocking. It returns KNX_BUSCOUPLER_ERROR as long as the sequence is not completed,
+    // and KNX_BUSCOUPLER_ERROR_ATTEMPT_EXCEED after KNX_FT12_RESET_ATTEMPTS unanswered attempts
+    byte Reset(void);
+
+    // Attach a list of com objects (see KnxTpUart)
+    byte AttachComObjectsList(KnxComObject KnxComObjectsList[], byte listSize);
+    byte AttachComObjectsList(KnxComObject** comObjectsList, byte listSize);
+
+    // Init
+    // returns ERROR (255) if the coupler is not in INIT state, else returns OK (0)
+    byte Init(void);
+
+    // Send a KNX telegram, the frame is written by the TX task
+    // returns ERROR (255) if TX is not available, else returns OK (0)
+    // NB : the source address is forced to the coupler physical address value
+    byte SendTelegram(KnxTelegram& sentTelegram);
+
+    // Telegram received from the application (not used by the FT1.2 coupler)
+    void SetReceivedTelegram(KnxTelegram &telegram);
+
+    // Reception task : read the available bytes (in chunks) and handle the complete frames
+    void RXTask(void);
+
+    // Transmission task : write the pending frame, repeat it if not acknowledged, handle the confirmation timeout
+    void TXTask(void);
+
+    // Wait up to "timeoutMicros" for received bytes, return true when data is available
+    boolean WaitForRxData(unsigned long timeoutMicros);
+
+    // Bus monitoring is not supported, always return false
+    boolean GetMonitoringData(type_MonitorData&);
+
+    // DEBUG purpose functions
+    void DEBUG_SendResetCommand(void);
+    void DEBUG_SendStateReqCommand(void);
+
+  private:
+  // Private INLINED functions (see definitions later in this file)
+#if defined(KNXTPUART_DEBUG_INFO)
+    void DebugInfo(e_KnxTraceEvent event, word arg0 = 0) const;
+#endif
+#if defined(KNXTPUART_DEBUG_ERROR)
+    void DebugError(e_KnxTraceEvent event) const;
+#endif
+
+  // Private NOT INLINED functions
+    // Read the available bytes and feed them to the frame parser
+    void ReceiveBytes(void);
+
+    // Frame parser, one byte at a time
+    void ParseByte(byte data);
+
+    // Handle a complete and valid variable length frame
+    void ProcessFrame(void);
+
+    // Handle a cEMI frame received from the module
+    void ProcessCemi(const byte cemi[], byte length);
+
+    // Build a variable length frame around the cEMI frame already written at _txFrame + FT12_HEADER_SIZE,
+    // "cemiLength" is the cEMI frame length
+    void BuildFrame(byte cemiLength);
+
+    // Write the frame being sent
+    void WriteFrame(void);
+
+    // End the transmission and notify the TX acknowledge
+    void EndTransmission(e_BusCouplerTxAck ack);
+};
+
+
+// ----- Definition of the INLINED functions :  ------------
+
+inline byte KnxFt12Coupler::SetEvtCallback(type_EventCallbackFctPtr evtCallbackFct)
+{
+  if (evtCallbackFct == NULL) return KNX_BUSCOUPLER_ERROR;
+  if ((_rx.state!=RX_INIT) || (_tx.state!=TX_INIT)) return KNX_BUSCOUPLER_ERROR_NOT_INIT_STATE;
+  _evtCallbackFct = evtCallbackFct;
+  return KNX_BUSCOUPLER_OK;
+}
+
+inline byte KnxFt12Coupler::SetAckCallback(type_AckCallbackFctPtr ackFctPtr)
+{
+  if (ackFctPtr == NULL) return KNX_BUSCOUPLER_ERROR;
+  if ((_rx.state!=RX_INIT) || (_tx.state!=TX_INIT)) return KNX_BUSCOUPLER_ERROR_NOT_INIT_STATE;
+  _tx.ackFctPtr = ackFctPtr;
+  return KNX_BUSCOUPLER_OK;
+}
+
+inline byte KnxFt12Coupler::GetStateIndication(void) const { return 0; }
+
+inline KnxTelegram& KnxFt12Coupler::GetReceivedTelegram(void) { return _rx.receivedTelegram; }
+
+inline byte KnxFt12Coupler::GetTargetedComObjectIndex(void) const { return _rx.addressedComObjectIndex; }
+
+inline boolean KnxFt12Coupler::IsActive(void) const { return ((_tx.state > TX_IDLE) || _rxIndex); }
+
+inline boolean KnxFt12Coupler::IsTxBusy(void) const { return (_tx.state != TX_IDLE); }
+
+inline boolean KnxFt12Coupler::PopReceivedTelegram(type_buscoupler_rx_telegram& rxTelegram)
+{ return _rx.queue.Pop(rxTelegram); }
+
+inline word KnxFt12Coupler::GetRxOverflowsNb(void) const { return _rx.overflowsNb; }
+
+inline word KnxFt12Coupler::GetRepeatedFramesNb(void) const { return _txRepeatedFramesNb; }
+
+#if defined(KNXTPUART_DEBUG_INFO) || defined(KNXTPUART_DEBUG_ERROR)
+inline void KnxFt12Coupler::SetTraceRing(KnxTraceRing *traceRing) { _traceRing = traceRing; }
+#endif
+
+#if defined(KNXTPUART_DEBUG_INFO)
+inline void KnxFt12Coupler::DebugInfo(e_KnxTraceEvent event, word arg0) const
+{
+  if (_traceRing != NULL) _traceRing->Record(event, arg0);
+}
+#endif
+
+#if defined(KNXTPUART_DEBUG_ERROR)
+inline void KnxFt12Coupler::DebugError(e_KnxTraceEvent event) const
+{
+  if (_traceRing != NULL) _traceRing->Record(event);
+}
+#endif
+
+#endif // KNXFT12COUPLER_H
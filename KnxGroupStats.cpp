@@ -0,0 +1,105 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxGroupStats.cpp
+// Author : Franck Marini
+// Description : Traffic statistics per target address
+// Module dependencies : KnxTelegram, KnxClock
+
+#include "KnxGroupStats.h"
+#include "KnxClock.h"
+
+KnxGroupStats::KnxGroupStats()
+{
+  static_assert((KNX_GROUP_STATS_SIZE <= 128) && !(KNX_GROUP_STATS_SIZE & (KNX_GROUP_STATS_SIZE - 1)),
+                "KNX_GROUP_STATS_SIZE shall be a power of 2 up to 128");
+  Clear();
+}
+
+
+void KnxGroupStats::Record(const KnxTelegram& telegram, unsigned long timeMicros)
+{
+  word address = telegram.GetTargetAddress();
+  boolean isGroup = telegram.IsMulticast();
+  byte flags = KNX_GROUP_STATS_USED | (isGroup ? KNX_GROUP_STATS_GROUP_ADDRESS : 0);
+  byte slot = Hash(address, isGroup);
+  unsigned long nowMillis = KnxMillis(), interval;
+  type_group_stats_entry *entry = NULL;
+
+  _telegramsNb++;
+  // linear probing, bounded
+  for (byte i = 0; i < KNX_GROUP_STATS_MAX_PROBES; i++, slot = (slot + 1) & (KNX_GROUP_STATS_SIZE - 1))
+  {
+    if (!_entries[slot].flags || ((_entries[slot].targetAddress == address) && (_entries[slot].flags == flags)))
+    { entry = &_entries[slot]; break; }
+  }
+  if (!entry) { _untrackedNb++; return; }
+
+  _lock.WriteBegin();
+  if (!entry->flags)
+  { // new address
+    entry->targetAddress = address;
+    entry->flags = flags;
+    entry->telegramsNb = 0;
+    entry->firstSeenMillis = nowMillis;
+    entry->minIntervalMicros = KNX_GROUP_STATS_NO_INTERVAL;
+  }
+  else
+  { // NB : the usec time wraps every 71mn, the interval is computed from the msec time beyond 1 hour
+    interval = nowMillis - entry->lastSeenMillis;
+    interval = (interval < 3600000UL) ? timeMicros - entry->lastSeenMicros : KNX_GROUP_STATS_NO_INTERVAL;
+    if (interval < entry->minIntervalMicros) entry->minIntervalMicros = interval;
+  }
+  entry->telegramsNb++;
+  entry->lastSourceAddress = telegram.GetSourceAddress();
+  entry->lastCommand = telegram.GetCommand();
+  entry->lastSeenMillis = nowMillis;
+  entry->lastSeenMicros = timeMicros;
+  _lock.WriteEnd();
+}
+
+
+void KnxGroupStats::Clear(void)
+{
+  _lock.WriteBegin();
+  memset(_entries, 0, sizeof(_entries));
+  _telegramsNb = 0;
+  _untrackedNb = 0;
+  _lock.WriteEnd();
+}
+
+
+boolean KnxGroupStats::GetNextEntry(byte& position, type_group_stats_entry& entry) const
+{
+  word sequence;
+
+  for (; position < KNX_GROUP_STATS_SIZE; position++)
+  {
+    do
+    { // copy again if an update occurred meanwhile
+      sequence = _lock.ReadBegin();
+      entry = _entries[position];
+    } while (_lock.ReadRetry(sequence));
+    if (entry.flags) { position++; return true; }
+  }
+  return false;
+}
+
+// EOF
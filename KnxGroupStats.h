@@ -0,0 +1,114 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxGroupStats.h
+// Author : Franck Marini
+// Description : Traffic statistics per target address, for line diagnostics (e.g. finding the noisy senders)
+//               The bus coupler RX task records every telegram seen on the bus, addressed to the device or not,
+//               in a fixed size open addressing hash table keyed by the target address : nb of telegrams, last
+//               source and command, first/last seen times and min/avg interval between 2 telegrams.
+//               The update time is bounded (KNX_GROUP_STATS_MAX_PROBES slots probed at most) and no memory is
+//               allocated : the telegrams of the addresses that do not fit in the table are only counted.
+//               The entries can be read from another thread than the RX task, each copied entry is consistent
+//               (sequence lock).
+// Module dependencies : KnxTelegram, KnxClock, KnxSeqLock
+
+#ifndef KNXGROUPSTATS_H
+#define KNXGROUPSTATS_H
+
+#include "Arduino.h"
+#include "KnxTelegram.h"
+#include "KnxSeqLock.h"
+
+// Nb of target addresses recorded (power of 2, up to 128)
+#ifndef KNX_GROUP_STATS_SIZE
+#define KNX_GROUP_STATS_SIZE 32
+#endif
+
+// Max nb of table slots probed per telegram
+#define KNX_GROUP_STATS_MAX_PROBES 8
+
+// Entry flags
+#define KNX_GROUP_STATS_USED           0x01
+#define KNX_GROUP_STATS_GROUP_ADDRESS  0x02 // the target is a group address (else an individual address)
+
+#define KNX_GROUP_STATS_NO_INTERVAL    0xFFFFFFFF // min interval until 2 telegrams are recorded
+
+typedef struct {
+  word targetAddress;
+  byte flags;                       // KNX_GROUP_STATS_xxx flags
+  byte lastCommand;                 // e_KnxCommand value of the last telegram
+  word lastSourceAddress;
+  unsigned long telegramsNb;
+  unsigned long firstSeenMillis;
+  unsigned long lastSeenMillis;
+  unsigned long lastSeenMicros;
+  unsigned long minIntervalMicros;  // KNX_GROUP_STATS_NO_INTERVAL until 2 telegrams are recorded
+} type_group_stats_entry;
+
+
+class KnxGroupStats {
+    type_group_stats_entry _entries[KNX_GROUP_STATS_SIZE];
+    KnxSeqLock _lock;               // entries updates / copies
+    unsigned long _telegramsNb;     // all the recorded telegrams
+    unsigned long _untrackedNb;     // telegrams of addresses that did not fit in the table
+
+  public:
+    KnxGroupStats();
+
+    // Record a telegram received on the bus (called by the bus coupler RX task)
+    // "timeMicros" is the telegram reception time
+    void Record(const KnxTelegram& telegram, unsigned long timeMicros);
+
+    // Remove all the entries and reset the counters
+    void Clear(void);
+
+    // Copy the next used entry from the "position" slot, and move "position" after it
+    // return false when there is no more entry
+    // Usage : byte position = 0; while (stats.GetNextEntry(position, entry)) { ... }
+    boolean GetNextEntry(byte& position, type_group_stats_entry& entry) const;
+
+  // INLINED functions (see definitions later in this file)
+    unsigned long GetTelegramsNb(void) const;
+    unsigned long GetUntrackedNb(void) const;
+
+    // Average interval between 2 telegrams of an entry (0 until 2 telegrams are recorded)
+    static unsigned long GetAverageIntervalMillis(const type_group_stats_entry& entry);
+
+  private:
+    static byte Hash(word address, boolean isGroup);
+};
+
+
+// --------------- Definition of the INLINED functions -----------------
+inline unsigned long KnxGroupStats::GetTelegramsNb(void) const { return _telegramsNb; }
+
+inline unsigned long KnxGroupStats::GetUntrackedNb(void) const { return _untrackedNb; }
+
+inline unsigned long KnxGroupStats::GetAverageIntervalMillis(const type_group_stats_entry& entry)
+{ return (entry.telegramsNb > 1) ? (entry.lastSeenMillis - entry.firstSeenMillis) / (entry.telegramsNb - 1) : 0; }
+
+// Fibonacci hashing, the top bits of the product are the best mixed
+inline byte KnxGroupStats::Hash(word address, boolean isGroup)
+{ return (byte)((word)((address ^ (isGroup ? 0 : 0x5555)) * 40503U) >> 8) & (KNX_GROUP_STATS_SIZE - 1); }
+
+#endif // KNXGROUPSTATS_H
+
+// EOF
@@ -0,0 +1,367 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxIpRoutingCoupler.cpp
+// Author : Franck Marini
+// Description : KNXnet/IP routing bus coupler (cEMI frames over UDP multicast, Linux implementation)
+// Module dependencies : KnxBusCoupler, KnxCemi, KnxNetIp, KnxTelegram, KnxComObject, KnxComObjectTable
+
+#include "KnxIpRoutingCoupler.h"
+
+#if defined(__linux__)
+
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+// ROUTING_BUSY body : structure length, device state, wait time (2 bytes), control field (2 bytes)
+#define ROUTING_BUSY_BODY_SIZE 6
+
+// ROUTING_LOST_MESSAGE body : structure length, device state, nb of lost messages (2 bytes)
+#define ROUTING_LOST_BODY_SIZE 4
+
+// Min time (ms) between 2 ROUTING_INDICATION sendings
+#define ROUTING_MIN_TX_PERIOD (1000 / KNXNETIP_ROUTING_MAX_RATE)
+
+static inline unsigned long TimeDeltaMillis(unsigned long now, unsigned long before) { return now - before; }
+// true if the time "limit" is reached, robust to the millis() wraparound
+static inline boolean IsTimeReached(unsigned long now, unsigned long limit) { return ((long)(now - limit) >= 0); }
+
+
+KnxIpRoutingCoupler::KnxIpRoutingCoupler(word physicalAddr, const char *multicastAddr, word port, const char *interfaceAddr)
+: _physicalAddr(physicalAddr), _multicastAddr(multicastAddr), _port(port), _interfaceAddr(interfaceAddr)
+{
+  _socket = -1;
+  _rx.state = RX_RESET;
+  _rx.addressedComObjectIndex = 0;
+  _rx.overflowsNb = 0;
+  _tx.state = TX_RESET;
+  _tx.sentTelegram = NULL;
+  _tx.ackFctPtr = NULL;
+  _tx.nbRemainingBytes = 0;
+  _tx.txByteIndex = 0;
+  _evtCallbackFct = NULL;
+  _groupStats = NULL;
+  _frameCallbackFct = NULL;
+  _nextTxTimeMillis = 0;
+  _txPausedUntilMillis = 0;
+  _lastBusyTimeMillis = 0;
+  _busyCounter = 0;
+  _receivedBusyNb = 0;
+  _overflowsNbAtLastBusy = 0;
+#if defined(KNXTPUART_DEBUG_INFO) || defined(KNXTPUART_DEBUG_ERROR)
+  _traceRing = NULL;
+#endif
+}
+
+
+// Destructor
+KnxIpRoutingCoupler::~KnxIpRoutingCoupler()
+{
+  if (_socket >= 0) close(_socket);
+}
+
+
+// Reset the coupler : (re)open the UDP socket and join the routing multicast group
+// The multicast loop is enabled so that several couplers of the same host (e.g. tests) see each other,
+// our own telegrams are filtered on reception.
+byte KnxIpRoutingCoupler::Reset(void)
+{
+  struct sockaddr_in local;
+  struct ip_mreq membership;
+  struct in_addr interface;
+  type_buscoupler_rx_telegram rxTelegram;
+  int enable = 1;
+  unsigned char loop = 1;
+
+  if (_socket >= 0) close(_socket);
+  _rx.state = RX_RESET;
+  _tx.state = TX_RESET;
+  while (_rx.queue.Pop(rxTelegram)); // flush the telegrams received before the reset
+
+  interface.s_addr = _interfaceAddr ? inet_addr(_interfaceAddr) : htonl(INADDR_ANY);
+  membership.imr_multiaddr.s_addr = inet_addr(_multicastAddr);
+  membership.imr_interface = interface;
+  memset(&local, 0, sizeof(local));
+  local.sin_family = AF_INET;
+  local.sin_port = htons(_port);
+  local.sin_addr.s_addr = htonl(INADDR_ANY);
+
+  _socket = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if ( (_socket < 0)
+    || (setsockopt(_socket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) < 0)
+    || (bind(_socket, (struct sockaddr *)&local, sizeof(local)) < 0)
+    || (setsockopt(_socket, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0)
+    || (setsockopt(_socket, IPPROTO_IP, IP_MULTICAST_IF, &interface, sizeof(interface)) < 0)
+    || (setsockopt(_socket, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0) )
+  {
+    if (_socket >= 0) { close(_socket); _socket = -1; }
+#if defined(KNXTPUART_DEBUG_ERROR)
+    DebugError(KNX_TRACE_COUPLER_TRANSPORT_ERROR);
+#endif
+    return KNX_BUSCOUPLER_ERROR;
+  }
+
+  _busyCounter = 0;
+  _txPausedUntilMillis = KnxMillis();
+  _nextTxTimeMillis = _txPausedUntilMillis;
+  _rx.state = RX_INIT;
+  _tx.state = TX_INIT;
+#if defined(KNXTPUART_DEBUG_INFO)
+  DebugInfo(KNX_TRACE_COUPLER_RESET_OK);
+#endif
+  return KNX_BUSCOUPLER_OK;
+}
+
+
+byte KnxIpRoutingCoupler::AttachComObjectsList(KnxComObject comObjectsList[], byte listSize)
+{
+  if ((_rx.state!=RX_INIT) || (_tx.state!=TX_INIT)) return KNX_BUSCOUPLER_ERROR_NOT_INIT_STATE;
+#if defined(KNXTPUART_DEBUG_INFO)
+  _comObjects.Attach(comObjectsList, listSize, _traceRing);
+#else
+  _comObjects.Attach(comObjectsList, listSize);
+#endif
+  return KNX_BUSCOUPLER_OK;
+}
+
+// Attach a list of com objects
+// NB1 : only the objects with "communication" attribute are considered by the coupler
+// NB2 : In case of objects with identical address, the object with highest index only is considered
+// return KNX_BUSCOUPLER_ERROR_NOT_INIT_STATE (254) if the coupler is not in Init state
+// The function must be called prior to Init() execution
+byte KnxIpRoutingCoupler::AttachComObjectsList(KnxComObject** comObjectsList, byte listSize)
+{
+  if ((_rx.state!=RX_INIT) || (_tx.state!=TX_INIT)) return KNX_BUSCOUPLER_ERROR_NOT_INIT_STATE;
+#if defined(KNXTPUART_DEBUG_INFO)
+  _comObjects.Attach(comObjectsList, listSize, _traceRing);
+#else
+  _comObjects.Attach(comObjectsList, listSize);
+#endif
+  return KNX_BUSCOUPLER_OK;
+}
+
+
+// Init
+// Init must be called after every reset() execution
+byte KnxIpRoutingCoupler::Init(void)
+{
+  if ((_rx.state!=RX_INIT) || (_tx.state!=TX_INIT)) return KNX_BUSCOUPLER_ERROR_NOT_INIT_STATE;
+  if (_evtCallbackFct == NULL) return KNX_BUSCOUPLER_ERROR_NULL_EVT_CALLBACK_FCT;
+  if (_tx.ackFctPtr == NULL) return KNX_BUSCOUPLER_ERROR_NULL_ACK_CALLBACK_FCT;
+  _rx.state = RX_IDLE_WAITING_FOR_CTRL_FIELD;
+  _tx.state = TX_IDLE;
+#if defined(KNXTPUART_DEBUG_INFO)
+  if (!_comObjects.GetAssignedNb()) DebugInfo(KNX_TRACE_COUPLER_INIT_EMPTY_LIST);
+  DebugInfo(KNX_TRACE_COUPLER_INIT_NORMAL);
+#endif
+  return KNX_BUSCOUPLER_OK;
+}
+
+
+// Send a KNX telegram
+// returns ERROR (255) if TX is not available, else returns OK (0)
+// NB : the source address is forced to the coupler physical address value
+byte KnxIpRoutingCoupler::SendTelegram(KnxTelegram& sentTelegram)
+{
+  if (_tx.state != TX_IDLE) return KNX_BUSCOUPLER_ERROR; // TX not initialized or busy
+
+  if (sentTelegram.GetSourceAddress() != _physicalAddr)
+  {
+    sentTelegram.SetSourceAddress(_physicalAddr);
+    sentTelegram.UpdateChecksum();
+  }
+  _tx.sentTelegram = &sentTelegram;
+  _tx.state = TX_TELEGRAM_SENDING_ONGOING;
+  return KNX_BUSCOUPLER_OK;
+}
+
+
+// The telegrams are received from the network by the RX task
+void KnxIpRoutingCoupler::SetReceivedTelegram(KnxTelegram &telegram) {}
+
+
+// Reception task
+// All the pending datagrams are read, KNXIPROUTING_RX_BATCH_SIZE datagrams per system call
+void KnxIpRoutingCoupler::RXTask(void)
+{
+  byte frames[KNXIPROUTING_RX_BATCH_SIZE][KNXIPROUTING_FRAME_MAX_SIZE];
+  struct iovec iovecs[KNXIPROUTING_RX_BATCH_SIZE];
+  struct mmsghdr messages[KNXIPROUTING_RX_BATCH_SIZE];
+  int nb;
+
+  if ((_rx.state < RX_IDLE_WAITING_FOR_CTRL_FIELD) || (_socket < 0)) return;
+
+  memset(messages, 0, sizeof(messages));
+  for (byte i = 0; i < KNXIPROUTING_RX_BATCH_SIZE; i++)
+  {
+    iovecs[i].iov_base = frames[i];
+    iovecs[i].iov_len = KNXIPROUTING_FRAME_MAX_SIZE;
+    messages[i].msg_hdr.msg_iov = &iovecs[i];
+    messages[i].msg_hdr.msg_iovlen = 1;
+  }
+  do
+  {
+    nb = recvmmsg(_socket, messages, KNXIPROUTING_RX_BATCH_SIZE, MSG_DONTWAIT, NULL);
+    for (int i = 0; i < nb; i++) ProcessFrame(frames[i], messages[i].msg_len);
+  } while (nb == KNXIPROUTING_RX_BATCH_SIZE); // full batch, more datagrams may be pending
+
+  // Received telegrams have been lost : ask the other routers to slow down
+  if (_rx.overflowsNb != _overflowsNbAtLastBusy)
+  {
+    _overflowsNbAtLastBusy = _rx.overflowsNb;
+    SendRoutingBusy();
+#if defined(KNXTPUART_DEBUG_INFO)
+    DebugInfo(KNX_TRACE_COUPLER_ROUTING_BUSY_TX, _rx.overflowsNb);
+#endif
+  }
+}
+
+
+// Transmission task
+// The pending telegram is sent when the routing flow control allows it, then acknowledged
+void KnxIpRoutingCoupler::TXTask(void)
+{
+  byte frame[KNXNETIP_HEADER_SIZE + KNX_CEMI_MAX_SIZE];
+  struct sockaddr_in group;
+  unsigned long nowTime;
+  byte length;
+
+  if (_tx.state != TX_TELEGRAM_SENDING_ONGOING) return;
+  nowTime = KnxMillis();
+  if (!IsTimeReached(nowTime, _txPausedUntilMillis) || !IsTimeReached(nowTime, _nextTxTimeMillis)) return;
+
+  length = KnxTelegramToCemi(*_tx.sentTelegram, KNX_CEMI_L_DATA_IND, frame + KNXNETIP_HEADER_SIZE);
+  KnxNetIpWriteHeader(frame, KNXNETIP_ROUTING_INDICATION, KNXNETIP_HEADER_SIZE + length);
+  memset(&group, 0, sizeof(group));
+  group.sin_family = AF_INET;
+  group.sin_port = htons(_port);
+  group.sin_addr.s_addr = inet_addr(_multicastAddr);
+
+  _nextTxTimeMillis = nowTime + ROUTING_MIN_TX_PERIOD;
+  _tx.state = TX_IDLE;
+  if (sendto(_socket, frame, KNXNETIP_HEADER_SIZE + length, 0, (struct sockaddr *)&group, sizeof(group)) < 0)
+  {
+#if defined(KNXTPUART_DEBUG_ERROR)
+    DebugError(KNX_TRACE_COUPLER_SEND_FAILED);
+#endif
+    _tx.ackFctPtr(NACK_RESPONSE);
+  }
+  else _tx.ackFctPtr(ACK_RESPONSE);
+}
+
+
+boolean KnxIpRoutingCoupler::WaitForRxData(unsigned long timeoutMicros)
+{
+  struct pollfd pfd;
+  int nb;
+
+  if (_socket < 0) return false;
+  pfd.fd = _socket; pfd.events = POLLIN;
+  do nb = poll(&pfd, 1, (int)((timeoutMicros + 999) / 1000));
+  while ((nb < 0) && (errno == EINTR));
+  return (nb > 0);
+}
+
+
+boolean KnxIpRoutingCoupler::GetMonitoringData(type_MonitorData&) { return false; }
+
+
+// Handle one received KNXnet/IP frame
+void KnxIpRoutingCoupler::ProcessFrame(const byte frame[], word length)
+{
+  KnxTelegram telegram;
+  word serviceType, waitTime;
+  unsigned long nowTime;
+  byte index;
+
+  if (KnxNetIpReadHeader(frame, length, serviceType) != KNXNETIP_OK) return;
+  switch (serviceType)
+  {
+    case KNXNETIP_ROUTING_INDICATION :
+      if (KnxCemiToTelegram(frame + KNXNETIP_HEADER_SIZE, length - KNXNETIP_HEADER_SIZE, telegram) != KNX_CEMI_OK) break;
+      if (telegram.GetSourceAddress() == _physicalAddr) break; // our own telegram looped back
+      if (_groupStats) _groupStats->Record(telegram, KnxMicros());
+      if (_frameCallbackFct) _frameCallbackFct(telegram, telegram.GetTelegramLength(), KnxMicros());
+      if (!telegram.IsMulticast() || !_comObjects.IsAddressAssigned(telegram.GetTargetAddress(), index)) break;
+      telegram.Copy(_rx.receivedTelegram);
+      _rx.addressedComObjectIndex = index;
+      QueueReceivedTelegram(_rx, telegram, index, KnxMicros());
+      _evtCallbackFct(BUSCOUPLER_EVENT_RECEIVED_EIB_TELEGRAM);
+      break;
+
+    case KNXNETIP_ROUTING_BUSY :
+      if ((length < KNXNETIP_HEADER_SIZE + ROUTING_BUSY_BODY_SIZE) || (frame[KNXNETIP_HEADER_SIZE] != ROUTING_BUSY_BODY_SIZE)) break;
+      waitTime = (frame[KNXNETIP_HEADER_SIZE + 2] << 8) | frame[KNXNETIP_HEADER_SIZE + 3];
+      nowTime = KnxMillis();
+      _receivedBusyNb++;
+      if (TimeDeltaMillis(nowTime, _lastBusyTimeMillis) > KNXNETIP_ROUTING_BUSY_RESET_TIME) _busyCounter = 0;
+      if (_busyCounter < 255) _busyCounter++;
+      _lastBusyTimeMillis = nowTime;
+      // pause = requested wait time + random part growing with the nb of recent ROUTING_BUSY
+      nowTime += waitTime + random((long)_busyCounter * KNXNETIP_ROUTING_BUSY_RANDOM_TIME);
+      if (IsTimeReached(nowTime, _txPausedUntilMillis)) _txPausedUntilMillis = nowTime;
+#if defined(KNXTPUART_DEBUG_INFO)
+      DebugInfo(KNX_TRACE_COUPLER_ROUTING_BUSY_RX, waitTime, _busyCounter);
+#endif
+      break;
+
+    case KNXNETIP_ROUTING_LOST_MESSAGE : // no flow control action, traced only
+#if defined(KNXTPUART_DEBUG_INFO)
+      if ((length < KNXNETIP_HEADER_SIZE + ROUTING_LOST_BODY_SIZE) || (frame[KNXNETIP_HEADER_SIZE] != ROUTING_LOST_BODY_SIZE)) break;
+      DebugInfo(KNX_TRACE_COUPLER_ROUTING_LOST, (frame[KNXNETIP_HEADER_SIZE + 2] << 8) | frame[KNXNETIP_HEADER_SIZE + 3]);
+#endif
+      break;
+
+    default : break; // other services are ignored
+  }
+}
+
+
+// Send a ROUTING_BUSY frame
+void KnxIpRoutingCoupler::SendRoutingBusy(void)
+{
+  byte frame[KNXNETIP_HEADER_SIZE + ROUTING_BUSY_BODY_SIZE];
+  struct sockaddr_in group;
+
+  KnxNetIpWriteHeader(frame, KNXNETIP_ROUTING_BUSY, sizeof(frame));
+  frame[6] = ROUTING_BUSY_BODY_SIZE;
+  frame[7] = 0; // device state
+  frame[8] = (byte)(KNXNETIP_ROUTING_BUSY_WAIT_TIME >> 8);
+  frame[9] = (byte)KNXNETIP_ROUTING_BUSY_WAIT_TIME;
+  frame[10] = 0; frame[11] = 0; // control field
+  memset(&group, 0, sizeof(group));
+  group.sin_family = AF_INET;
+  group.sin_port = htons(_port);
+  group.sin_addr.s_addr = inet_addr(_multicastAddr);
+  sendto(_socket, frame, sizeof(frame), 0, (struct sockaddr *)&group, sizeof(group));
+}
+
+
+// DEBUG purpose functions
+void KnxIpRoutingCoupler::DEBUG_SendResetCommand(void) {}
+
+void KnxIpRoutingCoupler::DEBUG_SendStateReqCommand(void) {}
+
+#endif // __linux__
+
+// EOF
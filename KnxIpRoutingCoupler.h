@@ -0,0 +1,234 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxIpRoutingCoupler.h
+// Author : Franck Marini
+// Description : KNXnet/IP routing bus coupler (cEMI frames over UDP multicast, Linux implementation)
+// Module dependencies : KnxBusCoupler, KnxCemi, KnxNetIp, KnxTelegram, KnxComObject, KnxComObjectTable
+
+// The coupler sends and receives ROUTING_INDICATION frames on the KNXnet/IP routing multicast group
+// (224.0.23.12:3671 by default). It applies the routing flow control of the KNXnet/IP specification :
+// - no more than KNXNETIP_ROUTING_MAX_RATE telegrams sent per second
+// - on ROUTING_BUSY reception, the transmission is paused during the requested wait time plus a random time
+//   proportional to the nb of ROUTING_BUSY received recently
+// - a ROUTING_BUSY is sent when received telegrams are lost because of RX queue overflow
+// Since there is no link layer acknowledge on IP, a telegram is acknowledged (ACK_RESPONSE) once sent.
+// The RX task reads the pending datagrams in batches (recvmmsg).
+
+#ifndef KNXIPROUTINGCOUPLER_H
+#define KNXIPROUTINGCOUPLER_H
+
+#if defined(__linux__)
+
+#include "Arduino.h"
+#include "KnxTelegram.h"
+#include "KnxComObject.h"
+#include "KnxComObjectTable.h"
+#include "KnxBusCoupler.h"
+#include "KnxCemi.h"
+#include "KnxNetIp.h"
+
+// !!!!!!!!!!!!!!! FLAG OPTIONS !!!!!!!!!!!!!!!!!
+// Max nb of datagrams read by one recvmmsg() call
+#ifndef KNXIPROUTING_RX_BATCH_SIZE
+#define KNXIPROUTING_RX_BATCH_SIZE 8
+#endif
+
+// DEBUG :
+// #define KNXTPUART_DEBUG_INFO   // Uncomment to activate info traces
+// #define KNXTPUART_DEBUG_ERROR  // Uncomment to activate error traces
+
+#define KNXIPROUTING_FRAME_MAX_SIZE 128
+
+
+class KnxIpRoutingCoupler : public KnxBusCoupler {
+    const word _physicalAddr;                 // Individual address of the device on the KNX network
+    const char *_multicastAddr;               // Routing multicast group
+    const word _port;                         // Routing UDP port
+    const char *_interfaceAddr;               // IP address of the network interface (NULL = default interface)
+    int _socket;                              // UDP socket (-1 when closed)
+    type_buscoupler_rx _rx;                   // Reception structure
+    type_buscoupler_tx _tx;                   // Transmission structure
+    type_EventCallbackFctPtr _evtCallbackFct; // Pointer to the EVENTS callback function
+    KnxComObjectTable _comObjects;            // Attached com objects, ordered by address
+    unsigned long _nextTxTimeMillis;          // Earliest time of the next transmission (rate limitation)
+    unsigned long _txPausedUntilMillis;       // End of the transmission pause requested by a ROUTING_BUSY
+    unsigned long _lastBusyTimeMillis;        // Time of the last received ROUTING_BUSY
+    byte _busyCounter;                        // Nb of ROUTING_BUSY received recently
+    word _receivedBusyNb;                     // Total nb of received ROUTING_BUSY
+    word _overflowsNbAtLastBusy;              // RX overflows nb when our last ROUTING_BUSY was sent
+    KnxGroupStats *_groupStats;               // Traffic statistics per target address (NULL if not recorded)
+    type_FrameCallbackFctPtr _frameCallbackFct; // Callback of the telegrams seen on the network (NULL if not set)
+
+#if defined(KNXTPUART_DEBUG_INFO) || defined(KNXTPUART_DEBUG_ERROR)
+    KnxTraceRing *_traceRing;                 // Ring of the debug traces (NULL if not traced)
+#endif
+
+  public:
+    // Constructor / Destructor
+    KnxIpRoutingCoupler(word physicalAddr, const char *multicastAddr = KNXNETIP_ROUTING_MULTICAST_ADDR,
+                        word port = KNXNETIP_PORT, const char *interfaceAddr = NULL);
+    ~KnxIpRoutingCoupler();
+
+  // INLINED functions (see definitions later in this file)
+    // Set EVENTs / ACK callback functions
+    // return KNX_BUSCOUPLER_ERROR (255) if the parameter is NULL
+    // return KNX_BUSCOUPLER_ERROR_NOT_INIT_STATE (254) if the coupler is not in Init state
+    // else return OK
+    byte SetEvtCallback(type_EventCallbackFctPtr);
+    byte SetAckCallback(type_AckCallbackFctPtr);
+
+    byte GetStateIndication(void) const;
+    KnxTelegram& GetReceivedTelegram(void);
+    byte GetTargetedComObjectIndex(void) const;
+    boolean IsActive(void) const;
+    boolean IsTxBusy(void) const;
+    boolean PopReceivedTelegram(type_buscoupler_rx_telegram&);
+    word GetRxOverflowsNb(void) const;
+    boolean SetGroupStats(KnxGroupStats *groupStats);
+    boolean SetFrameCallback(type_FrameCallbackFctPtr frameFct);
+
+    // Nb of ROUTING_BUSY received since the coupler creation
+    word GetReceivedBusyNb(void) const;
+
+    // UDP socket, allows to integrate the coupler into an application event loop
+    int GetFd(void) const;
+
+#if defined(KNXTPUART_DEBUG_INFO) || defined(KNXTPUART_DEBUG_ERROR)
+    void SetTraceRing(KnxTraceRing *traceRing);
+#endif
+
+  // Functions NOT INLINED
+    // Open the UDP socket and join the routing multicast group
+    // Return KNX_BUSCOUPLER_ERROR in case of network failure
+    byte Reset(void);
+
+    // Attach a list of com objects (see KnxTpUart)
+    byte AttachComObjectsList(KnxComObject KnxComObjectsList[], byte listSize);
+    byte AttachComObjectsList(KnxComObject** comObjectsList, byte listSize);
+
+    // Init
+    // returns ERROR (255) if the coupler is not in INIT state, else returns OK (0)
+    byte Init(void);
+
+    // Send a KNX telegram, the transmission is done by the TX task
+    // returns ERROR (255) if TX is not available, else returns OK (0)
+    // NB : the source address is forced to the coupler physical address value
+    byte SendTelegram(KnxTelegram& sentTelegram);
+
+    // Telegram received from the application (not used by the IP coupler)
+    void SetReceivedTelegram(KnxTelegram &telegram);
+
+    // Reception task : read all the pending datagrams (in batches) and queue the addressed telegrams
+    void RXTask(void);
+
+    // Transmission task : send the pending telegram when the routing flow control allows it
+    void TXTask(void);
+
+    // Wait up to "timeoutMicros" for received datagrams, return true when data is available
+    boolean WaitForRxData(unsigned long timeoutMicros);
+
+    // Bus monitoring is not supported, always return false
+    boolean GetMonitoringData(type_MonitorData&);
+
+    // DEBUG purpose functions (no effect)
+    void DEBUG_SendResetCommand(void);
+    void DEBUG_SendStateReqCommand(void);
+
+  private:
+  // Private INLINED functions (see definitions later in this file)
+#if defined(KNXTPUART_DEBUG_INFO)
+    void DebugInfo(e_KnxTraceEvent event, word arg0 = 0, word arg1 = 0) const;
+#endif
+#if defined(KNXTPUART_DEBUG_ERROR)
+    void DebugError(e_KnxTraceEvent event) const;
+#endif
+
+  // Private NOT INLINED functions
+    // Handle one received KNXnet/IP frame
+    void ProcessFrame(const byte frame[], word length);
+
+    // Send a ROUTING_BUSY frame
+    void SendRoutingBusy(void);
+};
+
+
+// ----- Definition of the INLINED functions :  ------------
+
+inline byte KnxIpRoutingCoupler::SetEvtCallback(type_EventCallbackFctPtr evtCallbackFct)
+{
+  if (evtCallbackFct == NULL) return KNX_BUSCOUPLER_ERROR;
+  if ((_rx.state!=RX_INIT) || (_tx.state!=TX_INIT)) return KNX_BUSCOUPLER_ERROR_NOT_INIT_STATE;
+  _evtCallbackFct = evtCallbackFct;
+  return KNX_BUSCOUPLER_OK;
+}
+
+inline byte KnxIpRoutingCoupler::SetAckCallback(type_AckCallbackFctPtr ackFctPtr)
+{
+  if (ackFctPtr == NULL) return KNX_BUSCOUPLER_ERROR;
+  if ((_rx.state!=RX_INIT) || (_tx.state!=TX_INIT)) return KNX_BUSCOUPLER_ERROR_NOT_INIT_STATE;
+  _tx.ackFctPtr = ackFctPtr;
+  return KNX_BUSCOUPLER_OK;
+}
+
+inline byte KnxIpRoutingCoupler::GetStateIndication(void) const { return 0; }
+
+inline KnxTelegram& KnxIpRoutingCoupler::GetReceivedTelegram(void) { return _rx.receivedTelegram; }
+
+inline byte KnxIpRoutingCoupler::GetTargetedComObjectIndex(void) const { return _rx.addressedComObjectIndex; }
+
+inline boolean KnxIpRoutingCoupler::IsActive(void) const { return (_tx.state > TX_IDLE); }
+
+inline boolean KnxIpRoutingCoupler::IsTxBusy(void) const { return (_tx.state != TX_IDLE); }
+
+inline boolean KnxIpRoutingCoupler::PopReceivedTelegram(type_buscoupler_rx_telegram& rxTelegram)
+{ return _rx.queue.Pop(rxTelegram); }
+
+inline word KnxIpRoutingCoupler::GetRxOverflowsNb(void) const { return _rx.overflowsNb; }
+
+inline boolean KnxIpRoutingCoupler::SetGroupStats(KnxGroupStats *groupStats) { _groupStats = groupStats; return true; }
+
+inline boolean KnxIpRoutingCoupler::SetFrameCallback(type_FrameCallbackFctPtr frameFct)
+{ _frameCallbackFct = frameFct; return true; }
+
+inline word KnxIpRoutingCoupler::GetReceivedBusyNb(void) const { return _receivedBusyNb; }
+
+inline int KnxIpRoutingCoupler::GetFd(void) const { return _socket; }
+
+#if defined(KNXTPUART_DEBUG_INFO) || defined(KNXTPUART_DEBUG_ERROR)
+inline void KnxIpRoutingCoupler::SetTraceRing(KnxTraceRing *traceRing) { _traceRing = traceRing; }
+#endif
+
+#if defined(KNXTPUART_DEBUG_INFO)
+inline void KnxIpRoutingCoupler::DebugInfo(e_KnxTraceEvent event, word arg0, word arg1) const
+{
+  if (_traceRing != NULL) _traceRing->Record(event, arg0, arg1);
+}
+#endif
+
+#if defined(KNXTPUART_DEBUG_ERROR)
+inline void KnxIpRoutingCoupler::DebugError(e_KnxTraceEvent event) const
+{
+  if (_traceRing != NULL) _traceRing->Record(event);
+}
+#endif
+
+#endif // __linux__
+
+#endif // KNXIPROUTINGCOUPLER_H
@@ -0,0 +1,458 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxIpTunnelingServer.cpp
+// Author : Franck Marini
+// Description : KNXnet/IP tunneling server endpoint (Linux implementation)
+// Module dependencies : KnxCemi, KnxNetIp, KnxTelegram, KnxComObject, ActionRingBuffer
+
+#include "KnxIpTunnelingServer.h"
+
+#if defined(__linux__)
+
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+// Frame sizes (KNXnet/IP header included)
+#define CONNECT_REQUEST_SIZE        (KNXNETIP_HEADER_SIZE + 2 * KNXNETIP_HPAI_SIZE + 4)
+#define CONNECT_RESPONSE_SIZE       (KNXNETIP_HEADER_SIZE + 2 + KNXNETIP_HPAI_SIZE + 4)
+#define CONNECTION_REQUEST_SIZE     (KNXNETIP_HEADER_SIZE + 2 + KNXNETIP_HPAI_SIZE) // CONNECTIONSTATE and DISCONNECT requests
+#define STATUS_FRAME_SIZE           (KNXNETIP_HEADER_SIZE + 2)
+#define CONNECTION_HEADER_SIZE      4
+#define TUNNELING_ACK_SIZE          (KNXNETIP_HEADER_SIZE + CONNECTION_HEADER_SIZE)
+
+// CRI/CRD structure length
+#define TUNNEL_CRI_SIZE 4
+
+
+KnxIpTunnelingServer::KnxIpTunnelingServer(word deviceAddr, word tunnelBaseAddr, KnxComObject** comObjectsList,
+                                           byte comObjectsNb, type_TransmitCallbackFctPtr transmitFct, word port,
+                                           const char *interfaceAddr)
+: _deviceAddr(deviceAddr), _tunnelBaseAddr(tunnelBaseAddr), _port(port), _interfaceAddr(interfaceAddr)
+{
+  _socket = -1;
+  _comObjectsList = comObjectsList;
+  _comObjectsNb = comObjectsNb;
+  _transmitFct = transmitFct;
+  for (byte i = 0; i < KNXIPTUNNEL_MAX_CONNECTIONS; i++) _connections[i].active = false;
+  _localReadsNb = 0;
+  _forwardedNb = 0;
+  _rejectedConnectionsNb = 0;
+}
+
+
+KnxIpTunnelingServer::~KnxIpTunnelingServer() { End(); }
+
+
+byte KnxIpTunnelingServer::Begin(void)
+{
+  struct sockaddr_in local;
+  int enable = 1;
+
+  End(); // in case of restart
+  memset(&local, 0, sizeof(local));
+  local.sin_family = AF_INET;
+  local.sin_port = htons(_port);
+  local.sin_addr.s_addr = _interfaceAddr ? inet_addr(_interfaceAddr) : htonl(INADDR_ANY);
+  _socket = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if ( (_socket < 0)
+    || (setsockopt(_socket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) < 0)
+    || (bind(_socket, (struct sockaddr *)&local, sizeof(local)) < 0) )
+  {
+    End();
+    return KNX_IPTUNNEL_ERROR;
+  }
+  return KNX_IPTUNNEL_OK;
+}
+
+
+void KnxIpTunnelingServer::End(void)
+{
+  for (byte i = 0; i < KNXIPTUNNEL_MAX_CONNECTIONS; i++) _connections[i].active = false;
+  if (_socket >= 0) { close(_socket); _socket = -1; }
+}
+
+
+// Server task
+// The received frames are handled first, so that the acknowledged connections can send their next frame
+void KnxIpTunnelingServer::Task(void)
+{
+  byte frame[KNXIPTUNNEL_FRAME_MAX_SIZE];
+  struct sockaddr_in sender;
+  socklen_t senderLength;
+  ssize_t length;
+  unsigned long nowTime;
+
+  if (_socket < 0) return;
+  for (;;)
+  {
+    senderLength = sizeof(sender);
+    length = recvfrom(_socket, frame, sizeof(frame), MSG_DONTWAIT, (struct sockaddr *)&sender, &senderLength);
+    if (length < 0) { if (errno == EINTR) continue; else break; }
+    ProcessFrame(frame, (word)length, sender);
+  }
+
+  nowTime = KnxMillis();
+  for (byte channel = 1; channel <= KNXIPTUNNEL_MAX_CONNECTIONS; channel++)
+  {
+    if (!_connections[channel - 1].active) continue;
+    if (nowTime - _connections[channel - 1].aliveTimeMillis > KNXNETIP_CONNECTION_ALIVE_TIME) Disconnect(channel);
+    else ServiceConnection(channel);
+  }
+}
+
+
+boolean KnxIpTunnelingServer::WaitForRxData(unsigned long timeoutMicros)
+{
+  struct pollfd pfd;
+  int nb;
+
+  if (_socket < 0) return false;
+  pfd.fd = _socket; pfd.events = POLLIN;
+  do nb = poll(&pfd, 1, (int)((timeoutMicros + 999) / 1000));
+  while ((nb < 0) && (errno == EINTR));
+  return (nb > 0);
+}
+
+
+void KnxIpTunnelingServer::IndicateTelegram(const KnxTelegram& telegram, byte excludedChannel)
+{
+  byte cemi[KNX_CEMI_MAX_SIZE], length;
+
+  length = KnxTelegramToCemi(telegram, KNX_CEMI_L_DATA_IND, cemi);
+  for (byte channel = 1; channel <= KNXIPTUNNEL_MAX_CONNECTIONS; channel++)
+    if (channel != excludedChannel) QueueFrame(channel, cemi, length);
+}
+
+
+byte KnxIpTunnelingServer::GetConnectionsNb(void) const
+{
+  byte nb = 0;
+  for (byte i = 0; i < KNXIPTUNNEL_MAX_CONNECTIONS; i++) if (_connections[i].active) nb++;
+  return nb;
+}
+
+
+void KnxIpTunnelingServer::ProcessFrame(const byte frame[], word length, const struct sockaddr_in& sender)
+{
+  struct sockaddr_in endpoint;
+  word serviceType;
+  byte channel;
+
+  if (KnxNetIpReadHeader(frame, length, serviceType) != KNXNETIP_OK) return;
+  channel = frame[KNXNETIP_HEADER_SIZE]; // valid for the connection management services
+  switch (serviceType)
+  {
+    case KNXNETIP_CONNECT_REQUEST : ProcessConnectRequest(frame, length, sender); break;
+
+    case KNXNETIP_CONNECTIONSTATE_REQUEST :
+    case KNXNETIP_DISCONNECT_REQUEST :
+      if (length < CONNECTION_REQUEST_SIZE) break;
+      ReadHpai(frame + KNXNETIP_HEADER_SIZE + 2, sender, endpoint);
+      if ((channel == 0) || (channel > KNXIPTUNNEL_MAX_CONNECTIONS) || !_connections[channel - 1].active)
+      {
+        SendStatusFrame(serviceType + 1, channel, KNXNETIP_E_CONNECTION_ID, endpoint); // response = request + 1
+        break;
+      }
+      if (serviceType == KNXNETIP_CONNECTIONSTATE_REQUEST)
+      {
+        _connections[channel - 1].aliveTimeMillis = KnxMillis();
+        SendStatusFrame(KNXNETIP_CONNECTIONSTATE_RESPONSE, channel, KNXNETIP_E_NO_ERROR, endpoint);
+      }
+      else
+      {
+        _connections[channel - 1].active = false;
+        SendStatusFrame(KNXNETIP_DISCONNECT_RESPONSE, channel, KNXNETIP_E_NO_ERROR, endpoint);
+      }
+      break;
+
+    case KNXNETIP_TUNNELING_REQUEST : ProcessTunnelingRequest(frame, length, sender); break;
+
+    case KNXNETIP_TUNNELING_ACK :
+      if (length < TUNNELING_ACK_SIZE) break;
+      channel = frame[KNXNETIP_HEADER_SIZE + 1];
+      if ((channel == 0) || (channel > KNXIPTUNNEL_MAX_CONNECTIONS)) break;
+      { type_iptunnel_connection& connection = _connections[channel - 1];
+        if (!connection.active || !connection.waitingAck || (frame[KNXNETIP_HEADER_SIZE + 2] != connection.txSequence)) break;
+        // a negative ACK does not release the frame, it is repeated after the ACK timeout
+        if (frame[KNXNETIP_HEADER_SIZE + 3] != KNXNETIP_E_NO_ERROR) break;
+        connection.waitingAck = false;
+        connection.txSequence++;
+      }
+      ServiceConnection(channel); // send the next queued frame
+      break;
+
+    default : break; // DISCONNECT_RESPONSE, search and description services are not handled
+  }
+}
+
+
+void KnxIpTunnelingServer::ProcessConnectRequest(const byte frame[], word length, const struct sockaddr_in& sender)
+{
+  byte response[CONNECT_RESPONSE_SIZE];
+  struct sockaddr_in controlEndpoint;
+  const byte *cri = frame + KNXNETIP_HEADER_SIZE + 2 * KNXNETIP_HPAI_SIZE;
+  byte channel;
+  word addr;
+
+  if (length < CONNECT_REQUEST_SIZE) return;
+  ReadHpai(frame + KNXNETIP_HEADER_SIZE, sender, controlEndpoint);
+  if ((cri[0] < TUNNEL_CRI_SIZE) || (cri[1] != KNXNETIP_TUNNEL_CONNECTION))
+  { SendStatusFrame(KNXNETIP_CONNECT_RESPONSE, 0, KNXNETIP_E_CONNECTION_TYPE, controlEndpoint); return; }
+  if (cri[2] != KNXNETIP_TUNNEL_LINKLAYER)
+  { SendStatusFrame(KNXNETIP_CONNECT_RESPONSE, 0, KNXNETIP_E_CONNECTION_OPTION, controlEndpoint); return; }
+
+  for (channel = 1; (channel <= KNXIPTUNNEL_MAX_CONNECTIONS) && _connections[channel - 1].active; channel++);
+  if (channel > KNXIPTUNNEL_MAX_CONNECTIONS)
+  {
+    _rejectedConnectionsNb++;
+    SendStatusFrame(KNXNETIP_CONNECT_RESPONSE, 0, KNXNETIP_E_NO_MORE_CONNECTIONS, controlEndpoint);
+    return;
+  }
+
+  type_iptunnel_connection& connection = _connections[channel - 1];
+  type_iptunnel_frame discarded;
+  connection.active = true;
+  connection.controlEndpoint = controlEndpoint;
+  ReadHpai(frame + KNXNETIP_HEADER_SIZE + KNXNETIP_HPAI_SIZE, sender, connection.dataEndpoint);
+  connection.rxSequence = 0;
+  connection.txSequence = 0;
+  connection.waitingAck = false;
+  connection.repeatsNb = 0;
+  connection.aliveTimeMillis = KnxMillis();
+  while (connection.txQueue.Pop(discarded)); // frames of a previous connection on the same channel
+
+  addr = _tunnelBaseAddr + channel - 1;
+  KnxNetIpWriteHeader(response, KNXNETIP_CONNECT_RESPONSE, sizeof(response));
+  response[6] = channel;
+  response[7] = KNXNETIP_E_NO_ERROR;
+  WriteLocalHpai(response + 8);
+  response[16] = TUNNEL_CRI_SIZE; response[17] = KNXNETIP_TUNNEL_CONNECTION;
+  response[18] = (byte)(addr >> 8); response[19] = (byte)addr;
+  SendFrame(response, sizeof(response), controlEndpoint);
+}
+
+
+// Handle a client TUNNELING_REQUEST
+// Expected sequence : acknowledge and process; previous sequence (repetition) : acknowledge only; else ignore
+void KnxIpTunnelingServer::ProcessTunnelingRequest(const byte frame[], word length, const struct sockaddr_in& sender)
+{
+  const byte *header = frame + KNXNETIP_HEADER_SIZE;
+  byte channel, sequence;
+
+  if (length < KNXNETIP_HEADER_SIZE + CONNECTION_HEADER_SIZE + KNX_CEMI_MIN_SIZE) return;
+  channel = header[1];
+  sequence = header[2];
+  if ((header[0] != CONNECTION_HEADER_SIZE) || (channel == 0) || (channel > KNXIPTUNNEL_MAX_CONNECTIONS)) return;
+  type_iptunnel_connection& connection = _connections[channel - 1];
+  if (!connection.active) return;
+
+  if (sequence == connection.rxSequence)
+  {
+    connection.rxSequence++;
+    SendConnectionHeaderFrame(KNXNETIP_TUNNELING_ACK, channel, sequence, KNXNETIP_E_NO_ERROR, connection.dataEndpoint);
+    ProcessCemiRequest(channel, header + CONNECTION_HEADER_SIZE, length - KNXNETIP_HEADER_SIZE - CONNECTION_HEADER_SIZE);
+  }
+  else if (sequence == (byte)(connection.rxSequence - 1))
+    SendConnectionHeaderFrame(KNXNETIP_TUNNELING_ACK, channel, sequence, KNXNETIP_E_NO_ERROR, connection.dataEndpoint);
+}
+
+
+// Handle a cEMI frame tunneled by a client
+// NB : the L_Data.con reports the acceptance of the telegram by the transmit callback, not the bus acknowledge
+void KnxIpTunnelingServer::ProcessCemiRequest(byte channel, const byte cemi[], byte length)
+{
+  KnxTelegram telegram, response;
+  byte confirmation[KNX_CEMI_MAX_SIZE], confirmationLength, index;
+  boolean transmitError = false;
+
+  if ((cemi[0] != KNX_CEMI_L_DATA_REQ) || (KnxCemiToTelegram(cemi, length, telegram) != KNX_CEMI_OK)) return;
+  if (telegram.GetSourceAddress() == 0)
+  { // the tunnel address is used by default
+    telegram.SetSourceAddress(_tunnelBaseAddr + channel - 1);
+    telegram.UpdateChecksum();
+  }
+
+  if ( telegram.IsMulticast() && (telegram.GetCommand() == KNX_COMMAND_VALUE_READ)
+    && FindComObject(telegram.GetTargetAddress(), index)
+    && ((_comObjectsList[index]->GetIndicator() & (KNX_COM_OBJ_C_INDICATOR | KNX_COM_OBJ_R_INDICATOR))
+        == (KNX_COM_OBJ_C_INDICATOR | KNX_COM_OBJ_R_INDICATOR)) )
+  { // group read of a local com object : answered locally, the TP line is not used
+    confirmationLength = KnxTelegramToCemi(telegram, KNX_CEMI_L_DATA_CON, confirmation);
+    QueueFrame(channel, confirmation, confirmationLength);
+    _comObjectsList[index]->CopyAttributes(response);
+    _comObjectsList[index]->CopyValue(response);
+    response.SetCommand(KNX_COMMAND_VALUE_RESPONSE);
+    response.SetSourceAddress(_deviceAddr);
+    response.UpdateChecksum();
+    IndicateTelegram(response);
+    _localReadsNb++;
+    return;
+  }
+
+  // any other telegram is forwarded to the bus coupler
+  if (_transmitFct && (_transmitFct(&telegram) == KNX_BUSCOUPLER_OK)) _forwardedNb++;
+  else transmitError = true;
+  confirmationLength = KnxTelegramToCemi(telegram, KNX_CEMI_L_DATA_CON, confirmation);
+  if (transmitError) confirmation[2] |= KNX_CEMI_CTRL1_CONFIRM_ERROR_MASK;
+  QueueFrame(channel, confirmation, confirmationLength);
+  // the other clients see the group writes and responses as if they came from the bus
+  if (!transmitError && telegram.IsMulticast() && (telegram.GetCommand() != KNX_COMMAND_VALUE_READ))
+    IndicateTelegram(telegram, channel);
+}
+
+
+void KnxIpTunnelingServer::QueueFrame(byte channel, const byte cemi[], byte length)
+{
+  type_iptunnel_frame frame;
+
+  if (!_connections[channel - 1].active) return;
+  frame.length = length;
+  memcpy(frame.cemi, cemi, length);
+  _connections[channel - 1].txQueue.Append(frame);
+  ServiceConnection(channel);
+}
+
+
+void KnxIpTunnelingServer::ServiceConnection(byte channel)
+{
+  type_iptunnel_connection& connection = _connections[channel - 1];
+
+  if (!connection.active) return;
+  if (connection.waitingAck)
+  {
+    if (KnxMillis() - connection.txTimeMillis < KNXNETIP_TUNNELING_REQUEST_TIMEOUT) return;
+    if (connection.repeatsNb)
+    { // no ACK after the repetition, the connection is lost
+      Disconnect(channel);
+      return;
+    }
+    connection.repeatsNb++;
+    SendTunnelingRequest(channel);
+    return;
+  }
+  if (!connection.txQueue.Pop(connection.pendingFrame)) return;
+  connection.waitingAck = true;
+  connection.repeatsNb = 0;
+  SendTunnelingRequest(channel);
+}
+
+
+void KnxIpTunnelingServer::Disconnect(byte channel)
+{
+  byte frame[CONNECTION_REQUEST_SIZE];
+
+  KnxNetIpWriteHeader(frame, KNXNETIP_DISCONNECT_REQUEST, sizeof(frame));
+  frame[6] = channel;
+  frame[7] = 0; // reserved
+  WriteLocalHpai(frame + 8);
+  SendFrame(frame, sizeof(frame), _connections[channel - 1].controlEndpoint);
+  _connections[channel - 1].active = false;
+}
+
+
+void KnxIpTunnelingServer::SendTunnelingRequest(byte channel)
+{
+  type_iptunnel_connection& connection = _connections[channel - 1];
+  byte frame[KNXNETIP_HEADER_SIZE + CONNECTION_HEADER_SIZE + KNX_CEMI_MAX_SIZE];
+  word length = KNXNETIP_HEADER_SIZE + CONNECTION_HEADER_SIZE + connection.pendingFrame.length;
+
+  KnxNetIpWriteHeader(frame, KNXNETIP_TUNNELING_REQUEST, length);
+  frame[6] = CONNECTION_HEADER_SIZE;
+  frame[7] = channel;
+  frame[8] = connection.txSequence;
+  frame[9] = 0; // reserved
+  memcpy(frame + KNXNETIP_HEADER_SIZE + CONNECTION_HEADER_SIZE, connection.pendingFrame.cemi, connection.pendingFrame.length);
+  connection.txTimeMillis = KnxMillis();
+  SendFrame(frame, length, connection.dataEndpoint);
+}
+
+
+void KnxIpTunnelingServer::SendConnectionHeaderFrame(word serviceType, byte channel, byte sequence, byte status,
+                                                     const struct sockaddr_in& dest)
+{
+  byte frame[TUNNELING_ACK_SIZE];
+
+  KnxNetIpWriteHeader(frame, serviceType, sizeof(frame));
+  frame[6] = CONNECTION_HEADER_SIZE;
+  frame[7] = channel;
+  frame[8] = sequence;
+  frame[9] = status;
+  SendFrame(frame, sizeof(frame), dest);
+}
+
+
+void KnxIpTunnelingServer::SendStatusFrame(word serviceType, byte channel, byte status, const struct sockaddr_in& dest)
+{
+  byte frame[STATUS_FRAME_SIZE];
+
+  KnxNetIpWriteHeader(frame, serviceType, sizeof(frame));
+  frame[6] = channel;
+  frame[7] = status;
+  SendFrame(frame, sizeof(frame), dest);
+}
+
+
+void KnxIpTunnelingServer::SendFrame(const byte frame[], word length, const struct sockaddr_in& dest)
+{
+  if (_socket < 0) return;
+  sendto(_socket, frame, length, 0, (const struct sockaddr *)&dest, sizeof(dest));
+}
+
+
+// The HPAI gives the bound address and port, 0.0.0.0 when bound to all the interfaces
+// (the clients then use the source address of the response)
+void KnxIpTunnelingServer::WriteLocalHpai(byte hpai[]) const
+{
+  struct sockaddr_in local;
+  socklen_t localLength = sizeof(local);
+
+  memset(&local, 0, sizeof(local));
+  getsockname(_socket, (struct sockaddr *)&local, &localLength);
+  hpai[0] = KNXNETIP_HPAI_SIZE;
+  hpai[1] = KNXNETIP_IPV4_UDP;
+  memcpy(hpai + 2, &local.sin_addr.s_addr, 4); // network byte order
+  memcpy(hpai + 6, &local.sin_port, 2);
+}
+
+
+void KnxIpTunnelingServer::ReadHpai(const byte hpai[], const struct sockaddr_in& sender, struct sockaddr_in& endpoint)
+{
+  memset(&endpoint, 0, sizeof(endpoint));
+  endpoint.sin_family = AF_INET;
+  memcpy(&endpoint.sin_addr.s_addr, hpai + 2, 4);
+  memcpy(&endpoint.sin_port, hpai + 6, 2);
+  // NAT mode : 0.0.0.0:0 means "reply to the sender"
+  if (endpoint.sin_addr.s_addr == 0) endpoint.sin_addr = sender.sin_addr;
+  if (endpoint.sin_port == 0) endpoint.sin_port = sender.sin_port;
+}
+
+
+boolean KnxIpTunnelingServer::FindComObject(word addr, byte &index) const
+{
+  for (index = 0; index < _comObjectsNb; index++) if (_comObjectsList[index]->GetAddr() == addr) return true;
+  return false;
+}
+
+#endif // __linux__
+
+// EOF
@@ -0,0 +1,188 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxIpTunnelingServer.h
+// Author : Franck Marini
+// Description : KNXnet/IP tunneling server endpoint (Linux implementation)
+// Module dependencies : KnxCemi, KnxNetIp, KnxTelegram, KnxComObject, ActionRingBuffer
+
+// The server lets KNXnet/IP tunneling clients (visualisation, commissioning tools) talk to the device
+// without an extra IP interface :
+// - up to KNXIPTUNNEL_MAX_CONNECTIONS simultaneous tunnel connections (link layer tunnels), each one gets
+//   its own individual address (base address + channel id)
+// - per channel sequence numbers, TUNNELING_ACK handling, 1 repetition after 1s then disconnection
+// - L_Data.req frames are confirmed (L_Data.con) and then :
+//     * group reads of a local com object (C+R indicators) are answered from the local value,
+//       nothing is sent on the bus
+//     * group writes and responses are forwarded to the bus coupler through the transmit callback
+//       and are indicated to the other clients. The server does not update the local com objects,
+//       this is up to the transmit callback : Knx.sendTelegram() updates (and notifies) the local
+//       com objects with the target address and W (U) indicator, as for a telegram received from the bus
+//     * any other telegram is forwarded to the bus coupler
+// - IndicateTelegram() forwards a telegram (e.g. received from the bus) to all the connected clients,
+//   e.g. called by the function set with KnxDevice::setTelegramCallback()
+// The server is driven by Task(), to be called in the application loop (or after WaitForRxData()).
+
+#ifndef KNXIPTUNNELINGSERVER_H
+#define KNXIPTUNNELINGSERVER_H
+
+#if defined(__linux__)
+
+#include "Arduino.h"
+#include "KnxTelegram.h"
+#include "KnxComObject.h"
+#include "KnxBusCoupler.h"
+#include "ActionRingBuffer.h"
+#include "KnxCemi.h"
+#include "KnxNetIp.h"
+#include <netinet/in.h>
+
+// !!!!!!!!!!!!!!! FLAG OPTIONS !!!!!!!!!!!!!!!!!
+// Max nb of simultaneous tunnel connections
+#ifndef KNXIPTUNNEL_MAX_CONNECTIONS
+#define KNXIPTUNNEL_MAX_CONNECTIONS 8
+#endif
+
+// Size of the per connection queue of frames waiting to be sent to the client
+#ifndef KNXIPTUNNEL_TX_QUEUE_SIZE
+#define KNXIPTUNNEL_TX_QUEUE_SIZE 8
+#endif
+
+#define KNXIPTUNNEL_FRAME_MAX_SIZE 128
+
+// Values returned by the KnxIpTunnelingServer member functions :
+#define KNX_IPTUNNEL_OK      0
+#define KNX_IPTUNNEL_ERROR 255
+
+// cEMI frame waiting to be sent to a client
+typedef struct {
+  byte length;
+  byte cemi[KNX_CEMI_MAX_SIZE];
+} type_iptunnel_frame;
+
+// Tunnel connection
+typedef struct {
+  boolean active;                     // true when the connection (channel) is in use
+  struct sockaddr_in controlEndpoint; // Client control endpoint (connection management)
+  struct sockaddr_in dataEndpoint;    // Client data endpoint (tunneling requests)
+  byte rxSequence;                    // Sequence counter expected in the next client TUNNELING_REQUEST
+  byte txSequence;                    // Sequence counter of our next TUNNELING_REQUEST
+  boolean waitingAck;                 // true when our last TUNNELING_REQUEST is not acknowledged yet
+  byte repeatsNb;                     // Nb of repetitions of the not acknowledged TUNNELING_REQUEST
+  unsigned long txTimeMillis;         // Sending time of the not acknowledged TUNNELING_REQUEST
+  unsigned long aliveTimeMillis;      // Time of the last CONNECTIONSTATE_REQUEST (or connection)
+  type_iptunnel_frame pendingFrame;   // Not acknowledged frame
+  ActionRingBuffer<type_iptunnel_frame, KNXIPTUNNEL_TX_QUEUE_SIZE> txQueue; // Frames waiting to be sent
+} type_iptunnel_connection;
+
+
+class KnxIpTunnelingServer {
+    const word _deviceAddr;                   // Individual address of the device (source of the local responses)
+    const word _tunnelBaseAddr;               // Individual address of channel n is _tunnelBaseAddr + n - 1
+    const word _port;                         // UDP port
+    const char *_interfaceAddr;               // IP address of the network interface (NULL = all interfaces)
+    int _socket;                              // UDP socket (-1 when closed)
+    KnxComObject **_comObjectsList;           // Local com objects
+    byte _comObjectsNb;                       // Nb of local com objects
+    type_TransmitCallbackFctPtr _transmitFct; // Forwarding of the telegrams to the bus coupler
+    type_iptunnel_connection _connections[KNXIPTUNNEL_MAX_CONNECTIONS]; // channel id n is _connections[n-1]
+    word _localReadsNb;                       // Nb of group reads answered from the local com objects
+    word _forwardedNb;                        // Nb of telegrams forwarded to the bus coupler
+    word _rejectedConnectionsNb;              // Nb of connection requests rejected (no more connections)
+
+  public:
+    // Constructor / Destructor
+    // "transmitFct" is called with each telegram to be sent on the bus, e.g. a function calling Knx.sendTelegram()
+    KnxIpTunnelingServer(word deviceAddr, word tunnelBaseAddr, KnxComObject** comObjectsList, byte comObjectsNb,
+                         type_TransmitCallbackFctPtr transmitFct, word port = KNXNETIP_PORT, const char *interfaceAddr = NULL);
+    ~KnxIpTunnelingServer();
+
+  // INLINED functions (see definitions later in this file)
+    // UDP socket, allows to integrate the server into an application event loop
+    int GetFd(void) const;
+
+    // Statistics
+    word GetLocalReadsNb(void) const;
+    word GetForwardedNb(void) const;
+    word GetRejectedConnectionsNb(void) const;
+
+  // Functions NOT INLINED
+    // Open the UDP socket
+    // return KNX_IPTUNNEL_ERROR in case of network failure, else KNX_IPTUNNEL_OK
+    byte Begin(void);
+
+    // Close the UDP socket, all the connections are lost
+    void End(void);
+
+    // Server task : handle all the received frames, the repetitions and the connection timeouts
+    void Task(void);
+
+    // Wait up to "timeoutMicros" for received frames, return true when data is available
+    boolean WaitForRxData(unsigned long timeoutMicros);
+
+    // Send a telegram (L_Data.ind) to all the connected clients, except the one on "excludedChannel" (0 = none)
+    void IndicateTelegram(const KnxTelegram& telegram, byte excludedChannel = 0);
+
+    // Nb of active tunnel connections
+    byte GetConnectionsNb(void) const;
+
+  private:
+    void ProcessFrame(const byte frame[], word length, const struct sockaddr_in& sender);
+    void ProcessConnectRequest(const byte frame[], word length, const struct sockaddr_in& sender);
+    void ProcessTunnelingRequest(const byte frame[], word length, const struct sockaddr_in& sender);
+    void ProcessCemiRequest(byte channel, const byte cemi[], byte length);
+
+    // Queue a cEMI frame for the connection "channel", the frame is sent as soon as the previous one is acknowledged
+    void QueueFrame(byte channel, const byte cemi[], byte length);
+
+    // Send the next queued frame, repeat or disconnect on acknowledge timeout
+    void ServiceConnection(byte channel);
+
+    // Send a DISCONNECT_REQUEST to the client and release the connection
+    void Disconnect(byte channel);
+
+    void SendTunnelingRequest(byte channel);
+    void SendConnectionHeaderFrame(word serviceType, byte channel, byte sequence, byte status, const struct sockaddr_in& dest);
+    void SendStatusFrame(word serviceType, byte channel, byte status, const struct sockaddr_in& dest);
+    void SendFrame(const byte frame[], word length, const struct sockaddr_in& dest);
+
+    // Write the HPAI of the server data/control endpoint
+    void WriteLocalHpai(byte hpai[]) const;
+
+    // Read a HPAI, the sender address is used in case of NAT (route back) HPAI
+    static void ReadHpai(const byte hpai[], const struct sockaddr_in& sender, struct sockaddr_in& endpoint);
+
+    // Get the index of the local com object with the address "addr", return false if none
+    boolean FindComObject(word addr, byte &index) const;
+};
+
+
+// ----- Definition of the INLINED functions :  ------------
+
+inline int KnxIpTunnelingServer::GetFd(void) const { return _socket; }
+
+inline word KnxIpTunnelingServer::GetLocalReadsNb(void) const { return _localReadsNb; }
+
+inline word KnxIpTunnelingServer::GetForwardedNb(void) const { return _forwardedNb; }
+
+inline word KnxIpTunnelingServer::GetRejectedConnectionsNb(void) const { return _rejectedConnectionsNb; }
+
+#endif // __linux__
+
+#endif // KNXIPTUNNELINGSERVER_H
@@ -0,0 +1,110 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxNetIp.h
+// Author : Franck Marini
+// Description : KNXnet/IP protocol definitions (header, service types, routing and tunneling constants)
+// Module dependencies : none
+
+// ---------- KNXnet/IP frame description (visit "www.knx.org" for more info) -----------
+//        Byte 0 | Header length (0x06)
+//        Byte 1 | Protocol version (0x10)
+//        Byte 2 | Service type High byte
+//        Byte 3 | Service type Low byte
+//        Byte 4 | Total length High byte (header included)
+//        Byte 5 | Total length Low byte
+//        Byte 6 ... | Service body (e.g. cEMI frame for a ROUTING_INDICATION)
+
+#ifndef KNXNETIP_H
+#define KNXNETIP_H
+
+#include "Arduino.h"
+
+#define KNXNETIP_HEADER_SIZE       6
+#define KNXNETIP_PROTOCOL_VERSION  0x10
+#define KNXNETIP_PORT              3671
+#define KNXNETIP_ROUTING_MULTICAST_ADDR "224.0.23.12"
+
+// Service types
+#define KNXNETIP_SEARCH_REQUEST             0x0201
+#define KNXNETIP_CONNECT_REQUEST            0x0205
+#define KNXNETIP_CONNECT_RESPONSE           0x0206
+#define KNXNETIP_CONNECTIONSTATE_REQUEST    0x0207
+#define KNXNETIP_CONNECTIONSTATE_RESPONSE   0x0208
+#define KNXNETIP_DISCONNECT_REQUEST         0x0209
+#define KNXNETIP_DISCONNECT_RESPONSE        0x020A
+#define KNXNETIP_TUNNELING_REQUEST          0x0420
+#define KNXNETIP_TUNNELING_ACK              0x0421
+#define KNXNETIP_ROUTING_INDICATION         0x0530
+#define KNXNETIP_ROUTING_LOST_MESSAGE       0x0531
+#define KNXNETIP_ROUTING_BUSY               0x0532
+
+// Status / error codes
+#define KNXNETIP_E_NO_ERROR                 0x00
+#define KNXNETIP_E_CONNECTION_ID            0x21
+#define KNXNETIP_E_CONNECTION_TYPE          0x22
+#define KNXNETIP_E_CONNECTION_OPTION        0x23
+#define KNXNETIP_E_NO_MORE_CONNECTIONS      0x24
+#define KNXNETIP_E_SEQUENCE_NUMBER          0x04
+#define KNXNETIP_E_DATA_CONNECTION          0x26
+#define KNXNETIP_E_KNX_CONNECTION           0x27
+
+// Connection types and layers
+#define KNXNETIP_TUNNEL_CONNECTION          0x04
+#define KNXNETIP_TUNNEL_LINKLAYER           0x02
+
+// Host protocol address information (HPAI)
+#define KNXNETIP_HPAI_SIZE                  8
+#define KNXNETIP_IPV4_UDP                   0x01
+
+// Routing flow control (see KNXnet/IP routing specification)
+#define KNXNETIP_ROUTING_MAX_RATE           50   // Max nb of ROUTING_INDICATION sent per second
+#define KNXNETIP_ROUTING_BUSY_WAIT_TIME     100  // Wait time (ms) requested in the ROUTING_BUSY we send
+#define KNXNETIP_ROUTING_BUSY_RANDOM_TIME   50   // Random wait time (ms) per received ROUTING_BUSY
+#define KNXNETIP_ROUTING_BUSY_RESET_TIME    600  // Time (ms) without ROUTING_BUSY before the busy counter reset
+
+// Tunneling timings (see KNXnet/IP tunneling specification)
+#define KNXNETIP_TUNNELING_REQUEST_TIMEOUT  1000   // Time (ms) to wait for a TUNNELING_ACK before repeating
+#define KNXNETIP_CONNECTION_ALIVE_TIME      120000 // Time (ms) without CONNECTIONSTATE_REQUEST before disconnection
+
+// Values returned by the KNXnet/IP header parsing function :
+#define KNXNETIP_OK      0
+#define KNXNETIP_ERROR 255
+
+
+// Write a KNXnet/IP header, "totalLength" includes the header
+inline void KnxNetIpWriteHeader(byte frame[], word serviceType, word totalLength)
+{
+  frame[0] = KNXNETIP_HEADER_SIZE; frame[1] = KNXNETIP_PROTOCOL_VERSION;
+  frame[2] = (byte)(serviceType >> 8); frame[3] = (byte)serviceType;
+  frame[4] = (byte)(totalLength >> 8); frame[5] = (byte)totalLength;
+}
+
+// Check a received KNXnet/IP header and get its service type
+// return KNXNETIP_ERROR if the header is invalid or if the total length does not match the received length
+inline byte KnxNetIpReadHeader(const byte frame[], word length, word& serviceType)
+{
+  if ((length < KNXNETIP_HEADER_SIZE) || (frame[0] != KNXNETIP_HEADER_SIZE) || (frame[1] != KNXNETIP_PROTOCOL_VERSION))
+    return KNXNETIP_ERROR;
+  if ((word)((frame[4] << 8) | frame[5]) != length) return KNXNETIP_ERROR;
+  serviceType = (frame[2] << 8) | frame[3];
+  return KNXNETIP_OK;
+}
+
+#endif // KNXNETIP_H
@@ -0,0 +1,174 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxPosixSerialTransport.cpp
+// Author : Franck Marini
+// Description : Linux implementation of the TPUART byte stream transport
+// Module dependencies : KnxSerialTransport
+
+#include "KnxPosixSerialTransport.h"
+
+#if defined(__linux__)
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include <sys/epoll.h>
+
+KnxPosixSerialTransport::KnxPosixSerialTransport(const char *devicePath, unsigned long baudRate, boolean noParityFallback)
+: _devicePath(devicePath), _fd(-1), _epollFd(-1), _baudRate(baudRate), _noParityFallback(noParityFallback) {}
+
+
+KnxPosixSerialTransport::~KnxPosixSerialTransport() { End(); }
+
+
+// Open the serial device with the TPUART frame format (8 bits, parity even, 1 stop bit) at the configured baud rate
+// Return KNX_SERIAL_TRANSPORT_ERROR when the device rejects the format (unless the no parity fallback is allowed)
+byte KnxPosixSerialTransport::Begin(void)
+{
+  struct termios tty, readback;
+  struct epoll_event event;
+  speed_t speed;
+
+  switch (_baudRate)
+  {
+    case 9600 : speed = B9600; break;
+    case 19200 : speed = B19200; break;
+    case 38400 : speed = B38400; break;
+    case 57600 : speed = B57600; break;
+    case 115200 : speed = B115200; break;
+    default : return KNX_SERIAL_TRANSPORT_ERROR;
+  }
+  End(); // in case of reopening
+  _fd = open(_devicePath, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if (_fd < 0) return KNX_SERIAL_TRANSPORT_ERROR;
+
+  if (tcgetattr(_fd, &tty) < 0) { End(); return KNX_SERIAL_TRANSPORT_ERROR; }
+  cfmakeraw(&tty);
+  tty.c_cflag &= ~(CSIZE | PARODD | CSTOPB | CRTSCTS);
+  tty.c_cflag |= CS8 | PARENB | CLOCAL | CREAD;
+  tty.c_iflag &= ~(IXON | IXOFF | IXANY);
+  tty.c_cc[VMIN] = 0; // non-blocking reads
+  tty.c_cc[VTIME] = 0;
+  cfsetispeed(&tty, speed);
+  cfsetospeed(&tty, speed);
+  // NB : tcsetattr() succeeds when only a part of the settings is applied, the parity is checked by reading them back
+  if ((tcsetattr(_fd, TCSANOW, &tty) < 0) || (tcgetattr(_fd, &readback) < 0) || !(readback.c_cflag & PARENB))
+  { // pseudo-terminals have no parity and reject or drop it, the fallback without parity is allowed for the tests only
+    if (!_noParityFallback) { End(); return KNX_SERIAL_TRANSPORT_ERROR; }
+    tty.c_cflag &= ~PARENB;
+    if (tcsetattr(_fd, TCSANOW, &tty) < 0) { End(); return KNX_SERIAL_TRANSPORT_ERROR; }
+  }
+  tcflush(_fd, TCIOFLUSH);
+
+  _epollFd = epoll_create1(EPOLL_CLOEXEC);
+  if (_epollFd < 0) { End(); return KNX_SERIAL_TRANSPORT_ERROR; }
+  event.events = EPOLLIN;
+  event.data.fd = _fd;
+  if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, _fd, &event) < 0) { End(); return KNX_SERIAL_TRANSPORT_ERROR; }
+
+  return KNX_SERIAL_TRANSPORT_OK;
+}
+
+
+void KnxPosixSerialTransport::End(void)
+{
+  if (_epollFd >= 0) { close(_epollFd); _epollFd = -1; }
+  if (_fd >= 0) { close(_fd); _fd = -1; }
+}
+
+
+int KnxPosixSerialTransport::Available(void)
+{
+  int nb;
+  if ((_fd < 0) || (ioctl(_fd, FIONREAD, &nb) < 0)) return 0;
+  return nb;
+}
+
+
+int KnxPosixSerialTransport::Read(void)
+{
+  byte data;
+  if (ReadBytes(&data, 1) != 1) return -1;
+  return data;
+}
+
+
+word KnxPosixSerialTransport::ReadBytes(byte buffer[], word length)
+{
+  ssize_t nb;
+  if (_fd < 0) return 0;
+  do nb = read(_fd, buffer, length);
+  while ((nb < 0) && (errno == EINTR));
+  return (nb > 0) ? (word)nb : 0;
+}
+
+
+word KnxPosixSerialTransport::Write(byte data) { return Write(&data, 1); }
+
+
+// Write all the bytes, waiting for room in the kernel TX buffer if needed
+word KnxPosixSerialTransport::Write(const byte buffer[], word length)
+{
+  struct pollfd pfd;
+  word written = 0;
+  ssize_t nb;
+
+  if (_fd < 0) return 0;
+  while (written < length)
+  {
+    nb = write(_fd, buffer + written, length - written);
+    if (nb > 0) { written += nb; continue; }
+    if ((nb < 0) && (errno == EINTR)) continue;
+    if ((nb < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK)) break;
+    // kernel TX buffer full
+    pfd.fd = _fd; pfd.events = POLLOUT;
+    if (poll(&pfd, 1, KNX_POSIX_SERIAL_WRITE_TIMEOUT) <= 0) break;
+  }
+  return written;
+}
+
+
+int KnxPosixSerialTransport::AvailableForWrite(void)
+{
+  int pending;
+  if (_fd < 0) return 0;
+  if (ioctl(_fd, TIOCOUTQ, &pending) < 0) pending = 0;
+  return (pending < KNX_POSIX_SERIAL_TX_BUFFER_SIZE) ? KNX_POSIX_SERIAL_TX_BUFFER_SIZE - pending : 0;
+}
+
+
+boolean KnxPosixSerialTransport::WaitForData(unsigned long timeoutMicros)
+{
+  struct epoll_event event;
+  int nb;
+
+  if (_epollFd < 0) return false;
+  if (Available() > 0) return true;
+  do nb = epoll_wait(_epollFd, &event, 1, (int)((timeoutMicros + 999) / 1000));
+  while ((nb < 0) && (errno == EINTR));
+  return (nb > 0);
+}
+
+#endif // __linux__
+
+// EOF
@@ -0,0 +1,78 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxPosixSerialTransport.h
+// Author : Franck Marini
+// Description : Linux implementation of the TPUART byte stream transport (see KnxSerialTransport.h)
+//               The serial device is configured with termios (19200 baud by default, 8 bits, parity even, 1 stop bit)
+//               and opened in non-blocking mode. The reception wake-up (WaitForData) is based on epoll.
+// Module dependencies : KnxSerialTransport
+
+#ifndef KNXPOSIXSERIALTRANSPORT_H
+#define KNXPOSIXSERIALTRANSPORT_H
+
+#if defined(__linux__)
+
+#include "KnxSerialTransport.h"
+
+// Size of the kernel TX buffer considered for AvailableForWrite()
+#define KNX_POSIX_SERIAL_TX_BUFFER_SIZE 4096
+
+// Max time spent waiting for the kernel TX buffer to have room, in milliseconds
+#define KNX_POSIX_SERIAL_WRITE_TIMEOUT 100
+
+
+class KnxPosixSerialTransport : public KnxSerialTransport {
+    const char *_devicePath;     // serial device, e.g. "/dev/ttyAMA0"
+    int _fd;                     // serial device file descriptor (-1 when closed)
+    int _epollFd;                // epoll instance watching the serial device reception
+    const unsigned long _baudRate;
+    const boolean _noParityFallback;
+
+  public:
+    // Supported baud rates : 9600, 19200 (TPUART), 38400, 57600, 115200
+    // noParityFallback : the device is opened without parity when it rejects the even parity (e.g. the pseudo-terminals
+    // of the tests), instead of failing. NB : keep false with a real TPUART, which needs the parity
+    KnxPosixSerialTransport(const char *devicePath, unsigned long baudRate = 19200, boolean noParityFallback = false);
+    ~KnxPosixSerialTransport();
+
+    byte Begin(void);
+    void End(void);
+    int Available(void);
+    int Read(void);
+    word ReadBytes(byte buffer[], word length);
+    word Write(byte data);
+    word Write(const byte buffer[], word length);
+    int AvailableForWrite(void);
+
+    // Wait for received bytes with epoll, the timeout is rounded up to the millisecond
+    boolean WaitForData(unsigned long timeoutMicros);
+
+  // INLINED functions (see definitions later in this file)
+    // File descriptor of the serial device, allows to integrate the transport into an application event loop
+    int GetFd(void) const;
+};
+
+
+// --------------- Definition of the INLINED functions -----------------
+inline int KnxPosixSerialTransport::GetFd(void) const { return _fd; }
+
+#endif // __linux__
+
+#endif // KNXPOSIXSERIALTRANSPORT_H
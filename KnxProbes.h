@@ -0,0 +1,81 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxProbes.h
+// Author : Franck Marini
+// Description : Static tracepoints (USDT) of the library, for perf, bpftrace or SystemTap on Linux hosts
+//               On Linux, when <sys/sdt.h> is available (e.g. "systemtap-sdt-dev" package), each probe is a
+//               single nop instruction plus an ELF note describing its arguments : nothing runs until a tracer
+//               attaches to it. On the other targets (Arduino), or with the KNX_NO_PROBES flag, the probes
+//               are empty macros.
+//               Probes of the "knxdevice" provider (see the scripts in extras/bpftrace) :
+//               - telegram_received(source, target, command, comObjectIndex) : telegram popped from the bus
+//                 coupler RX queue by the KnxDevice task
+//               - ack_sent(target, addressed) : ACK service (addressed or not) sent by the TPUART driver
+//               - telegram_queued(actionType, comObjectIndex, queuedNb) : TX action queued by KnxDevice
+//                 (e_KnxDeviceTxActionType, nb of actions in the queue including this one)
+//               - telegram_sent(target, command, priority, comObjectIndex) : telegram handed over to the bus coupler
+//                 (comObjectIndex 255 for a telegram built by the application)
+//               - telegram_acked(ack) : end of the transmission (e_BusCouplerTxAck : 0 ACK, 1 NACK, 2 timeout, 3 reset)
+//               - coupler_reset() : bus coupler reset event handled by KnxDevice
+//               - queue_overflow(queue) : a queue was full and its oldest item was lost (KNX_PROBE_QUEUE_xxx)
+// Module dependencies : none
+
+#ifndef KNXPROBES_H
+#define KNXPROBES_H
+
+// !!!!!!!!!!!!!!! FLAG OPTIONS !!!!!!!!!!!!!!!!!
+// #define KNX_NO_PROBES   // Uncomment to compile out the static tracepoints on Linux too
+
+// Queues of the queue_overflow probe
+#define KNX_PROBE_QUEUE_TX_ACTIONS   0 // KnxDevice TX actions
+#define KNX_PROBE_QUEUE_RX_TELEGRAMS 1 // bus coupler received telegrams
+#define KNX_PROBE_QUEUE_MONITOR      2 // TPUART bus monitor frames ring
+
+#if defined(__linux__) && !defined(KNX_NO_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define KNX_PROBES_ENABLED
+#endif
+#endif
+
+#if defined(KNX_PROBES_ENABLED)
+#define KNX_PROBE_TELEGRAM_RECEIVED(source, target, command, index) \
+  DTRACE_PROBE4(knxdevice, telegram_received, source, target, command, index)
+#define KNX_PROBE_ACK_SENT(target, addressed)           DTRACE_PROBE2(knxdevice, ack_sent, target, addressed)
+#define KNX_PROBE_TELEGRAM_QUEUED(type, index, queuedNb) DTRACE_PROBE3(knxdevice, telegram_queued, type, index, queuedNb)
+#define KNX_PROBE_TELEGRAM_SENT(target, command, priority, index) \
+  DTRACE_PROBE4(knxdevice, telegram_sent, target, command, priority, index)
+#define KNX_PROBE_TELEGRAM_ACKED(ack)                   DTRACE_PROBE1(knxdevice, telegram_acked, ack)
+#define KNX_PROBE_COUPLER_RESET()                       DTRACE_PROBE(knxdevice, coupler_reset)
+#define KNX_PROBE_QUEUE_OVERFLOW(queue)                 DTRACE_PROBE1(knxdevice, queue_overflow, queue)
+#else // no-op statements, usable as the body of an "if"
+#define KNX_PROBE_TELEGRAM_RECEIVED(source, target, command, index) do {} while (0)
+#define KNX_PROBE_ACK_SENT(target, addressed)           do {} while (0)
+#define KNX_PROBE_TELEGRAM_QUEUED(type, index, queuedNb) do {} while (0)
+#define KNX_PROBE_TELEGRAM_SENT(target, command, priority, index) do {} while (0)
+#define KNX_PROBE_TELEGRAM_ACKED(ack)                   do {} while (0)
+#define KNX_PROBE_COUPLER_RESET()                       do {} while (0)
+#define KNX_PROBE_QUEUE_OVERFLOW(queue)                 do {} while (0)
+#endif
+
+#endif // KNXPROBES_H
+
+// EOF
@@ -0,0 +1,98 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxProfiler.cpp
+// Author : Franck Marini
+// Description : CPU time profiling of the library tasks
+// Module dependencies : KnxClock
+
+#include "KnxProfiler.h"
+
+#if defined(KNX_PROFILING)
+
+// KnxProfiler unique instance creation
+KnxProfiler KnxProf;
+
+
+KnxProfiler::KnxProfiler()
+{
+  _watchdogLimitTicks = MicrosToTicks(KNX_PROFILE_WATCHDOG_MICROS);
+  _watchdogFctPtr = NULL;
+  Clear();
+}
+
+
+void KnxProfiler::Record(e_KnxProfileStage stage, unsigned long ticks)
+{
+  type_profile_stats& stats = _stats[stage];
+  unsigned long remaining = ticks;
+  byte bucket = 0;
+
+  while (remaining && (bucket < KNX_PROFILE_BUCKETS_NB - 1)) { bucket++; remaining >>= 1; }
+  stats.buckets[bucket]++;
+  stats.callsNb++;
+  stats.totalTicks += ticks;
+  if (ticks > stats.maxTicks) stats.maxTicks = ticks;
+}
+
+
+void KnxProfiler::RecordKnxEvent(byte objectIndex, unsigned long ticks)
+{
+  Record(KNX_PROFILE_KNX_EVENTS, ticks);
+  if (ticks <= _watchdogLimitTicks) return;
+  _watchdogAlertsNb++;
+  if (ticks > _watchdogWorstTicks)
+  {
+    _watchdogWorstTicks = ticks;
+    _watchdogWorstObject = objectIndex;
+  }
+  if (_watchdogFctPtr) _watchdogFctPtr(objectIndex, TicksToMicros(ticks));
+}
+
+
+void KnxProfiler::Clear(void)
+{
+  memset(_stats, 0, sizeof(_stats));
+  _watchdogAlertsNb = 0;
+  _watchdogWorstTicks = 0;
+  _watchdogWorstObject = 255;
+}
+
+
+unsigned long KnxProfiler::GetPercentile(e_KnxProfileStage stage, byte percentile) const
+{
+  const type_profile_stats& stats = _stats[stage];
+  unsigned long rank, cumulated = 0;
+
+  if (!stats.callsNb) return 0;
+  if (percentile > 100) percentile = 100;
+  rank = (stats.callsNb / 100) * percentile + ((stats.callsNb % 100) * percentile + 99) / 100; // rank of the percentile value
+  if (!rank) rank = 1;
+  for (byte bucket = 0; bucket < KNX_PROFILE_BUCKETS_NB - 1; bucket++)
+  {
+    cumulated += stats.buckets[bucket];
+    if (cumulated >= rank) return 1UL << bucket;
+  }
+  return stats.maxTicks; // last bucket, no upper limit
+}
+
+#endif // KNX_PROFILING
+
+// EOF
@@ -0,0 +1,162 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxProfiler.h
+// Author : Franck Marini
+// Description : CPU time profiling of the library tasks
+//               With the KNX_PROFILING flag, the durations of the KnxDevice task steps, of the TPUART RX task
+//               (EOP handling and bytes parsing), of the TX task, of the bus coupler events dispatch and of the
+//               user knxEvents() callback are measured and counted per stage (calls nb, total, worst case and
+//               log-scale histogram). A watchdog flags the knxEvents() handlers running long enough to threaten
+//               the 1,7ms TPUART ACK deadline of the next received telegram.
+//               Without the flag, the profiling macros are empty and nothing is compiled.
+//               The durations are counted in ticks : CPU cycles on ESP32, usec on the other targets.
+// Module dependencies : KnxClock
+
+#ifndef KNXPROFILER_H
+#define KNXPROFILER_H
+
+#include "Arduino.h"
+#include "KnxClock.h"
+
+// !!!!!!!!!!!!!!! FLAG OPTIONS !!!!!!!!!!!!!!!!!
+// #define KNX_PROFILING   // Uncomment to activate the profiling hooks (about 1KB of RAM)
+
+// Profiled stages
+enum e_KnxProfileStage {
+  KNX_PROFILE_TASK_INIT = 0,        // KnxDevice::task() step 1 : com objects init read requests
+  KNX_PROFILE_TASK_RX,              // KnxDevice::task() step 2 : RX task and received telegrams processing
+  KNX_PROFILE_TASK_TX_ACTION,       // KnxDevice::task() step 3 : TX action processing
+  KNX_PROFILE_TASK_TX,              // KnxDevice::task() step 4 : TX task
+  KNX_PROFILE_RX_EOP,               // TPUART RX task, telegram completed (EOP detected)
+  KNX_PROFILE_RX_BYTES,             // TPUART RX task, received bytes parsing (only when bytes are available)
+  KNX_PROFILE_TX_TASK,              // TPUART TX task
+  KNX_PROFILE_BUSCOUPLER_EVENTS,    // bus coupler events dispatch (KnxDevice::GetTpUartEvents())
+  KNX_PROFILE_KNX_EVENTS,           // user knxEvents() callback
+  KNX_PROFILE_STAGES_NB
+};
+
+// Histogram buckets : bucket 0 counts the 0 tick durations, bucket n those in [2^(n-1), 2^n) ticks,
+// the last bucket the longer ones (from 2^22 ticks, i.e. 17ms at 240MHz)
+#define KNX_PROFILE_BUCKETS_NB 24
+
+// knxEvents() duration above which the watchdog flags the handler
+// The TPUART shall get the ACK service of a telegram addressed to the device within 1,7ms, the RX task is
+// called every 400us : a handler running more than 1,3ms delays the ACK beyond the deadline
+#ifndef KNX_PROFILE_WATCHDOG_MICROS
+#define KNX_PROFILE_WATCHDOG_MICROS 1300
+#endif
+
+typedef struct {
+  unsigned long callsNb;
+  unsigned long totalTicks;
+  unsigned long maxTicks;
+  unsigned long buckets[KNX_PROFILE_BUCKETS_NB];
+} type_profile_stats;
+
+// Watchdog callback : index of the com object notified, duration of the handler in usec
+typedef void (*type_ProfileWatchdogFctPtr)(byte objectIndex, unsigned long durationMicros);
+
+
+class KnxProfiler {
+    type_profile_stats _stats[KNX_PROFILE_STAGES_NB];
+    unsigned long _watchdogLimitTicks;
+    unsigned long _watchdogAlertsNb;
+    unsigned long _watchdogWorstTicks;
+    byte _watchdogWorstObject;
+    type_ProfileWatchdogFctPtr _watchdogFctPtr;
+
+  public:
+    KnxProfiler();
+
+    // Count a stage duration
+    void Record(e_KnxProfileStage stage, unsigned long ticks);
+
+    // Count a knxEvents() duration and check it against the watchdog limit
+    void RecordKnxEvent(byte objectIndex, unsigned long ticks);
+
+    // Clear the stages stats and the watchdog alerts
+    void Clear(void);
+
+    // Duration (in ticks) below which "percentile" % of the stage durations are, 0 when the stage was not called
+    // NB : the upper limit of the bucket holding the percentile is returned, i.e. a value up to twice the real one
+    unsigned long GetPercentile(e_KnxProfileStage stage, byte percentile) const;
+
+  // INLINED functions (see definitions later in this file)
+    const type_profile_stats& GetStats(e_KnxProfileStage stage) const;
+
+    // Tick time source and conversion
+    static unsigned long Ticks(void);
+    static unsigned long TicksToMicros(unsigned long ticks);
+    static unsigned long MicrosToTicks(unsigned long micros);
+
+    // Watchdog settings and results
+    void SetWatchdogLimit(unsigned long limitMicros);
+    void SetWatchdogCallback(type_ProfileWatchdogFctPtr fctPtr);
+    unsigned long GetWatchdogAlertsNb(void) const;
+    unsigned long GetWatchdogWorstMicros(void) const;
+    byte GetWatchdogWorstObject(void) const; // 255 when no alert
+};
+
+
+#if defined(KNX_PROFILING)
+// Unique profiler instance, fed by the profiling macros
+extern KnxProfiler KnxProf;
+
+#define KNX_PROFILE_BEGIN(startTicks)          unsigned long startTicks = KnxProfiler::Ticks()
+#define KNX_PROFILE_END(stage, startTicks)     KnxProf.Record(stage, KnxProfiler::Ticks() - (startTicks))
+#define KNX_PROFILE_EVENT_END(index, startTicks) KnxProf.RecordKnxEvent(index, KnxProfiler::Ticks() - (startTicks))
+#else
+#define KNX_PROFILE_BEGIN(startTicks)
+#define KNX_PROFILE_END(stage, startTicks)
+#define KNX_PROFILE_EVENT_END(index, startTicks)
+#endif
+
+
+// --------------- Definition of the INLINED functions -----------------
+inline const type_profile_stats& KnxProfiler::GetStats(e_KnxProfileStage stage) const { return _stats[stage]; }
+
+#if defined(ESP32)
+inline unsigned long KnxProfiler::Ticks(void) { return ESP.getCycleCount(); }
+
+inline unsigned long KnxProfiler::TicksToMicros(unsigned long ticks) { return ticks / getCpuFrequencyMhz(); }
+
+inline unsigned long KnxProfiler::MicrosToTicks(unsigned long micros) { return micros * getCpuFrequencyMhz(); }
+#else
+inline unsigned long KnxProfiler::Ticks(void) { return KnxMicros(); }
+
+inline unsigned long KnxProfiler::TicksToMicros(unsigned long ticks) { return ticks; }
+
+inline unsigned long KnxProfiler::MicrosToTicks(unsigned long micros) { return micros; }
+#endif
+
+inline void KnxProfiler::SetWatchdogLimit(unsigned long limitMicros) { _watchdogLimitTicks = MicrosToTicks(limitMicros); }
+
+inline void KnxProfiler::SetWatchdogCallback(type_ProfileWatchdogFctPtr fctPtr) { _watchdogFctPtr = fctPtr; }
+
+inline unsigned long KnxProfiler::GetWatchdogAlertsNb(void) const { return _watchdogAlertsNb; }
+
+inline unsigned long KnxProfiler::GetWatchdogWorstMicros(void) const { return TicksToMicros(_watchdogWorstTicks); }
+
+inline byte KnxProfiler::GetWatchdogWorstObject(void) const { return _watchdogWorstObject; }
+
+#endif // KNXPROFILER_H
+
+// EOF
@@ -0,0 +1,70 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxSeqLock.h
+// Author : Franck Marini
+// Description : Sequence lock letting another thread read a consistent copy of data updated by a single writer
+//               (e.g. the RX task) without ever blocking the writer.
+//               The writer makes the sequence odd while it updates the data, a reader copies the data and
+//               copies it again if the sequence was odd or has changed meanwhile.
+//               Usage :
+//                 writer : lock.WriteBegin(); ...update... lock.WriteEnd();
+//                 reader : do { seq = lock.ReadBegin(); ...copy... } while (lock.ReadRetry(seq));
+// Module dependencies : none
+
+#ifndef KNXSEQLOCK_H
+#define KNXSEQLOCK_H
+
+#include "Arduino.h"
+
+class KnxSeqLock {
+    word _sequence; // odd while the data is being updated
+
+  public:
+    KnxSeqLock() : _sequence(0) {}
+
+  // INLINED functions (see definitions later in this file)
+    void WriteBegin(void);
+    void WriteEnd(void);
+    word ReadBegin(void) const;
+    boolean ReadRetry(word sequence) const;
+};
+
+
+// --------------- Definition of the INLINED functions -----------------
+inline void KnxSeqLock::WriteBegin(void)
+{
+  __atomic_store_n(&_sequence, (word)(_sequence + 1), __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+inline void KnxSeqLock::WriteEnd(void) { __atomic_store_n(&_sequence, (word)(_sequence + 1), __ATOMIC_RELEASE); }
+
+inline word KnxSeqLock::ReadBegin(void) const { return __atomic_load_n(&_sequence, __ATOMIC_ACQUIRE); }
+
+inline boolean KnxSeqLock::ReadRetry(word sequence) const
+{
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  return (sequence & 1) || (sequence != __atomic_load_n(&_sequence, __ATOMIC_RELAXED));
+}
+
+#endif // KNXSEQLOCK_H
+
+// EOF
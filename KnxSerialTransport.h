@@ -0,0 +1,143 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxSerialTransport.h
+// Author : Franck Marini
+// Description : Byte stream transport used by KnxTpUart to communicate with the TPUART.
+//               The Arduino implementation (KnxArduinoSerialTransport) runs over a HardwareSerial port,
+//               see KnxPosixSerialTransport for the Linux implementation.
+// Module dependencies : HardwareSerial
+
+#ifndef KNXSERIALTRANSPORT_H
+#define KNXSERIALTRANSPORT_H
+
+#include "Arduino.h"
+#include "HardwareSerial.h"
+#if defined(ESP32)
+#include "esp_task_wdt.h"
+#endif
+
+// Values returned by the transport member functions :
+#define KNX_SERIAL_TRANSPORT_OK      0
+#define KNX_SERIAL_TRANSPORT_ERROR 255
+
+// ESP32 : default UART pins connected to the TPUART
+#define KNX_SERIAL_TRANSPORT_ESP32_RX_PIN 14
+#define KNX_SERIAL_TRANSPORT_ESP32_TX_PIN 13
+
+
+class KnxSerialTransport {
+  public:
+    virtual ~KnxSerialTransport() {}
+
+    // Open the link with the TPUART frame format (19200 baud by default, 8 bits, parity even, 1 stop bit)
+    // return KNX_SERIAL_TRANSPORT_ERROR in case of failure, else KNX_SERIAL_TRANSPORT_OK
+    virtual byte Begin(void) = 0;
+
+    // Close the link
+    virtual void End(void) = 0;
+
+    // Nb of received bytes available for reading
+    virtual int Available(void) = 0;
+
+    // Read one byte, return -1 if no byte is available
+    virtual int Read(void) = 0;
+
+    // Read up to "length" bytes without blocking, return the nb of bytes read
+    virtual word ReadBytes(byte buffer[], word length) = 0;
+
+    // Write bytes, return the nb of bytes written
+    virtual word Write(byte data) = 0;
+    virtual word Write(const byte buffer[], word length) = 0;
+
+    // Nb of bytes that can be written without blocking
+    virtual int AvailableForWrite(void) = 0;
+
+    // Wait up to "timeoutMicros" for received bytes
+    // return true when bytes are available for reading
+    // NB : the transports without wake-up support return immediately
+    virtual boolean WaitForData(unsigned long timeoutMicros) { return (Available() > 0); }
+
+    // Called while waiting for the TPUART answer (e.g. to feed a watchdog)
+    virtual void Yield(void) {}
+};
+
+
+// Transport over an Arduino HardwareSerial port
+// The baud rate is 19200 by default (TPUART), other serial couplers (e.g. cEMI over FT1.2) may use higher rates
+class KnxArduinoSerialTransport : public KnxSerialTransport {
+    HardwareSerial& _serial;
+    const unsigned long _baudRate;
+#if defined(ESP32)
+    const int8_t _rxPin, _txPin;
+#endif
+
+  public:
+#if defined(ESP32)
+    KnxArduinoSerialTransport(HardwareSerial& serial, int8_t rxPin = KNX_SERIAL_TRANSPORT_ESP32_RX_PIN,
+                              int8_t txPin = KNX_SERIAL_TRANSPORT_ESP32_TX_PIN, unsigned long baudRate = 19200)
+    : _serial(serial), _baudRate(baudRate), _rxPin(rxPin), _txPin(txPin) {}
+#else
+    KnxArduinoSerialTransport(HardwareSerial& serial, unsigned long baudRate = 19200)
+    : _serial(serial), _baudRate(baudRate) {}
+#endif
+
+  // INLINED functions (see definitions later in this file)
+    byte Begin(void);
+    void End(void);
+    int Available(void);
+    int Read(void);
+    word ReadBytes(byte buffer[], word length);
+    word Write(byte data);
+    word Write(const byte buffer[], word length);
+    int AvailableForWrite(void);
+    void Yield(void);
+};
+
+
+// --------------- Definition of the INLINED functions -----------------
+#if defined(ESP32)
+inline byte KnxArduinoSerialTransport::Begin(void)
+{ _serial.begin(_baudRate, SERIAL_8E1, _rxPin, _txPin, false); return KNX_SERIAL_TRANSPORT_OK; }
+#else
+inline byte KnxArduinoSerialTransport::Begin(void)
+{ _serial.begin(_baudRate, SERIAL_8E1); return KNX_SERIAL_TRANSPORT_OK; }
+#endif
+
+inline void KnxArduinoSerialTransport::End(void) { _serial.end(); }
+
+inline int KnxArduinoSerialTransport::Available(void) { return _serial.available(); }
+
+inline int KnxArduinoSerialTransport::Read(void) { return _serial.read(); }
+
+inline word KnxArduinoSerialTransport::ReadBytes(byte buffer[], word length) { return _serial.readBytes(buffer, length); }
+
+inline word KnxArduinoSerialTransport::Write(byte data) { return _serial.write(data); }
+
+inline word KnxArduinoSerialTransport::Write(const byte buffer[], word length) { return _serial.write(buffer, length); }
+
+inline int KnxArduinoSerialTransport::AvailableForWrite(void) { return _serial.availableForWrite(); }
+
+#if defined(ESP32)
+inline void KnxArduinoSerialTransport::Yield(void) { esp_task_wdt_reset(); }
+#else
+inline void KnxArduinoSerialTransport::Yield(void) {}
+#endif
+
+#endif // KNXSERIALTRANSPORT_H
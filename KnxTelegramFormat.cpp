@@ -0,0 +1,285 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxTelegramFormat.cpp
+// Author : Franck Marini
+// Description : Allocation free formatting of the telegrams, as a text line or as a JSON object
+// Module dependencies : KnxTelegram, KnxDPT, KnxDPTCodec
+
+#include "KnxTelegramFormat.h"
+
+#define DPT_IDS_NB (sizeof(KnxDPTIdToFormat))
+
+// Output buffer being written
+typedef struct {
+  char *text;
+  word size;
+  word length;
+  boolean overflow;
+} type_format_output;
+
+static const char hexDigits[] = "0123456789ABCDEF";
+
+
+static void PutChar(type_format_output& out, char c)
+{
+  if (out.length + 1 < out.size) out.text[out.length++] = c;
+  else out.overflow = true;
+}
+
+
+static void PutText(type_format_output& out, const char *str)
+{
+  while (*str) PutChar(out, *str++);
+}
+
+
+static void PutUnsigned(type_format_output& out, unsigned long value)
+{
+  char digits[10];
+  byte nb = 0;
+
+  do { digits[nb++] = '0' + (value % 10); value /= 10; } while (value);
+  while (nb) PutChar(out, digits[--nb]);
+}
+
+
+static void PutSigned(type_format_output& out, long value)
+{
+  if (value < 0) { PutChar(out, '-'); PutUnsigned(out, 0UL - (unsigned long)value); }
+  else PutUnsigned(out, value);
+}
+
+
+static void PutHexByte(type_format_output& out, byte value)
+{
+  PutChar(out, hexDigits[value >> 4]);
+  PutChar(out, hexDigits[value & 0x0F]);
+}
+
+
+// Write a value with 2 decimals (no printf float support on AVR targets)
+// The large values are written in the scientific notation (e.g. 1.50e12)
+static void PutFloat(type_format_output& out, float value, boolean json)
+{
+  unsigned long valuex100;
+  char exponent = 0;
+
+  if (value != value) { PutText(out, json ? "null" : "nan"); return; }
+  if (value < 0) { PutChar(out, '-'); value = -value; }
+  if (value > 3.5e38) { PutText(out, json ? "null" : "inf"); return; }
+  if (value >= 21474836.0)
+    while (value >= 10) { value /= 10; exponent++; }
+  valuex100 = (unsigned long)(value * 100 + 0.5);
+  if (exponent && (valuex100 >= 1000)) { valuex100 /= 10; exponent++; } // 9.995 rounded to 10.00
+  PutUnsigned(out, valuex100 / 100);
+  PutChar(out, '.');
+  PutChar(out, '0' + (valuex100 / 10) % 10);
+  PutChar(out, '0' + valuex100 % 10);
+  if (exponent) { PutChar(out, 'e'); PutUnsigned(out, exponent); }
+}
+
+
+static void PutPhysicalAddress(type_format_output& out, word addr)
+{
+  PutUnsigned(out, addr >> 12); PutChar(out, '.');
+  PutUnsigned(out, (addr >> 8) & 0x0F); PutChar(out, '.');
+  PutUnsigned(out, addr & 0xFF);
+}
+
+
+static void PutGroupAddress(type_format_output& out, word addr)
+{
+  PutUnsigned(out, addr >> 11); PutChar(out, '/');
+  PutUnsigned(out, (addr >> 8) & 0x07); PutChar(out, '/');
+  PutUnsigned(out, addr & 0xFF);
+}
+
+
+static void PutTargetAddress(type_format_output& out, const KnxTelegram& telegram)
+{
+  if (telegram.IsMulticast()) PutGroupAddress(out, telegram.GetTargetAddress());
+  else PutPhysicalAddress(out, telegram.GetTargetAddress());
+}
+
+
+static void PutPayload(type_format_output& out, const KnxTelegram& telegram)
+{
+  byte payload[KNX_TELEGRAM_PAYLOAD_MAX_SIZE - 1];
+  byte length = telegram.GetPayloadLength();
+
+  PutHexByte(out, telegram.GetFirstPayloadByte());
+  if (length < 2) return;
+  telegram.GetLongPayload(payload, length - 1);
+  for (byte i = 0; i < length - 1; i++) PutHexByte(out, payload[i]);
+}
+
+
+static boolean IsCharacterFormat(byte dptFormat)
+{
+  return (dptFormat == KNX_DPT_FORMAT_A8) || (dptFormat == KNX_DPT_FORMAT_A112) || (dptFormat == KNX_DPT_FORMAT_AN)
+         || (dptFormat == KNX_DPT_FORMAT_A8A8A8A8) || (dptFormat == KNX_DPT_FORMAT_A8A8);
+}
+
+
+// Write the value decoded as per the DPT, return false (nothing written) if the value cannot be decoded
+// (unknown DPT, no value in the telegram, or payload length not matching the DPT one)
+static boolean PutValue(type_format_output& out, const KnxTelegram& telegram, byte dptId, boolean json)
+{
+  byte dpt[KNX_TELEGRAM_PAYLOAD_MAX_SIZE - 1];
+  long fields[KNX_DPT_FIELDS_MAX_NB];
+  float floatFields[KNX_DPT_FIELDS_MAX_NB];
+  byte dptFormat, length, fieldsNb, fieldType;
+  boolean floatDecoded = false;
+
+  if ((dptId >= DPT_IDS_NB) || ((telegram.GetCommand() != KNX_COMMAND_VALUE_WRITE)
+                                && (telegram.GetCommand() != KNX_COMMAND_VALUE_RESPONSE))) return false;
+  dptFormat = pgm_read_byte(&KnxDPTIdToFormat[dptId]);
+  length = KnxDptLength(dptFormat);
+  if (!length) return false;
+  // the formats shorter than 8 bits are carried by the 1st payload byte, the other ones follow it
+  if (pgm_read_byte(&KnxDPTFormatToLengthBit[dptFormat]) <= 6)
+  {
+    if (telegram.GetPayloadLength() != 1) return false;
+    dpt[0] = telegram.GetFirstPayloadByte();
+  }
+  else
+  {
+    if (telegram.GetPayloadLength() != length + 1) return false;
+    telegram.GetLongPayload(dpt, length);
+  }
+
+  if (IsCharacterFormat(dptFormat))
+  {
+    PutChar(out, '"');
+    for (byte i = 0; (i < length) && dpt[i]; i++)
+    {
+      if ((dpt[i] < 0x20) || (dpt[i] > 0x7E)) PutChar(out, '.'); // not printable
+      else
+      {
+        if (json && ((dpt[i] == '"') || (dpt[i] == '\\'))) PutChar(out, '\\');
+        PutChar(out, dpt[i]);
+      }
+    }
+    PutChar(out, '"');
+    return true;
+  }
+
+  KnxDptDecode(dpt, dptFormat, fields);
+  fieldsNb = KnxDptFieldsNb(dptFormat);
+  if (fieldsNb > 1) PutChar(out, '[');
+  for (byte i = 0; i < fieldsNb; i++)
+  {
+    if (i) PutChar(out, ',');
+    fieldType = KnxDptFieldType(dptFormat, i);
+    if ((fieldType == KNX_DPT_FIELD_F16) || (fieldType == KNX_DPT_FIELD_F32))
+    {
+      if (!floatDecoded) { KnxDptDecode(dpt, dptFormat, floatFields); floatDecoded = true; }
+      PutFloat(out, floatFields[i], json);
+    }
+    else if (fieldType == KNX_DPT_FIELD_V) PutSigned(out, fields[i]);
+    else PutUnsigned(out, (unsigned long)fields[i]);
+  }
+  if (fieldsNb > 1) PutChar(out, ']');
+  return true;
+}
+
+
+static word Terminate(type_format_output& out)
+{
+  if (!out.size) return 0;
+  if (out.overflow) out.length = 0;
+  out.text[out.length] = 0;
+  return out.length;
+}
+
+
+word KnxFormatTelegramText(const KnxTelegram& telegram, byte dptId, char text[], word size)
+{
+  type_format_output out = { text, size, 0, false };
+  word length;
+  boolean overflow;
+
+  PutPhysicalAddress(out, telegram.GetSourceAddress());
+  PutText(out, " > ");
+  PutTargetAddress(out, telegram);
+  switch (telegram.GetCommand())
+  {
+    case KNX_COMMAND_VALUE_READ : PutText(out, " VAL_READ "); break;
+    case KNX_COMMAND_VALUE_RESPONSE : PutText(out, " VAL_RESP "); break;
+    case KNX_COMMAND_VALUE_WRITE : PutText(out, " VAL_WRITE "); break;
+    case KNX_COMMAND_MEMORY_WRITE : PutText(out, " MEM_WRITE "); break;
+    default : PutText(out, " ERR_VAL! "); break;
+  }
+  PutPayload(out, telegram);
+  length = out.length;
+  overflow = out.overflow;
+  PutChar(out, ' ');
+  if (!PutValue(out, telegram, dptId, false)) { out.length = length; out.overflow = overflow; } // no trailing space
+  return Terminate(out);
+}
+
+
+word KnxFormatTelegramJson(const KnxTelegram& telegram, byte dptId, char text[], word size)
+{
+  type_format_output out = { text, size, 0, false };
+  word length;
+  boolean overflow;
+
+  PutText(out, "{\"src\":\"");
+  PutPhysicalAddress(out, telegram.GetSourceAddress());
+  PutText(out, "\",\"dst\":\"");
+  PutTargetAddress(out, telegram);
+  PutText(out, "\",\"cmd\":\"");
+  switch (telegram.GetCommand())
+  {
+    case KNX_COMMAND_VALUE_READ : PutText(out, "read"); break;
+    case KNX_COMMAND_VALUE_RESPONSE : PutText(out, "response"); break;
+    case KNX_COMMAND_VALUE_WRITE : PutText(out, "write"); break;
+    case KNX_COMMAND_MEMORY_WRITE : PutText(out, "memory_write"); break;
+    default : PutText(out, "unknown"); break;
+  }
+  PutText(out, "\",\"data\":\"");
+  PutPayload(out, telegram);
+  PutChar(out, '"');
+  length = out.length;
+  overflow = out.overflow;
+  PutText(out, ",\"value\":");
+  if (!PutValue(out, telegram, dptId, true)) { out.length = length; out.overflow = overflow; } // no value field
+  PutChar(out, '}');
+  return Terminate(out);
+}
+
+
+byte KnxFormatPhysicalAddress(word addr, char text[], byte size)
+{
+  type_format_output out = { text, size, 0, false };
+  PutPhysicalAddress(out, addr);
+  return Terminate(out);
+}
+
+
+byte KnxFormatGroupAddress(word addr, char text[], byte size)
+{
+  type_format_output out = { text, size, 0, false };
+  PutGroupAddress(out, addr);
+  return Terminate(out);
+}
+
+// EOF
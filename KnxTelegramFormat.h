@@ -0,0 +1,60 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxTelegramFormat.h
+// Author : Franck Marini
+// Description : Allocation free formatting of the telegrams, as a text line or as a JSON object
+//               The output is written into a caller buffer (no String, no heap, no printf), so that a gateway can
+//               log every telegram : source address (a.b.c), target address (group a/b/c or physical a.b.c),
+//               command, raw payload and value decoded as per the DPT (when known by the caller).
+//               Text  : "1.1.2 > 1/0/1 VAL_WRITE 0C1A 21.50"
+//               JSON  : {"src":"1.1.2","dst":"1/0/1","cmd":"write","data":"0C1A","value":21.50}
+//               The decoded value is a number, a string (character formats) or a list of numbers (multi fields
+//               formats, in the KnxDptDecode() fields order). F16 and F32 values are written with 2 decimals.
+// Module dependencies : KnxTelegram, KnxDPT, KnxDPTCodec
+
+#ifndef KNXTELEGRAMFORMAT_H
+#define KNXTELEGRAMFORMAT_H
+
+#include "Arduino.h"
+#include "KnxTelegram.h"
+#include "KnxDPT.h"
+#include "KnxDPTCodec.h"
+
+// DPT id to use when the DPT of the target is not known (no value decoding)
+#define KNX_FORMAT_NO_DPT            0xFF
+
+// Buffer size large enough for any telegram, in text and JSON (including the terminating null char)
+#define KNX_FORMAT_TELEGRAM_MAX_SIZE 256
+
+// Format a telegram into the "text" buffer of "size" bytes (null terminated)
+// "dptId" is the DPT of the target (e.g. the com object one), or KNX_FORMAT_NO_DPT
+// The value is not decoded when the payload length does not match the DPT one
+// return the text length, 0 if the buffer is too small (the text is then empty)
+word KnxFormatTelegramText(const KnxTelegram& telegram, byte dptId, char text[], word size);
+word KnxFormatTelegramJson(const KnxTelegram& telegram, byte dptId, char text[], word size);
+
+// Format an individual address (a.b.c) or a group address (a/b/c, 3 levels)
+// return the text length, 0 if the buffer is too small
+byte KnxFormatPhysicalAddress(word addr, char text[], byte size);
+byte KnxFormatGroupAddress(word addr, char text[], byte size);
+
+#endif // KNXTELEGRAMFORMAT_H
+
+// EOF
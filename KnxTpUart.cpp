@@ -20,45 +20,64 @@
 // File : KnxTpUart.cpp
 // Author : Franck Marini
 // Description : Communication with TPUART
-// Module dependencies : HardwareSerial, KnxTelegram, KnxComObject
+// Module dependencies : KnxSerialTransport, KnxTelegram, KnxComObject, KnxComObjectTable, KnxProfiler, KnxProbes
 
 #include "KnxTpUart.h"
-#include "esp_task_wdt.h"
+#include "KnxProfiler.h"
+#include "KnxProbes.h"
 #define TAG __FILE__
 
 static inline word TimeDeltaWord(word now, word before) { return (word)(now - before); }
 
-#ifdef KNXTPUART_DEBUG_INFO
-const char KnxTpUart::_debugInfoText[] = "KNXTPUART INFO: ";
-#endif
+// Constructor with an Arduino serial port, the transport over the serial port is created and owned by the TPUART object
+KnxTpUart::KnxTpUart(HardwareSerial &serial, word physicalAddr,
+    type_KnxBusCouplerMode mode) :
+  KnxTpUart(*new KnxArduinoSerialTransport(serial), physicalAddr, mode)
+{
+  _ownedTransport = &_transport;
+}
 
-#ifdef KNXTPUART_DEBUG_ERROR
-const char KnxTpUart::_debugErrorText[] = "KNXTPUART ERROR: ";
-#endif
 
-KnxTpUart::KnxTpUart(HardwareSerial &serial, word physicalAddr,
+KnxTpUart::KnxTpUart(KnxSerialTransport &transport, word physicalAddr,
     type_KnxBusCouplerMode mode) :
-  _serial(serial),
+  _ownedTransport(NULL),
+  _transport(transport),
   _physicalAddr(physicalAddr),
   _mode(mode)
 {
   _rx.state = RX_RESET;
   _rx.addressedComObjectIndex = 0;
+  _rx.overflowsNb = 0;
   _tx.state = TX_RESET;
   _tx.sentTelegram = NULL;
   _tx.ackFctPtr = NULL;
   _tx.nbRemainingBytes = 0;
   _tx.txByteIndex = 0;
+  _tx.endMicros = 0;
+#if defined(KNXTPUART_TX_BURST)
+  _txBurstEndMicros = 0;
+#endif
   _stateIndication = 0;
   _resetRespTimeout = 0;
   _resetAttempts = KNX_RESET_ATTEMPTS;
   _evtCallbackFct = NULL;
-  _comObjectsList = NULL;
-  _assignedComObjectsNb = 0;
-  _orderedIndexTable = NULL;
   _stateIndication = 0;
+  _monitor = NULL;
+  _groupStats = NULL;
+  _busHealth = NULL;
+  _frameCallbackFct = NULL;
+  if (_mode == BUS_MONITOR)
+  {
+    _monitor = new type_tpuart_monitor;
+    _monitor->started = false;
+    _monitor->frame.length = 0;
+    _monitor->lastByteRxMicros = 0;
+    _monitor->overflowsNb = 0;
+    _monitor->currentData.isEOP = true;
+    _monitor->currentData.dataByte = 0;
+  }
 #if defined(KNXTPUART_DEBUG_INFO) || defined(KNXTPUART_DEBUG_ERROR)
-  _debugStrPtr = NULL;
+  _traceRing = NULL;
 #endif
 }
 
@@ -66,18 +85,19 @@ KnxTpUart::KnxTpUart(HardwareSerial &serial, word physicalAddr,
 // Destructor
 KnxTpUart::~KnxTpUart()
 {
-  if (_orderedIndexTable) free(_orderedIndexTable);
+  if (_monitor) delete _monitor;
   // close the serial communication if opened
   if ( (_rx.state > RX_RESET) || (_tx.state > TX_RESET) )
   {
-    _serial.end();
+    _transport.End();
 #if defined(KNXTPUART_DEBUG_INFO)
-    DebugInfo("Destructor: connection closed, byebye\n");
+    DebugInfo(KNX_TRACE_COUPLER_CLOSED);
 #endif
   }
 #if defined(KNXTPUART_DEBUG_INFO)
-  else DebugInfo("Desctructor: byebye\n");
+  else DebugInfo(KNX_TRACE_COUPLER_DESTROYED);
 #endif
+  if (_ownedTransport) delete _ownedTransport;
 }
 
 
@@ -88,20 +108,25 @@ byte KnxTpUart::Reset(void)
   /*word startTime, nowTime;
   byte attempts = 10;*/
 
+  if (_monitor) _monitor->started = false; // the frames assembly restarts at Init()
+
   // CONFIGURATION OF THE ARDUINO USART WITH CORRECT FRAME FORMAT (19200, 8 bits, parity even, 1 stop bit)
-  if (!_resetRespTimeout || _resetRespTimeout < millis()) {
+  if (!_resetRespTimeout || _resetRespTimeout < KnxMillis()) {
 	if (_resetRespTimeout) {
 		if ( (_rx.state > RX_RESET) || (_tx.state > TX_RESET) )
 		{	// HOT RESET case
 			_rx.state = RX_RESET; _tx.state = TX_RESET;
 		}
 		// stop the serial communication before restarting it
-  		_serial.end();
+  		_transport.End();
 	}
 
-	_serial.begin(19200, SERIAL_8E1, 14, 13, false);
-	_serial.write(TPUART_RESET_REQ); // send RESET REQUEST
-	_resetRespTimeout = millis() + KNX_RESETRESP_TIMEOUT;
+	if (_transport.Begin() == KNX_SERIAL_TRANSPORT_OK)
+		_transport.Write(TPUART_RESET_REQ); // send RESET REQUEST
+#if defined(KNXTPUART_DEBUG_ERROR)
+	else DebugError(KNX_TRACE_COUPLER_TRANSPORT_ERROR);
+#endif
+	_resetRespTimeout = KnxMillis() + KNX_RESETRESP_TIMEOUT;
 
 	if (!_resetAttempts) {
 		_resetAttempts = KNX_RESET_ATTEMPTS;
@@ -110,36 +135,33 @@ byte KnxTpUart::Reset(void)
 	--_resetAttempts;
   }
 
-  //_serial.begin(19200);
-  //UCSR1C = UCSR1C | B00100000; // Even Parity
-
   /*while(attempts--)*/
   { // we send a RESET REQUEST and wait for the reset indication answer
     // the sequence is repeated every sec as long as we do not get the reset indication
 
-    /*_serial.write(TPUART_RESET_REQ); // send RESET REQUEST*/
+    /*_transport.Write(TPUART_RESET_REQ); // send RESET REQUEST*/
 
     /*for (nowTime = startTime = (word) millis() ; TimeDeltaWord(nowTime,startTime) < 1000 ; nowTime = (word)millis())*/
     {
-      if (_serial.available() > 0)
+      if (_transport.Available() > 0)
       {
-        if (_serial.read() == TPUART_RESET_INDICATION)
+        if (_transport.Read() == TPUART_RESET_INDICATION)
         {
           _rx.state = RX_INIT; _tx.state = TX_INIT;
 #if defined(KNXTPUART_DEBUG_INFO)
-          DebugInfo("Reset successful\n");
+          DebugInfo(KNX_TRACE_COUPLER_RESET_OK);
 #endif
           _resetAttempts = KNX_RESET_ATTEMPTS;
           return KNX_BUSCOUPLER_OK;
         }
       }
-      esp_task_wdt_reset();
+      _transport.Yield();
     } // 1 sec ellapsed
-	/*_serial.end();*/
+	/*_transport.End();*/
   } // while(attempts--)
 
 #if defined(KNXTPUART_DEBUG_ERROR)
-  DebugError("Reset failed, no answer from TPUART device\n");
+  DebugError(KNX_TRACE_COUPLER_RESET_FAILED);
 #endif
   return KNX_BUSCOUPLER_ERROR;
 }
@@ -152,7 +174,12 @@ byte KnxTpUart::Reset(void)
 
 byte KnxTpUart::AttachComObjectsList(KnxComObject comObjectsList[], byte listSize)
 {
-  return AttachComObjectsList(&comObjectsList, listSize);
+#if defined(KNXTPUART_DEBUG_INFO)
+  _comObjects.Attach(comObjectsList, listSize, _traceRing);
+#else
+  _comObjects.Attach(comObjectsList, listSize);
+#endif
+  return KNX_BUSCOUPLER_OK;
 }
 
 // Attach a list of com objects
@@ -162,74 +189,11 @@ byte KnxTpUart::AttachComObjectsList(KnxComObject comObjectsList[], byte listSiz
 // The function must be called prior to Init() execution
 byte KnxTpUart::AttachComObjectsList(KnxComObject** comObjectsList, byte listSize)
 {
-#define IS_COM(index) (comObjectsList[index]->GetIndicator() & KNX_COM_OBJ_C_INDICATOR)
-#define ADDR(index) (comObjectsList[index]->GetAddr())
-
   /*if ((_rx.state!=RX_INIT) || (_tx.state!=TX_INIT)) return KNX_BUSCOUPLER_ERROR_NOT_INIT_STATE;*/
-
-  if (_orderedIndexTable)
-  {  // a list is already attached, we detach it
-    free(_orderedIndexTable);
-    _orderedIndexTable = NULL;
-    _comObjectsList = NULL;
-    _assignedComObjectsNb = 0;
-  }
-  if ((!comObjectsList) || (!listSize))
-  {
 #if defined(KNXTPUART_DEBUG_INFO)
-    DebugInfo("AttachComObjectsList : warning : empty object list!\n");
-#endif
-    return  KNX_BUSCOUPLER_OK;
-  }
-  // Count all the com objects with communication indicator
-  for (byte i=0; i < listSize ; i++) if (IS_COM(i)) _assignedComObjectsNb++;
-  if (!_assignedComObjectsNb)
-  {
-#if defined(KNXTPUART_DEBUG_INFO)
-    DebugInfo("AttachComObjectsList : warning : no object with com attribute in the list!\n");
-#endif
-    return  KNX_BUSCOUPLER_OK;
-  }
-  // Deduct the duplicate addresses
-  for (byte i=0; i < listSize ; i++)
-  {
-    if (!IS_COM(i)) continue;
-    for (byte j=0; j < listSize ; j++)
-    {
-      if ( (i!=j) && (ADDR(j) == ADDR(i)) && (IS_COM(j)) )
-      { // duplicate address found
-        if (j<i) break; // duplicate address already treated
-        else
-        {
-          _assignedComObjectsNb--;
-#if defined(KNXTPUART_DEBUG_INFO)
-          DebugInfo("AttachComObjectsList : warning : duplicate address found!\n");
-#endif
-        }
-      }
-    }
-  }
-  _comObjectsList = comObjectsList;
-  // Creation of the ordered index table
-  _orderedIndexTable = (byte*) malloc(_assignedComObjectsNb);
-  memset(_orderedIndexTable, 255, _assignedComObjectsNb);
-  word minMin = 0x0000;   // minimum min value searched
-  word foundMin = 0xFFFF; // min value found so far
-  for (byte i=0; i < _assignedComObjectsNb; i++)
-  {
-    for (byte j=0; j < listSize ; j++)
-    {
-      if ( (IS_COM(j)) && (ADDR(j)>=minMin) && (ADDR(j)<=foundMin) )
-      {
-        foundMin = ADDR(j);
-        _orderedIndexTable[i] = j;
-      }
-    }
-    minMin = foundMin + 1;
-    foundMin = 0xFFFF;
-  }
-#if defined(KNXTPUART_DEBUG_INFO)
-  DebugInfo("AttachComObjectsList successful\n");
+  _comObjects.Attach(comObjectsList, listSize, _traceRing);
+#else
+  _comObjects.Attach(comObjectsList, listSize);
 #endif
   return KNX_BUSCOUPLER_OK;
 }
@@ -247,15 +211,17 @@ byte KnxTpUart::Init(void)
   // BUS MONITORING MODE in case it is selected
   if (_mode == BUS_MONITOR)
   {
-    _serial.write(TPUART_ACTIVATEBUSMON_REQ); // Send bus monitoring activation request
+    _transport.Write(TPUART_ACTIVATEBUSMON_REQ); // Send bus monitoring activation request
+    _monitor->started = true;
+    _monitor->frame.length = 0;
 #if defined(KNXTPUART_DEBUG_INFO)
-    DebugInfo("Init : Monitoring mode started\n");
+    DebugInfo(KNX_TRACE_COUPLER_INIT_MONITORING);
 #endif
   }
   else // NORMAL mode by default
   {
 #if defined(KNXTPUART_DEBUG_INFO)
-    if (_comObjectsList == NULL)  DebugInfo("Init : warning : empty object list!\n");
+    if (!_comObjects.GetAssignedNb())  DebugInfo(KNX_TRACE_COUPLER_INIT_EMPTY_LIST);
 #endif
     if (_evtCallbackFct == NULL) return KNX_BUSCOUPLER_ERROR_NULL_EVT_CALLBACK_FCT;
     if (_tx.ackFctPtr == NULL) return KNX_BUSCOUPLER_ERROR_NULL_ACK_CALLBACK_FCT;
@@ -264,15 +230,15 @@ byte KnxTpUart::Init(void)
     tpuartCmd[0] = TPUART_SET_ADDR_REQ;
     tpuartCmd[1] = (byte)(_physicalAddr>>8);
     tpuartCmd[2] = (byte)_physicalAddr;
-    _serial.write(tpuartCmd,3);
+    _transport.Write(tpuartCmd,3);
 
     // Call U_State.request-Service in order to have the field _stateIndication up-to-date
-    _serial.write(TPUART_STATE_REQ);
+    _transport.Write(TPUART_STATE_REQ);
 
     _rx.state = RX_IDLE_WAITING_FOR_CTRL_FIELD;
     _tx.state = TX_IDLE;
 #if defined(KNXTPUART_DEBUG_INFO)
-    DebugInfo("Init : Normal mode started\n");
+    DebugInfo(KNX_TRACE_COUPLER_INIT_NORMAL);
 #endif
   }
   return KNX_BUSCOUPLER_OK;
@@ -296,6 +262,7 @@ byte KnxTpUart::SendTelegram(KnxTelegram& sentTelegram)
   _tx.nbRemainingBytes = sentTelegram.GetTelegramLength();
   _tx.txByteIndex = 0; // Set index to 0
   _tx.state = TX_TELEGRAM_SENDING_ONGOING;
+  if (_busHealth) _busHealth->RecordTxTelegram();
 
   return KNX_BUSCOUPLER_OK;
 }
@@ -303,6 +270,17 @@ byte KnxTpUart::SendTelegram(KnxTelegram& sentTelegram)
 
 void KnxTpUart::SetReceivedTelegram(KnxTelegram &rxTelegram) {}
 
+// Wait for data coming from the TPUART
+// With a transport supporting wake-up (e.g. Linux), the calling thread sleeps till data is received
+// instead of polling. While a reception or a transmission is ongoing, the timeout is reduced to the
+// RX task period so that the EOP detection and the TX task are not delayed.
+boolean KnxTpUart::WaitForRxData(unsigned long timeoutMicros)
+{
+  if (IsActive() && (timeoutMicros > KNXTPUART_ACTIVE_WAIT_MAX_MICROS)) timeoutMicros = KNXTPUART_ACTIVE_WAIT_MAX_MICROS;
+  return _transport.WaitForData(timeoutMicros);
+}
+
+
 // Reception task
 // This function shall be called periodically in order to allow a correct reception of the EIB bus data
 // Assuming the TPUART speed is configured to 19200 baud, a character (8 data + 1 start + 1 parity + 1 stop)
@@ -312,18 +290,34 @@ void KnxTpUart::SetReceivedTelegram(KnxTelegram &rxTelegram) {}
 void KnxTpUart::RXTask(void)
   {
   byte incomingByte;
+  byte rxChunk[KNXTPUART_RX_CHUNK_SIZE]; // bytes pulled from the serial in one bulk read
+  int rxBytesNb;
+  unsigned long chunkTimeMicrosec;
   word nowTime;
   static byte readBytesNb; // Nb of read bytes during an EIB telegram reception
   static KnxTelegram telegram; // telegram being received
   static byte addressedComObjectIndex; // index of the com object targeted by the received telegram
   static word lastByteRxTimeMicrosec;
+  static unsigned long telegramStartTimeMicros; // reception time of the telegram 1st byte
+
+  if (_monitor)
+  { // BUS MONITOR mode
+    if (_monitor->started) MonitoringTask();
+    return;
+  }
+  if (_busHealth) _busHealth->Update();
 
 // === STEP 1 : Check EOP in case a Telegram is being received ===
   if (_rx.state >= RX_EIB_TELEGRAM_RECEPTION_STARTED)
   { // a telegram reception is ongoing
-    nowTime = (word) micros(); // word cast because a 65ms looping counter is long enough
+    nowTime = (word) KnxMicros(); // word cast because a 65ms looping counter is long enough
     if(TimeDeltaWord(nowTime,lastByteRxTimeMicrosec) > 2000 /* 2 ms */ )
     { // EOP detected, the telegram reception is completed
+      KNX_PROFILE_BEGIN(eopStartTicks);
+      if (_busHealth) _busHealth->RecordFrame(readBytesNb, (readBytesNb >= 3) && (telegram.GetSourceAddress() == _physicalAddr),
+        (_rx.state == RX_EIB_TELEGRAM_RECEPTION_NOT_ADDRESSED)
+        || ((_rx.state == RX_EIB_TELEGRAM_RECEPTION_ADDRESSED) && telegram.IsChecksumCorrect()));
+      if (_frameCallbackFct) _frameCallbackFct(telegram, readBytesNb, telegramStartTimeMicros);
 
       switch (_rx.state)
       {
@@ -337,6 +331,8 @@ void KnxTpUart::RXTask(void)
           { // checksum correct, let's update the _rx struct with the received telegram and correct index
         	telegram.Copy(_rx.receivedTelegram);
             _rx.addressedComObjectIndex  = addressedComObjectIndex;
+            QueueReceivedTelegram(_rx, telegram, addressedComObjectIndex, telegramStartTimeMicros);
+            if (_groupStats) _groupStats->Record(telegram, telegramStartTimeMicros);
             _evtCallbackFct(BUSCOUPLER_EVENT_RECEIVED_EIB_TELEGRAM); // Notify the new received telegram
           }
           else
@@ -347,140 +343,174 @@ void KnxTpUart::RXTask(void)
           }
           break;
 
-        // case RX_EIB_TELEGRAM_RECEPTION_NOT_ADDRESSED : break; // nothing to do!
+        case RX_EIB_TELEGRAM_RECEPTION_NOT_ADDRESSED : // nothing to do, except the traffic statistics
+          if (_groupStats && (readBytesNb == telegram.GetTelegramLength()) && telegram.IsChecksumCorrect())
+            _groupStats->Record(telegram, telegramStartTimeMicros);
+          break;
 
         default : break;
       } // end of switch
 
       // we move state back to RX IDLE in any case
       _rx.state = RX_IDLE_WAITING_FOR_CTRL_FIELD;
+      KNX_PROFILE_END(KNX_PROFILE_RX_EOP, eopStartTicks);
     } // end EOP detected
   }
 
 // === STEP 2 : Get New RX Data ===
-  while (_serial.available() > 0)
+  // The available bytes are pulled in chunks with a single bulk read (instead of an available()/read() pair per byte)
+  // and they are all time stamped with the chunk reading time.
+  // NB : readBytes() does not block since we never ask for more than the available bytes
+  while ((rxBytesNb = _transport.Available()) > 0)
   {
-    incomingByte = (byte)(_serial.read());
-    lastByteRxTimeMicrosec = (word)micros();
+    KNX_PROFILE_BEGIN(chunkStartTicks);
+    if (rxBytesNb > KNXTPUART_RX_CHUNK_SIZE) rxBytesNb = KNXTPUART_RX_CHUNK_SIZE;
+    rxBytesNb = _transport.ReadBytes(rxChunk, rxBytesNb);
+    chunkTimeMicrosec = KnxMicros();
+    lastByteRxTimeMicrosec = (word)chunkTimeMicrosec;
 
-    switch (_rx.state)
+    for (byte i = 0; i < rxBytesNb; i++)
     {
-      case RX_IDLE_WAITING_FOR_CTRL_FIELD:
-          // CASE OF EIB MESSAGE
-          if ((incomingByte & EIB_CONTROL_FIELD_PATTERN_MASK) == EIB_CONTROL_FIELD_VALID_PATTERN)
-          {
-            _rx.state = RX_EIB_TELEGRAM_RECEPTION_STARTED;
-            readBytesNb = 1; telegram.WriteRawByte(incomingByte,0);
-          }
-          // CASE OF TPUART_DATA_CONFIRM_SUCCESS NOTIFICATION
-          else if (incomingByte == TPUART_DATA_CONFIRM_SUCCESS)
-          {
-            if (_tx.state == TX_WAITING_ACK)
+      incomingByte = rxChunk[i];
+
+      switch (_rx.state)
+      {
+        case RX_IDLE_WAITING_FOR_CTRL_FIELD:
+            // CASE OF EIB MESSAGE
+            if ((incomingByte & EIB_CONTROL_FIELD_PATTERN_MASK) == EIB_CONTROL_FIELD_VALID_PATTERN)
             {
-              _tx.ackFctPtr(ACK_RESPONSE);
-              _tx.state = TX_IDLE;
+              _rx.state = RX_EIB_TELEGRAM_RECEPTION_STARTED;
+              readBytesNb = 1; telegram.WriteRawByte(incomingByte,0);
+              telegramStartTimeMicros = chunkTimeMicrosec;
             }
+            // CASE OF TPUART_DATA_CONFIRM_SUCCESS NOTIFICATION
+            else if (incomingByte == TPUART_DATA_CONFIRM_SUCCESS)
+            {
+              if (_tx.state == TX_WAITING_ACK)
+              {
+                NotifyTxAck(ACK_RESPONSE);
+                _tx.state = TX_IDLE;
+              }
 #if defined(KNXTPUART_DEBUG_ERROR)
-            else {
-              DebugError("Rx: unexpected TPUART_DATA_CONFIRM_SUCCESS received!\n");
-              ESP_LOGE(TAG, "Rx: unexpected TPUART_DATA_CONFIRM_SUCCESS received");
-            }
+              else {
+                DebugError(KNX_TRACE_COUPLER_UNEXPECTED_CONFIRM, 1);
+                ESP_LOGE(TAG, "Rx: unexpected TPUART_DATA_CONFIRM_SUCCESS received");
+              }
 #endif
-          }
-          // CASE OF TPUART_RESET NOTIFICATION
-          else if (incomingByte == TPUART_RESET_INDICATION)
-          {
+            }
+            // CASE OF TPUART_RESET NOTIFICATION
+            else if (incomingByte == TPUART_RESET_INDICATION)
+            {
 
-            if ( (_tx.state == TX_TELEGRAM_SENDING_ONGOING ) || (_tx.state == TX_WAITING_ACK ) )
-            { // response to the TP UART transmission
-              _tx.ackFctPtr(BUSCOUPLER_RESET_RESPONSE);
+              if ( (_tx.state == TX_TELEGRAM_SENDING_ONGOING ) || (_tx.state == TX_WAITING_ACK ) )
+              { // response to the TP UART transmission
+                NotifyTxAck(BUSCOUPLER_RESET_RESPONSE);
+              }
+             _tx.state = TX_STOPPED;
+             _rx.state = RX_STOPPED;
+             if (_busHealth) _busHealth->RecordCouplerReset();
+             _evtCallbackFct(BUSCOUPLER_EVENT_RESET); // Notify RESET
+             // The parsing stops here on purpose : the bytes left in the chunk were sent by the TPUART before
+             // the driver is initialized again (RX_STOPPED), they are dropped as the not read ones would be
+             return;
             }
-           _tx.state = TX_STOPPED;
-           _rx.state = RX_STOPPED;
-           _evtCallbackFct(BUSCOUPLER_EVENT_RESET); // Notify RESET
-           return;
-          }
-          // CASE OF STATE_INDICATION RESPONSE
-          else if ((incomingByte & TPUART_STATE_INDICATION_MASK) == TPUART_STATE_INDICATION)
-          {
-            _evtCallbackFct(BUSCOUPLER_EVENT_STATE_INDICATION); // Notify STATE INDICATION
-            _stateIndication = incomingByte;
+            // CASE OF STATE_INDICATION RESPONSE
+            else if ((incomingByte & TPUART_STATE_INDICATION_MASK) == TPUART_STATE_INDICATION)
+            {
+              _stateIndication = incomingByte; // updated 1st so that GetStateIndication() is right in the callback
+              if (_busHealth) _busHealth->RecordStateErrors(
+                  ((incomingByte & TPUART_STATE_INDICATION_SLAVE_COLLISION_MASK) ? 1 << KNX_BUS_HEALTH_SLAVE_COLLISION : 0)
+                | ((incomingByte & TPUART_STATE_INDICATION_RECEIVE_ERROR_MASK) ? 1 << KNX_BUS_HEALTH_RECEIVE_ERROR : 0)
+                | ((incomingByte & TPUART_STATE_INDICATION_TRANSMIT_ERROR_MASK) ? 1 << KNX_BUS_HEALTH_TRANSMIT_ERROR : 0)
+                | ((incomingByte & TPUART_STATE_INDICATION_PROTOCOL_ERROR_MASK) ? 1 << KNX_BUS_HEALTH_PROTOCOL_ERROR : 0)
+                | ((incomingByte & TPUART_STATE_INDICATION_TEMP_WARNING_MASK) ? 1 << KNX_BUS_HEALTH_TEMPERATURE_WARNING : 0));
+              _evtCallbackFct(BUSCOUPLER_EVENT_STATE_INDICATION); // Notify STATE INDICATION
 #if defined(KNXTPUART_DEBUG_INFO)
-            DebugInfo("Rx: State Indication Received\n");
+              DebugInfo(KNX_TRACE_COUPLER_STATE_INDICATION, incomingByte);
 #endif
-          }
-          // CASE OF TPUART_DATA_CONFIRM_FAILED NOTIFICATION
-          else if (incomingByte == TPUART_DATA_CONFIRM_FAILED)
-          {
-            // NACK following Telegram transmission
-            if (_tx.state == TX_WAITING_ACK)
-            {
-              _tx.ackFctPtr(NACK_RESPONSE);
-              _tx.state = TX_IDLE;
             }
+            // CASE OF TPUART_DATA_CONFIRM_FAILED NOTIFICATION
+            else if (incomingByte == TPUART_DATA_CONFIRM_FAILED)
+            {
+              // NACK following Telegram transmission
+              if (_tx.state == TX_WAITING_ACK)
+              {
+                NotifyTxAck(NACK_RESPONSE);
+                _tx.state = TX_IDLE;
+              }
 #if defined(KNXTPUART_DEBUG_ERROR)
-            else {
-                DebugError("Rx: unexpected TPUART_DATA_CONFIRM_FAILED received!\n");
-                ESP_LOGE(TAG, "Rx: unexpected TPUART_DATA_CONFIRM_FAILED received");
-            }
+              else {
+                  DebugError(KNX_TRACE_COUPLER_UNEXPECTED_CONFIRM, 0);
+                  ESP_LOGE(TAG, "Rx: unexpected TPUART_DATA_CONFIRM_FAILED received");
+              }
 #endif
-          }
+            }
 #if defined(KNXTPUART_DEBUG_ERROR)
-          // UNKNOWN CONTROL FIELD RECEIVED
-          else if (incomingByte) {
-            DebugError("Rx: Unknown Control Field received\n");
-            //ESP_LOGE(TAG, "Rx: Unknown Control Field received: %02x", incomingByte);
-          }
+            // UNKNOWN CONTROL FIELD RECEIVED
+            else if (incomingByte) {
+              DebugError(KNX_TRACE_COUPLER_UNKNOWN_BYTE, incomingByte);
+              //ESP_LOGE(TAG, "Rx: Unknown Control Field received: %02x", incomingByte);
+            }
 #endif
-          // else ignore "0" value sent on Reset by TPUART prior to TPUART_RESET_INDICATION
-          break;
-
-      case RX_EIB_TELEGRAM_RECEPTION_STARTED :
-          telegram.WriteRawByte(incomingByte,readBytesNb);
-          readBytesNb++;
-
-          if (readBytesNb==3)
-          {  // We have just received the source address
-             // we check whether the received EIB telegram is coming from us (i.e. telegram is sent by the TPUART itself)
-            if ( telegram.GetSourceAddress() == _physicalAddr )
-            { // the message is coming from us, we consider it as not addressed and we don't send any ACK service
-              _rx.state = RX_EIB_TELEGRAM_RECEPTION_NOT_ADDRESSED;
+            // else ignore "0" value sent on Reset by TPUART prior to TPUART_RESET_INDICATION
+            break;
+
+        case RX_EIB_TELEGRAM_RECEPTION_STARTED :
+            telegram.WriteRawByte(incomingByte,readBytesNb);
+            readBytesNb++;
+
+            if (readBytesNb==3)
+            {  // We have just received the source address
+               // we check whether the received EIB telegram is coming from us (i.e. telegram is sent by the TPUART itself)
+              if ( telegram.GetSourceAddress() == _physicalAddr )
+              { // the message is coming from us, we consider it as not addressed and we don't send any ACK service
+                _rx.state = RX_EIB_TELEGRAM_RECEPTION_NOT_ADDRESSED;
+              }
             }
-          }
-          else if (readBytesNb==6) // We have just read the routing field containing the address type and the payload length
-          { // We check if the message is addressed to us in order to send the appropriate acknowledge
-            if(IsAddressAssigned(telegram.GetTargetAddress(), addressedComObjectIndex))
-            { // Message addressed to us
-              _rx.state = RX_EIB_TELEGRAM_RECEPTION_ADDRESSED;
-              //sent the correct ACK service now
-              // the ACK info must be sent latest 1,7 ms after receiving the address type octet of an addressed frame
-              _serial.write(TPUART_RX_ACK_SERVICE_ADDRESSED);
+            else if (readBytesNb==6) // We have just read the routing field containing the address type and the payload length
+            { // We check if the message is addressed to us in order to send the appropriate acknowledge
+              if(_comObjects.IsAddressAssigned(telegram.GetTargetAddress(), addressedComObjectIndex))
+              { // Message addressed to us
+                _rx.state = RX_EIB_TELEGRAM_RECEPTION_ADDRESSED;
+                //sent the correct ACK service now
+                // the ACK info must be sent latest 1,7 ms after receiving the address type octet of an addressed frame
+                _transport.Write(TPUART_RX_ACK_SERVICE_ADDRESSED);
+                KNX_PROBE_ACK_SENT(telegram.GetTargetAddress(), 1);
+              }
+              else
+              { // Message NOT addressed to us
+                _rx.state = RX_EIB_TELEGRAM_RECEPTION_NOT_ADDRESSED;
+                //sent the correct ACK service now
+                // the ACK info must be sent latest 1,7 ms after receiving the address type octet of an addressed frame
+                _transport.Write(TPUART_RX_ACK_SERVICE_NOT_ADDRESSED);
+                KNX_PROBE_ACK_SENT(telegram.GetTargetAddress(), 0);
+              }
             }
+            break;
+
+        case RX_EIB_TELEGRAM_RECEPTION_ADDRESSED :
+            if (readBytesNb == KNX_TELEGRAM_MAX_SIZE) _rx.state = RX_EIB_TELEGRAM_RECEPTION_LENGTH_INVALID;
             else
-            { // Message NOT addressed to us
-              _rx.state = RX_EIB_TELEGRAM_RECEPTION_NOT_ADDRESSED;
-              //sent the correct ACK service now
-              // the ACK info must be sent latest 1,7 ms after receiving the address type octet of an addressed frame
-              _serial.write(TPUART_RX_ACK_SERVICE_NOT_ADDRESSED);
+            {
+            telegram.WriteRawByte(incomingByte,readBytesNb);
+            readBytesNb++;
             }
-          }
-          break;
-
-      case RX_EIB_TELEGRAM_RECEPTION_ADDRESSED :
-          if (readBytesNb == KNX_TELEGRAM_MAX_SIZE) _rx.state = RX_EIB_TELEGRAM_RECEPTION_LENGTH_INVALID;
-          else
-          {
-          telegram.WriteRawByte(incomingByte,readBytesNb);
-          readBytesNb++;
-          }
-          break;
-
-    //  case RX_EIB_TELEGRAM_RECEPTION_LENGTH_INVALID : break; // if the message is too long, nothing to do except waiting for EOP
-    //  case RX_EIB_TELEGRAM_RECEPTION_NOT_ADDRESSED : break; // if the message is not addressed, nothing to do except waiting for EOP
+            break;
+
+      //  case RX_EIB_TELEGRAM_RECEPTION_LENGTH_INVALID : break; // if the message is too long, nothing to do except waiting for EOP
+        case RX_EIB_TELEGRAM_RECEPTION_NOT_ADDRESSED : // if the message is not addressed, nothing to do except waiting for EOP
+            if (readBytesNb < KNX_TELEGRAM_MAX_SIZE)
+            { // the length is counted for the bus health, the bytes are kept for the traffic statistics and the frame callback
+              if (_groupStats || _frameCallbackFct) telegram.WriteRawByte(incomingByte,readBytesNb);
+              readBytesNb++;
+            }
+            break;
 
-      default : break;
-    } // switch (_rx.state)
-  } // if (_serial.available() > 0)
+        default : break;
+      } // switch (_rx.state)
+    } // for each byte of the chunk
+    KNX_PROFILE_END(KNX_PROFILE_RX_BYTES, chunkStartTicks);
+  } // while (_transport.Available() > 0)
 }
 
 
@@ -490,19 +520,24 @@ void KnxTpUart::RXTask(void)
 // is transmitted in 0,58ms.
 // Sending one byte of a telegram consists in transmitting 2 characters (1,16ms)
 // Let's wait around 800us between each telegram piece sending so that the 64byte TX buffer remains almost empty.
+// With KNXTPUART_TX_BURST flag, several telegram pieces are written at once, as long as the characters not sent yet
+// do not exceed KNXTPUART_TX_BURST_MAX_PAIRS pieces.
 // Typical calling period is 800 usec.
 void KnxTpUart::TXTask(void)
 {
   word nowTime;
+#if !defined(KNXTPUART_TX_BURST)
   byte txByte[2];
+#endif
   static word sentMessageTimeMillisec;
+  KNX_PROFILE_BEGIN(startTicks);
 
   // STEP 1 : Manage Message Acknowledge timeout
   switch (_tx.state)
   {
   case TX_WAITING_ACK :
     // A transmission ACK is awaited, increment Acknowledge timeout
-    nowTime = (word) millis(); // word is enough to count up to 500
+    nowTime = (word) KnxMillis(); // word is enough to count up to 500
     if(TimeDeltaWord(nowTime,sentMessageTimeMillisec) > 500 /* 500 ms */ )
     { // The no-answer timeout value is defined as follows :
       // - The emission duration for a single max sized telegram is 40ms
@@ -510,7 +545,7 @@ void KnxTpUart::TXTask(void)
       // - The telegram emission might be delayed by another message transmission ongoing
       // - The telegram emission might be delayed by the simultaneous transmission of higher prio messages
       // Let's take around 3 times the max emission duration (160ms) as arbitrary value
-      _tx.ackFctPtr(NO_ANSWER_TIMEOUT); // Send a No Answer TIMEOUT
+      NotifyTxAck(NO_ANSWER_TIMEOUT); // Send a No Answer TIMEOUT
       _tx.state = TX_IDLE;
     }
     break;
@@ -522,31 +557,64 @@ void KnxTpUart::TXTask(void)
     // In that way, the TX buffer will remain empty and the ACK will be sent immediately
     if (_rx.state != RX_EIB_TELEGRAM_RECEPTION_STARTED)
     {
+#if defined(KNXTPUART_TX_BURST)
+      // BURST : the Data Start/Continue/End services are written by chunks, as long as the line time of the
+      // characters not sent yet stays within KNXTPUART_TX_BURST_MAX_PAIRS services. The telegram pieces left
+      // are written by the next calls, once the reception state has been checked again.
+      byte txBurst[2 * KNXTPUART_TX_BURST_MAX_PAIRS];
+      byte burstLength = 0;
+      unsigned long nowMicros = KnxMicros();
+
+      if ((long)(_txBurstEndMicros - nowMicros) < 0) _txBurstEndMicros = nowMicros; // all the characters are sent
+      while ((_tx.state == TX_TELEGRAM_SENDING_ONGOING) && (burstLength < sizeof(txBurst))
+             && (_txBurstEndMicros - nowMicros <= (KNXTPUART_TX_BURST_MAX_PAIRS - 1) * KNXTPUART_CHAR_PAIR_MICROS))
+      {
+        txBurst[burstLength++] = ((_tx.nbRemainingBytes == 1) ? TPUART_DATA_END_REQ : TPUART_DATA_START_CONTINUE_REQ)
+                                 + _tx.txByteIndex;
+        txBurst[burstLength++] = _tx.sentTelegram->ReadRawByte(_tx.txByteIndex);
+        _txBurstEndMicros += KNXTPUART_CHAR_PAIR_MICROS;
+        if (_tx.nbRemainingBytes == 1)
+        { // Message sending completed
+          sentMessageTimeMillisec = (word)KnxMillis(); // memorize sending time in order to manage ACK timeout
+          _tx.endMicros = nowMicros;
+          _tx.state = TX_WAITING_ACK;
+        }
+        else
+        {
+          _tx.txByteIndex++;
+          _tx.nbRemainingBytes--;
+        }
+      }
+      if (burstLength) _transport.Write(txBurst, burstLength);
+#else
       {
         if (_tx.nbRemainingBytes == 1)
         { // We are sending the last byte, i.e checksum
           txByte[0] = TPUART_DATA_END_REQ + _tx.txByteIndex;
           txByte[1] = _tx.sentTelegram->ReadRawByte(_tx.txByteIndex);
-          _serial.write(txByte,2); // write the UART control field and the data byte
+          _transport.Write(txByte,2); // write the UART control field and the data byte
 
           // Message sending completed
-          sentMessageTimeMillisec = (word)millis(); // memorize sending time in order to manage ACK timeout
+          sentMessageTimeMillisec = (word)KnxMillis(); // memorize sending time in order to manage ACK timeout
+          _tx.endMicros = KnxMicros();
 	  _tx.state = TX_WAITING_ACK;
         }
         else
         {
           txByte[0] = TPUART_DATA_START_CONTINUE_REQ + _tx.txByteIndex;
           txByte[1] = _tx.sentTelegram->ReadRawByte(_tx.txByteIndex);
-          _serial.write(txByte,2); // write the UART control field and the data byte
+          _transport.Write(txByte,2); // write the UART control field and the data byte
           _tx.txByteIndex++;
           _tx.nbRemainingBytes--;
         }
       }
+#endif
     }
     break;
 
   default : break;
   } // switch
+  KNX_PROFILE_END(KNX_PROFILE_TX_TASK, startTicks);
 }
 
 
@@ -557,14 +625,14 @@ void KnxTpUart::TXTask(void)
 boolean KnxTpUart::GetMonitoringData(type_MonitorData& data)
 {
 word nowTime;
-static type_MonitorData currentData={true,0};
-static word lastByteRxTimeMicrosec;
 
+  if (!_monitor) return false;
+  type_MonitorData& currentData = _monitor->currentData;
   // STEP 1 : Check EOP
   if (!(currentData.isEOP)) // check that we have not already detected an EOP
   {
-    nowTime = (word) micros(); // word cast because a 65ms counter is enough
-    if(TimeDeltaWord(nowTime,lastByteRxTimeMicrosec) > 2000 /* 2 ms */ )
+    nowTime = (word) KnxMicros(); // word cast because a 65ms counter is enough
+    if(TimeDeltaWord(nowTime,(word)_monitor->lastByteRxMicros) > 2000 /* 2 ms */ )
     {  // EOP detected
       currentData.isEOP = true;
       currentData.dataByte = 0;
@@ -573,64 +641,81 @@ static word lastByteRxTimeMicrosec;
     }
   }
   // STEP 2 : Get New RX Data
-  if (_serial.available() > 0)
+  if (_transport.Available() > 0)
   {
-    currentData.dataByte = (byte)(_serial.read());
+    currentData.dataByte = (byte)(_transport.Read());
     currentData.isEOP = false;
     data= currentData;
-    lastByteRxTimeMicrosec = (word) micros();
+    _monitor->lastByteRxMicros = KnxMicros();
     return true;
   }
   return false; // No data received
 }
 
 
-// Check if the target address is an assigned com object one
-// if yes, then update index parameter with the index (in the list) of the targeted com object and return true
-// else return false
-boolean KnxTpUart::IsAddressAssigned(word addr, byte &index) const
+// RX task in BUS MONITOR mode : the bytes are gathered in frames, a frame ends after a 2ms gap
+// NB : the bytes of a chunk read at once are back dated from the reading time at the bus pace
+void KnxTpUart::MonitoringTask(void)
 {
-byte divisionCounter=0;
-byte i, searchIndexStart, searchIndexStop, searchIndexRange;
+  byte rxChunk[KNXTPUART_RX_CHUNK_SIZE];
+  int rxBytesNb;
+  unsigned long chunkTimeMicros;
+  type_MonitorFrame& frame = _monitor->frame;
+
+  // EOP
+  if (frame.length && (KnxMicros() - _monitor->lastByteRxMicros > 2000 /* 2 ms */)) CompleteMonitoringFrame();
 
-  if (!_assignedComObjectsNb) return false; // in case of empty list, we return immediately
+  while ((rxBytesNb = _transport.Available()) > 0)
+  {
+    if (rxBytesNb > KNXTPUART_RX_CHUNK_SIZE) rxBytesNb = KNXTPUART_RX_CHUNK_SIZE;
+    rxBytesNb = _transport.ReadBytes(rxChunk, rxBytesNb);
+    chunkTimeMicros = KnxMicros();
+    _monitor->lastByteRxMicros = chunkTimeMicros;
+    for (byte i = 0; i < rxBytesNb; i++)
+    {
+      if (!frame.length)
+      {
+        frame.startTimeMicros = chunkTimeMicros - (unsigned long)(rxBytesNb - 1 - i) * EIB_BYTE_PERIOD;
+        frame.status = 0;
+      }
+      if (frame.length < KNX_TELEGRAM_MAX_SIZE) frame.data[frame.length++] = rxChunk[i];
+      else frame.status |= KNX_MONITOR_FRAME_TRUNCATED;
+    }
+  }
+}
 
-  // Define how many divisions by 2 shall be done in order to reduce the search list by 8 Addr max
-  // if _assignedComObjectsNb >= 16 => divisionCounter = 1
-  // if _assignedComObjectsNb >= 32 => divisionCounter = 2
-  // if _assignedComObjectsNb >= 64 => divisionCounter = 3
-  // if _assignedComObjectsNb >= 128 => divisionCounter = 4
-  for (i=4; _assignedComObjectsNb >>i ; i++) divisionCounter++;
 
-  // the starting point is to search on the whole address range (0 -> _assignedComObjectsNb -1)
-  searchIndexStart = 0; searchIndexStop = _assignedComObjectsNb - 1; searchIndexRange = _assignedComObjectsNb;
+void KnxTpUart::CompleteMonitoringFrame(void)
+{
+  type_MonitorFrame& frame = _monitor->frame;
+  byte xorSum = 0;
 
-  // reduce the address range if needed
-  while(divisionCounter)
+  if (frame.length == 1)
   {
-    searchIndexRange>>=1; // Divide range width by 2
-    if (_orderedIndexTable[searchIndexStart+searchIndexRange]!=255
-    && addr >= _comObjectsList[_orderedIndexTable[searchIndexStart+searchIndexRange]]->GetAddr())
-      searchIndexStart += searchIndexRange ;
-    else searchIndexStop-=searchIndexRange;
-    divisionCounter --;
+    if ((frame.data[0] == EIB_ACK_FRAME) || (frame.data[0] == EIB_NACK_FRAME) || (frame.data[0] == EIB_BUSY_FRAME))
+      frame.status |= KNX_MONITOR_FRAME_ACK;
   }
-
-  // search the address value and index in the reduced range
-  for (i = searchIndexStart;
-      (_orderedIndexTable[i]!=255 && _orderedIndexTable[i]<=_assignedComObjectsNb &&
-      _comObjectsList[_orderedIndexTable[i]]->GetAddr() != addr && i <= searchIndexStop);
-      i++);
-  if (i > searchIndexStop) return false; // Address is NOT part of the assigned addresses
-  // Address is part of the assigned addresses
-  index = _orderedIndexTable[i];
-  return true;
+  else
+  {
+    if (((frame.data[0] & EIB_CONTROL_FIELD_PATTERN_MASK) == EIB_CONTROL_FIELD_VALID_PATTERN)
+        && (frame.length >= KNX_TELEGRAM_MIN_SIZE) && !(frame.status & KNX_MONITOR_FRAME_TRUNCATED)
+        && (frame.length == (frame.data[5] & 0x0F) + KNX_TELEGRAM_LENGTH_OFFSET))
+      frame.status |= KNX_MONITOR_FRAME_VALID;
+    for (byte i = 0; i < frame.length; i++) xorSum ^= frame.data[i];
+    if (xorSum == 0xFF) frame.status |= KNX_MONITOR_FRAME_CHECKSUM_OK; // checksum is the 1's complement of the XOR sum
+  }
+  if (!_monitor->frames.Push(frame))
+  { // single writer : a plain increment, stored atomically for the reader context
+    __atomic_store_n(&_monitor->overflowsNb, (word)(_monitor->overflowsNb + 1), __ATOMIC_RELAXED);
+    KNX_PROBE_QUEUE_OVERFLOW(KNX_PROBE_QUEUE_MONITOR);
+  }
+  frame.length = 0;
 }
 
 
 // DEBUG purpose functions
-void KnxTpUart::DEBUG_SendResetCommand() { _serial.write(TPUART_RESET_REQ); }
+void KnxTpUart::DEBUG_SendResetCommand() { _transport.Write(TPUART_RESET_REQ); }
 
-void KnxTpUart::DEBUG_SendStateReqCommand() { _serial.write(TPUART_STATE_REQ); }
+void KnxTpUart::DEBUG_SendStateReqCommand() { _transport.Write(TPUART_STATE_REQ); }
 
 //EOF
@@ -20,7 +20,7 @@
 // File : KnxTpUart.h
 // Author : Franck Marini
 // Description : Communication with TPUART
-// Module dependencies : HardwareSerial, KnxTelegram, KnxComObject
+// Module dependencies : KnxSerialTransport, KnxTelegram, KnxComObject, KnxComObjectTable
 
 // This library supports both TPUART version 1 and 2
 // The Siemens KNX TPUART version 1 datasheet is available at :
@@ -32,16 +32,46 @@
 #define KNXTPUART_H
 
 #include "Arduino.h"
-#include "HardwareSerial.h"
+#include "KnxSerialTransport.h"
 #include "KnxTelegram.h"
 #include "KnxComObject.h"
+#include "KnxComObjectTable.h"
 #include "KnxBusCoupler.h"
+#include "SpscRingBuffer.h"
 
 // !!!!!!!!!!!!!!! FLAG OPTIONS !!!!!!!!!!!!!!!!!
 // DEBUG :
 // #define KNXTPUART_DEBUG_INFO   // Uncomment to activate info traces
 // #define KNXTPUART_DEBUG_ERROR  // Uncomment to activate error traces
 
+// TX : burst transmission, the telegram bytes are written into the UART TX buffer by chunks of several Data services
+// instead of one telegram byte per TX task call (i.e. every 800us). This reduces the telegram transmission latency
+// when the TX task is called less often than once per character pair (1,16ms).
+// NB : the characters written and not sent yet are limited to KNXTPUART_TX_BURST_MAX_PAIRS pairs, so that the ACK of
+// a telegram whose reception starts during the burst is sent in time (the reception is checked before every chunk)
+// #define KNXTPUART_TX_BURST // Uncomment to activate the burst transmission
+#ifndef KNXTPUART_TX_BURST_MAX_PAIRS
+#define KNXTPUART_TX_BURST_MAX_PAIRS 4
+#endif
+
+// Sending time of a Data service (2 characters of 11 bits at 19200 baud)
+#define KNXTPUART_CHAR_PAIR_MICROS 1146
+
+// RX : max nb of bytes pulled from the serial in a single bulk read by the RX task
+// NB : the chunk buffer is allocated on the stack
+#ifndef KNXTPUART_RX_CHUNK_SIZE
+#define KNXTPUART_RX_CHUNK_SIZE 16
+#endif
+
+// Max wait time of WaitForRxData() while a reception or transmission is ongoing (i.e. RX task period)
+#define KNXTPUART_ACTIVE_WAIT_MAX_MICROS 400
+
+// BUS MONITOR : nb of whole frames buffered by the RX task until GetMonitoringFrames() (power of 2, up to 128)
+// NB : the buffer is allocated in BUS_MONITOR mode only
+#ifndef KNXTPUART_MONITOR_RING_SIZE
+#define KNXTPUART_MONITOR_RING_SIZE 16
+#endif
+
 
 
 // Services to TPUART (hostcontroller -> TPUART) :
@@ -68,6 +98,12 @@
 #define EIB_CONTROL_FIELD_PATTERN_MASK   0b11010011
 #define EIB_CONTROL_FIELD_VALID_PATTERN  0b10010000 // Only Standard Frame Format "10" is handled
 
+// Bus acknowledge frames (BUS MONITOR mode)
+#define EIB_ACK_FRAME                    0xCC
+#define EIB_NACK_FRAME                   0x0C
+#define EIB_BUSY_FRAME                   0xC0
+#define EIB_BYTE_PERIOD                  1352 // us, 13 bits at 9600 bit/s
+
 // Mask for STATE INDICATION service
 #define TPUART_STATE_INDICATION_SLAVE_COLLISION_MASK  0x80
 #define TPUART_STATE_INDICATION_RECEIVE_ERROR_MASK    0x40
@@ -78,35 +114,48 @@
 #define KNX_RESETRESP_TIMEOUT 1000
 #define KNX_RESET_ATTEMPTS 100
 
+// BUS MONITOR mode data
+typedef struct {
+  SpscRingBuffer<type_MonitorFrame, KNXTPUART_MONITOR_RING_SIZE> frames; // Whole frames, filled by the RX task
+  type_MonitorFrame frame;        // Frame being received
+  boolean started;                // Init() done, the RX task assembles the frames
+  unsigned long lastByteRxMicros; // Reception time of the last byte (EOP detection)
+  word overflowsNb;               // Nb of frames lost because the ring buffer was full (written by the RX task only)
+  type_MonitorData currentData;   // GetMonitoringData() state
+} type_tpuart_monitor;
+
 class KnxTpUart : public KnxBusCoupler {
-    HardwareSerial& _serial;                  // Arduino HW serial port connected to the TPUART
+    KnxSerialTransport *_ownedTransport;      // Transport allocated by the TPUART object (NULL if provided by the user)
+    KnxSerialTransport& _transport;           // Byte stream transport connected to the TPUART
     const word _physicalAddr;                 // Physical address set in the TP-UART
     const type_KnxBusCouplerMode _mode;           // TpUart working Mode (Normal/Bus Monitor)
     type_buscoupler_rx _rx;                       // Reception structure
     type_buscoupler_tx _tx;                       // Transmission structure
     type_EventCallbackFctPtr _evtCallbackFct; // Pointer to the EVENTS callback function
-    KnxComObject **_comObjectsList;            // Attached list of com objects
-    byte _assignedComObjectsNb;               // Nb of assigned com objects
-    byte *_orderedIndexTable;                 // Table containing the assigned com objects indexes ordered by increasing @
+    KnxComObjectTable _comObjects;            // Attached com objects, ordered by address
     byte _stateIndication;                    // Value of the last received state indication
+    type_tpuart_monitor *_monitor;            // BUS MONITOR mode data (NULL in NORMAL mode)
+    KnxGroupStats *_groupStats;               // Traffic statistics per target address (NULL if not recorded)
+    KnxBusHealth *_busHealth;                 // Bus health and load counters (NULL if not maintained)
+    type_FrameCallbackFctPtr _frameCallbackFct; // Callback of the frames seen on the bus (NULL if not set)
 	unsigned long _resetRespTimeout;
 	word _resetAttempts;
-#if defined(KNXTPUART_DEBUG_INFO) || defined(KNXTPUART_DEBUG_ERROR)
-    String *_debugStrPtr;
-#endif
-
-#ifdef KNXTPUART_DEBUG_INFO
-static const char _debugInfoText[];
+#if defined(KNXTPUART_TX_BURST)
+    unsigned long _txBurstEndMicros;          // Time when the characters written into the UART are all sent
 #endif
-#ifdef KNXTPUART_DEBUG_ERROR
-static const char _debugErrorText[];
+#if defined(KNXTPUART_DEBUG_INFO) || defined(KNXTPUART_DEBUG_ERROR)
+    KnxTraceRing *_traceRing;                 // Ring of the debug traces (NULL if not traced)
 #endif
 
   public:
 
     // Constructor / Destructor
+    // Arduino : TPUART connected to a HW serial port
     KnxTpUart(HardwareSerial& serial, word physicalAddr,
       type_KnxBusCouplerMode _mode);
+    // TPUART connected through any byte stream transport (e.g. KnxPosixSerialTransport on Linux)
+    KnxTpUart(KnxSerialTransport& transport, word physicalAddr,
+      type_KnxBusCouplerMode _mode);
     ~KnxTpUart();
 
   // INLINED functions (see definitions later in this file)
@@ -142,9 +191,36 @@ static const char _debugErrorText[];
     // false when there's no activity or when the tpuart is not initialized
     boolean IsActive(void) const;
 
+    // Pop the oldest telegram from the RX queue
+    // return false when no received telegram is pending
+    // NB : every telegram added in the queue is notified by a "BUSCOUPLER_EVENT_RECEIVED_EIB_TELEGRAM" event
+    boolean PopReceivedTelegram(type_buscoupler_rx_telegram&);
+
+    // Get the nb of received telegrams lost because of RX queue overflow
+    word GetRxOverflowsNb(void) const;
+
+    // Record the traffic statistics per target address of all the telegrams seen on the bus (NULL to stop)
+    // NB : the statistics object is not owned by the TPUART object
+    boolean SetGroupStats(KnxGroupStats *groupStats);
+
+    // Maintain the bus health and load counters (NULL to stop) : frames seen on the bus, transmission outcomes,
+    // state indication errors and TPUART resets
+    // NB : the counters object is not owned by the TPUART object
+    boolean SetBusHealth(KnxBusHealth *busHealth);
+
+    // Call "frameFct" at the EOP of every frame seen on the bus (NULL to stop)
+    boolean SetFrameCallback(type_FrameCallbackFctPtr frameFct);
+
+    // Get the time when the last byte of the last sent telegram was written to the TPUART
+    boolean GetTxEndMicros(unsigned long& timeMicros) const;
+
+    // Return true while a telegram is being sent or waits for its ACK
+    boolean IsTxBusy(void) const;
+
 #if defined(KNXTPUART_DEBUG_INFO) || defined(KNXTPUART_DEBUG_ERROR)
-    // Set the string used for debug traces
-    void SetDebugString(String *strPtr);
+    // Set the ring recording the debug traces
+    // NB : the ring is not owned by the bus coupler object
+    void SetTraceRing(KnxTraceRing *traceRing);
 #endif
 
   // Functions NOT INLINED
@@ -171,12 +247,18 @@ static const char _debugErrorText[];
     // NB : the source address is forced to TPUART physical address value
     byte SendTelegram(KnxTelegram& sentTelegram);
 
+    // Wait up to "timeoutMicros" for data coming from the TPUART, return true when data is available
+    // With a transport supporting wake-up (e.g. Linux), the calling thread sleeps instead of polling
+    // NB : the timeout is reduced to KNXTPUART_ACTIVE_WAIT_MAX_MICROS while a reception or transmission is ongoing
+    boolean WaitForRxData(unsigned long timeoutMicros);
+
     // Reception task
     // This function shall be called periodically in order to allow a correct reception of the EIB bus data
     // Assuming the TPUART speed is configured to 19200 baud, a character (8 data + 1 start + 1 parity + 1 stop)
     // is transmitted in 0,58ms.
     // In order not to miss any End Of Packets (i.e. a gap from 2 to 2,5ms), the function shall be called at a max period of 0,5ms.
     // Typical calling period is 400 usec.
+    // In BUS MONITOR mode, the task assembles the whole frames got with GetMonitoringFrames()
     void RXTask(void);
 
     // Transmission task
@@ -192,8 +274,18 @@ static const char _debugErrorText[];
     // The function returns true if a new data has been retrieved (data pointer in argument), else false
     // It shall be called periodically (max period of 0,5ms) in order to allow correct data reception
     // Typical calling period is 400 usec.
+    // NB : byte per byte alternative to GetMonitoringFrames(), the RX task shall not be called meanwhile
     boolean GetMonitoringData(type_MonitorData&);
 
+    // Get up to "maxNb" whole frames assembled by the RX task (BUS MONITORING mode), oldest first
+    // return the nb of frames copied
+    // NB : the frames are buffered in a lock-free ring, the function may be called from another thread than the
+    // RX task. A frame completed while the ring is full is lost (see GetMonitoringOverflowsNb()).
+    word GetMonitoringFrames(type_MonitorFrame frames[], word maxNb);
+
+    // Get the nb of monitored frames lost because the ring was full
+    word GetMonitoringOverflowsNb(void) const;
+
     // DEBUG purpose functions
     void DEBUG_SendResetCommand(void);
     void DEBUG_SendStateReqCommand(void);
@@ -201,17 +293,21 @@ static const char _debugErrorText[];
   private:
   // Private INLINED functions (see definitions later in this file)
 #if defined(KNXTPUART_DEBUG_INFO)
-    void DebugInfo(const char[]) const;
+    void DebugInfo(e_KnxTraceEvent event, word arg0 = 0) const;
 #endif
 #if defined(KNXTPUART_DEBUG_ERROR)
-    void DebugError(const char[]) const;
+    void DebugError(e_KnxTraceEvent event, word arg0 = 0) const;
 #endif
 
   // Private NOT INLINED functions
-    // Check if the target address points to an assigned com object (i.e. the target address equals a com object address)
-    // if yes, then update index parameter with the index (in the list) of the targeted com object and return true
-    // else return false
-    boolean IsAddressAssigned(word addr, byte &index) const;
+
+    // Notify the transmission outcome (ACK callback)
+    void NotifyTxAck(e_BusCouplerTxAck value);
+
+    // RX task in BUS MONITOR mode
+    void MonitoringTask(void);
+    // Set the status of the frame being received and push it in the ring
+    void CompleteMonitoringFrame(void);
 };
 
 
@@ -251,26 +347,59 @@ inline boolean KnxTpUart::IsActive(void) const
 }
 
 
-#if defined(KNXTPUART_DEBUG_INFO) || defined(KNXTPUART_DEBUG_ERROR)
-inline void KnxTpUart::SetDebugString(String *strPtr)
+inline boolean KnxTpUart::PopReceivedTelegram(type_buscoupler_rx_telegram& rxTelegram)
+{ return _rx.queue.Pop(rxTelegram); }
+
+
+inline word KnxTpUart::GetRxOverflowsNb(void) const { return _rx.overflowsNb; }
+
+
+inline boolean KnxTpUart::SetGroupStats(KnxGroupStats *groupStats) { _groupStats = groupStats; return true; }
+
+
+inline boolean KnxTpUart::SetBusHealth(KnxBusHealth *busHealth) { _busHealth = busHealth; return true; }
+
+
+inline boolean KnxTpUart::SetFrameCallback(type_FrameCallbackFctPtr frameFct) { _frameCallbackFct = frameFct; return true; }
+
+
+inline boolean KnxTpUart::GetTxEndMicros(unsigned long& timeMicros) const { timeMicros = _tx.endMicros; return true; }
+
+inline boolean KnxTpUart::IsTxBusy(void) const { return (_tx.state != TX_IDLE); }
+
+
+inline void KnxTpUart::NotifyTxAck(e_BusCouplerTxAck value)
 {
-   _debugStrPtr = strPtr;
+  if (_busHealth) _busHealth->RecordTxOutcome(value);
+  _tx.ackFctPtr(value);
 }
+
+
+inline word KnxTpUart::GetMonitoringFrames(type_MonitorFrame frames[], word maxNb)
+{ return _monitor ? _monitor->frames.PopBatch(frames, maxNb) : 0; }
+
+
+inline word KnxTpUart::GetMonitoringOverflowsNb(void) const
+{ return _monitor ? __atomic_load_n(&_monitor->overflowsNb, __ATOMIC_RELAXED) : 0; }
+
+
+#if defined(KNXTPUART_DEBUG_INFO) || defined(KNXTPUART_DEBUG_ERROR)
+inline void KnxTpUart::SetTraceRing(KnxTraceRing *traceRing) { _traceRing = traceRing; }
 #endif
 
 
 #if defined(KNXTPUART_DEBUG_INFO)
-inline void KnxTpUart::DebugInfo(const char comment[]) const
+inline void KnxTpUart::DebugInfo(e_KnxTraceEvent event, word arg0) const
 {
-  if (_debugStrPtr != NULL) *_debugStrPtr += String(_debugInfoText) + String(comment);
+  if (_traceRing != NULL) _traceRing->Record(event, arg0);
 }
 #endif
 
 
 #if defined(KNXTPUART_DEBUG_ERROR)
-inline void KnxTpUart::DebugError(const char comment[]) const
+inline void KnxTpUart::DebugError(e_KnxTraceEvent event, word arg0) const
 {
-  if (_debugStrPtr != NULL) *_debugStrPtr += String(_debugErrorText) + String(comment);
+  if (_traceRing != NULL) _traceRing->Record(event, arg0);
 }
 #endif
 
@@ -0,0 +1,135 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxTraceRing.cpp
+// Author : Franck Marini
+// Description : Binary trace ring of the library debug traces
+// Module dependencies : ActionRingBuffer, KnxClock, pgmspace
+
+#include "KnxTraceRing.h"
+
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+// AVR : the texts are read from the program memory
+#define TRACE_SNPRINTF          snprintf_P
+#define TRACE_TEXT(text)        PSTR(text)
+#define TRACE_EVENT_TEXT(event) ((const char *)pgm_read_word(&_traceTexts[event]))
+#else
+#include <pgmspace.h>
+#define TRACE_SNPRINTF          snprintf
+#define TRACE_TEXT(text)        (text)
+#define TRACE_EVENT_TEXT(event) (_traceTexts[event])
+#endif
+
+// Event texts, kept in program memory on AVR (the arguments are formatted with "%u" and "%X")
+static const char _textDeviceNoBusCoupler[] PROGMEM = "KNXDEVICE INFO: !_knxBus";
+static const char _textDeviceInitError[] PROGMEM = "KNXDEVICE INFO: Init Error! knx bus init attempt exceeded";
+static const char _textDeviceInitOk[] PROGMEM = "KNXDEVICE INFO: Init successful";
+static const char _textDeviceInitRead[] PROGMEM = "KNXDEVICE INFO: Init read req., com object %u";
+static const char _textDeviceInitCompleted[] PROGMEM = "KNXDEVICE INFO: Com Object init completed, %u objs initialized";
+static const char _textDeviceReadReq[] PROGMEM = "KNXDEVICE INFO: READ req., com object %u from %X";
+static const char _textDeviceResponseReq[] PROGMEM = "KNXDEVICE INFO: RESP req., com object %u from %X";
+static const char _textDeviceWriteReq[] PROGMEM = "KNXDEVICE INFO: WRITE req., com object %u from %X";
+static const char _textDeviceTxFailed[] PROGMEM = "KNXDEVICE INFO: TX failed, ack %u (1 NACK, 2 NO ANSWER TIMEOUT, 3 RESET)";
+static const char _textDeviceRepeatSuppressed[] PROGMEM = "KNXDEVICE INFO: Repeated telegram ignored, com object %u from %X";
+static const char _textCouplerClosed[] PROGMEM = "KNXTPUART INFO: Destructor: connection closed, byebye";
+static const char _textCouplerDestroyed[] PROGMEM = "KNXTPUART INFO: Destructor: byebye";
+static const char _textCouplerResetOk[] PROGMEM = "KNXTPUART INFO: Reset successful";
+static const char _textCouplerAttachEmptyList[] PROGMEM = "KNXTPUART INFO: AttachComObjectsList : warning : empty object list!";
+static const char _textCouplerAttachNoComObject[] PROGMEM =
+  "KNXTPUART INFO: AttachComObjectsList : warning : no object with com attribute in the list!";
+static const char _textCouplerAttachDuplicate[] PROGMEM =
+  "KNXTPUART INFO: AttachComObjectsList : warning : duplicate address %X found!";
+static const char _textCouplerAttachOk[] PROGMEM = "KNXTPUART INFO: AttachComObjectsList successful, %u objects";
+static const char _textCouplerInitMonitoring[] PROGMEM = "KNXTPUART INFO: Init : Monitoring mode started";
+static const char _textCouplerInitEmptyList[] PROGMEM = "KNXTPUART INFO: Init : warning : empty object list!";
+static const char _textCouplerInitNormal[] PROGMEM = "KNXTPUART INFO: Init : Normal mode started";
+static const char _textCouplerStateIndication[] PROGMEM = "KNXTPUART INFO: Rx: State Indication Received %X";
+static const char _textCouplerRepeatedFrame[] PROGMEM = "KNXFT12 INFO: Tx: frame repeated, no acknowledge (%u)";
+static const char _textCouplerRoutingBusyRx[] PROGMEM = "KNXIPROUTING INFO: Rx: ROUTING_BUSY received, wait time %u ms (%u busy)";
+static const char _textCouplerRoutingBusyTx[] PROGMEM = "KNXIPROUTING INFO: Tx: ROUTING_BUSY sent, %u RX overflows";
+static const char _textCouplerRoutingLost[] PROGMEM = "KNXIPROUTING INFO: Rx: ROUTING_LOST_MESSAGE received, %u messages lost";
+static const char _textCouplerTransportError[] PROGMEM = "KNXTPUART ERROR: Reset : transport opening failed";
+static const char _textCouplerResetFailed[] PROGMEM = "KNXTPUART ERROR: Reset failed, no answer from TPUART device";
+static const char _textCouplerUnexpectedConfirm[] PROGMEM = "KNXTPUART ERROR: Rx: unexpected TPUART_DATA_CONFIRM received (%u)!";
+static const char _textCouplerUnknownByte[] PROGMEM = "KNXTPUART ERROR: Rx: Unknown Control Field received %X";
+static const char _textCouplerSendFailed[] PROGMEM = "KNXIPROUTING ERROR: Tx: datagram sending failed";
+
+// Event texts table, in the e_KnxTraceEvent order
+static const char * const _traceTexts[KNX_TRACE_EVENTS_NB] PROGMEM = {
+  _textDeviceNoBusCoupler, _textDeviceInitError, _textDeviceInitOk, _textDeviceInitRead, _textDeviceInitCompleted,
+  _textDeviceReadReq, _textDeviceResponseReq, _textDeviceWriteReq, _textDeviceTxFailed, _textDeviceRepeatSuppressed,
+  _textCouplerClosed, _textCouplerDestroyed, _textCouplerResetOk, _textCouplerAttachEmptyList,
+  _textCouplerAttachNoComObject, _textCouplerAttachDuplicate, _textCouplerAttachOk, _textCouplerInitMonitoring,
+  _textCouplerInitEmptyList, _textCouplerInitNormal, _textCouplerStateIndication, _textCouplerRepeatedFrame,
+  _textCouplerRoutingBusyRx, _textCouplerRoutingBusyTx, _textCouplerRoutingLost, _textCouplerTransportError,
+  _textCouplerResetFailed, _textCouplerUnexpectedConfirm, _textCouplerUnknownByte, _textCouplerSendFailed };
+
+
+boolean KnxTraceRing::Pop(type_trace_entry& entry) { return _entries.Pop(entry); }
+
+
+byte KnxTraceRing::Format(const type_trace_entry& entry, char text[], byte size)
+{
+  int length, textLength;
+
+  if (!size) return 0;
+  length = TRACE_SNPRINTF(text, size, TRACE_TEXT("%lu "), (unsigned long)entry.timeMicros);
+  if ((length < 0) || (length >= size)) return size - 1;
+  if (entry.event < KNX_TRACE_EVENTS_NB)
+    textLength = TRACE_SNPRINTF(text + length, size - length, TRACE_EVENT_TEXT(entry.event), entry.args[0], entry.args[1]);
+  else textLength = TRACE_SNPRINTF(text + length, size - length, TRACE_TEXT("KNX TRACE: unknown event %u"), entry.event);
+  if (textLength < 0) textLength = 0;
+  length += textLength;
+  return (length >= size) ? size - 1 : length;
+}
+
+
+word KnxTraceRing::Dump(Stream& stream)
+{
+  type_trace_entry entry;
+  char text[KNX_TRACE_TEXT_MAX_SIZE];
+  word nb = 0;
+
+  if (_lostEntriesNb)
+  {
+    TRACE_SNPRINTF(text, sizeof(text), TRACE_TEXT("KNX TRACE: %u entries lost"), _lostEntriesNb);
+    stream.println(text);
+    _lostEntriesNb = 0;
+  }
+  while (_entries.Pop(entry))
+  {
+    Format(entry, text, sizeof(text));
+    stream.println(text);
+    nb++;
+  }
+  return nb;
+}
+
+
+void KnxTraceRing::Clear(void)
+{
+  type_trace_entry entry;
+
+  while (_entries.Pop(entry));
+  _lostEntriesNb = 0;
+}
+
+// EOF
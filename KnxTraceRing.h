@@ -0,0 +1,140 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxTraceRing.h
+// Author : Franck Marini
+// Description : Binary trace ring of the library debug traces (KNXDEVICE_DEBUG_INFO, KNXTPUART_DEBUG_INFO and
+//               KNXTPUART_DEBUG_ERROR flags)
+//               A trace is recorded as a fixed size entry (time in usec, event id and 2 integer arguments) in a
+//               ring owned by the application : no allocation and no formatting on the traced code path.
+//               The entries are formatted to text later on, when the ring is dumped (e.g. to Serial from loop()).
+//               In case of ring full, the oldest entry is overwritten and the loss is counted.
+// Module dependencies : ActionRingBuffer, KnxClock
+
+#ifndef KNXTRACERING_H
+#define KNXTRACERING_H
+
+#include "Arduino.h"
+#include "ActionRingBuffer.h"
+#include "KnxClock.h"
+
+// Nb of entries of the ring
+#ifndef KNX_TRACE_RING_SIZE
+#define KNX_TRACE_RING_SIZE 32
+#endif
+
+// Max length of a formatted entry (including the terminating null char)
+#define KNX_TRACE_TEXT_MAX_SIZE 96
+
+// Trace events (the texts are defined in the same order in KnxTraceRing.cpp)
+enum e_KnxTraceEvent {
+  // KnxDevice info traces
+  KNX_TRACE_DEVICE_NO_BUS_COUPLER = 0,
+  KNX_TRACE_DEVICE_INIT_ERROR,
+  KNX_TRACE_DEVICE_INIT_OK,
+  KNX_TRACE_DEVICE_INIT_READ,           // arg0 : com object index
+  KNX_TRACE_DEVICE_INIT_COMPLETED,      // arg0 : nb of init read requests
+  KNX_TRACE_DEVICE_READ_REQ,            // arg0 : com object index, arg1 : source address
+  KNX_TRACE_DEVICE_RESPONSE_REQ,        // arg0 : com object index, arg1 : source address
+  KNX_TRACE_DEVICE_WRITE_REQ,           // arg0 : com object index, arg1 : source address
+  KNX_TRACE_DEVICE_TX_FAILED,           // arg0 : e_BusCouplerTxAck value
+  KNX_TRACE_DEVICE_REPEAT_SUPPRESSED,   // arg0 : com object index, arg1 : source address
+  // Bus coupler info traces
+  KNX_TRACE_COUPLER_CLOSED,
+  KNX_TRACE_COUPLER_DESTROYED,
+  KNX_TRACE_COUPLER_RESET_OK,
+  KNX_TRACE_COUPLER_ATTACH_EMPTY_LIST,
+  KNX_TRACE_COUPLER_ATTACH_NO_COM_OBJECT,
+  KNX_TRACE_COUPLER_ATTACH_DUPLICATE,   // arg0 : group address
+  KNX_TRACE_COUPLER_ATTACH_OK,          // arg0 : nb of com objects with communication attribute
+  KNX_TRACE_COUPLER_INIT_MONITORING,
+  KNX_TRACE_COUPLER_INIT_EMPTY_LIST,
+  KNX_TRACE_COUPLER_INIT_NORMAL,
+  KNX_TRACE_COUPLER_STATE_INDICATION,   // arg0 : TPUART state indication
+  KNX_TRACE_COUPLER_REPEATED_FRAME,     // arg0 : nb of repetitions of the frame
+  KNX_TRACE_COUPLER_ROUTING_BUSY_RX,    // arg0 : requested wait time (ms), arg1 : nb of ROUTING_BUSY received recently
+  KNX_TRACE_COUPLER_ROUTING_BUSY_TX,    // arg0 : nb of RX queue overflows
+  KNX_TRACE_COUPLER_ROUTING_LOST,       // arg0 : nb of messages lost by the sending router
+  // Bus coupler error traces
+  KNX_TRACE_COUPLER_TRANSPORT_ERROR,
+  KNX_TRACE_COUPLER_RESET_FAILED,
+  KNX_TRACE_COUPLER_UNEXPECTED_CONFIRM, // arg0 : 1 for a positive confirmation, 0 for a negative one
+  KNX_TRACE_COUPLER_UNKNOWN_BYTE,       // arg0 : received byte
+  KNX_TRACE_COUPLER_SEND_FAILED,
+  KNX_TRACE_EVENTS_NB
+};
+
+typedef struct {
+  unsigned long timeMicros;
+  byte event;    // e_KnxTraceEvent
+  word args[2];
+} type_trace_entry;
+
+
+class KnxTraceRing {
+    ActionRingBuffer<type_trace_entry, KNX_TRACE_RING_SIZE> _entries;
+    word _lostEntriesNb; // nb of entries overwritten since the last dump
+
+  public:
+    KnxTraceRing() : _lostEntriesNb(0) {}
+
+    // Pop the oldest entry, return false when the ring is empty
+    boolean Pop(type_trace_entry& entry);
+
+    // Format an entry to text (time in usec, then the event text with its arguments)
+    // return the text length
+    static byte Format(const type_trace_entry& entry, char text[], byte size);
+
+    // Print and remove all the entries, one per line
+    // The nb of lost entries is printed first if any, then cleared
+    // return the nb of printed entries
+    word Dump(Stream& stream);
+
+    void Clear(void);
+
+  // INLINED functions (see definitions later in this file)
+    // Record a trace (to be called from the traced code, no allocation nor formatting)
+    void Record(e_KnxTraceEvent event, word arg0 = 0, word arg1 = 0);
+
+    byte GetEntriesNb(void) const;
+    word GetLostEntriesNb(void) const;
+};
+
+
+// --------------- Definition of the INLINED functions -----------------
+inline void KnxTraceRing::Record(e_KnxTraceEvent event, word arg0, word arg1)
+{
+  type_trace_entry entry;
+
+  entry.timeMicros = KnxMicros();
+  entry.event = event;
+  entry.args[0] = arg0;
+  entry.args[1] = arg1;
+  if (_entries.IsFull() && (_lostEntriesNb != 0xFFFF)) _lostEntriesNb++;
+  _entries.Append(entry);
+}
+
+inline byte KnxTraceRing::GetEntriesNb(void) const { return _entries.ElementsNb(); }
+
+inline word KnxTraceRing::GetLostEntriesNb(void) const { return _lostEntriesNb; }
+
+#endif // KNXTRACERING_H
+
+// EOF
@@ -0,0 +1,88 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxTxLatency.cpp
+// Author : Franck Marini
+// Description : Latency histograms of the telegram transmissions
+// Module dependencies : KnxTelegram
+
+#include "KnxTxLatency.h"
+
+void KnxLatencyHistogram::Add(unsigned long latencyMicros)
+{
+  byte bucket = 0;
+
+  latencyMicros >>= KNX_LATENCY_FIRST_BUCKET_SHIFT;
+  while (latencyMicros && (bucket < KNX_LATENCY_BUCKETS_NB - 1)) { bucket++; latencyMicros >>= 1; }
+  _counts[bucket]++;
+  _totalNb++;
+}
+
+
+void KnxLatencyHistogram::Clear(void)
+{
+  memset(_counts, 0, sizeof(_counts));
+  _totalNb = 0;
+}
+
+
+unsigned long KnxLatencyHistogram::GetPercentile(byte percentile) const
+{
+  unsigned long rank, cumulated = 0;
+
+  if (!_totalNb) return 0;
+  if (percentile > 100) percentile = 100;
+  rank = (_totalNb / 100) * percentile + ((_totalNb % 100) * percentile + 99) / 100; // rank of the percentile value
+  if (!rank) rank = 1;
+  for (byte bucket = 0; bucket < KNX_LATENCY_BUCKETS_NB; bucket++)
+  {
+    cumulated += _counts[bucket];
+    if (cumulated >= rank) return GetBucketLimit(bucket);
+  }
+  return GetBucketLimit(KNX_LATENCY_BUCKETS_NB - 1);
+}
+
+
+void KnxTxLatency::Record(const type_tx_latency_trace& trace, boolean txEndKnown, unsigned long txEndMicros,
+                          unsigned long ackMicros)
+{
+  byte priority = trace.priority >> 2;
+
+  _stages[KNX_TX_STAGE_QUEUE][priority].Add(trace.dequeuedMicros - trace.queuedMicros);
+  _stages[KNX_TX_STAGE_PREPARE][priority].Add(trace.handoffMicros - trace.dequeuedMicros);
+  // the time of the last byte written shall be the one of this transmission
+  if (txEndKnown && ((long)(txEndMicros - trace.handoffMicros) >= 0) && ((long)(ackMicros - txEndMicros) >= 0))
+  {
+    _stages[KNX_TX_STAGE_FEED][priority].Add(txEndMicros - trace.handoffMicros);
+    _stages[KNX_TX_STAGE_CONFIRM][priority].Add(ackMicros - txEndMicros);
+  }
+  _stages[KNX_TX_STAGE_TOTAL][priority].Add(ackMicros - trace.queuedMicros);
+  if (trace.objectIndex < KNX_TX_LATENCY_OBJECTS_NB) _objects[trace.objectIndex].Add(ackMicros - trace.queuedMicros);
+}
+
+
+void KnxTxLatency::Clear(void)
+{
+  for (byte stage = 0; stage < KNX_TX_STAGES_NB; stage++)
+    for (byte priority = 0; priority < KNX_TX_LATENCY_PRIORITIES_NB; priority++) _stages[stage][priority].Clear();
+  for (byte i = 0; i < KNX_TX_LATENCY_OBJECTS_NB; i++) _objects[i].Clear();
+}
+
+// EOF
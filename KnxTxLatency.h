@@ -0,0 +1,130 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxTxLatency.h
+// Author : Franck Marini
+// Description : Latency histograms of the telegram transmissions, from the application request to the bus ACK
+//               Each transmission is split in stages :
+//               - QUEUE   : from the action queued (e.g. write()) to its dequeuing by the device task
+//               - PREPARE : from the dequeuing to the telegram handoff to the bus coupler (SendTelegram())
+//               - FEED    : from the handoff to the last telegram byte written to the bus coupler
+//               - CONFIRM : from the last byte written to the ACK callback
+//               - TOTAL   : from the action queued to the ACK callback
+//               The latencies are counted in fixed memory log-scale histograms (power of 2 buckets, from 128us to
+//               2s) per stage and priority, plus the TOTAL histograms of the first KNX_TX_LATENCY_OBJECTS_NB com objects.
+// Module dependencies : KnxTelegram
+
+#ifndef KNXTXLATENCY_H
+#define KNXTXLATENCY_H
+
+#include "Arduino.h"
+#include "KnxTelegram.h"
+
+// Histogram buckets : bucket 0 counts the latencies below 128us, bucket n those in [2^(n+6), 2^(n+7)) usec,
+// the last bucket those above 2^21 usec (2,1s)
+#define KNX_LATENCY_BUCKETS_NB         16
+#define KNX_LATENCY_FIRST_BUCKET_SHIFT 7
+
+// Nb of com objects (the first ones of the list) having their own TOTAL histogram
+#ifndef KNX_TX_LATENCY_OBJECTS_NB
+#define KNX_TX_LATENCY_OBJECTS_NB      8
+#endif
+
+#define KNX_TX_LATENCY_NO_OBJECT       255 // telegram built by the application
+#define KNX_TX_LATENCY_PRIORITIES_NB   4
+
+enum e_KnxTxLatencyStage {
+  KNX_TX_STAGE_QUEUE = 0,
+  KNX_TX_STAGE_PREPARE,
+  KNX_TX_STAGE_FEED,
+  KNX_TX_STAGE_CONFIRM,
+  KNX_TX_STAGE_TOTAL,
+  KNX_TX_STAGES_NB
+};
+
+// Time stamps of the transmission in progress (usec)
+typedef struct {
+  unsigned long queuedMicros;
+  unsigned long dequeuedMicros;
+  unsigned long handoffMicros;
+  byte objectIndex;       // KNX_TX_LATENCY_NO_OBJECT for a telegram built by the application
+  e_KnxPriority priority;
+} type_tx_latency_trace;
+
+
+class KnxLatencyHistogram {
+    unsigned long _counts[KNX_LATENCY_BUCKETS_NB];
+    unsigned long _totalNb;
+
+  public:
+    KnxLatencyHistogram() { Clear(); }
+
+    void Add(unsigned long latencyMicros);
+    void Clear(void);
+
+    // Latency (usec) below which "percentile" % of the latencies are, 0 when the histogram is empty
+    // NB : the upper limit of the bucket holding the percentile is returned, i.e. a value up to twice the real one
+    unsigned long GetPercentile(byte percentile) const;
+
+  // INLINED functions (see definitions later in this file)
+    unsigned long GetCount(void) const;
+    unsigned long GetBucketCount(byte bucket) const;
+    // Upper limit (excluded) of a bucket in usec, 0xFFFFFFFF for the last one
+    static unsigned long GetBucketLimit(byte bucket);
+};
+
+
+class KnxTxLatency {
+    KnxLatencyHistogram _stages[KNX_TX_STAGES_NB][KNX_TX_LATENCY_PRIORITIES_NB];
+    KnxLatencyHistogram _objects[KNX_TX_LATENCY_OBJECTS_NB];
+
+  public:
+    // Record an acknowledged transmission
+    // "txEndMicros" is the time of the last byte written to the bus coupler ("txEndKnown" false if not provided
+    // by the coupler, the FEED and CONFIRM stages are then not recorded)
+    void Record(const type_tx_latency_trace& trace, boolean txEndKnown, unsigned long txEndMicros, unsigned long ackMicros);
+
+    void Clear(void);
+
+  // INLINED functions (see definitions later in this file)
+    const KnxLatencyHistogram& GetStageHistogram(e_KnxTxLatencyStage stage, e_KnxPriority priority) const;
+    // return NULL if the com object has no TOTAL histogram
+    const KnxLatencyHistogram *GetObjectHistogram(byte objectIndex) const;
+};
+
+
+// --------------- Definition of the INLINED functions -----------------
+inline unsigned long KnxLatencyHistogram::GetCount(void) const { return _totalNb; }
+
+inline unsigned long KnxLatencyHistogram::GetBucketCount(byte bucket) const
+{ return (bucket < KNX_LATENCY_BUCKETS_NB) ? _counts[bucket] : 0; }
+
+inline unsigned long KnxLatencyHistogram::GetBucketLimit(byte bucket)
+{ return (bucket < KNX_LATENCY_BUCKETS_NB - 1) ? (1UL << (bucket + KNX_LATENCY_FIRST_BUCKET_SHIFT)) : 0xFFFFFFFF; }
+
+inline const KnxLatencyHistogram& KnxTxLatency::GetStageHistogram(e_KnxTxLatencyStage stage, e_KnxPriority priority) const
+{ return _stages[stage][priority >> 2]; }
+
+inline const KnxLatencyHistogram *KnxTxLatency::GetObjectHistogram(byte objectIndex) const
+{ return (objectIndex < KNX_TX_LATENCY_OBJECTS_NB) ? &_objects[objectIndex] : NULL; }
+
+#endif // KNXTXLATENCY_H
+
+// EOF
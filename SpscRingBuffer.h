@@ -0,0 +1,88 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : SpscRingBuffer.h
+// Author : Franck Marini
+// Description : Lock-free ring buffer with a single producer and a single consumer
+//               The producer and the consumer may run in different threads (or the producer in an interrupt) : the
+//               producer only writes the tail index and the consumer only writes the head index, each index is
+//               published with release semantics after the elements are written/read.
+//               Unlike ActionRingBuffer, a full buffer rejects the new element (the producer can not drop the oldest
+//               one without racing with the consumer).
+// Module dependencies : none
+
+#ifndef SPSCRINGBUFFER_H
+#define SPSCRINGBUFFER_H
+
+#include "Arduino.h"
+
+// The type of the contained elements and the ring buffer size are defined at compile time (template)
+// The size shall be a power of 2, up to 128 (the byte indexes are free running, hence atomic on every target)
+template<typename T, byte size>
+class SpscRingBuffer {
+     byte _head;          // next element to read, written by the consumer only
+     byte _tail;          // next element to write, written by the producer only
+     T _buffer[size];     // elements buffer
+
+  public :
+
+    SpscRingBuffer() : _head(0), _tail(0)
+    { static_assert((size > 0) && (size <= 128) && !(size & (size - 1)), "size shall be a power of 2 up to 128"); }
+
+
+    // --- Producer side ---
+
+    // Append an element, return false when the buffer is full (the element is not stored)
+    boolean Push(const T& element)
+    {
+      byte tail = _tail;
+      if ((byte)(tail - __atomic_load_n(&_head, __ATOMIC_ACQUIRE)) == size) return false;
+      _buffer[tail & (size - 1)] = element;
+      __atomic_store_n(&_tail, (byte)(tail + 1), __ATOMIC_RELEASE);
+      return true;
+    }
+
+
+    // --- Consumer side ---
+
+    // Pop the oldest element, return false when the buffer is empty
+    boolean Pop(T& element) { return (PopBatch(&element, 1) == 1); }
+
+
+    // Pop up to "maxNb" elements (oldest first), return the nb of popped elements
+    word PopBatch(T elements[], word maxNb)
+    {
+      byte head = _head;
+      byte nb = __atomic_load_n(&_tail, __ATOMIC_ACQUIRE) - head;
+      if (nb > maxNb) nb = maxNb;
+      for (byte i = 0; i < nb; i++) elements[i] = _buffer[(byte)(head + i) & (size - 1)];
+      __atomic_store_n(&_head, (byte)(head + nb), __ATOMIC_RELEASE);
+      return nb;
+    }
+
+
+    // Return the current number of elements (a snapshot when called by the producer or by the consumer)
+    byte ElementsNb(void) const
+    { return __atomic_load_n(&_tail, __ATOMIC_ACQUIRE) - __atomic_load_n(&_head, __ATOMIC_ACQUIRE); }
+};
+
+#endif // SPSCRINGBUFFER_H
+
+// EOF
@@ -20,7 +20,7 @@
 // File : StKnxCoupler.cpp
 // Author : Franz Auernigg
 // Description : Communication with StKnxCoupler Chip
-// Module dependencies : KnxTelegram, KnxComObject
+// Module dependencies : KnxTelegram, KnxComObject, KnxComObjectTable
 
 #include "StKnxCoupler.h"
 
@@ -34,6 +34,7 @@ StKnxCoupler::StKnxCoupler(type_TransmitCallbackFctPtr cb, word physicalAddr,
 {
   _rx.state = RX_RESET;
   _rx.addressedComObjectIndex = 0;
+  _rx.overflowsNb = 0;
   _tx.state = TX_RESET;
   _tx.sentTelegram = NULL;
   _tx.ackFctPtr = NULL;
@@ -41,12 +42,9 @@ StKnxCoupler::StKnxCoupler(type_TransmitCallbackFctPtr cb, word physicalAddr,
   _tx.txByteIndex = 0;
   _stateIndication = 0;
   _evtCallbackFct = NULL;
-  _comObjectsList = NULL;
-  _assignedComObjectsNb = 0;
-  _orderedIndexTable = NULL;
   _stateIndication = 0;
 #if defined(KNXTPUART_DEBUG_INFO) || defined(KNXTPUART_DEBUG_ERROR)
-  _debugStrPtr = NULL;
+  _traceRing = NULL;
 #endif
 }
 
@@ -54,16 +52,15 @@ StKnxCoupler::StKnxCoupler(type_TransmitCallbackFctPtr cb, word physicalAddr,
 // Destructor
 StKnxCoupler::~StKnxCoupler()
 {
-  if (_orderedIndexTable) free(_orderedIndexTable);
   // close the serial communication if opened
   if ( (_rx.state > RX_RESET) || (_tx.state > TX_RESET) )
   {
 #if defined(KNXTPUART_DEBUG_INFO)
-    DebugInfo("Destructor: connection closed, byebye\n");
+    DebugInfo(KNX_TRACE_COUPLER_CLOSED);
 #endif
   }
 #if defined(KNXTPUART_DEBUG_INFO)
-  else DebugInfo("Desctructor: byebye\n");
+  else DebugInfo(KNX_TRACE_COUPLER_DESTROYED);
 #endif
 }
 
@@ -80,7 +77,13 @@ byte StKnxCoupler::Reset(void)
 
 byte StKnxCoupler::AttachComObjectsList(KnxComObject comObjectsList[], byte listSize)
 {
-  return AttachComObjectsList(&comObjectsList, listSize);
+  if ((_rx.state!=RX_INIT) || (_tx.state!=TX_INIT)) return KNX_BUSCOUPLER_ERROR_NOT_INIT_STATE;
+#if defined(KNXTPUART_DEBUG_INFO)
+  _comObjects.Attach(comObjectsList, listSize, _traceRing);
+#else
+  _comObjects.Attach(comObjectsList, listSize);
+#endif
+  return KNX_BUSCOUPLER_OK;
 }
 
 // Attach a list of com objects
@@ -90,74 +93,11 @@ byte StKnxCoupler::AttachComObjectsList(KnxComObject comObjectsList[], byte list
 // The function must be called prior to Init() execution
 byte StKnxCoupler::AttachComObjectsList(KnxComObject** comObjectsList, byte listSize)
 {
-#define IS_COM(index) (comObjectsList[index]->GetIndicator() & KNX_COM_OBJ_C_INDICATOR)
-#define ADDR(index) (comObjectsList[index]->GetAddr())
-
   if ((_rx.state!=RX_INIT) || (_tx.state!=TX_INIT)) return KNX_BUSCOUPLER_ERROR_NOT_INIT_STATE;
-
-  if (_orderedIndexTable)
-  {  // a list is already attached, we detach it
-    free(_orderedIndexTable);
-    _orderedIndexTable = NULL;
-    _comObjectsList = NULL;
-    _assignedComObjectsNb = 0;
-  }
-  if ((!comObjectsList) || (!listSize))
-  {
-#if defined(KNXTPUART_DEBUG_INFO)
-    DebugInfo("AttachComObjectsList : warning : empty object list!\n");
-#endif
-    return  KNX_BUSCOUPLER_OK;
-  }
-  // Count all the com objects with communication indicator
-  for (byte i=0; i < listSize ; i++) if (IS_COM(i)) _assignedComObjectsNb++;
-  if (!_assignedComObjectsNb)
-  {
-#if defined(KNXTPUART_DEBUG_INFO)
-    DebugInfo("AttachComObjectsList : warning : no object with com attribute in the list!\n");
-#endif
-    return  KNX_BUSCOUPLER_OK;
-  }
-  // Deduct the duplicate addresses
-  for (byte i=0; i < listSize ; i++)
-  {
-    if (!IS_COM(i)) continue;
-    for (byte j=0; j < listSize ; j++)
-    {
-      if ( (i!=j) && (ADDR(j) == ADDR(i)) && (IS_COM(j)) )
-      { // duplicate address found
-        if (j<i) break; // duplicate address already treated
-        else
-        {
-          _assignedComObjectsNb--;
-#if defined(KNXTPUART_DEBUG_INFO)
-          DebugInfo("AttachComObjectsList : warning : duplicate address found!\n");
-#endif
-        }
-      }
-    }
-  }
-  _comObjectsList = comObjectsList;
-  // Creation of the ordered index table
-  _orderedIndexTable = (byte*) malloc(_assignedComObjectsNb);
-  memset(_orderedIndexTable, 255, _assignedComObjectsNb);
-  word minMin = 0x0000;   // minimum min value searched
-  word foundMin = 0xFFFF; // min value found so far
-  for (byte i=0; i < _assignedComObjectsNb; i++)
-  {
-    for (byte j=0; j < listSize ; j++)
-    {
-      if ( (IS_COM(j)) && (ADDR(j)>=minMin) && (ADDR(j)<=foundMin) )
-      {
-        foundMin = ADDR(j);
-        _orderedIndexTable[i] = j;
-      }
-    }
-    minMin = foundMin + 1;
-    foundMin = 0xFFFF;
-  }
 #if defined(KNXTPUART_DEBUG_INFO)
-  DebugInfo("AttachComObjectsList successful\n");
+  _comObjects.Attach(comObjectsList, listSize, _traceRing);
+#else
+  _comObjects.Attach(comObjectsList, listSize);
 #endif
   return KNX_BUSCOUPLER_OK;
 }
@@ -207,7 +147,7 @@ static word lastByteRxTimeMicrosec;
 
 void StKnxCoupler::SetReceivedTelegram(KnxTelegram &rxTelegram)
 {
-    if (IsAddressAssigned(rxTelegram.GetTargetAddress(), addressedComObjectIndex))
+    if (_comObjects.IsAddressAssigned(rxTelegram.GetTargetAddress(), addressedComObjectIndex))
     { // Message addressed to us
       //rxTelegram.Copy(telegram);
       //_rx.state = RX_EIB_TELEGRAM_RECEPTION_ADDRESSED;
@@ -216,6 +156,7 @@ void StKnxCoupler::SetReceivedTelegram(KnxTelegram &rxTelegram)
         { // checksum correct, let's update the _rx struct with the received telegram and correct index
           rxTelegram.Copy(_rx.receivedTelegram);
           _rx.addressedComObjectIndex  = addressedComObjectIndex;
+          QueueReceivedTelegram(_rx, rxTelegram, addressedComObjectIndex, KnxMicros());
           _evtCallbackFct(BUSCOUPLER_EVENT_RECEIVED_EIB_TELEGRAM); // Notify the new received telegram
 
           _rx.state = RX_IDLE_WAITING_FOR_CTRL_FIELD;
@@ -240,6 +181,7 @@ void StKnxCoupler::RXTask(void)
         { // checksum correct, let's update the _rx struct with the received telegram and correct index
           telegram.Copy(_rx.receivedTelegram);
           _rx.addressedComObjectIndex  = addressedComObjectIndex;
+          QueueReceivedTelegram(_rx, telegram, addressedComObjectIndex, KnxMicros());
           _evtCallbackFct(BUSCOUPLER_EVENT_RECEIVED_EIB_TELEGRAM); // Notify the new received telegram
 
           _rx.state = RX_IDLE_WAITING_FOR_CTRL_FIELD;
@@ -253,7 +195,7 @@ void StKnxCoupler::RXTask(void)
 // === STEP 1 : Check EOP in case a Telegram is being received ===
   if (_rx.state >= RX_EIB_TELEGRAM_RECEPTION_STARTED)
   { // a telegram reception is ongoing
-    nowTime = (word) micros(); // word cast because a 65ms looping counter is long enough
+    nowTime = (word) KnxMicros(); // word cast because a 65ms looping counter is long enough
     if(TimeDeltaWord(nowTime,lastByteRxTimeMicrosec) > 2000 /* 2 ms */ )
     { // EOP detected, the telegram reception is completed
 
@@ -269,6 +211,7 @@ void StKnxCoupler::RXTask(void)
           { // checksum correct, let's update the _rx struct with the received telegram and correct index
         	telegram.Copy(_rx.receivedTelegram);
             _rx.addressedComObjectIndex  = addressedComObjectIndex;
+            QueueReceivedTelegram(_rx, telegram, addressedComObjectIndex, KnxMicros());
             _evtCallbackFct(BUSCOUPLER_EVENT_RECEIVED_EIB_TELEGRAM); // Notify the new received telegram
           }
           else
@@ -315,7 +258,7 @@ void StKnxCoupler::TXTask(void)
   {
   case TX_WAITING_ACK :
     // A transmission ACK is awaited, increment Acknowledge timeout
-    nowTime = (word) millis(); // word is enough to count up to 500
+    nowTime = (word) KnxMillis(); // word is enough to count up to 500
     if(TimeDeltaWord(nowTime,sentMessageTimeMillisec) > 500 /* 500 ms */ )
     { // The no-answer timeout value is defined as follows :
       // - The emission duration for a single max sized telegram is 40ms
@@ -340,7 +283,7 @@ void StKnxCoupler::TXTask(void)
         {
 
           // Message sending completed
-          sentMessageTimeMillisec = (word)millis(); // memorize sending time in order to manage ACK timeout
+          sentMessageTimeMillisec = (word)KnxMillis(); // memorize sending time in order to manage ACK timeout
 	        _tx.state = TX_WAITING_ACK;
         }
         else
@@ -363,50 +306,7 @@ void StKnxCoupler::TXTask(void)
 // Typical calling period is 400 usec.
 boolean StKnxCoupler::GetMonitoringData(type_MonitorData& data)
 {
-  return true;
-}
-
-
-// Check if the target address is an assigned com object one
-// if yes, then update index parameter with the index (in the list) of the targeted com object and return true
-// else return false
-boolean StKnxCoupler::IsAddressAssigned(word addr, byte &index) const
-{
-byte divisionCounter=0;
-byte i, searchIndexStart, searchIndexStop, searchIndexRange;
-
-  if (!_assignedComObjectsNb) return false; // in case of empty list, we return immediately
-
-  // Define how many divisions by 2 shall be done in order to reduce the search list by 8 Addr max
-  // if _assignedComObjectsNb >= 16 => divisionCounter = 1
-  // if _assignedComObjectsNb >= 32 => divisionCounter = 2
-  // if _assignedComObjectsNb >= 64 => divisionCounter = 3
-  // if _assignedComObjectsNb >= 128 => divisionCounter = 4
-  for (i=4; _assignedComObjectsNb >>i ; i++) divisionCounter++;
-
-  // the starting point is to search on the whole address range (0 -> _assignedComObjectsNb -1)
-  searchIndexStart = 0; searchIndexStop = _assignedComObjectsNb - 1; searchIndexRange = _assignedComObjectsNb;
-
-  // reduce the address range if needed
-  while(divisionCounter)
-  {
-    searchIndexRange>>=1; // Divide range width by 2
-    if (_orderedIndexTable[searchIndexStart+searchIndexRange]!=255
-    && addr >= _comObjectsList[_orderedIndexTable[searchIndexStart+searchIndexRange]]->GetAddr())
-      searchIndexStart += searchIndexRange ;
-    else searchIndexStop-=searchIndexRange;
-    divisionCounter --;
-  }
-
-  // search the address value and index in the reduced range
-  for (i = searchIndexStart;
-      (_orderedIndexTable[i]!=255 && _orderedIndexTable[i]<=_assignedComObjectsNb &&
-      _comObjectsList[_orderedIndexTable[i]]->GetAddr() != addr && i <= searchIndexStop);
-      i++);
-  if (i > searchIndexStop) return false; // Address is NOT part of the assigned addresses
-  // Address is part of the assigned addresses
-  index = _orderedIndexTable[i];
-  return true;
+  return false; // no bus monitoring with the external transmit callback
 }
 
 
@@ -20,7 +20,7 @@
 // File : StKnxCoupler.h
 // Author : Franz Auernigg
 // Description : Communication with StKnxCoupler Chip
-// Module dependencies : KnxTelegram, KnxComObject
+// Module dependencies : KnxTelegram, KnxComObject, KnxComObjectTable
 
 // This library supports both TPUART version 1 and 2
 // The Siemens KNX TPUART version 1 datasheet is available at :
@@ -34,6 +34,7 @@
 #include "Arduino.h"
 #include "KnxTelegram.h"
 #include "KnxComObject.h"
+#include "KnxComObjectTable.h"
 #include "KnxBusCoupler.h"
 
 // !!!!!!!!!!!!!!! FLAG OPTIONS !!!!!!!!!!!!!!!!!
@@ -49,20 +50,11 @@ class StKnxCoupler : public KnxBusCoupler {
     type_buscoupler_rx _rx;                   // Reception structure
     type_buscoupler_tx _tx;                   // Transmission structure
     type_EventCallbackFctPtr _evtCallbackFct; // Pointer to the EVENTS callback function
-    KnxComObject **_comObjectsList;           // Attached list of com objects
-    byte _assignedComObjectsNb;               // Nb of assigned com objects
-    byte *_orderedIndexTable;                 // Table containing the assigned com objects indexes ordered by increasing @
+    KnxComObjectTable _comObjects;            // Attached com objects, ordered by address
     byte _stateIndication;                    // Value of the last received state indication
 
 #if defined(KNXTPUART_DEBUG_INFO) || defined(KNXTPUART_DEBUG_ERROR)
-    String *_debugStrPtr;
-#endif
-
-#ifdef KNXTPUART_DEBUG_INFO
-static const char _debugInfoText[];
-#endif
-#ifdef KNXTPUART_DEBUG_ERROR
-static const char _debugErrorText[];
+    KnxTraceRing *_traceRing;                 // Ring of the debug traces (NULL if not traced)
 #endif
 
   public:
@@ -106,9 +98,21 @@ static const char _debugErrorText[];
     // false when there's no activity or when the tpuart is not initialized
     boolean IsActive(void) const;
 
+    // Return true while a telegram is being sent or waits for its ACK
+    boolean IsTxBusy(void) const;
+
+    // Pop the oldest telegram from the RX queue
+    // return false when no received telegram is pending
+    // NB : every telegram added in the queue is notified by a "BUSCOUPLER_EVENT_RECEIVED_EIB_TELEGRAM" event
+    boolean PopReceivedTelegram(type_buscoupler_rx_telegram&);
+
+    // Get the nb of received telegrams lost because of RX queue overflow
+    word GetRxOverflowsNb(void) const;
+
 #if defined(KNXTPUART_DEBUG_INFO) || defined(KNXTPUART_DEBUG_ERROR)
-    // Set the string used for debug traces
-    void SetDebugString(String *strPtr);
+    // Set the ring recording the debug traces
+    // NB : the ring is not owned by the bus coupler object
+    void SetTraceRing(KnxTraceRing *traceRing);
 #endif
 
   // Functions NOT INLINED
@@ -165,17 +169,13 @@ static const char _debugErrorText[];
   private:
   // Private INLINED functions (see definitions later in this file)
 #if defined(KNXTPUART_DEBUG_INFO)
-    void DebugInfo(const char[]) const;
+    void DebugInfo(e_KnxTraceEvent event, word arg0 = 0) const;
 #endif
 #if defined(KNXTPUART_DEBUG_ERROR)
-    void DebugError(const char[]) const;
+    void DebugError(e_KnxTraceEvent event, word arg0 = 0) const;
 #endif
 
   // Private NOT INLINED functions
-    // Check if the target address points to an assigned com object (i.e. the target address equals a com object address)
-    // if yes, then update index parameter with the index (in the list) of the targeted com object and return true
-    // else return false
-    boolean IsAddressAssigned(word addr, byte &index) const;
 };
 
 
@@ -215,26 +215,33 @@ inline boolean StKnxCoupler::IsActive(void) const
 }
 
 
+inline boolean StKnxCoupler::IsTxBusy(void) const { return (_tx.state != TX_IDLE); }
+
+
+inline boolean StKnxCoupler::PopReceivedTelegram(type_buscoupler_rx_telegram& rxTelegram)
+{ return _rx.queue.Pop(rxTelegram); }
+
+
+inline word StKnxCoupler::GetRxOverflowsNb(void) const { return _rx.overflowsNb; }
+
+
 #if defined(KNXTPUART_DEBUG_INFO) || defined(KNXTPUART_DEBUG_ERROR)
-inline void StKnxCoupler::SetDebugString(String *strPtr)
-{
-   _debugStrPtr = strPtr;
-}
+inline void StKnxCoupler::SetTraceRing(KnxTraceRing *traceRing) { _traceRing = traceRing; }
 #endif
 
 
 #if defined(KNXTPUART_DEBUG_INFO)
-inline void StKnxCoupler::DebugInfo(const char comment[]) const
+inline void StKnxCoupler::DebugInfo(e_KnxTraceEvent event, word arg0) const
 {
-  if (_debugStrPtr != NULL) *_debugStrPtr += String(_debugInfoText) + String(comment);
+  if (_traceRing != NULL) _traceRing->Record(event, arg0);
 }
 #endif
 
 
 #if defined(KNXTPUART_DEBUG_ERROR)
-inline void StKnxCoupler::DebugError(const char comment[]) const
+inline void StKnxCoupler::DebugError(e_KnxTraceEvent event, word arg0) const
 {
-  if (_debugStrPtr != NULL) *_debugStrPtr += String(_debugErrorText) + String(comment);
+  if (_traceRing != NULL) _traceRing->Record(event, arg0);
 }
 #endif
 
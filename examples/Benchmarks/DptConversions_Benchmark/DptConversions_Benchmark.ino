@@ -0,0 +1,95 @@
+
+// Benchmark of the DPT Format <=> C type conversions :
+// per value conversion (ConvertFromDpt/ConvertToDpt called in a loop) versus bulk conversion (ConvertFromDptArray/ConvertToDptArray)
+// The results are printed in values per second
+
+#include <KnxDevice.h>
+
+#define VALUES_NB 256   // Nb of values converted per run
+#define RUNS_NB    20   // Nb of runs per measurement
+
+byte dptValues[VALUES_NB * 4]; // DPT values packed one after the other (4 bytes max per value)
+long longValues[VALUES_NB];
+float floatValues[VALUES_NB];
+
+
+void PrintResult(const char *label, unsigned long elapsedMicros)
+{
+  Serial.print(label);
+  if (!elapsedMicros) elapsedMicros = 1;
+  Serial.print((unsigned long)(((float)VALUES_NB * RUNS_NB * 1000000.0) / elapsedMicros)); Serial.println(" values/s");
+}
+
+
+// Decode VALUES_NB DPT values of the given format and length, one call per value then one single bulk call
+template <typename T> void DecodeBenchmark(const char *name, byte dptFormat, byte dptLength, T values[])
+{
+  unsigned long startTime, scalarTime, bulkTime;
+
+  startTime = micros();
+  for (int run = 0; run < RUNS_NB; run++)
+    for (int i = 0; i < VALUES_NB; i++) ConvertFromDpt(&dptValues[i*dptLength], values[i], dptFormat);
+  scalarTime = micros() - startTime;
+
+  startTime = micros();
+  for (int run = 0; run < RUNS_NB; run++) ConvertFromDptArray(dptValues, values, VALUES_NB, dptFormat);
+  bulkTime = micros() - startTime;
+
+  Serial.print(F("*** DECODE ")); Serial.println(name);
+  PrintResult("  scalar : ", scalarTime);
+  PrintResult("  bulk   : ", bulkTime);
+}
+
+
+// Encode VALUES_NB C values into the given DPT format, one call per value then one single bulk call
+template <typename T> void EncodeBenchmark(const char *name, byte dptFormat, byte dptLength, const T values[])
+{
+  unsigned long startTime, scalarTime, bulkTime;
+
+  startTime = micros();
+  for (int run = 0; run < RUNS_NB; run++)
+    for (int i = 0; i < VALUES_NB; i++) ConvertToDpt(values[i], &dptValues[i*dptLength], dptFormat);
+  scalarTime = micros() - startTime;
+
+  startTime = micros();
+  for (int run = 0; run < RUNS_NB; run++) ConvertToDptArray(values, dptValues, VALUES_NB, dptFormat);
+  bulkTime = micros() - startTime;
+
+  Serial.print(F("*** ENCODE ")); Serial.println(name);
+  PrintResult("  scalar : ", scalarTime);
+  PrintResult("  bulk   : ", bulkTime);
+}
+
+
+void setup()
+{
+  Serial.begin(115200);
+}
+
+
+void loop()
+{
+  // pseudo random DPT content
+  for (int i = 0; i < VALUES_NB * 4; i++) dptValues[i] = (byte)(i * 37 + 11);
+
+  Serial.println(F("\n******************************************************************"));
+  Serial.println(F("************* BENCHMARK DPT CONVERSIONS (values/s) ***************"));
+  Serial.println(F("******************************************************************"));
+
+  DecodeBenchmark("U16 => long", KNX_DPT_FORMAT_U16, 2, longValues);
+  DecodeBenchmark("V16 => long", KNX_DPT_FORMAT_V16, 2, longValues);
+  DecodeBenchmark("U32 => long", KNX_DPT_FORMAT_U32, 4, longValues);
+  DecodeBenchmark("V32 => long", KNX_DPT_FORMAT_V32, 4, longValues);
+  DecodeBenchmark("F16 => float", KNX_DPT_FORMAT_F16, 2, floatValues);
+  DecodeBenchmark("B24 => long", KNX_DPT_FORMAT_B24, 3, longValues);
+
+  for (int i = 0; i < VALUES_NB; i++) { longValues[i] = (long)i * 1234 - 100000; floatValues[i] = i * 12.34 - 1000.0; }
+
+  EncodeBenchmark("long => U16", KNX_DPT_FORMAT_U16, 2, longValues);
+  EncodeBenchmark("long => V16", KNX_DPT_FORMAT_V16, 2, longValues);
+  EncodeBenchmark("long => U32", KNX_DPT_FORMAT_U32, 4, longValues);
+  EncodeBenchmark("long => V32", KNX_DPT_FORMAT_V32, 4, longValues);
+  EncodeBenchmark("float => F16", KNX_DPT_FORMAT_F16, 2, floatValues);
+
+  while(1); // Stop here
+}
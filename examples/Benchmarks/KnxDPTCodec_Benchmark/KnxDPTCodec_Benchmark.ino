@@ -0,0 +1,57 @@
+
+// Benchmark of the table driven DPT codec (KnxDPTCodec)
+// For each DPT format, the decoding and encoding throughputs are printed in values per second
+
+#include <KnxDevice.h>
+
+#define FORMATS_NB (KNX_DPT_FORMAT_A8A8 + 1)
+#define VALUES_NB 64  // Nb of different values per format
+#define RUNS_NB   20  // Nb of runs per measurement
+
+byte dptValues[VALUES_NB][16];
+long fields[KNX_DPT_FIELDS_MAX_NB];
+
+
+void PrintRate(unsigned long elapsedMicros)
+{
+  if (!elapsedMicros) elapsedMicros = 1;
+  Serial.print((unsigned long)(((float)VALUES_NB * RUNS_NB * 1000000.0) / elapsedMicros));
+}
+
+
+void setup()
+{
+  Serial.begin(115200);
+}
+
+
+void loop()
+{
+  unsigned long startTime, decodeTime, encodeTime;
+
+  for (int i = 0; i < VALUES_NB; i++)
+    for (int j = 0; j < 16; j++) dptValues[i][j] = (byte) random(256);
+
+  Serial.println(F("\n******************************************************************"));
+  Serial.println(F("********** BENCHMARK DPT CODEC (values/s per format) *************"));
+  Serial.println(F("******************************************************************"));
+  Serial.println(F("format;fields;decode;encode"));
+
+  for (byte format = 0; format < FORMATS_NB; format++)
+  {
+    startTime = micros();
+    for (int run = 0; run < RUNS_NB; run++)
+      for (int i = 0; i < VALUES_NB; i++) KnxDptDecode(dptValues[i], format, fields);
+    decodeTime = micros() - startTime;
+
+    startTime = micros();
+    for (int run = 0; run < RUNS_NB; run++)
+      for (int i = 0; i < VALUES_NB; i++) KnxDptEncode(fields, format, dptValues[i]);
+    encodeTime = micros() - startTime;
+
+    Serial.print(format); Serial.print(";"); Serial.print(KnxDptFieldsNb(format)); Serial.print(";");
+    PrintRate(decodeTime); Serial.print(";"); PrintRate(encodeTime); Serial.println();
+  }
+
+  while(1); // Stop here
+}
@@ -0,0 +1,182 @@
+
+// Test of the table driven DPT codec (KnxDPTCodec)
+// - round trip tests (decode => encode => decode) on all the DPT formats
+// - encoding tests with known DPT values (F16, F32, time of day, date, color, scene control)
+// - decoding test of a known DPT 19.001 date time value
+
+#include <KnxDevice.h>
+
+#define FORMATS_NB (KNX_DPT_FORMAT_A8A8 + 1)
+#define ROUND_TRIPS_NB 200 // nb of random values tested per format
+
+word errorsNb;
+
+
+void Check(const char *label, boolean result)
+{
+  Serial.print(label); Serial.println(result ? F(" : OK") : F(" : FAILED !!"));
+  if (!result) errorsNb++;
+}
+
+
+boolean CheckBytes(const char *label, const byte dpt[], const byte expected[], byte length)
+{
+  boolean result = !memcmp(dpt, expected, length);
+  if (!result)
+  {
+    Serial.print(label); Serial.print(F(" dpt=")); for (byte i = 0; i < length; i++) { Serial.print(dpt[i], HEX); Serial.print(" "); }
+    Serial.println();
+  }
+  Check(label, result);
+  return result;
+}
+
+
+void RoundTripTests(void)
+{
+  byte dpt[16], dptEncoded[16], dptReencoded[16];
+  long fields[KNX_DPT_FIELDS_MAX_NB], fieldsDecoded[KNX_DPT_FIELDS_MAX_NB];
+  word failedNb = 0;
+
+  Serial.println(F("\n*********** ROUND TRIP TESTS (all formats) ***********"));
+  for (byte format = 0; format < FORMATS_NB; format++)
+  {
+    byte fieldsNb = KnxDptFieldsNb(format);
+    byte length = KnxDptLength(format);
+    if ((!fieldsNb) || (fieldsNb > KNX_DPT_FIELDS_MAX_NB) || (!length))
+    {
+      Serial.print(F("Format ")); Serial.print(format); Serial.println(F(" : no layout !!"));
+      failedNb++; continue;
+    }
+    for (word t = 0; t < ROUND_TRIPS_NB; t++)
+    {
+      for (byte i = 0; i < length; i++) dpt[i] = (byte) random(256);
+      KnxDptDecode(dpt, format, fields);
+      KnxDptEncode(fields, format, dptEncoded);
+      KnxDptDecode(dptEncoded, format, fieldsDecoded);
+      KnxDptEncode(fieldsDecoded, format, dptReencoded);
+      if (memcmp(fields, fieldsDecoded, fieldsNb * sizeof(long)) || memcmp(dptEncoded, dptReencoded, length))
+      {
+        Serial.print(F("Format ")); Serial.print(format); Serial.println(F(" : round trip error !!"));
+        failedNb++; break;
+      }
+    }
+  }
+  Check("Round trips", !failedNb);
+  Check("Unknown format", (KnxDptDecode(dpt, FORMATS_NB, fields) == KNX_DPT_CODEC_ERROR) && !KnxDptFieldsNb(FORMATS_NB));
+}
+
+
+void FloatTests(void)
+{
+  byte dpt[6];
+  float value;
+
+  Serial.println(F("\n*********** FLOAT TESTS ***********"));
+  const byte f32Expected[4] = { 0x41, 0xAC, 0x00, 0x00 }; // 21.5
+  ConvertToDpt((float)21.5, dpt, KNX_DPT_FORMAT_F32);
+  CheckBytes("float 21.5 => F32", dpt, f32Expected, 4);
+  Check("F32 => float", (ConvertFromDpt(dpt, value, KNX_DPT_FORMAT_F32) == KNX_DEVICE_OK) && (value == (float)21.5));
+
+  const byte f16Expected[2] = { 0x0C, 0x33 }; // 21.5 = 0.01 * 1075 * 2^1
+  ConvertToDpt((float)21.5, dpt, KNX_DPT_FORMAT_F16);
+  CheckBytes("float 21.5 => F16", dpt, f16Expected, 2);
+  Check("F16 => float", KnxDptDecodeF16(dpt) == (float)21.5);
+
+  float fields[3] = { -12.5, 0.0, 20.5 };
+  float decoded[3];
+  KnxDptEncode(fields, KNX_DPT_FORMAT_F16F16F16, dpt);
+  KnxDptDecode(dpt, KNX_DPT_FORMAT_F16F16F16, decoded);
+  Check("F16F16F16 round trip", (decoded[0] == (float)-12.5) && (decoded[1] == 0) && (decoded[2] == (float)20.5));
+}
+
+
+void TimeDateColorTests(void)
+{
+  byte dpt[3];
+
+  Serial.println(F("\n*********** TIME / DATE / COLOR TESTS ***********"));
+  type_KnxTimeOfDay time = { 4, 13, 30, 45 }, timeDecoded; // Thursday 13:30:45
+  const byte timeExpected[3] = { 0x8D, 0x1E, 0x2D };
+  KnxDptEncodeTimeOfDay(time, dpt);
+  CheckBytes("Time => DPT 10.001", dpt, timeExpected, 3);
+  KnxDptDecodeTimeOfDay(dpt, timeDecoded);
+  Check("DPT 10.001 => Time", (timeDecoded.weekDay == 4) && (timeDecoded.hour == 13) && (timeDecoded.minute == 30) && (timeDecoded.second == 45));
+  time.hour = 24;
+  Check("Invalid time", KnxDptEncodeTimeOfDay(time, dpt) == KNX_DPT_CODEC_ERROR);
+
+  type_KnxDate date = { 18, 10, 2026 }, dateDecoded;
+  const byte dateExpected[3] = { 0x12, 0x0A, 0x1A };
+  KnxDptEncodeDate(date, dpt);
+  CheckBytes("Date => DPT 11.001", dpt, dateExpected, 3);
+  KnxDptDecodeDate(dpt, dateDecoded);
+  Check("DPT 11.001 => Date", (dateDecoded.day == 18) && (dateDecoded.month == 10) && (dateDecoded.year == 2026));
+  dpt[2] = 95;
+  KnxDptDecodeDate(dpt, dateDecoded);
+  Check("DPT 11.001 year 95 => 1995", dateDecoded.year == 1995);
+
+  type_KnxColorRGB color = { 0x12, 0x34, 0x56 }, colorDecoded;
+  const byte colorExpected[3] = { 0x12, 0x34, 0x56 };
+  KnxDptEncodeColorRGB(color, dpt);
+  CheckBytes("Color => DPT 232.600", dpt, colorExpected, 3);
+  KnxDptDecodeColorRGB(dpt, colorDecoded);
+  Check("DPT 232.600 => Color", (colorDecoded.red == 0x12) && (colorDecoded.green == 0x34) && (colorDecoded.blue == 0x56));
+}
+
+
+void DateTimeTests(void)
+{
+  long fields[KNX_DPT_FIELDS_MAX_NB];
+  byte dpt[8];
+
+  Serial.println(F("\n*********** DATE TIME (DPT 19.001) TESTS ***********"));
+  // Sunday 2026-10-18 13:30:45, flags 0x2080 (working day field not valid, clock with external sync)
+  const byte dateTime[8] = { 126, 0x0A, 0x12, 0xED, 0x1E, 0x2D, 0x20, 0x80 };
+  Check("DPT 19.001 length", KnxDptLength(KNX_DPT_FORMAT_U8R4U4R3U5U3U5R2U6B16) == 8);
+  KnxDptDecode(dateTime, KNX_DPT_FORMAT_U8R4U4R3U5U3U5R2U6B16, fields);
+  Check("DPT 19.001 => date", (fields[0] == 126) && (fields[1] == 10) && (fields[2] == 18));
+  Check("DPT 19.001 => time", (fields[3] == 7) && (fields[4] == 13) && (fields[5] == 30) && (fields[6] == 45));
+  Check("DPT 19.001 => flags", fields[7] == 0x2080);
+  KnxDptEncode(fields, KNX_DPT_FORMAT_U8R4U4R3U5U3U5R2U6B16, dpt);
+  CheckBytes("Date time => DPT 19.001", dpt, dateTime, 8);
+}
+
+
+void BitFieldsTests(void)
+{
+  byte dpt[2];
+  long fields[2];
+
+  Serial.println(F("\n*********** BIT FIELDS TESTS ***********"));
+  long scene[2] = { 1, 63 }; // learn scene 64
+  KnxDptEncode(scene, KNX_DPT_FORMAT_B1R1U6, dpt);
+  Check("Scene control => B1R1U6", dpt[0] == 0xBF);
+
+  dpt[0] = 0x0B; // dimming : increase, step code 3
+  KnxDptDecode(dpt, KNX_DPT_FORMAT_B1U3, fields);
+  Check("B1U3 => dimming", (fields[0] == 1) && (fields[1] == 3));
+
+  dpt[0] = 0xF0;
+  long v8;
+  ConvertFromDpt(dpt, v8, KNX_DPT_FORMAT_V8);
+  Check("V8 sign extension", v8 == -16);
+}
+
+
+void setup()
+{
+  Serial.begin(115200);
+}
+
+
+void loop()
+{
+  errorsNb = 0;
+  RoundTripTests();
+  FloatTests();
+  TimeDateColorTests();
+  DateTimeTests();
+  BitFieldsTests();
+  Serial.print(F("\n=> Errors nb : ")); Serial.println(errorsNb);
+  while(1); // Stop here
+}
@@ -14,7 +14,7 @@
 #include <Cli.h> // command line interpreter lib available at https://github.com/franckmarini/Cli
 
 Cli cli = Cli(Serial);
-String traces;
+KnxTraceRing traces;
 KnxComObject objList[] =
 {
   KnxComObject(0x0001, KNX_DPT_1_001 /* 1.001 B1 DPT_Switch */ , COM_OBJ_LOGIC_IN) , // Switch actuator command
@@ -26,10 +26,10 @@ e_TpUartTxAck ackVal;
 
 
 // WARNING : "KNXTPUART_DEBUG_INFO" and "KNXTPUART_DEBUG_ERROR" flags shall be set in order to get KnxTpUart traces
-void TracesDisplay() { Serial.print(traces); traces=""; }
+void TracesDisplay() { traces.Dump(Serial); }
 
 
-void PrintTelegramInfo(KnxTelegram& tg) { traces = " => Info() :\n"; tg.Info(traces); TracesDisplay(); }
+void PrintTelegramInfo(KnxTelegram& tg) { String info = " => Info() :\n"; tg.Info(info); Serial.print(info); }
 
 
 boolean Pulse400us(void)
@@ -120,7 +120,7 @@ void Reset_Tests(void)
     Serial.println(F("\n########## Reset Tests ##########"));
     Serial.println(F("Requesting Reset..."));    
     KnxTpUart tpuart(Serial1, 0x1234, NORMAL);
-    tpuart.SetDebugString(&traces);
+    tpuart.SetTraceRing(&traces);
     
     return_val = tpuart.Reset();
     TracesDisplay();
@@ -155,7 +155,7 @@ byte return_val;
     /* index 6 */ KnxComObject(0xFFFF, KNX_DPT_1_001 /* 1.001 B1 DPT_Switch */ , COM_OBJ_LOGIC_IN) ,
     };
     KnxTpUart tpuart(Serial1, 0x1234, NORMAL);
-    tpuart.SetDebugString(&traces);
+    tpuart.SetTraceRing(&traces);
     tpuart.Reset();
     return_val = tpuart.AttachComObjectsList(list,sizeof(list)/sizeof(KnxComObject));
     TracesDisplay();
@@ -189,9 +189,9 @@ byte return_val;
     /* index 6 */ KnxComObject(0x0000, KNX_DPT_1_001 /* 1.001 B1 DPT_Switch */ , COM_OBJ_LOGIC_IN) ,
     };
     KnxTpUart tpuart(Serial1, 0x1234, NORMAL);
-    tpuart.SetDebugString(&traces);
+    tpuart.SetTraceRing(&traces);
     tpuart.Reset();
-    tpuart.SetDebugString(&traces);
+    tpuart.SetTraceRing(&traces);
     return_val = tpuart.AttachComObjectsList(list,sizeof(list)/sizeof(KnxComObject));
     TracesDisplay();
     Serial.print(F("Attach return val = ")); Serial.println(return_val);
@@ -228,9 +228,9 @@ byte return_val;
     /* index 10*/ KnxComObject(0x0000, KNX_DPT_1_001 /* 1.001 B1 DPT_Switch */ , COM_OBJ_LOGIC_IN) , // duplicate @!!
     };
     KnxTpUart tpuart(Serial1, 0x1234, NORMAL);
-    tpuart.SetDebugString(&traces);
+    tpuart.SetTraceRing(&traces);
     tpuart.Reset();
-    tpuart.SetDebugString(&traces);
+    tpuart.SetTraceRing(&traces);
     return_val = tpuart.AttachComObjectsList(list,sizeof(list)/sizeof(KnxComObject));
     TracesDisplay();
     Serial.print(F("Attach return val = ")); Serial.println(return_val);
@@ -267,9 +267,9 @@ byte return_val;
     /* index 10*/ KnxComObject(0x0000, KNX_DPT_1_001 /* 1.001 B1 DPT_Switch */ , COM_OBJ_LOGIC_IN) , // duplicate @!!
     };
     KnxTpUart tpuart(Serial1, 0x1234, NORMAL);
-    tpuart.SetDebugString(&traces);
+    tpuart.SetTraceRing(&traces);
     tpuart.Reset();
-    tpuart.SetDebugString(&traces);
+    tpuart.SetTraceRing(&traces);
     return_val = tpuart.AttachComObjectsList(list,sizeof(list)/sizeof(KnxComObject));
     TracesDisplay();
     Serial.print(F("Attach return val = ")); Serial.println(return_val);
@@ -299,7 +299,7 @@ void Init_Tests(void)
     
   {
     KnxTpUart tpuart(Serial1, 0x1234, NORMAL);
-    tpuart.SetDebugString(&traces);
+    tpuart.SetTraceRing(&traces);
 
     Serial.println(F("### Testing NORMAL mode Init with error KNX_TPUART_ERROR_NOT_INIT_STATE (254)"));
     return_val = tpuart.Init();
@@ -338,11 +338,11 @@ void Init_Tests(void)
     TracesDisplay();
     Serial.print(F("Init return val = ")); Serial.println(return_val);
   }
-    Serial.print(traces); traces=""; // will show destructor traces      
+    TracesDisplay(); // will show destructor traces      
   {
     Serial.println(F("### Testing MONITOR mode"));
     KnxTpUart tpuart(Serial1, 0x1234, BUS_MONITOR);
-    tpuart.SetDebugString(&traces);
+    tpuart.SetTraceRing(&traces);
     Serial.println(F("Requesting Reset..."));
     tpuart.Reset();
     return_val = tpuart.Init();
@@ -357,7 +357,7 @@ void Bus_Monitoring(void)
   Serial.println(F("\n########## Bus Monitoring  ##########"));
   Serial.println(F("Press Enter to stop  the test..."));
   KnxTpUart tpuart(Serial1, 0x1234, BUS_MONITOR);
-  tpuart.SetDebugString(&traces);
+  tpuart.SetTraceRing(&traces);
   Serial.println(F("Requesting Reset..."));
   tpuart.Reset();
   tpuart.Init();
@@ -390,7 +390,7 @@ void Normal_Rx(void)
   Serial.println(F("Press Enter to stop  the test..."));
   KnxTpUart tpuart(Serial1, 0x1234, NORMAL);
   KnxTelegram &tg = tpuart.GetReceivedTelegram();
-  tpuart.SetDebugString(&traces);
+  tpuart.SetTraceRing(&traces);
   tpuart.Reset();
   tpuart.SetEvtCallback(eventCallback);
   tpuart.SetAckCallback(ackCallback);
@@ -420,7 +420,7 @@ void Normal_Rx_ResetEvt(void)
   Serial.println(F("\n########## Reset Event reception test  ##########"));
   KnxTpUart tpuart(Serial1, 0x1234, NORMAL);
   KnxTelegram &tg = tpuart.GetReceivedTelegram();
-  tpuart.SetDebugString(&traces);
+  tpuart.SetTraceRing(&traces);
   tpuart.Reset();
   tpuart.SetEvtCallback(eventCallback);
   tpuart.SetAckCallback(ackCallback);
@@ -448,7 +448,7 @@ void Normal_Rx_StateEvt(void)
   Serial.println(F("\n########## State Event reception test  ##########"));  
   KnxTpUart tpuart(Serial1, 0x1234, NORMAL);
   KnxTelegram &tg = tpuart.GetReceivedTelegram();
-  tpuart.SetDebugString(&traces);
+  tpuart.SetTraceRing(&traces);
   tpuart.Reset();
   tpuart.SetEvtCallback(eventCallback);
   tpuart.SetAckCallback(ackCallback);
@@ -475,7 +475,7 @@ void Normal_Tx_Val1(void)
 {
   Serial.println(F("\n########## Telegram Transmission Test (value 1)  ##########"));  
   KnxTpUart tpuart(Serial1, 0x1234, NORMAL);
-  tpuart.SetDebugString(&traces);
+  tpuart.SetTraceRing(&traces);
   tpuart.Reset();
   tpuart.SetEvtCallback(eventCallback);
   tpuart.SetAckCallback(ackCallback);
@@ -513,7 +513,7 @@ void Normal_Tx_Val0(void)
 {
   Serial.println(F("\n########## Telegram Transmission Test (value 0)  ##########"));  
   KnxTpUart tpuart(Serial1, 0x1234, NORMAL);
-  tpuart.SetDebugString(&traces);
+  tpuart.SetTraceRing(&traces);
   tpuart.Reset();
   tpuart.SetEvtCallback(eventCallback);
   tpuart.SetAckCallback(ackCallback);
@@ -551,7 +551,7 @@ void Normal_Tx_NoAck(void)
 {
   Serial.println(F("\n########## Telegram Transmission with No Ack ##########"));  
   KnxTpUart tpuart(Serial1, 0x1234, NORMAL);
-  tpuart.SetDebugString(&traces);
+  tpuart.SetTraceRing(&traces);
   tpuart.Reset();
   tpuart.SetEvtCallback(eventCallback);
   tpuart.SetAckCallback(ackCallback);
@@ -584,7 +584,7 @@ void Normal_Tx_Timeout(void)
 {
   Serial.println(F("\n########## Test Telegram Transmission with No answer timeout ##########"));  
   KnxTpUart tpuart(Serial1, 0x1234, NORMAL);
-  tpuart.SetDebugString(&traces);
+  tpuart.SetTraceRing(&traces);
   tpuart.Reset();
   tpuart.SetEvtCallback(eventCallback);
   tpuart.SetAckCallback(ackCallback);
@@ -619,7 +619,7 @@ void Normal_Tx_Reset(void)
 {
   Serial.println(F("\n########## Test Telegram Transmission with Reset response ##########"));  
   KnxTpUart tpuart(Serial1, 0x1234, NORMAL);
-  tpuart.SetDebugString(&traces);
+  tpuart.SetTraceRing(&traces);
   tpuart.Reset();
   tpuart.SetEvtCallback(eventCallback);
   tpuart.SetAckCallback(ackCallback);
@@ -0,0 +1,131 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : Arduino.h (host)
+// Author : Franck Marini
+// Description : Minimal Arduino core stand-in allowing to build the library on a host (Linux/POSIX) machine
+//               Only the parts of the Arduino API used by the library are provided.
+// Module dependencies : none
+
+#ifndef ARDUINO_HOST_H
+#define ARDUINO_HOST_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+
+typedef uint8_t byte;
+typedef uint16_t word;
+typedef bool boolean;
+
+#define HEX 16
+#define DEC 10
+#define SERIAL_8E1 0x800001e
+#define F(str) (str)
+
+#define ESP_LOGE(tag, ...) do {} while (0)
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+long random(long max);
+long random(long min, long max);
+
+
+// Arduino String stand-in, only the features used by the library debug functions
+class String : public std::string {
+  public:
+    String() {}
+    String(const char *str) : std::string(str) {}
+    String(const std::string& str) : std::string(str) {}
+    String(char c) : std::string(1, c) {}
+    String(long value, int base = DEC) { Format(value, base); }
+    String(unsigned long value, int base = DEC) { Format((long)value, base); }
+    String(int value, int base = DEC) { Format(value, base); }
+    String(unsigned int value, int base = DEC) { Format(value, base); }
+    String(unsigned char value, int base = DEC) { Format(value, base); }
+    String(double value, int decimals = 2) { char str[32]; snprintf(str, sizeof(str), "%.*f", decimals, value); assign(str); }
+    String& operator+=(const String& str) { append(str); return *this; }
+    String& operator+=(const char *str) { append(str); return *this; }
+    String& operator+=(char c) { push_back(c); return *this; }
+    unsigned int length(void) const { return size(); }
+
+  private:
+    void Format(long value, int base)
+    { char str[34]; snprintf(str, sizeof(str), (base == HEX) ? "%lX" : "%ld", value); assign(str); }
+};
+
+inline String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, const char *b) { String r(a); r += b; return r; }
+inline String operator+(const char *a, const String& b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, char b) { String r(a); r += b; return r; }
+
+
+// Arduino Stream stand-in, the print functions write to the host standard output
+class Stream {
+  public:
+    virtual ~Stream() {}
+    virtual int available(void) = 0;
+    virtual int read(void) = 0;
+    virtual size_t write(uint8_t data) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    { size_t i; for (i = 0; i < size; i++) if (!write(buffer[i])) break; return i; }
+    virtual int availableForWrite(void) { return 0; }
+    virtual size_t readBytes(uint8_t *buffer, size_t length)
+    { size_t i = 0; while ((i < length) && (available() > 0)) buffer[i++] = (uint8_t)read(); return i; }
+    size_t readBytes(char *buffer, size_t length) { return readBytes((uint8_t *)buffer, length); }
+
+    void print(const char *str) { fputs(str, stdout); }
+    void print(const String& str) { fputs(str.c_str(), stdout); }
+    void print(char c) { putchar(c); }
+    void print(long value, int base = DEC) { printf((base == HEX) ? "%lX" : "%ld", value); }
+    void print(unsigned long value, int base = DEC) { printf((base == HEX) ? "%lX" : "%lu", value); }
+    void print(int value, int base = DEC) { print((long)value, base); }
+    void print(unsigned int value, int base = DEC) { print((unsigned long)value, base); }
+    void print(unsigned char value, int base = DEC) { print((unsigned long)value, base); }
+    void print(double value, int decimals = 2) { printf("%.*f", decimals, value); }
+    template <typename T> void println(T value) { print(value); putchar('\n'); }
+    template <typename T> void println(T value, int format) { print(value, format); putchar('\n'); }
+    void println(void) { putchar('\n'); }
+};
+
+
+// Arduino HardwareSerial stand-in
+// The default implementation is a closed line : nothing is received and the written bytes are discarded.
+// Serial stand-ins (e.g. HostSerial) derive from this class.
+class HardwareSerial : public Stream {
+  public:
+    virtual ~HardwareSerial() {}
+    virtual void begin(unsigned long baud, uint32_t config = SERIAL_8E1, int8_t rxPin = -1, int8_t txPin = -1, bool invert = false) {}
+    virtual void end(void) {}
+    virtual int available(void) { return 0; }
+    virtual int read(void) { return -1; }
+    virtual size_t write(uint8_t data) { return 1; }
+    virtual size_t write(const uint8_t *buffer, size_t size) { return size; }
+    virtual int availableForWrite(void) { return 128; }
+    using Stream::readBytes;
+};
+
+extern HardwareSerial Serial;
+
+#endif // ARDUINO_HOST_H
@@ -0,0 +1,70 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : ArduinoHost.cpp
+// Author : Franck Marini
+// Description : Implementation of the Arduino core stand-in for host builds (see Arduino.h)
+// Module dependencies : none
+
+#include "Arduino.h"
+#include <time.h>
+
+HardwareSerial Serial;
+
+
+// Time elapsed since the 1st time function call, in microseconds
+static unsigned long long HostTimeMicros(void)
+{
+  static struct timespec origin;
+  static boolean originSet = false;
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  if (!originSet) { origin = now; originSet = true; }
+  return (unsigned long long)(now.tv_sec - origin.tv_sec) * 1000000ULL
+         + (now.tv_nsec - origin.tv_nsec) / 1000;
+}
+
+
+unsigned long millis(void) { return (unsigned long)(HostTimeMicros() / 1000); }
+
+
+unsigned long micros(void) { return (unsigned long)HostTimeMicros(); }
+
+
+void delay(unsigned long ms)
+{
+  unsigned long long end = HostTimeMicros() + (unsigned long long)ms * 1000;
+  while (HostTimeMicros() < end);
+}
+
+
+void delayMicroseconds(unsigned int us)
+{
+  unsigned long long end = HostTimeMicros() + us;
+  while (HostTimeMicros() < end);
+}
+
+
+long random(long max) { return (max > 0) ? (rand() % max) : 0; }
+
+
+long random(long min, long max) { return (max > min) ? (min + rand() % (max - min)) : min; }
+
+// EOF
@@ -0,0 +1,150 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : HostSerial.h
+// Author : Franck Marini
+// Description : HardwareSerial stand-in for host tests and benchmarks
+//               The RX bytes are injected by the test, the TX bytes are recorded.
+//               A busy wait cost can be added to every driver call (available, read, readBytes, write)
+//               in order to emulate the cost of a real UART driver (e.g. ESP32 driver lock).
+//               The TX line is modelled at 19200 baud 8E1 (1 character every 573us) behind a TX FIFO,
+//               availableForWrite() returns the FIFO room left by the characters not sent on the line yet.
+// Module dependencies : Arduino (host)
+
+#ifndef HOSTSERIAL_H
+#define HOSTSERIAL_H
+
+#include "Arduino.h"
+#include <time.h>
+
+#define HOSTSERIAL_RX_BUFFER_SIZE 1024
+#define HOSTSERIAL_TX_BUFFER_SIZE 1024
+#define HOSTSERIAL_TX_FIFO_SIZE   128  // ESP32 UART hardware FIFO size
+#define HOSTSERIAL_CHAR_TIME_MICROS 573 // 11 bits (start + 8 data + parity + stop) at 19200 baud
+
+class HostSerial : public HardwareSerial {
+    byte _rxBuffer[HOSTSERIAL_RX_BUFFER_SIZE];
+    word _rxHead, _rxTail;                    // read and write positions in the RX buffer
+    byte _txBuffer[HOSTSERIAL_TX_BUFFER_SIZE];
+    word _txBytesNb;                          // nb of recorded TX bytes
+    unsigned int _callCostNanosec;            // emulated cost of every driver call
+    unsigned long _callsNb;                   // nb of driver calls
+    word _txFifoSize;                         // size of the modelled TX FIFO
+    unsigned long _txLineEndMicros;           // time when the last written character leaves the TX line
+
+  public:
+    HostSerial() : _rxHead(0), _rxTail(0), _txBytesNb(0), _callCostNanosec(0), _callsNb(0),
+                   _txFifoSize(HOSTSERIAL_TX_FIFO_SIZE), _txLineEndMicros(0) {}
+
+    // Inject bytes, they become immediately available for reading
+    // return the nb of injected bytes (less than nbOfBytes in case of RX buffer full)
+    word InjectRxBytes(const byte bytes[], word nbOfBytes)
+    {
+      word i;
+      for (i = 0; (i < nbOfBytes) && (_rxTail < HOSTSERIAL_RX_BUFFER_SIZE); i++) _rxBuffer[_rxTail++] = bytes[i];
+      return i;
+    }
+
+    // Nb of injected bytes not read yet
+    word RxBytesNb(void) const { return _rxTail - _rxHead; }
+
+    // Access to the recorded TX bytes
+    word TxBytesNb(void) const { return _txBytesNb; }
+    byte TxByte(word index) const { return _txBuffer[index]; }
+    void ClearTx(void) { _txBytesNb = 0; }
+
+    // Set the size of the modelled TX FIFO
+    void SetTxFifoSize(word size) { _txFifoSize = size; }
+
+    // Time (micros() value) when the last written character has left (or will leave) the TX line
+    unsigned long GetTxLineEndMicros(void) const { return _txLineEndMicros; }
+
+    // Set the emulated cost of every driver call
+    void SetCallCost(unsigned int nanosec) { _callCostNanosec = nanosec; }
+    unsigned long GetCallsNb(void) const { return _callsNb; }
+    void ClearCallsNb(void) { _callsNb = 0; }
+
+    // HardwareSerial interface
+    void begin(unsigned long baud, uint32_t config = SERIAL_8E1, int8_t rxPin = -1, int8_t txPin = -1, bool invert = false)
+    { _rxHead = _rxTail = 0; }
+
+    int available(void) { DriverCall(); return RxBytesNb(); }
+
+    int read(void)
+    {
+      DriverCall();
+      if (_rxHead == _rxTail) return -1;
+      return ReadRxByte();
+    }
+
+    size_t readBytes(uint8_t *buffer, size_t length)
+    {
+      size_t i;
+      DriverCall();
+      for (i = 0; (i < length) && (_rxHead != _rxTail); i++) buffer[i] = ReadRxByte();
+      return i;
+    }
+
+    size_t write(uint8_t data) { DriverCall(); RecordTxByte(data); SendOnLine(1); return 1; }
+
+    size_t write(const uint8_t *buffer, size_t size)
+    {
+      DriverCall();
+      for (size_t i = 0; i < size; i++) RecordTxByte(buffer[i]);
+      SendOnLine(size);
+      return size;
+    }
+
+    int availableForWrite(void)
+    {
+      long pendingTime = (long)(_txLineEndMicros - micros());
+      word pendingChars = (pendingTime > 0) ? (pendingTime + HOSTSERIAL_CHAR_TIME_MICROS - 1) / HOSTSERIAL_CHAR_TIME_MICROS : 0;
+      DriverCall();
+      return (pendingChars < _txFifoSize) ? _txFifoSize - pendingChars : 0;
+    }
+
+  private:
+    byte ReadRxByte(void)
+    {
+      byte data = _rxBuffer[_rxHead++];
+      if (_rxHead == _rxTail) _rxHead = _rxTail = 0; // buffer empty, restart from the beginning
+      return data;
+    }
+
+    void RecordTxByte(byte data) { if (_txBytesNb < HOSTSERIAL_TX_BUFFER_SIZE) _txBuffer[_txBytesNb++] = data; }
+
+    void SendOnLine(size_t charsNb)
+    {
+      unsigned long now = micros();
+      if ((long)(_txLineEndMicros - now) < 0) _txLineEndMicros = now; // line idle
+      _txLineEndMicros += charsNb * HOSTSERIAL_CHAR_TIME_MICROS;
+    }
+
+    void DriverCall(void)
+    {
+      struct timespec start, now;
+      _callsNb++;
+      if (!_callCostNanosec) return;
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      do clock_gettime(CLOCK_MONOTONIC, &now);
+      while ((unsigned long)((now.tv_sec - start.tv_sec) * 1000000000L + (now.tv_nsec - start.tv_nsec)) < _callCostNanosec);
+    }
+};
+
+#endif // HOSTSERIAL_H
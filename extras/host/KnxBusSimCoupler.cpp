@@ -0,0 +1,162 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxBusSimCoupler.cpp
+// Author : Franck Marini
+// Description : Bus coupler attaching a KnxDevice to the simulated TP1 bus (see KnxBusSimCoupler.h)
+// Module dependencies : KnxBusCoupler, KnxBusSimulator
+
+#include "KnxBusSimCoupler.h"
+
+KnxBusSimCoupler::KnxBusSimCoupler(KnxBusSimulator& sim, word physicalAddr)
+: _sim(sim), _physicalAddr(physicalAddr), _evtCallbackFct(NULL), _txRequestTime(0), _requestedNb(0)
+{
+  _rx.state = RX_RESET;
+  _rx.addressedComObjectIndex = 0;
+  _rx.overflowsNb = 0;
+  _tx.state = TX_RESET;
+  _tx.sentTelegram = NULL;
+  _tx.ackFctPtr = NULL;
+  _tx.nbRemainingBytes = 0;
+  _tx.txByteIndex = 0;
+}
+
+
+KnxBusSimCoupler::~KnxBusSimCoupler()
+{
+}
+
+
+byte KnxBusSimCoupler::SetEvtCallback(type_EventCallbackFctPtr evtCallbackFct)
+{
+  if (evtCallbackFct == NULL) return KNX_BUSCOUPLER_ERROR;
+  if ((_rx.state!=RX_INIT) || (_tx.state!=TX_INIT)) return KNX_BUSCOUPLER_ERROR_NOT_INIT_STATE;
+  _evtCallbackFct = evtCallbackFct;
+  return KNX_BUSCOUPLER_OK;
+}
+
+
+byte KnxBusSimCoupler::SetAckCallback(type_AckCallbackFctPtr ackFctPtr)
+{
+  if (ackFctPtr == NULL) return KNX_BUSCOUPLER_ERROR;
+  if ((_rx.state!=RX_INIT) || (_tx.state!=TX_INIT)) return KNX_BUSCOUPLER_ERROR_NOT_INIT_STATE;
+  _tx.ackFctPtr = ackFctPtr;
+  return KNX_BUSCOUPLER_OK;
+}
+
+
+// A telegram being sent is abandoned
+byte KnxBusSimCoupler::Reset(void)
+{
+  _rx.state = RX_INIT;
+  _tx.state = TX_INIT;
+  return KNX_BUSCOUPLER_OK;
+}
+
+
+byte KnxBusSimCoupler::AttachComObjectsList(KnxComObject comObjectsList[], byte listSize)
+{
+  if ((_rx.state!=RX_INIT) || (_tx.state!=TX_INIT)) return KNX_BUSCOUPLER_ERROR_NOT_INIT_STATE;
+  _comObjects.Attach(comObjectsList, listSize);
+  return KNX_BUSCOUPLER_OK;
+}
+
+
+// Attach a list of com objects
+// NB1 : only the objects with "communication" attribute are considered
+// NB2 : In case of objects with identical address, the object with highest index only is considered
+// return KNX_BUSCOUPLER_ERROR_NOT_INIT_STATE (254) if the coupler is not in Init state
+byte KnxBusSimCoupler::AttachComObjectsList(KnxComObject** comObjectsList, byte listSize)
+{
+  if ((_rx.state!=RX_INIT) || (_tx.state!=TX_INIT)) return KNX_BUSCOUPLER_ERROR_NOT_INIT_STATE;
+  _comObjects.Attach(comObjectsList, listSize);
+  return KNX_BUSCOUPLER_OK;
+}
+
+
+byte KnxBusSimCoupler::Init(void)
+{
+  if ((_rx.state!=RX_INIT) || (_tx.state!=TX_INIT)) return KNX_BUSCOUPLER_ERROR_NOT_INIT_STATE;
+  if (_evtCallbackFct == NULL) return KNX_BUSCOUPLER_ERROR_NULL_EVT_CALLBACK_FCT;
+  if (_tx.ackFctPtr == NULL) return KNX_BUSCOUPLER_ERROR_NULL_ACK_CALLBACK_FCT;
+  _rx.state = RX_IDLE_WAITING_FOR_CTRL_FIELD;
+  _tx.state = TX_IDLE;
+  return KNX_BUSCOUPLER_OK;
+}
+
+
+// Send a KNX telegram
+// returns ERROR (255) if TX is not available, else returns OK (0)
+// NB : the source address is forced to the coupler physical address value
+byte KnxBusSimCoupler::SendTelegram(KnxTelegram& sentTelegram)
+{
+  if (_tx.state != TX_IDLE) return KNX_BUSCOUPLER_ERROR; // TX not initialized or busy
+
+  if (sentTelegram.GetSourceAddress() != _physicalAddr)
+  {
+    sentTelegram.SetSourceAddress(_physicalAddr);
+    sentTelegram.UpdateChecksum();
+  }
+  sentTelegram.Copy(_txFrame);
+  _tx.sentTelegram = &sentTelegram;
+  _txRequestTime = _sim.GetTime();
+  _requestedNb++;
+  _tx.state = TX_TELEGRAM_SENDING_ONGOING;
+  return KNX_BUSCOUPLER_OK;
+}
+
+
+void KnxBusSimCoupler::PendingFrameCompleted(byte ack)
+{
+  if (_tx.state != TX_TELEGRAM_SENDING_ONGOING) return; // coupler reset meanwhile
+  _tx.state = TX_IDLE;
+  _tx.ackFctPtr((ack == KNXBUSSIM_ACK) ? ACK_RESPONSE : NACK_RESPONSE);
+}
+
+
+byte KnxBusSimCoupler::FrameReceived(const KnxTelegram& frame)
+{
+  type_buscoupler_rx_telegram rxTelegram;
+  byte index;
+  boolean repetition;
+
+  if (_rx.state < RX_IDLE_WAITING_FOR_CTRL_FIELD) return KNXBUSSIM_NO_ACK; // not initialized
+  if (!frame.IsMulticast()) return (frame.GetTargetAddress() == _physicalAddr) ? KNXBUSSIM_ACK : KNXBUSSIM_NO_ACK;
+  if (!_comObjects.IsAddressAssigned(frame.GetTargetAddress(), index)) return KNXBUSSIM_NO_ACK;
+
+  // a repeated frame already received (i.e. whose acknowledge has been lost) is acknowledged but not queued again
+  repetition = frame.IsRepeated();
+  for (byte i = 1; repetition && (i < frame.GetTelegramLength() - 1); i++)
+    if (frame.ReadRawByte(i) != _lastRxFrame.ReadRawByte(i)) repetition = false;
+  if (repetition) return KNXBUSSIM_ACK;
+  if (_rx.queue.IsFull()) return KNXBUSSIM_BUSY;
+
+  frame.Copy(_lastRxFrame);
+  frame.Copy(_rx.receivedTelegram);
+  _rx.addressedComObjectIndex = index;
+  frame.Copy(rxTelegram.telegram);
+  rxTelegram.comObjectIndex = index;
+  rxTelegram.timeMicros = KnxMicros();
+  _rx.queue.Append(rxTelegram);
+  _evtCallbackFct(BUSCOUPLER_EVENT_RECEIVED_EIB_TELEGRAM);
+  return KNXBUSSIM_ACK;
+}
+
+// EOF
@@ -0,0 +1,90 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxBusSimCoupler.h
+// Author : Franck Marini
+// Description : Bus coupler attaching a KnxDevice to the simulated TP1 bus (see KnxBusSimulator.h)
+//               The coupler works at the link layer : the telegram sent is handed over to the simulated bus which
+//               manages the arbitration and the repetitions, and the final acknowledge is notified through the ACK
+//               callback. The received telegrams addressed to the com objects are acknowledged and queued,
+//               BUSY is answered when the RX queue is full, and the repetitions of a received telegram are ignored.
+// Module dependencies : KnxBusCoupler, KnxBusSimulator, KnxComObjectTable
+
+#ifndef KNXBUSSIMCOUPLER_H
+#define KNXBUSSIMCOUPLER_H
+
+#include "Arduino.h"
+#include "KnxBusCoupler.h"
+#include "KnxComObjectTable.h"
+#include "KnxBusSimulator.h"
+
+class KnxBusSimCoupler : public KnxBusCoupler, public KnxBusParticipant {
+    KnxBusSimulator& _sim;
+    const word _physicalAddr;
+    type_buscoupler_rx _rx;                   // Reception structure
+    type_buscoupler_tx _tx;                   // Transmission structure
+    type_EventCallbackFctPtr _evtCallbackFct; // Pointer to the EVENTS callback function
+    KnxComObjectTable _comObjects;            // Attached com objects, ordered by address
+    KnxTelegram _txFrame;                     // Copy of the telegram being sent
+    unsigned long long _txRequestTime;        // Time of the SendTelegram() call
+    unsigned long _requestedNb;               // Nb of SendTelegram() calls accepted
+    KnxTelegram _lastRxFrame;                 // Last received telegram (repetitions detection)
+
+  public:
+    KnxBusSimCoupler(KnxBusSimulator& sim, word physicalAddr);
+    ~KnxBusSimCoupler();
+
+    // KnxBusCoupler interface
+    byte SetEvtCallback(type_EventCallbackFctPtr);
+    void SetReceivedTelegram(KnxTelegram &telegram) { FrameReceived(telegram); }
+    byte SetAckCallback(type_AckCallbackFctPtr);
+    byte GetStateIndication(void) const { return 0; }
+    KnxTelegram& GetReceivedTelegram(void) { return _rx.receivedTelegram; }
+    byte GetTargetedComObjectIndex(void) const { return _rx.addressedComObjectIndex; }
+    boolean IsActive(void) const { return (_tx.state > TX_IDLE); }
+    boolean PopReceivedTelegram(type_buscoupler_rx_telegram& rxTelegram) { return _rx.queue.Pop(rxTelegram); }
+    word GetRxOverflowsNb(void) const { return _rx.overflowsNb; }
+#if defined(KNXTPUART_DEBUG_INFO) || defined(KNXTPUART_DEBUG_ERROR)
+    void SetTraceRing(KnxTraceRing *traceRing) {}
+#endif
+    byte Reset(void);
+    byte AttachComObjectsList(KnxComObject comObjectsList[], byte listSize);
+    byte AttachComObjectsList(KnxComObject** comObjectsList, byte listSize);
+    byte Init(void);
+    byte SendTelegram(KnxTelegram& sentTelegram);
+    void RXTask(void) {} // the telegrams are delivered by the simulated bus
+    void TXTask(void) {} // the transmission is managed by the simulated bus
+    boolean GetMonitoringData(type_MonitorData&) { return false; }
+    void DEBUG_SendResetCommand(void) {}
+    void DEBUG_SendStateReqCommand(void) {}
+
+    // KnxBusParticipant interface
+    word GetPhysicalAddr(void) const { return _physicalAddr; }
+    KnxTelegram* GetPendingFrame(void) { return (_tx.state == TX_TELEGRAM_SENDING_ONGOING) ? &_txFrame : NULL; }
+    unsigned long long GetPendingFrameTime(void) const { return _txRequestTime; }
+    void PendingFrameCompleted(byte ack);
+    byte FrameReceived(const KnxTelegram& frame);
+    unsigned long GetRequestedFramesNb(void) const { return _requestedNb; }
+
+};
+
+#endif // KNXBUSSIMCOUPLER_H
+
+// EOF
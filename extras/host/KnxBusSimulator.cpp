@@ -0,0 +1,383 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxBusSimulator.cpp
+// Author : Franck Marini
+// Description : Simulation of a KNX TP1 line with several participants (see KnxBusSimulator.h)
+// Module dependencies : Arduino (host), KnxTelegram
+
+#include "KnxBusSimulator.h"
+
+// Duration of a frame on the bus
+#define FRAME_BITS(length) ((length) * (KNXBUSSIM_CHAR_BITS + KNXBUSSIM_PAUSE_BITS) - KNXBUSSIM_PAUSE_BITS)
+
+static const char* const priorityNames[] = { "system", "high", "alarm", "normal" };
+
+
+// ---------- KnxBusLatencyStats ----------
+
+void KnxBusLatencyStats::Clear(void)
+{
+  memset(_bins, 0, sizeof(_bins));
+  _samplesNb = 0; _sumMicros = 0; _maxMicros = 0;
+}
+
+
+void KnxBusLatencyStats::Add(unsigned long latencyMicros)
+{
+  unsigned long bin = latencyMicros / KNXBUSSIM_LATENCY_BIN;
+
+  _bins[(bin < KNXBUSSIM_LATENCY_BINS_NB) ? bin : KNXBUSSIM_LATENCY_BINS_NB - 1]++;
+  _samplesNb++;
+  _sumMicros += latencyMicros;
+  if (latencyMicros > _maxMicros) _maxMicros = latencyMicros;
+}
+
+
+unsigned long KnxBusLatencyStats::GetPercentile(byte percent) const
+{
+  unsigned long long threshold = ((unsigned long long)_samplesNb * percent + 99) / 100;
+  unsigned long long count = 0;
+
+  if (!_samplesNb) return 0;
+  for (word bin = 0; bin < KNXBUSSIM_LATENCY_BINS_NB - 1; bin++)
+  {
+    count += _bins[bin];
+    if (count >= threshold) return (bin + 1) * KNXBUSSIM_LATENCY_BIN;
+  }
+  return _maxMicros;
+}
+
+
+// ---------- KnxBusSimulator ----------
+
+// The virtual time goes on from one simulator to the next one, the library timers never go backward
+static unsigned long long simulatorsEndTime = 0;
+
+KnxBusSimulator::KnxBusSimulator(unsigned long stepMicros, unsigned long randomSeed)
+: _participantsNb(0), _stepCallback(NULL), _stepMicros(stepMicros), _time(simulatorsEndTime), _busFreeTime(0),
+  _randomState(randomSeed ? randomSeed : 1), _transmissionOngoing(false), _clock(simulatorsEndTime)
+{
+  KnxSetClock(&_clock);
+  ClearStats();
+}
+
+
+KnxBusSimulator::~KnxBusSimulator()
+{
+  simulatorsEndTime = _time;
+  KnxSetClock(NULL);
+}
+
+
+byte KnxBusSimulator::Attach(KnxBusParticipant& participant)
+{
+  if (_participantsNb == KNXBUSSIM_MAX_PARTICIPANTS) return KNXBUSSIM_ERROR;
+  _participants[_participantsNb] = &participant;
+  _txState[_participantsNb].attemptsNb = 0;
+  _txState[_participantsNb].earliestTime = 0;
+  memset(&_stats[_participantsNb], 0, sizeof(_stats[0]));
+  _participantsNb++;
+  return KNXBUSSIM_OK;
+}
+
+
+// The bus events are processed with their exact time, the participants tasks run at every step
+void KnxBusSimulator::Run(unsigned long long durationMicros)
+{
+  unsigned long long endTime = _time + durationMicros;
+  unsigned long long nextTime;
+
+  while (_time < endTime)
+  {
+    nextTime = _time + _stepMicros;
+    ProcessBus(nextTime);
+    _time = nextTime;
+    _clock.SetTime(_time);
+    for (byte i = 0; i < _participantsNb; i++) _participants[i]->Task();
+    if (_stepCallback) _stepCallback();
+  }
+}
+
+
+unsigned long KnxBusSimulator::Random(void)
+{
+  _randomState ^= _randomState << 13; _randomState &= 0xFFFFFFFF;
+  _randomState ^= _randomState >> 17;
+  _randomState ^= _randomState << 5; _randomState &= 0xFFFFFFFF;
+  return _randomState;
+}
+
+
+void KnxBusSimulator::ClearStats(void)
+{
+  _startTime = _time;
+  _framesNb = 0;
+  _busyMicros = 0;
+  for (byte i = 0; i < 4; i++) _latency[i].Clear();
+  for (byte i = 0; i < _participantsNb; i++) memset(&_stats[i], 0, sizeof(_stats[0]));
+}
+
+
+float KnxBusSimulator::GetBusLoad(void) const
+{
+  if (_time == _startTime) return 0;
+  return 100.0 * _busyMicros / (_time - _startTime);
+}
+
+
+float KnxBusSimulator::GetThroughput(void) const
+{
+  unsigned long sentNb = 0;
+
+  if (_time == _startTime) return 0;
+  for (byte i = 0; i < _participantsNb; i++) sentNb += _stats[i].sentNb;
+  return 1000000.0 * sentNb / (_time - _startTime);
+}
+
+
+void KnxBusSimulator::PrintStats(const char *label) const
+{
+  printf("bus;%s;%.1f;%lu;%.1f;%.2f\n", label, (_time - _startTime) / 1000000.0, _framesNb, GetBusLoad(), GetThroughput());
+  for (byte p = 0; p < 4; p++)
+  {
+    if (!_latency[p].GetSamplesNb()) continue;
+    printf("priority;%s;%s;%lu;%.2f;%.2f;%.2f;%.2f;%.2f\n", label, priorityNames[p], _latency[p].GetSamplesNb(),
+           _latency[p].GetAverage() / 1000.0, _latency[p].GetPercentile(50) / 1000.0, _latency[p].GetPercentile(90) / 1000.0,
+           _latency[p].GetPercentile(99) / 1000.0, _latency[p].GetMax() / 1000.0);
+  }
+  for (byte i = 0; i < _participantsNb; i++)
+  {
+    unsigned long requestedNb = _participants[i]->GetRequestedFramesNb();
+    unsigned long droppedNb = _participants[i]->GetDroppedFramesNb();
+    if (!requestedNb) continue; // no traffic
+    printf("participant;%s;%u.%u.%u;%lu;%lu;%lu;%lu;%.2f;%lu;%lu\n", label, _participants[i]->GetPhysicalAddr() >> 12,
+           (_participants[i]->GetPhysicalAddr() >> 8) & 0x0F, _participants[i]->GetPhysicalAddr() & 0xFF,
+           requestedNb, _stats[i].sentNb, _stats[i].failedNb, droppedNb, 100.0 * droppedNb / requestedNb,
+           _stats[i].repeatsNb, _stats[i].arbitrationLostNb);
+  }
+}
+
+
+void KnxBusSimulator::ProcessBus(unsigned long long limitTime)
+{
+  while (true)
+  {
+    if ((!_transmissionOngoing) && (!StartTransmission(limitTime))) return;
+    if (_ackEndTime > limitTime) return; // the transmission ends during a next step
+    CompleteTransmission();
+  }
+}
+
+
+// Start the transmission of the frame winning the arbitration, if a frame may start before limitTime
+boolean KnxBusSimulator::StartTransmission(unsigned long long limitTime)
+{
+  unsigned long long startTime = 0, time;
+  KnxTelegram *frames[KNXBUSSIM_MAX_PARTICIPANTS];
+  byte contendersNb = 0;
+  byte length, i, j;
+
+  // the frames may start at the end of the bus idle time, or later when they are not ready yet
+  for (i = 0; i < _participantsNb; i++)
+  {
+    frames[i] = _participants[i]->GetPendingFrame();
+    if (!frames[i]) continue;
+    time = _time;
+    if (_busFreeTime > time) time = _busFreeTime;
+    if (_txState[i].earliestTime > time) time = _txState[i].earliestTime;
+    if ((!contendersNb) || (time < startTime)) { startTime = time; contendersNb = 1; }
+    else if (time == startTime) contendersNb++;
+  }
+  if ((!contendersNb) || (startTime >= limitTime)) return false;
+
+  // arbitration between the frames starting at the same time : the lowest bytes sequence wins (0 is dominant)
+  _sender = KNXBUSSIM_MAX_PARTICIPANTS;
+  for (i = 0; i < _participantsNb; i++)
+  {
+    if ((!frames[i]) || (_txState[i].earliestTime > startTime)) continue;
+    if (_sender == KNXBUSSIM_MAX_PARTICIPANTS) { _sender = i; continue; }
+    for (j = 0; (j < KNX_TELEGRAM_MAX_SIZE) && (frames[i]->ReadRawByte(j) == frames[_sender]->ReadRawByte(j)); j++);
+    if ((j < KNX_TELEGRAM_MAX_SIZE) && (frames[i]->ReadRawByte(j) < frames[_sender]->ReadRawByte(j)))
+    { // i wins against the current winner
+      _stats[_sender].arbitrationLostNb++;
+      _sender = i;
+    }
+    else _stats[i].arbitrationLostNb++;
+  }
+
+  _frame = frames[_sender];
+  length = _frame->GetTelegramLength();
+  _frameEndTime = startTime + KNXBUSSIM_BITS_TO_MICROS(FRAME_BITS(length));
+  _ackEndTime = _frameEndTime + KNXBUSSIM_BITS_TO_MICROS(KNXBUSSIM_ACK_GAP_BITS + KNXBUSSIM_CHAR_BITS);
+  _transmissionOngoing = true;
+  _framesNb++;
+  _busyMicros += _ackEndTime - startTime;
+  return true;
+}
+
+
+// Deliver the frame to the other participants, superimpose their acknowledges and notify the sender
+void KnxBusSimulator::CompleteTransmission(void)
+{
+  KnxBusParticipant& sender = *_participants[_sender];
+  KnxTelegram& frame = *_frame;
+  byte ack = KNXBUSSIM_NO_ACK, receiverAck;
+  unsigned long long requestTime;
+
+  _transmissionOngoing = false;
+  _clock.SetTime(_frameEndTime);
+  for (byte i = 0; i < _participantsNb; i++)
+  {
+    if (i == _sender) continue;
+    receiverAck = _participants[i]->FrameReceived(frame);
+    if (receiverAck != KNXBUSSIM_NO_ACK) ack &= receiverAck;
+  }
+  _clock.SetTime(_ackEndTime);
+  _busFreeTime = _ackEndTime + KNXBUSSIM_BITS_TO_MICROS(KNXBUSSIM_IDLE_BITS);
+
+  if (ack == KNXBUSSIM_ACK)
+  {
+    requestTime = sender.GetPendingFrameTime();
+    _latency[frame.GetPriority() >> 2].Add((unsigned long)(_ackEndTime - requestTime));
+    _stats[_sender].sentNb++;
+    _txState[_sender].attemptsNb = 0;
+    sender.PendingFrameCompleted(ack);
+  }
+  else if (_txState[_sender].attemptsNb == KNXBUSSIM_TX_REPEATS_NB)
+  { // no more repetition
+    _stats[_sender].failedNb++;
+    _txState[_sender].attemptsNb = 0;
+    sender.PendingFrameCompleted(ack);
+  }
+  else
+  { // repetition (NACK, BUSY, no acknowledge or acknowledges collision)
+    _txState[_sender].attemptsNb++;
+    _stats[_sender].repeatsNb++;
+    if (!frame.IsRepeated()) { frame.SetRepeated(); frame.UpdateChecksum(); }
+    if (ack == KNXBUSSIM_BUSY)
+      _txState[_sender].earliestTime = _ackEndTime + KNXBUSSIM_BITS_TO_MICROS(KNXBUSSIM_BUSY_IDLE_BITS);
+  }
+}
+
+
+// ---------- KnxBusTrafficGenerator ----------
+
+KnxBusTrafficGenerator::KnxBusTrafficGenerator(KnxBusSimulator& sim, word physicalAddr, e_KnxPriority priority,
+                                               unsigned long meanPeriodMicros, word firstGroupAddr, word groupAddrNb,
+                                               byte payloadLength, byte queueSize)
+: _sim(sim), _physicalAddr(physicalAddr), _priority(priority), _meanPeriodMicros(0), _fixedPeriod(false),
+  _firstGroupAddr(firstGroupAddr), _groupAddrNb(groupAddrNb ? groupAddrNb : 1), _payloadLength(payloadLength),
+  _queueSize((queueSize > KNXBUSSIM_GENERATOR_QUEUE_MAX) ? KNXBUSSIM_GENERATOR_QUEUE_MAX : queueSize),
+  _queueHead(0), _queueNb(0), _framesCounter(0), _ackFirstGroupAddr(0), _ackGroupAddrNb(0),
+  _nackPercent(0), _busyPercent(0), _requestedNb(0), _droppedNb(0), _receivedNb(0)
+{
+  if (_payloadLength < 1) _payloadLength = 1;
+  if (_payloadLength > KNX_TELEGRAM_PAYLOAD_MAX_SIZE - 1) _payloadLength = KNX_TELEGRAM_PAYLOAD_MAX_SIZE - 1;
+  SetTraffic(meanPeriodMicros);
+}
+
+
+void KnxBusTrafficGenerator::SetTraffic(unsigned long meanPeriodMicros, boolean fixedPeriod)
+{
+  _meanPeriodMicros = meanPeriodMicros;
+  _fixedPeriod = fixedPeriod;
+  if (_meanPeriodMicros) _nextFrameTime = _sim.GetTime() + NextPeriod();
+}
+
+
+void KnxBusTrafficGenerator::SetAcknowledge(word firstGroupAddr, word groupAddrNb, byte nackPercent, byte busyPercent)
+{
+  _ackFirstGroupAddr = firstGroupAddr; _ackGroupAddrNb = groupAddrNb;
+  _nackPercent = nackPercent; _busyPercent = busyPercent;
+}
+
+
+void KnxBusTrafficGenerator::PendingFrameCompleted(byte ack)
+{
+  if (!_queueNb) return;
+  _queueHead = (_queueHead + 1) % _queueSize;
+  _queueNb--;
+}
+
+
+byte KnxBusTrafficGenerator::FrameReceived(const KnxTelegram& frame)
+{
+  word addr = frame.GetTargetAddress();
+  unsigned long random;
+
+  if (!frame.IsMulticast()) return (addr == _physicalAddr) ? KNXBUSSIM_ACK : KNXBUSSIM_NO_ACK;
+  if ((addr < _ackFirstGroupAddr) || ((unsigned long)addr >= (unsigned long)_ackFirstGroupAddr + _ackGroupAddrNb)) return KNXBUSSIM_NO_ACK;
+  _receivedNb++;
+  random = _sim.Random() % 100;
+  if (random < _nackPercent) return KNXBUSSIM_NACK;
+  if (random < (unsigned long)_nackPercent + _busyPercent) return KNXBUSSIM_BUSY;
+  return KNXBUSSIM_ACK;
+}
+
+
+// Queue the frames generated till the current time
+void KnxBusTrafficGenerator::Task(void)
+{
+  byte index;
+  byte payload[KNX_TELEGRAM_PAYLOAD_MAX_SIZE];
+
+  if (!_meanPeriodMicros) return;
+  while (_nextFrameTime <= _sim.GetTime())
+  {
+    _requestedNb++;
+    if (_queueNb == _queueSize) _droppedNb++;
+    else
+    {
+      index = (_queueHead + _queueNb) % _queueSize;
+      KnxTelegram& frame = _queue[index];
+      frame.ClearTelegram();
+      frame.ChangePriority(_priority);
+      frame.SetSourceAddress(_physicalAddr);
+      frame.SetTargetAddress(_firstGroupAddr + (_framesCounter % _groupAddrNb));
+      frame.SetCommand(KNX_COMMAND_VALUE_WRITE);
+      frame.SetPayloadLength(_payloadLength);
+      frame.SetFirstPayloadByte(_framesCounter & 1);
+      if (_payloadLength > 1)
+      {
+        for (byte i = 0; i < _payloadLength - 1; i++) payload[i] = (byte)(_framesCounter + i);
+        frame.SetLongPayload(payload, _payloadLength - 1);
+      }
+      frame.UpdateChecksum();
+      _queueTime[index] = _nextFrameTime;
+      _queueNb++;
+    }
+    _framesCounter++;
+    _nextFrameTime += NextPeriod();
+  }
+}
+
+
+// Period till the next frame, exponential distribution (Poisson traffic) unless fixed period
+unsigned long KnxBusTrafficGenerator::NextPeriod(void)
+{
+  double uniform;
+
+  if (_fixedPeriod) return _meanPeriodMicros;
+  uniform = (_sim.Random() + 1.0) / 4294967297.0; // ]0,1[
+  return (unsigned long)(-log(uniform) * _meanPeriodMicros) + 1;
+}
+
+// EOF
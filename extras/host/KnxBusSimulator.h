@@ -0,0 +1,252 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxBusSimulator.h
+// Author : Franck Marini
+// Description : Simulation of a KNX TP1 line with several participants, for load tests on a host
+//               - frame timing at 9600 bit/s : 13 bits per character (11 bits + 2 bits pause), acknowledge
+//                 character 15 bits after the frame end, 50 bits bus idle time between frames
+//               - CSMA/CA arbitration : the participants ready when the bus becomes free start together, the frame
+//                 with the most dominant (0) bits wins, i.e. the control field first (repeat flag, then priority),
+//                 then the source address. The losers try again at the next bus idle time.
+//               - link layer acknowledge : the ACK/NACK/BUSY characters of all the receivers are superimposed
+//                 (wired AND). A frame not acknowledged is repeated up to 3 times, after 150 bit times in case of BUSY.
+//               - virtual clock : the simulation runs step by step and installs its KnxVirtualClock as the library
+//                 clock so that the code attached to the bus (e.g. KnxDevice through KnxBusSimCoupler) sees the virtual time.
+//               The simulator measures the bus load, the throughput, the latency distribution per priority
+//               (from the frame request to the acknowledge) and per participant the TX queue drops.
+// Module dependencies : Arduino (host), KnxTelegram, KnxClock
+
+#ifndef KNXBUSSIMULATOR_H
+#define KNXBUSSIMULATOR_H
+
+#include "Arduino.h"
+#include "KnxTelegram.h"
+#include "KnxClock.h"
+
+#define KNXBUSSIM_OK     0
+#define KNXBUSSIM_ERROR  255
+
+#define KNXBUSSIM_MAX_PARTICIPANTS   32
+#define KNXBUSSIM_TX_REPEATS_NB      3     // nb of repetitions of a frame not acknowledged
+#define KNXBUSSIM_LATENCY_BIN        250   // usec, width of the latency histogram bins
+#define KNXBUSSIM_LATENCY_BINS_NB    4000  // i.e. 1s range, the longer latencies are counted in the last bin
+#define KNXBUSSIM_GENERATOR_QUEUE_MAX 32   // max TX queue size of a traffic generator
+
+// Link layer acknowledge characters (superimposed with a wired AND on the bus)
+#define KNXBUSSIM_ACK     0xCC
+#define KNXBUSSIM_NACK    0x0C
+#define KNXBUSSIM_BUSY    0xC0
+#define KNXBUSSIM_NO_ACK  0xFF  // no acknowledge character sent
+
+// Bus timings (9600 bit/s)
+#define KNXBUSSIM_BITS_TO_MICROS(bits) ((unsigned long long)(bits) * 625 / 6)
+#define KNXBUSSIM_CHAR_BITS      11  // start + 8 data + parity + stop
+#define KNXBUSSIM_PAUSE_BITS     2   // pause between 2 characters of a frame
+#define KNXBUSSIM_ACK_GAP_BITS   15  // gap between the frame end and the acknowledge character
+#define KNXBUSSIM_IDLE_BITS      50  // bus idle time before a new frame
+#define KNXBUSSIM_BUSY_IDLE_BITS 150 // bus idle time before the repetition of a frame answered with BUSY
+
+
+// Participant attached to the simulated bus
+class KnxBusParticipant {
+  public:
+    virtual ~KnxBusParticipant() {}
+
+    // Physical address of the participant
+    virtual word GetPhysicalAddr(void) const = 0;
+
+    // Frame waiting for transmission, NULL if none
+    // The frame shall stay unchanged till PendingFrameCompleted() call, except the repeat flag set by the simulator
+    virtual KnxTelegram* GetPendingFrame(void) = 0;
+
+    // Time when the pending frame transmission was requested (latency reference)
+    virtual unsigned long long GetPendingFrameTime(void) const = 0;
+
+    // End of the pending frame transmission, with the last acknowledge received (KNXBUSSIM_ACK on success)
+    virtual void PendingFrameCompleted(byte ack) = 0;
+
+    // Frame seen on the bus (sent by another participant)
+    // return the acknowledge character to send (KNXBUSSIM_NO_ACK when the frame is not addressed to the participant)
+    virtual byte FrameReceived(const KnxTelegram& frame) = 0;
+
+    // Participant task, called at every simulation step
+    virtual void Task(void) {}
+
+    // TX requests statistics
+    virtual unsigned long GetRequestedFramesNb(void) const = 0;
+    virtual unsigned long GetDroppedFramesNb(void) const { return 0; } // requests lost because of TX queue full
+};
+
+
+// Latency distribution
+class KnxBusLatencyStats {
+    unsigned long _bins[KNXBUSSIM_LATENCY_BINS_NB];
+    unsigned long _samplesNb;
+    unsigned long long _sumMicros;
+    unsigned long _maxMicros;
+
+  public:
+    KnxBusLatencyStats() { Clear(); }
+    void Clear(void);
+    void Add(unsigned long latencyMicros);
+    unsigned long GetSamplesNb(void) const { return _samplesNb; }
+    unsigned long GetAverage(void) const { return _samplesNb ? (unsigned long)(_sumMicros / _samplesNb) : 0; }
+    unsigned long GetMax(void) const { return _maxMicros; }
+    // Latency under which "percent" % of the samples are (upper bound of the histogram bin)
+    unsigned long GetPercentile(byte percent) const;
+};
+
+
+// Statistics of a participant
+typedef struct {
+  unsigned long sentNb;           // frames acknowledged
+  unsigned long failedNb;         // frames not acknowledged after the repetitions
+  unsigned long repeatsNb;        // repetitions
+  unsigned long arbitrationLostNb; // transmissions delayed by a higher priority frame
+} type_KnxBusParticipantStats;
+
+// Typedef for the function called at every simulation step
+typedef void (*type_KnxBusSimStepCallbackFctPtr)(void);
+
+
+class KnxBusSimulator {
+    KnxBusParticipant *_participants[KNXBUSSIM_MAX_PARTICIPANTS];
+    struct {
+      byte attemptsNb;                  // transmission attempts of the pending frame
+      unsigned long long earliestTime;  // time from which the pending frame may be sent again
+    } _txState[KNXBUSSIM_MAX_PARTICIPANTS];
+    type_KnxBusParticipantStats _stats[KNXBUSSIM_MAX_PARTICIPANTS];
+    byte _participantsNb;
+    type_KnxBusSimStepCallbackFctPtr _stepCallback;
+    unsigned long _stepMicros;          // simulation step
+    unsigned long long _time;           // virtual time (usec)
+    unsigned long long _startTime;      // start time of the statistics
+    unsigned long long _busFreeTime;    // end of the bus idle time following the last frame
+    unsigned long _randomState;
+
+    // Frame on the bus
+    boolean _transmissionOngoing;
+    byte _sender;                       // index of the sending participant
+    KnxTelegram *_frame;                // frame being sent
+    unsigned long long _frameEndTime;
+    unsigned long long _ackEndTime;
+
+    KnxVirtualClock _clock;             // library clock during the simulator lifetime
+
+    // Bus statistics
+    unsigned long _framesNb;            // frames on the bus, including repetitions
+    unsigned long long _busyMicros;     // bus occupation time (frames and acknowledges)
+    KnxBusLatencyStats _latency[4];     // per priority (e_KnxPriority >> 2)
+
+  public:
+    // NB : only one simulator shall exist at a time (it is the library clock)
+    KnxBusSimulator(unsigned long stepMicros = 200, unsigned long randomSeed = 1);
+    ~KnxBusSimulator();
+
+    // Attach a participant, return KNXBUSSIM_ERROR when the max nb of participants is reached
+    byte Attach(KnxBusParticipant& participant);
+
+    // Set the function called at every simulation step (e.g. the KnxDevice application loop)
+    void SetStepCallback(type_KnxBusSimStepCallbackFctPtr callback) { _stepCallback = callback; }
+
+    // Run the simulation during the given (virtual) duration
+    void Run(unsigned long long durationMicros);
+
+    // Virtual time
+    unsigned long long GetTime(void) const { return _time; }
+
+    // Deterministic pseudo random generator shared by the participants (xorshift)
+    unsigned long Random(void);
+
+    // Statistics
+    void ClearStats(void);
+    unsigned long GetFramesNb(void) const { return _framesNb; }
+    float GetBusLoad(void) const; // %
+    float GetThroughput(void) const; // acknowledged frames per second
+    const KnxBusLatencyStats& GetLatencyStats(e_KnxPriority priority) const { return _latency[priority >> 2]; }
+    byte GetParticipantsNb(void) const { return _participantsNb; }
+    KnxBusParticipant& GetParticipant(byte index) const { return *_participants[index]; }
+    const type_KnxBusParticipantStats& GetParticipantStats(byte index) const { return _stats[index]; }
+
+    // Print the statistics (CSV format) :
+    // bus;<label>;duration_s;frames;load_pct;throughput_fps
+    // priority;<label>;priority;samples;avg_ms;p50_ms;p90_ms;p99_ms;max_ms
+    // participant;<label>;addr;requested;sent;failed;dropped;drop_pct;repeats;arbitration_lost
+    void PrintStats(const char *label) const;
+
+  private:
+    void ProcessBus(unsigned long long limitTime);
+    boolean StartTransmission(unsigned long long limitTime);
+    void CompleteTransmission(void);
+};
+
+
+// Scripted traffic source
+// The frames (group value write) are generated with a Poisson distribution (or a fixed period) on a range of
+// group addresses, and queued in a TX queue of limited size. The generator may also acknowledge a range of
+// group addresses (e.g. line coupler) with a given rate of NACK and BUSY answers.
+class KnxBusTrafficGenerator : public KnxBusParticipant {
+    KnxBusSimulator& _sim;
+    const word _physicalAddr;
+    const e_KnxPriority _priority;
+    unsigned long _meanPeriodMicros;    // 0 : no traffic
+    boolean _fixedPeriod;
+    word _firstGroupAddr;
+    word _groupAddrNb;
+    byte _payloadLength;
+    byte _queueSize;
+    KnxTelegram _queue[KNXBUSSIM_GENERATOR_QUEUE_MAX];
+    unsigned long long _queueTime[KNXBUSSIM_GENERATOR_QUEUE_MAX];
+    byte _queueHead, _queueNb;
+    unsigned long long _nextFrameTime;
+    unsigned long _framesCounter;
+    word _ackFirstGroupAddr, _ackGroupAddrNb; // acknowledged group addresses
+    byte _nackPercent, _busyPercent;
+    unsigned long _requestedNb, _droppedNb, _receivedNb;
+
+  public:
+    KnxBusTrafficGenerator(KnxBusSimulator& sim, word physicalAddr, e_KnxPriority priority = KNX_PRIORITY_NORMAL_VALUE,
+                           unsigned long meanPeriodMicros = 0, word firstGroupAddr = 0x0A00, word groupAddrNb = 1,
+                           byte payloadLength = 1, byte queueSize = 8);
+
+    // Traffic settings
+    void SetTraffic(unsigned long meanPeriodMicros, boolean fixedPeriod = false);
+    void SetAcknowledge(word firstGroupAddr, word groupAddrNb, byte nackPercent = 0, byte busyPercent = 0);
+    unsigned long GetReceivedFramesNb(void) const { return _receivedNb; }
+    void ClearStats(void) { _requestedNb = _droppedNb = _receivedNb = 0; }
+
+    // KnxBusParticipant interface
+    word GetPhysicalAddr(void) const { return _physicalAddr; }
+    KnxTelegram* GetPendingFrame(void) { return _queueNb ? &_queue[_queueHead] : NULL; }
+    unsigned long long GetPendingFrameTime(void) const { return _queueTime[_queueHead]; }
+    void PendingFrameCompleted(byte ack);
+    byte FrameReceived(const KnxTelegram& frame);
+    void Task(void);
+    unsigned long GetRequestedFramesNb(void) const { return _requestedNb; }
+    unsigned long GetDroppedFramesNb(void) const { return _droppedNb; }
+
+  private:
+    unsigned long NextPeriod(void);
+};
+
+#endif // KNXBUSSIMULATOR_H
+
+// EOF
@@ -0,0 +1,145 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxCaptureFile.cpp
+// Author : Franck Marini
+// Description : Capture files on the host (see KnxCaptureFile.h)
+// Module dependencies : KnxCapture
+
+#include "KnxCaptureFile.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+byte KnxCaptureFile::Open(const char *path)
+{
+  Close();
+  _file = fopen(path, "ab");
+  if (!_file) return KNX_CAPTURE_FILE_ERROR;
+  if ((ftell(_file) == 0) && (fwrite(KnxCaptureHeader, KNX_CAPTURE_HEADER_SIZE, 1, _file) != 1))
+  {
+    Close();
+    return KNX_CAPTURE_FILE_ERROR;
+  }
+  return KNX_CAPTURE_FILE_OK;
+}
+
+
+void KnxCaptureFile::Close(void)
+{
+  if (_file) { fclose(_file); _file = NULL; }
+}
+
+
+boolean KnxCaptureFile::Write(const byte record[], byte length)
+{
+  return (_file && (fwrite(record, length, 1, _file) == 1));
+}
+
+
+KnxCaptureReader::KnxCaptureReader()
+: _buffer(NULL), _size(0), _offset(0), _mapped(false), _lastTime(0), _time(0), _recordsNb(0), _truncated(false) {}
+
+
+byte KnxCaptureReader::Open(const char *path)
+{
+  struct stat fileStat;
+  void *map;
+  int fd;
+
+  Close();
+  fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return KNX_CAPTURE_FILE_ERROR;
+  if ((fstat(fd, &fileStat) < 0) || (fileStat.st_size < KNX_CAPTURE_HEADER_SIZE)) { close(fd); return KNX_CAPTURE_FILE_ERROR; }
+  map = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd); // the mapping remains valid
+  if (map == MAP_FAILED) return KNX_CAPTURE_FILE_ERROR;
+  madvise(map, fileStat.st_size, MADV_SEQUENTIAL);
+  if (Open((const byte *)map, fileStat.st_size) != KNX_CAPTURE_FILE_OK)
+  {
+    munmap(map, fileStat.st_size);
+    return KNX_CAPTURE_FILE_ERROR;
+  }
+  _mapped = true;
+  return KNX_CAPTURE_FILE_OK;
+}
+
+
+byte KnxCaptureReader::Open(const byte capture[], size_t size)
+{
+  Close();
+  if ((size < KNX_CAPTURE_HEADER_SIZE) || memcmp(capture, KnxCaptureHeader, KNX_CAPTURE_HEADER_SIZE))
+    return KNX_CAPTURE_FILE_ERROR;
+  _buffer = capture;
+  _size = size;
+  Rewind();
+  return KNX_CAPTURE_FILE_OK;
+}
+
+
+void KnxCaptureReader::Close(void)
+{
+  if (_mapped) munmap((void *)_buffer, _size);
+  _buffer = NULL;
+  _size = 0;
+  _mapped = false;
+  Rewind();
+}
+
+
+void KnxCaptureReader::Rewind(void)
+{
+  _offset = KNX_CAPTURE_HEADER_SIZE;
+  _lastTime = 0;
+  _time = 0;
+  _recordsNb = 0;
+  _truncated = false;
+}
+
+
+boolean KnxCaptureReader::Next(KnxCaptureRecord& record)
+{
+  const byte *raw;
+  unsigned long time;
+
+  if (!_buffer || (_offset >= _size)) return false;
+  raw = _buffer + _offset;
+  if ((raw[0] < KNX_CAPTURE_RECORD_HEADER_SIZE - 1) || (_offset + 1 + raw[0] > _size))
+  { // wrong length or record truncated
+    _truncated = true;
+    _offset = _size;
+    return false;
+  }
+  time = raw[2] | ((unsigned long)raw[3] << 8) | ((unsigned long)raw[4] << 16) | ((unsigned long)raw[5] << 24);
+  // signed difference with the previous record time (32 bits wrap around)
+  if (_recordsNb) _time += (long long)(int32_t)(uint32_t)(time - _lastTime);
+  else _time = time;
+  _lastTime = time;
+  record.type = (e_KnxCaptureRecordType)raw[1];
+  record.timeMicros = _time;
+  record.dataLength = raw[0] + 1 - KNX_CAPTURE_RECORD_HEADER_SIZE;
+  record.data = raw + KNX_CAPTURE_RECORD_HEADER_SIZE;
+  _offset += 1 + raw[0];
+  _recordsNb++;
+  return true;
+}
+
+// EOF
@@ -0,0 +1,100 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxCaptureFile.h
+// Author : Franck Marini
+// Description : Capture files on the host (see KnxCapture.h for the format)
+//               - KnxCaptureFile : capture sink appending the records to a file (the header is written when the
+//                 file is created)
+//               - KnxCaptureReader : sequential reader of a capture, memory-mapped from a file or given in memory.
+//                 The record times are extended to 64 bits. A record truncated at the capture end (e.g. power loss
+//                 while writing) ends the reading.
+// Module dependencies : KnxCapture
+
+#ifndef KNXCAPTUREFILE_H
+#define KNXCAPTUREFILE_H
+
+#include "Arduino.h"
+#include "KnxCapture.h"
+
+#define KNX_CAPTURE_FILE_OK     0
+#define KNX_CAPTURE_FILE_ERROR  255
+
+class KnxCaptureFile : public KnxCaptureSink {
+    FILE *_file;
+
+  public:
+    KnxCaptureFile() : _file(NULL) {}
+    ~KnxCaptureFile() { Close(); }
+
+    // Open a capture file for appending (created if it does not exist)
+    // return KNX_CAPTURE_FILE_ERROR in case of failure, else KNX_CAPTURE_FILE_OK
+    byte Open(const char *path);
+    void Close(void);
+    void Flush(void) { if (_file) fflush(_file); }
+
+    // KnxCaptureSink interface
+    boolean Write(const byte record[], byte length);
+};
+
+
+// Record read from a capture
+struct KnxCaptureRecord {
+  e_KnxCaptureRecordType type;
+  unsigned long long timeMicros; // record time extended to 64 bits
+  byte dataLength;
+  const byte *data;              // points in the capture
+};
+
+
+class KnxCaptureReader {
+    const byte *_buffer;           // whole capture, header included
+    size_t _size;
+    size_t _offset;                // offset of the next record
+    boolean _mapped;               // true when the capture is a memory-mapped file
+    unsigned long _lastTime;       // last record time as stored (32 bits)
+    unsigned long long _time;      // last record time extended to 64 bits
+    unsigned long _recordsNb;      // nb of records read since the rewind
+    boolean _truncated;            // true when the capture ends with a truncated record
+
+  public:
+    KnxCaptureReader();
+    ~KnxCaptureReader() { Close(); }
+
+    // Open a capture file (memory-mapped) or a capture in memory (not copied)
+    // return KNX_CAPTURE_FILE_ERROR if the capture can not be read or if its header is wrong
+    byte Open(const char *path);
+    byte Open(const byte capture[], size_t size);
+    void Close(void);
+
+    // Get back to the 1st record
+    void Rewind(void);
+
+    // Read the next record, return false at the end of the capture
+    boolean Next(KnxCaptureRecord& record);
+
+    unsigned long GetRecordsNb(void) const { return _recordsNb; }
+    boolean IsTruncated(void) const { return _truncated; }
+    size_t GetSize(void) const { return _size; }
+};
+
+#endif // KNXCAPTUREFILE_H
+
+// EOF
@@ -0,0 +1,196 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxReplayCoupler.cpp
+// Author : Franck Marini
+// Description : Bus coupler replaying a capture to a KnxDevice (see KnxReplayCoupler.h)
+// Module dependencies : KnxBusCoupler, KnxCaptureFile
+
+#include "KnxReplayCoupler.h"
+
+KnxReplayCoupler::KnxReplayCoupler(KnxCaptureReader& reader, word speed)
+: _reader(reader), _speed(speed), _evtCallbackFct(NULL), _stateIndication(0),
+  _started(false), _pending(false), _captureStartTime(0), _elapsedMicros(0), _lastMicros(0), _rxNb(0), _skippedNb(0),
+  _eventsNb(0), _acksNb(0), _unmatchedAcksNb(0), _capturedTxNb(0), _sentNb(0)
+{
+  _rx.state = RX_RESET;
+  _rx.addressedComObjectIndex = 0;
+  _rx.overflowsNb = 0;
+  _tx.state = TX_RESET;
+  _tx.sentTelegram = NULL;
+  _tx.ackFctPtr = NULL;
+  _tx.nbRemainingBytes = 0;
+  _tx.txByteIndex = 0;
+}
+
+
+byte KnxReplayCoupler::SetEvtCallback(type_EventCallbackFctPtr evtCallbackFct)
+{
+  if (evtCallbackFct == NULL) return KNX_BUSCOUPLER_ERROR;
+  if ((_rx.state!=RX_INIT) || (_tx.state!=TX_INIT)) return KNX_BUSCOUPLER_ERROR_NOT_INIT_STATE;
+  _evtCallbackFct = evtCallbackFct;
+  return KNX_BUSCOUPLER_OK;
+}
+
+
+byte KnxReplayCoupler::SetAckCallback(type_AckCallbackFctPtr ackFctPtr)
+{
+  if (ackFctPtr == NULL) return KNX_BUSCOUPLER_ERROR;
+  if ((_rx.state!=RX_INIT) || (_tx.state!=TX_INIT)) return KNX_BUSCOUPLER_ERROR_NOT_INIT_STATE;
+  _tx.ackFctPtr = ackFctPtr;
+  return KNX_BUSCOUPLER_OK;
+}
+
+
+// A telegram being sent is abandoned, the replay goes on
+byte KnxReplayCoupler::Reset(void)
+{
+  _rx.state = RX_INIT;
+  _tx.state = TX_INIT;
+  return KNX_BUSCOUPLER_OK;
+}
+
+
+byte KnxReplayCoupler::AttachComObjectsList(KnxComObject comObjectsList[], byte listSize)
+{
+  if ((_rx.state!=RX_INIT) || (_tx.state!=TX_INIT)) return KNX_BUSCOUPLER_ERROR_NOT_INIT_STATE;
+  _comObjects.Attach(comObjectsList, listSize);
+  return KNX_BUSCOUPLER_OK;
+}
+
+
+byte KnxReplayCoupler::AttachComObjectsList(KnxComObject** comObjectsList, byte listSize)
+{
+  if ((_rx.state!=RX_INIT) || (_tx.state!=TX_INIT)) return KNX_BUSCOUPLER_ERROR_NOT_INIT_STATE;
+  _comObjects.Attach(comObjectsList, listSize);
+  return KNX_BUSCOUPLER_OK;
+}
+
+
+// The 1st call starts the replay
+byte KnxReplayCoupler::Init(void)
+{
+  if ((_rx.state!=RX_INIT) || (_tx.state!=TX_INIT)) return KNX_BUSCOUPLER_ERROR_NOT_INIT_STATE;
+  if (_evtCallbackFct == NULL) return KNX_BUSCOUPLER_ERROR_NULL_EVT_CALLBACK_FCT;
+  if (_tx.ackFctPtr == NULL) return KNX_BUSCOUPLER_ERROR_NULL_ACK_CALLBACK_FCT;
+  _rx.state = RX_IDLE_WAITING_FOR_CTRL_FIELD;
+  _tx.state = TX_IDLE;
+  if (!_started)
+  {
+    _started = true;
+    _reader.Rewind();
+    _pending = _reader.Next(_nextRecord);
+    _captureStartTime = _pending ? _nextRecord.timeMicros : 0;
+    _elapsedMicros = 0;
+    _lastMicros = KnxMicros();
+  }
+  return KNX_BUSCOUPLER_OK;
+}
+
+
+byte KnxReplayCoupler::SendTelegram(KnxTelegram& sentTelegram)
+{
+  if (_tx.state != TX_IDLE) return KNX_BUSCOUPLER_ERROR; // TX not initialized or busy
+  _tx.sentTelegram = &sentTelegram;
+  _tx.state = TX_WAITING_ACK;
+  _sentNb++;
+  return KNX_BUSCOUPLER_OK;
+}
+
+
+// Replay the records whose time has come
+void KnxReplayCoupler::RXTask(void)
+{
+  unsigned long nowMicros;
+
+  if (_rx.state < RX_IDLE_WAITING_FOR_CTRL_FIELD) return;
+  nowMicros = KnxMicros();
+  _elapsedMicros += (unsigned long)(nowMicros - _lastMicros);
+  _lastMicros = nowMicros;
+  while (_pending)
+  {
+    // NB : a record older than the previous one is replayed at once
+    if ((_speed != KNX_REPLAY_AS_FAST_AS_POSSIBLE) && (_nextRecord.timeMicros > _captureStartTime)
+        && (_nextRecord.timeMicros - _captureStartTime > _elapsedMicros * _speed)) break;
+    Replay(_nextRecord);
+    _pending = _reader.Next(_nextRecord);
+    if (_speed == KNX_REPLAY_AS_FAST_AS_POSSIBLE) break;
+  }
+}
+
+
+// Once the capture is over, the sent telegrams are acknowledged immediately
+void KnxReplayCoupler::TXTask(void)
+{
+  if (!_pending && (_tx.state == TX_WAITING_ACK))
+  {
+    _tx.state = TX_IDLE;
+    _tx.ackFctPtr(ACK_RESPONSE);
+  }
+}
+
+
+void KnxReplayCoupler::Replay(const KnxCaptureRecord& record)
+{
+  type_buscoupler_rx_telegram rxTelegram;
+  byte index;
+
+  switch (record.type)
+  {
+    case KNX_CAPTURE_RX_TELEGRAM :
+      if ((record.dataLength < 1 + KNX_TELEGRAM_MIN_SIZE) || (record.dataLength > 1 + KNX_TELEGRAM_MAX_SIZE)) break;
+      for (byte i = 0; i < record.dataLength - 1; i++) rxTelegram.telegram.WriteRawByte(record.data[1 + i], i);
+      if (!rxTelegram.telegram.IsMulticast() || !_comObjects.IsAddressAssigned(rxTelegram.telegram.GetTargetAddress(), index))
+      {
+        _skippedNb++;
+        break;
+      }
+      rxTelegram.telegram.Copy(_rx.receivedTelegram);
+      _rx.addressedComObjectIndex = index;
+      rxTelegram.comObjectIndex = index;
+      rxTelegram.timeMicros = KnxMicros();
+      QueueReceivedTelegram(_rx, rxTelegram);
+      _rxNb++;
+      _evtCallbackFct(BUSCOUPLER_EVENT_RECEIVED_EIB_TELEGRAM);
+      break;
+
+    case KNX_CAPTURE_TX_TELEGRAM :
+      _capturedTxNb++;
+      break;
+
+    case KNX_CAPTURE_TX_ACK :
+      if ((record.dataLength < 1) || (_tx.state != TX_WAITING_ACK)) { _unmatchedAcksNb++; break; }
+      _tx.state = TX_IDLE;
+      _acksNb++;
+      _tx.ackFctPtr((e_BusCouplerTxAck)record.data[0]);
+      break;
+
+    case KNX_CAPTURE_EVENT :
+      if (record.dataLength < 2) break;
+      _stateIndication = record.data[1];
+      _eventsNb++;
+      _evtCallbackFct((e_KnxBusCouplerEvent)record.data[0]);
+      break;
+
+    default : break; // unknown record type (later format version)
+  }
+}
+
+// EOF
@@ -0,0 +1,104 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxReplayCoupler.h
+// Author : Franck Marini
+// Description : Bus coupler replaying a capture (see KnxCapture.h) to a KnxDevice
+//               The captured received telegrams and coupler events are delivered by RXTask() at the capture pace
+//               (real time), N times faster, or one record per RXTask() call (as fast as possible).
+//               - the received telegrams are routed with the com objects attached to the replay coupler (the captured
+//                 com object index is not used), the telegrams not addressed to them are skipped
+//               - the reset, reception error and state indication events are notified with the captured state
+//               - a telegram sent by the device is acknowledged with the next captured TX acknowledge, and
+//                 immediately once the capture is over. The captured sent telegrams are only counted.
+//               The replay starts at Init(), the time reference is KnxMicros().
+// Module dependencies : KnxBusCoupler, KnxCaptureFile, KnxComObjectTable
+
+#ifndef KNXREPLAYCOUPLER_H
+#define KNXREPLAYCOUPLER_H
+
+#include "Arduino.h"
+#include "KnxBusCoupler.h"
+#include "KnxComObjectTable.h"
+#include "KnxCaptureFile.h"
+
+#define KNX_REPLAY_AS_FAST_AS_POSSIBLE 0 // speed value
+
+class KnxReplayCoupler : public KnxBusCoupler {
+    KnxCaptureReader& _reader;
+    const word _speed;                        // 1 for real time, N for N times faster
+    type_buscoupler_rx _rx;                   // Reception structure
+    type_buscoupler_tx _tx;                   // Transmission structure
+    type_EventCallbackFctPtr _evtCallbackFct; // Pointer to the EVENTS callback function
+    KnxComObjectTable _comObjects;            // Attached com objects, ordered by address
+    byte _stateIndication;                    // last replayed state indication
+    boolean _started;                         // replay started (1st Init() call)
+    boolean _pending;                         // _nextRecord is valid
+    KnxCaptureRecord _nextRecord;             // next record to replay
+    unsigned long long _captureStartTime;     // time of the 1st record
+    unsigned long long _elapsedMicros;        // replay time
+    unsigned long _lastMicros;                // last KnxMicros() value read
+    // Statistics
+    unsigned long _rxNb, _skippedNb, _eventsNb, _acksNb, _unmatchedAcksNb, _capturedTxNb, _sentNb;
+
+  public:
+    KnxReplayCoupler(KnxCaptureReader& reader, word speed);
+
+    // Replay status and statistics
+    boolean IsFinished(void) const { return _started && !_pending; }
+    unsigned long GetRxTelegramsNb(void) const { return _rxNb; }      // telegrams delivered to the device
+    unsigned long GetSkippedNb(void) const { return _skippedNb; }     // telegrams not addressed to the com objects
+    unsigned long GetEventsNb(void) const { return _eventsNb; }       // events notified
+    unsigned long GetAcksNb(void) const { return _acksNb; }           // captured ACKs notified to the device
+    unsigned long GetUnmatchedAcksNb(void) const { return _unmatchedAcksNb; } // captured ACKs without device telegram
+    unsigned long GetCapturedTxNb(void) const { return _capturedTxNb; } // telegrams sent in the capture
+    unsigned long GetSentNb(void) const { return _sentNb; }           // telegrams sent by the device
+
+    // KnxBusCoupler interface
+    byte SetEvtCallback(type_EventCallbackFctPtr);
+    void SetReceivedTelegram(KnxTelegram &telegram) {}
+    byte SetAckCallback(type_AckCallbackFctPtr);
+    byte GetStateIndication(void) const { return _stateIndication; }
+    KnxTelegram& GetReceivedTelegram(void) { return _rx.receivedTelegram; }
+    byte GetTargetedComObjectIndex(void) const { return _rx.addressedComObjectIndex; }
+    boolean IsActive(void) const { return (_tx.state > TX_IDLE); }
+    boolean PopReceivedTelegram(type_buscoupler_rx_telegram& rxTelegram) { return _rx.queue.Pop(rxTelegram); }
+    word GetRxOverflowsNb(void) const { return _rx.overflowsNb; }
+#if defined(KNXTPUART_DEBUG_INFO) || defined(KNXTPUART_DEBUG_ERROR)
+    void SetTraceRing(KnxTraceRing *traceRing) {}
+#endif
+    byte Reset(void);
+    byte AttachComObjectsList(KnxComObject comObjectsList[], byte listSize);
+    byte AttachComObjectsList(KnxComObject** comObjectsList, byte listSize);
+    byte Init(void);
+    byte SendTelegram(KnxTelegram& sentTelegram);
+    void RXTask(void);
+    void TXTask(void);
+    boolean GetMonitoringData(type_MonitorData&) { return false; }
+    void DEBUG_SendResetCommand(void) {}
+    void DEBUG_SendStateReqCommand(void) {}
+
+  private:
+    void Replay(const KnxCaptureRecord& record);
+};
+
+#endif // KNXREPLAYCOUPLER_H
+
+// EOF
@@ -0,0 +1,441 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : TpUartEmulator.cpp
+// Author : Franck Marini
+// Description : Byte accurate TPUART emulator for host tests and benchmarks (see TpUartEmulator.h)
+// Module dependencies : Arduino (host), KnxTelegram
+
+#include "TpUartEmulator.h"
+
+// TPUART services (seen from the TPUART side)
+#define SERVICE_RESET_REQ          0x01
+#define SERVICE_STATE_REQ          0x02
+#define SERVICE_ACTIVATEBUSMON_REQ 0x05
+#define SERVICE_SET_ADDR_REQ       0x28
+#define SERVICE_ACK_INFO           0x10 // 0x10 to 0x17
+#define SERVICE_ACK_INFO_MASK      0xF8
+#define SERVICE_DATA_START_CONT    0x80 // + byte index
+#define SERVICE_DATA_END           0x40 // + byte index
+#define SERVICE_DATA_MASK          0xC0
+#define SERVICE_DATA_INDEX_MASK    0x3F
+#define RESET_INDICATION           0x03
+#define STATE_INDICATION           0x07
+#define STATE_PROTOCOL_ERROR       0x10
+#define DATA_CONFIRM_SUCCESS       0x8B
+#define DATA_CONFIRM_FAILED        0x0B
+#define CTRL_FIELD_REPEAT_FLAG     0x20 // cleared in repeated frames
+#define ADDR_TYPE_OCTET_INDEX      5    // the ACK info refers to the address type octet
+#define BUS_ACK                    0xCC // acknowledge character on the bus
+
+// Decoding state of the services written by the driver
+enum { SERVICE_IDLE, SERVICE_ADDR_HIGH, SERVICE_ADDR_LOW, SERVICE_DATA, SERVICE_DATA_LAST };
+
+// Time when the byte of a frame started on the bus at "start" is available to the driver
+#define BUS_BYTE_RX_TIME(start, index) ((start) + (unsigned long)(index) * TPUARTEMU_BUS_BYTE_PERIOD \
+                                        + TPUARTEMU_BUS_CHAR_TIME + TPUARTEMU_UART_CHAR_TIME)
+
+// Time when the acknowledge character of a frame started on the bus at "start" is completed
+#define BUS_ACK_END_TIME(start, length) ((start) + (unsigned long)((length) - 1) * TPUARTEMU_BUS_BYTE_PERIOD \
+                                         + TPUARTEMU_BUS_CHAR_TIME + TPUARTEMU_BUS_ACK_GAP + TPUARTEMU_BUS_CHAR_TIME)
+
+#define TIME_REACHED(time, now) ((long)((now) - (time)) >= 0)
+
+
+TpUartEmulator::TpUartEmulator()
+: _rxHead(0), _rxTail(0), _rxFrameContinued(false), _rxLastReadMicros(0), _rxEopPending(false), _rxUnitLength(0),
+  _missedEopsNb(0), _txHead(0), _txTail(0), _txLineEndMicros(0), _baudRate(0),
+  _responding(true), _busMonitor(false), _busAcknowledge(true), _physicalAddr(0), _stateFlags(0),
+  _serviceState(SERVICE_IDLE), _txFrameIndex(0), _txFrameValid(false), _busFreeMicros(0),
+  _ackRecordsNb(0), _retiredLateAcksNb(0), _retiredMissedAcksNb(0), _unexpectedAcksNb(0),
+  _protocolErrorsNb(0), _resetRequestsNb(0), _stateRequestsNb(0), _busFramesNb(0) {}
+
+
+// Process the bytes written by the driver and received by the TPUART till now
+void TpUartEmulator::Update(void)
+{
+  unsigned long now = KnxMicros();
+
+  while ((_txHead != _txTail) && TIME_REACHED(_txQueue[_txHead].time, now))
+  {
+    ProcessService(_txQueue[_txHead].data, _txQueue[_txHead].time);
+    _txHead++;
+  }
+  if (_txHead == _txTail) _txHead = _txTail = 0; // queue empty, restart from the beginning
+}
+
+
+byte TpUartEmulator::InjectBusFrame(const byte frame[], byte length)
+{
+  unsigned long startTime;
+  TpUartEmulatorAckRecord *record;
+
+  if ((length <= ADDR_TYPE_OCTET_INDEX) || (length > KNX_TELEGRAM_MAX_SIZE)) return TPUARTEMU_ERROR;
+  if (_rxTail + length > TPUARTEMU_RX_QUEUE_SIZE) return TPUARTEMU_ERROR;
+  Update(); // the driver services received before the injection are processed first
+
+  startTime = ScheduleBusFrame(frame, length, KnxMicros());
+  if (_busMonitor && _busAcknowledge) // the bus acknowledge character is forwarded too
+    ScheduleRxByte(BUS_ACK, BUS_ACK_END_TIME(startTime, length) + TPUARTEMU_UART_CHAR_TIME, false);
+  if (_ackRecordsNb == TPUARTEMU_ACK_RECORDS_NB) RetireAckRecords();
+  if ((!_busMonitor) && (_ackRecordsNb < TPUARTEMU_ACK_RECORDS_NB))
+  { // the TPUART expects the ACK info service of the driver
+    record = &_ackRecords[_ackRecordsNb++];
+    record->targetAddr = ((word)frame[3] << 8) + frame[4];
+    record->addrTypeRxMicros = BUS_BYTE_RX_TIME(startTime, ADDR_TYPE_OCTET_INDEX);
+    record->frameEndMicros = BUS_BYTE_RX_TIME(startTime, length - 1);
+    record->ackMicros = 0;
+    record->ackService = 0;
+  }
+  return TPUARTEMU_OK;
+}
+
+
+byte TpUartEmulator::InjectBusTelegram(const KnxTelegram& telegram)
+{
+  byte frame[KNX_TELEGRAM_MAX_SIZE];
+
+  for (byte i = 0; i < telegram.GetTelegramLength(); i++) frame[i] = telegram.ReadRawByte(i);
+  return InjectBusFrame(frame, telegram.GetTelegramLength());
+}
+
+
+void TpUartEmulator::SimulateReset(void)
+{
+  Update();
+  _busMonitor = false; _physicalAddr = 0; _serviceState = SERVICE_IDLE;
+  ScheduleAnswer(RESET_INDICATION, KnxMicros() + TPUARTEMU_UART_CHAR_TIME);
+}
+
+
+byte TpUartEmulator::GetLateAcksNb(void)
+{
+  byte nb = 0;
+
+  Update();
+  for (byte i = 0; i < _ackRecordsNb; i++)
+    if (_ackRecords[i].ackService && (_ackRecords[i].ackMicros - _ackRecords[i].addrTypeRxMicros > TPUARTEMU_ACK_DEADLINE)) nb++;
+  return nb;
+}
+
+
+byte TpUartEmulator::GetMissedAcksNb(void)
+{
+  byte nb = 0;
+  unsigned long now;
+
+  Update();
+  now = KnxMicros();
+  for (byte i = 0; i < _ackRecordsNb; i++)
+    if ((!_ackRecords[i].ackService) && TIME_REACHED(_ackRecords[i].addrTypeRxMicros + TPUARTEMU_ACK_DEADLINE, now)) nb++;
+  return nb;
+}
+
+
+unsigned long TpUartEmulator::GetTotalLateAcksNb(void) { return _retiredLateAcksNb + GetLateAcksNb(); }
+
+
+unsigned long TpUartEmulator::GetTotalMissedAcksNb(void) { return _retiredMissedAcksNb + GetMissedAcksNb(); }
+
+
+void TpUartEmulator::ClearAckRecords(void)
+{
+  _ackRecordsNb = 0; _unexpectedAcksNb = 0;
+  _retiredLateAcksNb = _retiredMissedAcksNb = 0;
+}
+
+
+byte TpUartEmulator::GetBusFrame(word index, byte frame[]) const
+{
+  index %= TPUARTEMU_BUS_FRAMES_NB;
+  for (byte i = 0; i < _busFramesLength[index]; i++) frame[i] = _busFrames[index][i];
+  return _busFramesLength[index];
+}
+
+
+// The bytes already available when the UART is (re)opened are lost
+void TpUartEmulator::begin(unsigned long baud, uint32_t config, int8_t rxPin, int8_t txPin, bool invert)
+{
+  unsigned long now;
+
+  Update();
+  now = KnxMicros();
+  _baudRate = baud;
+  _rxEopPending = false;
+  while ((_rxHead != _rxTail) && TIME_REACHED(_rxQueue[_rxHead].time, now)) _rxFrameContinued = _rxQueue[_rxHead++].frameContinued;
+  if (_rxHead == _rxTail) _rxHead = _rxTail = 0;
+}
+
+
+int TpUartEmulator::available(void)
+{
+  unsigned long now;
+  word index;
+
+  Update();
+  now = KnxMicros();
+  CheckDriverEop(now);
+  for (index = _rxHead; (index != _rxTail) && TIME_REACHED(_rxQueue[index].time, now); index++);
+  return index - _rxHead;
+}
+
+
+int TpUartEmulator::read(void)
+{
+  byte data;
+  if (readBytes(&data, 1) != 1) return -1;
+  return data;
+}
+
+
+size_t TpUartEmulator::readBytes(uint8_t *buffer, size_t length)
+{
+  unsigned long now;
+  size_t i;
+
+  Update();
+  now = KnxMicros();
+  CheckDriverEop(now);
+  for (i = 0; (i < length) && (_rxHead != _rxTail) && TIME_REACHED(_rxQueue[_rxHead].time, now); i++)
+  {
+    if (!_rxFrameContinued)
+    { // 1st byte of a frame or of a service answer, the driver shall have seen the end of the previous frame
+      if (_rxEopPending) _missedEopsNb++;
+      _rxEopPending = false;
+      _rxUnitLength = 0;
+    }
+    _rxFrameContinued = _rxQueue[_rxHead].frameContinued;
+    buffer[i] = _rxQueue[_rxHead++].data;
+    if ((++_rxUnitLength > 1) && !_rxFrameContinued) _rxEopPending = true; // last byte of a frame
+  }
+  if (i) _rxLastReadMicros = now;
+  if (_rxHead == _rxTail) _rxHead = _rxTail = 0;
+  return i;
+}
+
+
+// The characters are sent one after the other on the UART line, each one reaches the TPUART at the end of its character time
+size_t TpUartEmulator::write(const uint8_t *buffer, size_t size)
+{
+  unsigned long now;
+  size_t i;
+
+  Update();
+  now = KnxMicros();
+  if (!TIME_REACHED(_txLineEndMicros, now)) now = _txLineEndMicros; // line busy
+  if (_txHead && (_txTail + size > TPUARTEMU_TX_QUEUE_SIZE))
+  { // move the pending bytes at the beginning of the queue
+    memmove(_txQueue, _txQueue + _txHead, (_txTail - _txHead) * sizeof(_txQueue[0]));
+    _txTail -= _txHead; _txHead = 0;
+  }
+  for (i = 0; (i < size) && (_txTail < TPUARTEMU_TX_QUEUE_SIZE); i++)
+  {
+    now += TPUARTEMU_UART_CHAR_TIME;
+    _txQueue[_txTail].data = buffer[i];
+    _txQueue[_txTail++].time = now;
+  }
+  _txLineEndMicros = now;
+  return i;
+}
+
+
+int TpUartEmulator::availableForWrite(void)
+{
+  long pendingTime = (long)(_txLineEndMicros - KnxMicros());
+  word pendingChars = (pendingTime > 0) ? (pendingTime + TPUARTEMU_UART_CHAR_TIME - 1) / TPUARTEMU_UART_CHAR_TIME : 0;
+
+  Update();
+  return (pendingChars < TPUARTEMU_TX_FIFO_SIZE) ? TPUARTEMU_TX_FIFO_SIZE - pendingChars : 0;
+}
+
+
+// The driver detects the end of a frame when it polls the UART after a gap of more than 2ms without data
+void TpUartEmulator::CheckDriverEop(unsigned long now)
+{
+  if (_rxEopPending && (now - _rxLastReadMicros > TPUARTEMU_EOP_GAP)) _rxEopPending = false;
+}
+
+
+// Fold the records that cannot change anymore in the totals, so that new frames can be recorded
+// A record is final once acknowledged, or once the address type octet of a later frame has been available to the
+// driver (an ACK info refers to the last frame only)
+void TpUartEmulator::RetireAckRecords(void)
+{
+  unsigned long now = KnxMicros();
+  byte retiredNb = 0;
+
+  while (retiredNb < _ackRecordsNb)
+  {
+    TpUartEmulatorAckRecord *record = &_ackRecords[retiredNb];
+    if (!record->ackService
+        && !((retiredNb + 1 < _ackRecordsNb) && TIME_REACHED(_ackRecords[retiredNb + 1].addrTypeRxMicros, now))) break;
+    if (record->ackService && (record->ackMicros - record->addrTypeRxMicros > TPUARTEMU_ACK_DEADLINE)) _retiredLateAcksNb++;
+    if (!record->ackService) _retiredMissedAcksNb++;
+    retiredNb++;
+  }
+  memmove(_ackRecords, _ackRecords + retiredNb, (_ackRecordsNb - retiredNb) * sizeof(_ackRecords[0]));
+  _ackRecordsNb -= retiredNb;
+}
+
+
+// Insert a byte towards the driver, the queue is kept ordered by availability time
+void TpUartEmulator::ScheduleRxByte(byte data, unsigned long time, boolean frameContinued)
+{
+  word index;
+
+  if (_rxHead && (_rxTail == TPUARTEMU_RX_QUEUE_SIZE))
+  { // move the pending bytes at the beginning of the queue
+    memmove(_rxQueue, _rxQueue + _rxHead, (_rxTail - _rxHead) * sizeof(_rxQueue[0]));
+    _rxTail -= _rxHead; _rxHead = 0;
+  }
+  if (_rxTail == TPUARTEMU_RX_QUEUE_SIZE) return; // queue full, the byte is lost
+  for (index = _rxTail; (index > _rxHead) && ((long)(_rxQueue[index - 1].time - time) > 0); index--)
+    _rxQueue[index] = _rxQueue[index - 1];
+  _rxQueue[index].data = data;
+  _rxQueue[index].frameContinued = frameContinued;
+  _rxQueue[index].time = time;
+  _rxTail++;
+}
+
+
+// Insert an answer to a service, after the end of the frame being forwarded if any
+void TpUartEmulator::ScheduleAnswer(byte data, unsigned long time)
+{
+  word index;
+  boolean frameContinued;
+
+  for (index = _rxTail; (index > _rxHead) && ((long)(_rxQueue[index - 1].time - time) > 0); index--);
+  frameContinued = (index > _rxHead) ? _rxQueue[index - 1].frameContinued : _rxFrameContinued;
+  for ( ; frameContinued && (index < _rxTail); index++)
+  {
+    time = _rxQueue[index].time + TPUARTEMU_UART_CHAR_TIME;
+    frameContinued = _rxQueue[index].frameContinued;
+  }
+  ScheduleRxByte(data, time);
+}
+
+
+// Decode a byte written by the driver and received by the TPUART at "time"
+void TpUartEmulator::ProcessService(byte data, unsigned long time)
+{
+  switch (_serviceState)
+  {
+    case SERVICE_ADDR_HIGH : _physicalAddr = (word)data << 8; _serviceState = SERVICE_ADDR_LOW; return;
+
+    case SERVICE_ADDR_LOW : _physicalAddr |= data; _serviceState = SERVICE_IDLE; return;
+
+    case SERVICE_DATA :
+    case SERVICE_DATA_LAST :
+      _txFrame[_txFrameIndex++] = data;
+      if (_serviceState == SERVICE_DATA_LAST)
+      {
+        if (_txFrameValid) SendFrameOnBus(time);
+        else ScheduleAnswer(DATA_CONFIRM_FAILED, time + TPUARTEMU_UART_CHAR_TIME);
+      }
+      _serviceState = SERVICE_IDLE;
+      return;
+
+    default : break; // SERVICE_IDLE
+  }
+
+  if (!_responding) return;
+
+  if (data == SERVICE_RESET_REQ)
+  {
+    _resetRequestsNb++;
+    _busMonitor = false; _physicalAddr = 0; _txFrameValid = false;
+    ScheduleAnswer(RESET_INDICATION, time + TPUARTEMU_UART_CHAR_TIME);
+  }
+  else if (data == SERVICE_STATE_REQ)
+  {
+    _stateRequestsNb++;
+    ScheduleAnswer(STATE_INDICATION | _stateFlags, time + TPUARTEMU_UART_CHAR_TIME);
+  }
+  else if (data == SERVICE_SET_ADDR_REQ) _serviceState = SERVICE_ADDR_HIGH;
+  else if (data == SERVICE_ACTIVATEBUSMON_REQ) _busMonitor = true;
+  else if ((data & SERVICE_ACK_INFO_MASK) == SERVICE_ACK_INFO) ReceiveAckInfo(data, time);
+  else if (((data & SERVICE_DATA_MASK) == SERVICE_DATA_START_CONT) || ((data & SERVICE_DATA_MASK) == SERVICE_DATA_END))
+  { // the frame bytes shall be given in order, starting from index 0
+    if ((data & SERVICE_DATA_INDEX_MASK) == 0) _txFrameValid = true;
+    else if ((data & SERVICE_DATA_INDEX_MASK) != _txFrameIndex) _txFrameValid = false;
+    if (!_txFrameValid) { _protocolErrorsNb++; _stateFlags |= STATE_PROTOCOL_ERROR; }
+    _txFrameIndex = data & SERVICE_DATA_INDEX_MASK;
+    _serviceState = ((data & SERVICE_DATA_MASK) == SERVICE_DATA_END) ? SERVICE_DATA_LAST : SERVICE_DATA;
+  }
+  else { _protocolErrorsNb++; _stateFlags |= STATE_PROTOCOL_ERROR; }
+}
+
+
+// Send the frame received from the driver on the bus
+// The frame is repeated when not acknowledged, the data confirm is sent after the last acknowledge character
+void TpUartEmulator::SendFrameOnBus(unsigned long time)
+{
+  byte length = _txFrameIndex;
+  byte *recordedFrame = _busFrames[_busFramesNb % TPUARTEMU_BUS_FRAMES_NB];
+  unsigned long startTime;
+
+  for (byte i = 0; i < length; i++) recordedFrame[i] = _txFrame[i];
+  _busFramesLength[_busFramesNb % TPUARTEMU_BUS_FRAMES_NB] = length;
+  _busFramesRxMicros[_busFramesNb % TPUARTEMU_BUS_FRAMES_NB] = time;
+  _busFramesNb++;
+  _txFrameValid = false;
+
+  for (byte attempt = 0; ; attempt++)
+  {
+    startTime = ScheduleBusFrame(_txFrame, length, time);
+    if (_busAcknowledge || (attempt == TPUARTEMU_TX_REPEATS_NB)) break;
+    if (_txFrame[0] & CTRL_FIELD_REPEAT_FLAG)
+    { // repeated frame
+      _txFrame[0] &= ~CTRL_FIELD_REPEAT_FLAG;
+      _txFrame[length - 1] ^= CTRL_FIELD_REPEAT_FLAG; // checksum update
+    }
+  }
+  ScheduleAnswer(_busAcknowledge ? DATA_CONFIRM_SUCCESS : DATA_CONFIRM_FAILED,
+                 BUS_ACK_END_TIME(startTime, length) + TPUARTEMU_UART_CHAR_TIME);
+}
+
+
+// The ACK info refers to the last frame whose address type octet was available to the driver
+void TpUartEmulator::ReceiveAckInfo(byte service, unsigned long time)
+{
+  for (byte i = _ackRecordsNb; i > 0; i--)
+  {
+    TpUartEmulatorAckRecord *record = &_ackRecords[i - 1];
+    if (!TIME_REACHED(record->addrTypeRxMicros, time)) continue;
+    if (record->ackService) break; // already acknowledged
+    record->ackService = service;
+    record->ackMicros = time;
+    return;
+  }
+  _unexpectedAcksNb++;
+}
+
+
+// Schedule the frame bytes towards the driver (the TPUART forwards every frame seen on the bus, including its own ones)
+// return the frame start time on the bus
+unsigned long TpUartEmulator::ScheduleBusFrame(const byte frame[], byte length, unsigned long startTime)
+{
+  if (!TIME_REACHED(_busFreeMicros, startTime)) startTime = _busFreeMicros; // bus busy
+  for (byte i = 0; i < length; i++) ScheduleRxByte(frame[i], BUS_BYTE_RX_TIME(startTime, i), i < length - 1);
+  _busFreeMicros = BUS_ACK_END_TIME(startTime, length) + TPUARTEMU_BUS_IDLE_TIME;
+  return startTime;
+}
+
+// EOF
@@ -0,0 +1,196 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : TpUartEmulator.h
+// Author : Franck Marini
+// Description : Byte accurate TPUART emulator for host tests and benchmarks
+//               The emulator is a HardwareSerial stand-in playing the TPUART side of the serial line :
+//               - the UART line is modelled at 19200 baud 8E1 (1 character every 573us) in both directions,
+//                 a byte written by the driver reaches the TPUART at the end of its character time.
+//               - the TPUART services are answered : U_Reset.req (reset indication), U_State.req (state indication),
+//                 U_SetAddress, U_ActivateBusmon, U_Data start/continue/end (telegram sent on the bus, echo of the
+//                 telegram bytes, then data confirm success/failed with up to 3 repetitions on missing bus acknowledge).
+//                 An answer ready while a frame is being forwarded to the driver is sent after the frame end.
+//               - the TP1 bus is modelled at 9600 bit/s : a telegram byte is forwarded to the driver 1 bus character
+//                 plus 1 UART character after its start on the bus, the bus bytes come every 13 bit times.
+//               - in bus monitor mode, the injected frames are forwarded followed by their bus acknowledge character
+//                 (ACK, or none with SetBusAcknowledge(false)).
+//               - the bus traffic is injected by the test (InjectBusFrame), and for each injected frame the emulator
+//                 records whether the U_AckInformation service has reached the TPUART at latest 1,7ms after the
+//                 address type octet was available to the driver.
+//               - the driver polls are watched : a frame end is missed when the driver reads the next frame (or
+//                 service answer) without having polled the UART after a gap of more than 2ms.
+//               The time reference is KnxMicros() (micros() unless a virtual clock is installed), the emulator state
+//               is updated on every HardwareSerial call (or by calling Update()).
+// Module dependencies : Arduino (host), KnxTelegram, KnxClock
+
+#ifndef TPUARTEMULATOR_H
+#define TPUARTEMULATOR_H
+
+#include "Arduino.h"
+#include "KnxTelegram.h"
+#include "KnxClock.h"
+
+#define TPUARTEMU_OK     0
+#define TPUARTEMU_ERROR  255
+
+#define TPUARTEMU_RX_QUEUE_SIZE      1024 // bytes scheduled towards the driver
+#define TPUARTEMU_TX_QUEUE_SIZE      256  // bytes written by the driver and not received by the TPUART yet
+#define TPUARTEMU_TX_FIFO_SIZE       128  // size of the modelled UART TX FIFO
+#define TPUARTEMU_ACK_RECORDS_NB     64   // nb of injected frames whose ACK timing is recorded
+#define TPUARTEMU_BUS_FRAMES_NB      16   // nb of frames sent by the driver that are recorded
+
+#define TPUARTEMU_UART_CHAR_TIME     573  // 11 bits (start + 8 data + parity + stop) at 19200 baud
+#define TPUARTEMU_BUS_BIT_TIME       104  // 9600 bit/s
+#define TPUARTEMU_BUS_CHAR_TIME      (11 * TPUARTEMU_BUS_BIT_TIME) // start + 8 data + parity + stop
+#define TPUARTEMU_BUS_BYTE_PERIOD    (13 * TPUARTEMU_BUS_BIT_TIME) // character + 2 bits inter character gap
+#define TPUARTEMU_BUS_ACK_GAP        (15 * TPUARTEMU_BUS_BIT_TIME) // gap between the frame end and the acknowledge
+#define TPUARTEMU_BUS_IDLE_TIME      (50 * TPUARTEMU_BUS_BIT_TIME) // min bus idle time before a new frame
+#define TPUARTEMU_ACK_DEADLINE       1700 // the ACK info shall be received at latest 1,7ms after the address type octet
+#define TPUARTEMU_TX_REPEATS_NB      3    // nb of repetitions when the sent frame is not acknowledged
+#define TPUARTEMU_EOP_GAP            2000 // the driver detects the end of a frame after 2ms without data
+
+// Timing record of an injected frame acknowledge
+struct TpUartEmulatorAckRecord {
+  word targetAddr;                // target address of the injected frame
+  unsigned long addrTypeRxMicros; // time when the address type octet is available to the driver
+  unsigned long frameEndMicros;   // time when the frame end is available to the driver
+  unsigned long ackMicros;        // time when the ACK info service has been received by the TPUART
+  byte ackService;                // received ACK info service (0 if not received yet)
+};
+
+
+class TpUartEmulator : public HardwareSerial {
+    // Bytes towards the driver, ordered by availability time
+    struct { byte data; boolean frameContinued; unsigned long time; } _rxQueue[TPUARTEMU_RX_QUEUE_SIZE];
+    word _rxHead, _rxTail;          // read and write positions in the RX queue
+    boolean _rxFrameContinued;      // true when the last byte read by the driver is not the end of a frame
+    unsigned long _rxLastReadMicros; // time of the last read by the driver
+    boolean _rxEopPending;          // true when the driver has read a whole frame and has not detected its end yet
+    byte _rxUnitLength;             // nb of bytes of the frame (or service answer) being read by the driver
+    word _missedEopsNb;             // frame ends not detected by the driver
+    // Bytes written by the driver, ordered by reception time on the TPUART side
+    struct { byte data; unsigned long time; } _txQueue[TPUARTEMU_TX_QUEUE_SIZE];
+    word _txHead, _txTail;          // read and write positions in the TX queue
+    unsigned long _txLineEndMicros; // time when the last written character reaches the TPUART
+    unsigned long _baudRate;        // baud rate set by the driver
+
+    // TPUART state
+    boolean _responding;            // false emulates a TPUART not answering
+    boolean _busMonitor;            // U_ActivateBusmon received
+    boolean _busAcknowledge;        // false emulates a bus where the sent frames are not acknowledged
+    word _physicalAddr;             // address set by U_SetAddress
+    byte _stateFlags;               // error flags of the state indication
+    byte _serviceState;             // driver service decoding state
+    byte _txFrame[KNX_TELEGRAM_MAX_SIZE]; // frame being received from the driver
+    byte _txFrameIndex;             // index of the frame byte expected from the driver
+    boolean _txFrameValid;          // false in case of wrong byte index in the frame services
+    unsigned long _busFreeMicros;   // time from which a new frame may start on the bus
+
+    // Statistics
+    TpUartEmulatorAckRecord _ackRecords[TPUARTEMU_ACK_RECORDS_NB];
+    byte _ackRecordsNb;
+    unsigned long _retiredLateAcksNb, _retiredMissedAcksNb; // records folded in the totals
+    word _unexpectedAcksNb;
+    word _protocolErrorsNb;
+    word _resetRequestsNb;
+    word _stateRequestsNb;
+    byte _busFrames[TPUARTEMU_BUS_FRAMES_NB][KNX_TELEGRAM_MAX_SIZE]; // frames sent by the driver on the bus
+    byte _busFramesLength[TPUARTEMU_BUS_FRAMES_NB];
+    unsigned long _busFramesRxMicros[TPUARTEMU_BUS_FRAMES_NB]; // time when the U_Data end service was received
+    word _busFramesNb;
+
+  public:
+    TpUartEmulator();
+
+    // Update the emulator state till the current time (done by every HardwareSerial call)
+    void Update(void);
+
+    // Inject a frame on the bus, it starts at the current time or as soon as the bus is free
+    // return TPUARTEMU_ERROR if the frame cannot be scheduled (queue full or invalid length)
+    byte InjectBusFrame(const byte frame[], byte length);
+    byte InjectBusTelegram(const KnxTelegram& telegram);
+
+    // Emulate a TPUART reset (e.g. bus power failure), the reset indication is sent to the driver
+    void SimulateReset(void);
+
+    // Emulation options
+    void SetResponding(boolean responding) { _responding = responding; }
+    void SetBusAcknowledge(boolean acknowledge) { _busAcknowledge = acknowledge; }
+    void SetStateFlags(byte flags) { _stateFlags = flags; }
+
+    // TPUART state set by the driver
+    word GetPhysicalAddr(void) const { return _physicalAddr; }
+    boolean IsBusMonitor(void) const { return _busMonitor; }
+    unsigned long GetBaudRate(void) const { return _baudRate; }
+
+    // Time when the bus is free after the scheduled frames
+    unsigned long GetBusFreeMicros(void) const { return _busFreeMicros; }
+
+    // ACK timing records of the injected frames
+    // When all the records are used, the final ones (acknowledged, or followed by a newer frame) are folded in
+    // the totals and removed from the records
+    byte GetAckRecordsNb(void) const { return _ackRecordsNb; }
+    const TpUartEmulatorAckRecord& GetAckRecord(byte index) const { return _ackRecords[index]; }
+    void ClearAckRecords(void);
+    byte GetLateAcksNb(void);     // ACK received after the deadline
+    byte GetMissedAcksNb(void);   // no ACK received, and the deadline is elapsed
+    word GetUnexpectedAcksNb(void) const { return _unexpectedAcksNb; } // ACK without injected frame
+    unsigned long GetTotalLateAcksNb(void);   // including the folded records
+    unsigned long GetTotalMissedAcksNb(void);
+
+    // Frame ends missed by the driver (polling gap too short before the next frame)
+    word GetMissedEopsNb(void) const { return _missedEopsNb; }
+    void ClearMissedEopsNb(void) { _missedEopsNb = 0; }
+
+    // Service statistics
+    word GetProtocolErrorsNb(void) const { return _protocolErrorsNb; }
+    word GetResetRequestsNb(void) const { return _resetRequestsNb; }
+    word GetStateRequestsNb(void) const { return _stateRequestsNb; }
+
+    // Frames sent on the bus by the driver (the last TPUARTEMU_BUS_FRAMES_NB are kept)
+    word GetBusFramesNb(void) const { return _busFramesNb; }
+    byte GetBusFrame(word index, byte frame[]) const; // return the frame length
+    unsigned long GetBusFrameRxMicros(word index) const { return _busFramesRxMicros[index % TPUARTEMU_BUS_FRAMES_NB]; }
+
+    // HardwareSerial interface
+    void begin(unsigned long baud, uint32_t config = SERIAL_8E1, int8_t rxPin = -1, int8_t txPin = -1, bool invert = false);
+    void end(void) {}
+    int available(void);
+    int read(void);
+    size_t readBytes(uint8_t *buffer, size_t length);
+    size_t write(uint8_t data) { return write(&data, 1); }
+    size_t write(const uint8_t *buffer, size_t size);
+    int availableForWrite(void);
+
+  private:
+    void CheckDriverEop(unsigned long now);
+    void RetireAckRecords(void);
+    void ScheduleRxByte(byte data, unsigned long time, boolean frameContinued = false);
+    void ScheduleAnswer(byte data, unsigned long time);
+    void ProcessService(byte data, unsigned long time);
+    void SendFrameOnBus(unsigned long time);
+    void ReceiveAckInfo(byte service, unsigned long time);
+    unsigned long ScheduleBusFrame(const byte frame[], byte length, unsigned long startTime);
+};
+
+#endif // TPUARTEMULATOR_H
+
+// EOF
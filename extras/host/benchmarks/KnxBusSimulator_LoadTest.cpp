@@ -0,0 +1,146 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxBusSimulator_LoadTest.cpp
+// Author : Franck Marini
+// Description : Load test of a KnxDevice on a simulated TP1 line (virtual time)
+//               The line gathers the device (KnxDevice singleton through KnxBusSimCoupler), 4 traffic generators
+//               with different priorities and payload lengths, and a line coupler acknowledging all the group
+//               telegrams with 1% NACK and 1% BUSY answers. The device application writes a sensor object every
+//               200ms while the generators offered load increases, each load level is simulated for 10 minutes.
+//               Output format (CSV) : see KnxBusSimulator::PrintStats(), plus per load level :
+//               device;<label>;writes;sent_to_coupler;dropped;drop_pct;received
+//               NB : the device TX queue is the KnxDevice actions queue (the oldest action is lost when full),
+//               the latency of the device frames is measured from the SendTelegram() call.
+// Module dependencies : KnxDevice, KnxBusSimulator, KnxBusSimCoupler
+//
+// Build and run from the library root folder (single command line) :
+//   g++ -O2 -I extras/host -I . extras/host/benchmarks/KnxBusSimulator_LoadTest.cpp extras/host/KnxBusSimulator.cpp
+//       extras/host/KnxBusSimCoupler.cpp extras/host/ArduinoHost.cpp KnxDevice.cpp KnxTpUart.cpp KnxTelegram.cpp KnxClock.cpp
+//       KnxGroupStats.cpp KnxBusHealth.cpp KnxComObject.cpp KnxComObjectTable.cpp KnxDPTCodec.cpp StKnxCoupler.cpp
+//       KnxTxLatency.cpp -o KnxBusSimulator_LoadTest
+//   ./KnxBusSimulator_LoadTest
+
+#include "KnxDevice.h"
+#include "KnxBusSimulator.h"
+#include "KnxBusSimCoupler.h"
+#include <time.h>
+
+#define DEVICE_ADDR          0x1101
+#define LINE_COUPLER_ADDR    0x1000
+#define SIMULATION_STEP      200          // us
+#define LEVEL_DURATION       600000000ULL // us, 10 minutes per load level
+#define DRAIN_DURATION       5000000ULL   // us
+#define WRITE_PERIOD         200000       // us
+
+static const word offeredLoads[] = { 4, 10, 20, 30, 40 }; // generators frames per second
+
+static KnxComObject sensor0(0x0801, KNX_DPT_9_001, COM_OBJ_SENSOR);
+static KnxComObject sensor1(0x0802, KNX_DPT_9_001, COM_OBJ_SENSOR);
+static KnxComObject sensor2(0x0803, KNX_DPT_1_001, COM_OBJ_SENSOR);
+static KnxComObject sensor3(0x0804, KNX_DPT_1_001, COM_OBJ_SENSOR);
+static KnxComObject input0(0x0A00, KNX_DPT_5_001, COM_OBJ_LOGIC_IN);
+static KnxComObject input1(0x0A01, KNX_DPT_5_001, COM_OBJ_LOGIC_IN);
+static KnxComObject input2(0x0A02, KNX_DPT_5_001, COM_OBJ_LOGIC_IN);
+static KnxComObject input3(0x0A03, KNX_DPT_5_001, COM_OBJ_LOGIC_IN);
+static KnxComObject* comObjects[] = { &sensor0, &sensor1, &sensor2, &sensor3, &input0, &input1, &input2, &input3 };
+
+static KnxBusSimulator *sim;
+static boolean appWriting;
+static unsigned long long nextWriteTime;
+static unsigned long writesNb, receivedNb;
+
+void knxEvents(byte index) { receivedNb++; }
+
+
+// Device application loop, called at every simulation step
+static void DeviceLoop(void)
+{
+  if (Knx.checkInitBus() != KNX_DEVICE_OK) return;
+  Knx.task();
+  if (appWriting && (sim->GetTime() >= nextWriteTime))
+  {
+    byte index = writesNb % 4;
+    if (index < 2) Knx.write(index, (float)(writesNb % 100));
+    else Knx.write(index, (boolean)(writesNb & 1));
+    writesNb++;
+    nextWriteTime += WRITE_PERIOD;
+  }
+}
+
+
+static void RunLevel(word offeredLoad)
+{
+  KnxBusSimulator busSim(SIMULATION_STEP);
+  KnxBusSimCoupler *coupler = new KnxBusSimCoupler(busSim, DEVICE_ADDR);
+  unsigned long period = 4000000UL / offeredLoad; // 4 generators
+  KnxBusTrafficGenerator alarms(busSim, 0x1201, KNX_PRIORITY_ALARM_VALUE, period, 0x0B00, 4, 1);
+  KnxBusTrafficGenerator inputs(busSim, 0x1202, KNX_PRIORITY_HIGH_VALUE, period, 0x0A00, 4, 2);
+  KnxBusTrafficGenerator texts(busSim, 0x1203, KNX_PRIORITY_NORMAL_VALUE, period, 0x0C00, 8, 14);
+  KnxBusTrafficGenerator values(busSim, 0x1204, KNX_PRIORITY_NORMAL_VALUE, period, 0x0C10, 8, 3);
+  KnxBusTrafficGenerator lineCoupler(busSim, LINE_COUPLER_ADDR);
+  char label[16];
+  unsigned long sentToCoupler;
+
+  sim = &busSim;
+  lineCoupler.SetAcknowledge(0x0000, 0xFFFF, 1, 1);
+  busSim.Attach(*coupler);
+  busSim.Attach(alarms);
+  busSim.Attach(inputs);
+  busSim.Attach(texts);
+  busSim.Attach(values);
+  busSim.Attach(lineCoupler);
+  busSim.SetStepCallback(&DeviceLoop);
+  Knx.begin(coupler, comObjects, sizeof(comObjects) / sizeof(comObjects[0]));
+
+  writesNb = receivedNb = 0;
+  appWriting = true;
+  nextWriteTime = busSim.GetTime();
+  busSim.ClearStats();
+  busSim.Run(LEVEL_DURATION);
+  snprintf(label, sizeof(label), "%ufps", offeredLoad);
+  busSim.PrintStats(label);
+
+  // let the device send the queued actions before counting the drops
+  appWriting = false;
+  alarms.SetTraffic(0); inputs.SetTraffic(0); texts.SetTraffic(0); values.SetTraffic(0);
+  busSim.Run(DRAIN_DURATION);
+  sentToCoupler = coupler->GetRequestedFramesNb();
+  printf("device;%s;%lu;%lu;%lu;%.2f;%lu\n", label, writesNb, sentToCoupler,
+         (writesNb > sentToCoupler) ? writesNb - sentToCoupler : 0,
+         writesNb ? 100.0 * ((writesNb > sentToCoupler) ? writesNb - sentToCoupler : 0) / writesNb : 0.0, receivedNb);
+  Knx.end(); // deletes the coupler
+}
+
+
+int main(void)
+{
+  struct timespec start, end;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (byte i = 0; i < sizeof(offeredLoads) / sizeof(offeredLoads[0]); i++) RunLevel(offeredLoads[i]);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  printf("# %.0f s of bus time simulated in %.1f s\n",
+         sizeof(offeredLoads) / sizeof(offeredLoads[0]) * (LEVEL_DURATION + DRAIN_DURATION) / 1000000.0,
+         (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+  return 0;
+}
+
+// EOF
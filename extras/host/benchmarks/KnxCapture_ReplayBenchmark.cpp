@@ -0,0 +1,172 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxCapture_ReplayBenchmark.cpp
+// Author : Franck Marini
+// Description : Replay of a bus capture to a KnxDevice, at the capture pace, N times faster and as fast as possible
+//               Without argument, a 10 minutes capture is first recorded on a simulated TP1 line (the device
+//               wrapped in a KnxCaptureCoupler, group writes to its inputs from 2 generators and a sensor write every
+//               200ms) in "/tmp/KnxCapture_ReplayBenchmark.cap". Otherwise the given capture file is replayed.
+//               The replay runs on a virtual clock advanced by 400us per task() call, the wall time is the library
+//               and replay cost (NB : without installed clock, the replay follows the real time). The replay
+//               application writes the sensor object each time a telegram sent in the capture is replayed, the
+//               device telegrams are then acknowledged by the captured acknowledges.
+//               Output format (CSV) :
+//               speed;records;delivered;skipped;rx_overflows;app_events;device_sent;acks;unmatched_acks;task_calls;
+//               replay_s;wall_ms;ns_per_record
+//               (speed 0 : as fast as possible, one record per RX task run)
+// Module dependencies : KnxCapture, KnxCaptureFile, KnxReplayCoupler, KnxDevice, KnxBusSimulator, KnxBusSimCoupler
+//
+// Build and run from the library root folder (single command line) :
+//   g++ -O2 -I extras/host -I . extras/host/benchmarks/KnxCapture_ReplayBenchmark.cpp extras/host/KnxCaptureFile.cpp
+//       extras/host/KnxReplayCoupler.cpp extras/host/KnxBusSimulator.cpp extras/host/KnxBusSimCoupler.cpp
+//       extras/host/ArduinoHost.cpp KnxCapture.cpp KnxDevice.cpp KnxTpUart.cpp KnxTelegram.cpp KnxClock.cpp KnxGroupStats.cpp
+//       KnxBusHealth.cpp KnxComObject.cpp KnxComObjectTable.cpp KnxDPTCodec.cpp StKnxCoupler.cpp
+//       KnxTxLatency.cpp -o KnxCapture_ReplayBenchmark
+//   ./KnxCapture_ReplayBenchmark [capture_file]
+
+#include "KnxCapture.h"
+#include "KnxCaptureFile.h"
+#include "KnxReplayCoupler.h"
+#include "KnxDevice.h"
+#include "KnxBusSimulator.h"
+#include "KnxBusSimCoupler.h"
+#include <time.h>
+
+#define DEVICE_ADDR          0x1101
+#define CAPTURE_PATH         "/tmp/KnxCapture_ReplayBenchmark.cap"
+#define CAPTURE_DURATION     600000000ULL // us
+#define WRITE_PERIOD         200000       // us
+#define TASK_PERIOD          400          // us
+
+static const word speeds[] = { 1, 10, 100, KNX_REPLAY_AS_FAST_AS_POSSIBLE };
+
+static KnxComObject sensor(0x0801, KNX_DPT_9_001, COM_OBJ_SENSOR);
+static KnxComObject input0(0x0A00, KNX_DPT_5_001, COM_OBJ_LOGIC_IN);
+static KnxComObject input1(0x0A01, KNX_DPT_5_001, COM_OBJ_LOGIC_IN);
+static KnxComObject input2(0x0A02, KNX_DPT_5_001, COM_OBJ_LOGIC_IN);
+static KnxComObject input3(0x0A03, KNX_DPT_5_001, COM_OBJ_LOGIC_IN);
+static KnxComObject* comObjects[] = { &sensor, &input0, &input1, &input2, &input3 };
+
+static KnxBusSimulator *sim;
+static unsigned long long nextWriteTime;
+static unsigned long writesNb, eventsNb;
+
+void knxEvents(byte index) { eventsNb++; }
+
+
+static double NowSeconds(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+// Device application loop during the capture, called at every simulation step
+static void DeviceLoop(void)
+{
+  if (Knx.checkInitBus() != KNX_DEVICE_OK) return;
+  Knx.task();
+  if (sim->GetTime() >= nextWriteTime)
+  {
+    Knx.write(0, (float)(writesNb++ % 100));
+    nextWriteTime += WRITE_PERIOD;
+  }
+}
+
+
+static boolean RecordCapture(const char *path)
+{
+  KnxBusSimulator busSim;
+  KnxBusSimCoupler *coupler = new KnxBusSimCoupler(busSim, DEVICE_ADDR);
+  KnxBusTrafficGenerator switches(busSim, 0x1202, KNX_PRIORITY_HIGH_VALUE, 150000, 0x0A00, 4, 1);
+  KnxBusTrafficGenerator values(busSim, 0x1203, KNX_PRIORITY_NORMAL_VALUE, 300000, 0x0A02, 4, 2);
+  KnxBusTrafficGenerator lineCoupler(busSim, 0x1000);
+  KnxCaptureFile file;
+  KnxCaptureCoupler *capture;
+
+  remove(path);
+  if (file.Open(path) != KNX_CAPTURE_FILE_OK) return false;
+  capture = new KnxCaptureCoupler(coupler, file);
+  sim = &busSim;
+  lineCoupler.SetAcknowledge(0x0000, 0xFFFF, 1, 1);
+  busSim.Attach(*coupler);
+  busSim.Attach(switches);
+  busSim.Attach(values);
+  busSim.Attach(lineCoupler);
+  busSim.SetStepCallback(&DeviceLoop);
+  Knx.begin(capture, comObjects, sizeof(comObjects) / sizeof(comObjects[0]));
+  writesNb = eventsNb = 0;
+  nextWriteTime = busSim.GetTime();
+  busSim.Run(CAPTURE_DURATION);
+  printf("# capture : %lu records (%lu lost), %lu application events, %lu writes\n", capture->GetRecordsNb(),
+         capture->GetLostRecordsNb(), eventsNb, writesNb);
+  Knx.end(); // deletes the capture coupler and the simulator coupler
+  return true;
+}
+
+
+static void Replay(KnxCaptureReader& reader, word speed)
+{
+  KnxVirtualClock clock;
+  KnxReplayCoupler *replay = new KnxReplayCoupler(reader, speed);
+  unsigned long callsNb = 0;
+  unsigned long long startTime;
+  double wallTime;
+
+  KnxSetClock(&clock);
+  Knx.begin(replay, comObjects, sizeof(comObjects) / sizeof(comObjects[0]));
+  writesNb = eventsNb = 0;
+  startTime = clock.GetTime();
+  wallTime = NowSeconds();
+  while (!replay->IsFinished())
+  {
+    if (Knx.checkInitBus() == KNX_DEVICE_OK) Knx.task();
+    if (replay->GetCapturedTxNb() > writesNb) Knx.write(0, (float)(writesNb++ % 100));
+    callsNb++;
+    clock.Advance(TASK_PERIOD);
+  }
+  wallTime = NowSeconds() - wallTime;
+  printf("%u;%lu;%lu;%lu;%u;%lu;%lu;%lu;%lu;%lu;%.1f;%.1f;%.0f\n", speed, reader.GetRecordsNb(),
+         replay->GetRxTelegramsNb(), replay->GetSkippedNb(), replay->GetRxOverflowsNb(), eventsNb, replay->GetSentNb(),
+         replay->GetAcksNb(), replay->GetUnmatchedAcksNb(), callsNb, (clock.GetTime() - startTime) / 1e6,
+         wallTime * 1000, reader.GetRecordsNb() ? wallTime * 1e9 / reader.GetRecordsNb() : 0.0);
+  fflush(stdout);
+  Knx.end(); // deletes the replay coupler
+  KnxSetClock(NULL);
+}
+
+
+int main(int argc, char *argv[])
+{
+  const char *path = (argc > 1) ? argv[1] : CAPTURE_PATH;
+  KnxCaptureReader reader;
+
+  if ((argc <= 1) && !RecordCapture(path)) { printf("# capture file creation failed\n"); return 1; }
+  if (reader.Open(path) != KNX_CAPTURE_FILE_OK) { printf("# %s is not a capture file\n", path); return 1; }
+  printf("# %s : %lu bytes\n", path, (unsigned long)reader.GetSize());
+  printf("speed;records;delivered;skipped;rx_overflows;app_events;device_sent;acks;unmatched_acks;task_calls;"
+         "replay_s;wall_ms;ns_per_record\n");
+  for (byte i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++) Replay(reader, speeds[i]);
+  return 0;
+}
+
+// EOF
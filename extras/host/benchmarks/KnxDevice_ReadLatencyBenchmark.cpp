@@ -0,0 +1,134 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxDevice_ReadLatencyBenchmark.cpp
+// Author : Franck Marini
+// Description : Host benchmark of the group read response latency of KnxDevice (TPUART emulator, virtual time)
+//               For each measurement, writes are queued in the TX action list, then a read of a sensor com object
+//               is received at a random time while the writes are sent. The latency is measured from the end of
+//               the read frame (available to the driver) to the end of the response frame sent on the bus.
+//               Build with -DKNXDEVICE_NO_FAST_READ to measure the responses queued behind the writes.
+//               Output format (CSV) : queued_writes;reads;p50_us;p99_us;max_us;unanswered
+// Module dependencies : KnxDevice, KnxTpUart, TpUartEmulator, KnxClock
+//
+// Build and run from the library root folder (single command line) :
+//   g++ -O2 -I extras/host -I . extras/host/benchmarks/KnxDevice_ReadLatencyBenchmark.cpp extras/host/TpUartEmulator.cpp
+//       extras/host/ArduinoHost.cpp KnxDevice.cpp KnxTpUart.cpp KnxTelegram.cpp KnxClock.cpp KnxGroupStats.cpp
+//       KnxBusHealth.cpp KnxComObject.cpp KnxComObjectTable.cpp KnxDPTCodec.cpp StKnxCoupler.cpp
+//       KnxTxLatency.cpp -o KnxDevice_ReadLatencyBenchmark
+//   ./KnxDevice_ReadLatencyBenchmark
+
+#include <algorithm>
+#include "TpUartEmulator.h"
+#include "KnxDevice.h"
+
+#define DEVICE_ADDR     0x1101
+#define TASK_PERIOD     400     // us
+#define READS_NB        200     // Nb of reads per measurement
+#define RESPONSE_DELAY  2000000 // us, max wait for a response
+
+static const byte queuedWrites[] = { 0, 1, 4, 12 };
+
+static KnxVirtualClock clock_(1000);
+static TpUartEmulator *emulator;
+
+static KnxComObject temperature(0x0801, KNX_DPT_9_001, COM_OBJ_SENSOR);
+static KnxComObject output(0x0901, KNX_DPT_1_001, COM_OBJ_SENSOR);
+static KnxComObject* comObjects[] = { &temperature, &output };
+
+static word framesSeenNb;
+static unsigned long latencies[READS_NB];
+
+void knxEvents(byte index) {}
+
+
+static void RunDevice(unsigned long durationMicros)
+{
+  for (unsigned long t = 0; t < durationMicros; t += TASK_PERIOD) { clock_.Advance(TASK_PERIOD); Knx.task(); }
+}
+
+
+// Run the device till a response of the temperature is sent on the bus, return false after RESPONSE_DELAY
+static boolean WaitResponse(unsigned long& responseMicros)
+{
+  byte frame[KNX_TELEGRAM_MAX_SIZE], length;
+  KnxTelegram telegram;
+
+  for (unsigned long t = 0; t < RESPONSE_DELAY; t += TASK_PERIOD)
+  {
+    clock_.Advance(TASK_PERIOD);
+    Knx.task();
+    for (; framesSeenNb < emulator->GetBusFramesNb(); framesSeenNb++)
+    {
+      length = emulator->GetBusFrame(framesSeenNb, frame);
+      for (byte i = 0; i < length; i++) telegram.WriteRawByte(frame[i], i);
+      if ((telegram.GetTargetAddress() != 0x0801) || (telegram.GetCommand() != KNX_COMMAND_VALUE_RESPONSE)) continue;
+      responseMicros = emulator->GetBusFrameRxMicros(framesSeenNb);
+      framesSeenNb++;
+      return true;
+    }
+  }
+  return false;
+}
+
+
+int main(void)
+{
+  KnxTelegram read;
+  unsigned long responseMicros;
+  word readsNb, unansweredNb;
+
+  KnxSetClock(&clock_);
+  emulator = new TpUartEmulator();
+  Knx.begin(new KnxTpUart(*emulator, DEVICE_ADDR, NORMAL), comObjects, 2);
+  while (Knx.checkInitBus() != KNX_DEVICE_OK) clock_.Advance(TASK_PERIOD);
+  Knx.write(0, 21.5f);
+  RunDevice(100000);
+
+  read.SetSourceAddress(0x1102);
+  read.SetTargetAddress(0x0801);
+  read.SetCommand(KNX_COMMAND_VALUE_READ);
+  read.UpdateChecksum();
+
+  printf("queued_writes;reads;p50_us;p99_us;max_us;unanswered\n");
+  for (byte q = 0; q < sizeof(queuedWrites); q++)
+  {
+    readsNb = 0; unansweredNb = 0;
+    for (word n = 0; n < READS_NB; n++)
+    {
+      for (byte i = 0; i < queuedWrites[q]; i++) Knx.write(1, (boolean)(i & 1));
+      RunDevice(random(20000)); // the read is received at a random time of the writes transmission
+      framesSeenNb = emulator->GetBusFramesNb();
+      emulator->ClearAckRecords();
+      emulator->InjectBusTelegram(read);
+      if (WaitResponse(responseMicros) && emulator->GetAckRecordsNb())
+        latencies[readsNb++] = responseMicros - emulator->GetAckRecord(0).frameEndMicros;
+      else unansweredNb++;
+      while (Knx.isActive()) RunDevice(TASK_PERIOD); // the remaining writes are sent
+      RunDevice(10000);
+    }
+    std::sort(latencies, latencies + readsNb);
+    if (readsNb) printf("%u;%u;%lu;%lu;%lu;%u\n", queuedWrites[q], readsNb, latencies[readsNb / 2],
+                        latencies[(readsNb * 99) / 100], latencies[readsNb - 1], unansweredNb);
+    else printf("%u;0;;;;%u\n", queuedWrites[q], unansweredNb);
+  }
+  return 0;
+}
+
+// EOF
@@ -0,0 +1,385 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxLibrary_MicroBenchmarks.cpp
+// Author : Franck Marini
+// Description : Host micro-benchmarks of the library hot paths
+//               - KnxTelegram : build, UpdateChecksum(), GetValidity()
+//               - KnxTpUart : AttachComObjectsList() depending on the nb of com objects
+//               - KnxComObjectTable : IsAddressAssigned() (lookup done by the RX tasks) depending on the nb of com objects
+//               - ConvertToDpt()/ConvertFromDpt() for each single field DPT format (param : eKnxDPT_Format value)
+//               - ActionRingBuffer : Append()/Pop() of TX actions
+//               - KnxGroupStats : Record() of telegrams to a few target addresses (hits), and to many addresses
+//                 (table full, max probing)
+//               - KnxDevice::task() iteration with an idle coupler and with a busy one (a telegram received and a
+//                 telegram sent at every iteration), the virtual clock makes every iteration run the RX and TX tasks
+//               Every case is calibrated to last at least 2ms per run, then run 9 times. The min and the median
+//               are stable figures to track regressions (the max shows the host noise).
+//               Output format (CSV) : benchmark;param;ns_min;ns_median;ns_max;iterations
+// Module dependencies : KnxDevice, KnxTpUart, KnxComObjectTable, HostSerial
+//
+// Build and run from the library root folder (single command line) :
+//   g++ -O2 -I extras/host -I . extras/host/benchmarks/KnxLibrary_MicroBenchmarks.cpp extras/host/ArduinoHost.cpp
+//       KnxDevice.cpp KnxTpUart.cpp KnxTelegram.cpp KnxClock.cpp KnxGroupStats.cpp KnxBusHealth.cpp KnxComObject.cpp
+//       KnxComObjectTable.cpp KnxDPTCodec.cpp StKnxCoupler.cpp KnxTxLatency.cpp -o KnxLibrary_MicroBenchmarks
+//   ./KnxLibrary_MicroBenchmarks
+
+#include "HostSerial.h"
+#include "KnxDevice.h"
+#include <time.h>
+
+#define RUNS_NB          9
+#define MIN_RUN_NANOSEC  2000000
+#define PHYSICAL_ADDR    0x1101
+#define OBJECTS_MAX_NB   255
+#define DPT_FORMATS_NB   (KNX_DPT_FORMAT_A8A8 + 1)
+
+typedef void (*type_BenchFctPtr)(unsigned long iterations);
+
+static const byte objectsNbs[] = { 4, 16, 64, 128, 255 };
+
+// Benchmark parameters and results sink (prevents the compiler from removing the measured code)
+static byte benchObjectsNb, benchFormat, benchPayloadLength;
+static word benchAddressesNb;
+static volatile unsigned long sink;
+
+static KnxComObject *objects[OBJECTS_MAX_NB];
+static KnxTelegram benchTelegram;
+static HostSerial serial;
+static KnxTpUart *tpuart;
+static KnxComObjectTable comObjectsTable;
+static KnxVirtualClock clock_;
+
+void knxEvents(byte index) { sink += index; }
+
+static void EventCallback(e_KnxBusCouplerEvent) {}
+static void AckCallback(e_BusCouplerTxAck) {}
+
+
+static unsigned long long NowNanosec(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+
+static unsigned long long TimeRun(type_BenchFctPtr fct, unsigned long iterations)
+{
+  unsigned long long start = NowNanosec();
+  fct(iterations);
+  return NowNanosec() - start;
+}
+
+
+static int CompareDouble(const void *a, const void *b)
+{
+  double da = *(const double *)a, db = *(const double *)b;
+  return (da > db) - (da < db);
+}
+
+
+// Calibrate the nb of iterations, then run and print the results
+static void Measure(const char *name, const char *param, type_BenchFctPtr fct)
+{
+  unsigned long iterations = 1;
+  double nsPerOp[RUNS_NB];
+
+  while (TimeRun(fct, iterations) < MIN_RUN_NANOSEC) iterations *= 2;
+  for (byte r = 0; r < RUNS_NB; r++) nsPerOp[r] = (double)TimeRun(fct, iterations) / iterations;
+  qsort(nsPerOp, RUNS_NB, sizeof(double), &CompareDouble);
+  printf("%s;%s;%.2f;%.2f;%.2f;%lu\n", name, param, nsPerOp[0], nsPerOp[RUNS_NB / 2], nsPerOp[RUNS_NB - 1], iterations);
+}
+
+
+// ---------- KnxTelegram ----------
+
+static void TelegramBuild(unsigned long iterations)
+{
+  static const byte payload[KNX_TELEGRAM_PAYLOAD_MAX_SIZE] = { 0 };
+  KnxTelegram telegram;
+
+  for (unsigned long i = 0; i < iterations; i++)
+  {
+    telegram.ClearTelegram();
+    telegram.SetSourceAddress(PHYSICAL_ADDR);
+    telegram.SetTargetAddress(0x0800 + (i & 0xFF));
+    telegram.SetCommand(KNX_COMMAND_VALUE_WRITE);
+    telegram.SetPayloadLength(benchPayloadLength);
+    telegram.SetFirstPayloadByte(i & 1);
+    if (benchPayloadLength > 1) telegram.SetLongPayload(payload, benchPayloadLength - 1);
+    telegram.UpdateChecksum();
+    sink += telegram.GetChecksum();
+  }
+}
+
+
+static void TelegramChecksum(unsigned long iterations)
+{
+  for (unsigned long i = 0; i < iterations; i++)
+  {
+    benchTelegram.WriteRawByte((byte)i, 8);
+    benchTelegram.UpdateChecksum();
+  }
+  sink += benchTelegram.GetChecksum();
+}
+
+
+static void TelegramValidity(unsigned long iterations)
+{
+  for (unsigned long i = 0; i < iterations; i++) sink += benchTelegram.GetValidity();
+}
+
+
+// ---------- KnxTpUart / KnxComObjectTable ----------
+
+static void AttachComObjects(unsigned long iterations)
+{
+  for (unsigned long i = 0; i < iterations; i++) sink += tpuart->AttachComObjectsList(objects, benchObjectsNb);
+}
+
+
+static void IsAddressAssigned(unsigned long iterations)
+{
+  byte index;
+  // hits and misses : the objects addresses are 0x0800 + 2 * n
+  for (unsigned long i = 0; i < iterations; i++)
+    if (comObjectsTable.IsAddressAssigned(0x0800 + (i % (2 * benchObjectsNb)), index)) sink += index;
+}
+
+
+// ---------- DPT conversions ----------
+
+static void DptToFormat(unsigned long iterations)
+{
+  byte dpt[14];
+  for (unsigned long i = 0; i < iterations; i++)
+  {
+    if ((benchFormat == KNX_DPT_FORMAT_F16) || (benchFormat == KNX_DPT_FORMAT_F32))
+      ConvertToDpt((float)(i & 0x3FF) / 4, dpt, benchFormat);
+    else ConvertToDpt((long)(i & 0x3F), dpt, benchFormat);
+    sink += dpt[0];
+  }
+}
+
+
+static void DptFromFormat(unsigned long iterations)
+{
+  byte dpt[14] = { 0x0C, 0x1A, 0x20, 0x30, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A };
+  long longValue;
+  float floatValue;
+
+  for (unsigned long i = 0; i < iterations; i++)
+  {
+    dpt[1] = (byte)i;
+    if ((benchFormat == KNX_DPT_FORMAT_F16) || (benchFormat == KNX_DPT_FORMAT_F32))
+    { ConvertFromDpt(dpt, floatValue, benchFormat); sink += (unsigned long)floatValue; }
+    else { ConvertFromDpt(dpt, longValue, benchFormat); sink += longValue; }
+  }
+}
+
+
+// ---------- ActionRingBuffer ----------
+
+static void RingAppendPop(unsigned long iterations)
+{
+  static ActionRingBuffer<type_tx_action, ACTIONS_QUEUE_SIZE> ring;
+  type_tx_action action;
+
+  action.command = EIB_WRITE_REQUEST;
+  for (unsigned long i = 0; i < iterations; i++)
+  {
+    action.index = (byte)i;
+    ring.Append(action);
+    ring.Pop(action);
+    sink += action.index;
+  }
+}
+
+
+static void RingFillDrain(unsigned long iterations)
+{
+  static ActionRingBuffer<type_tx_action, ACTIONS_QUEUE_SIZE> ring;
+  type_tx_action action;
+
+  action.command = EIB_WRITE_REQUEST;
+  for (unsigned long i = 0; i < iterations; i++)
+  {
+    for (byte n = 0; n < ACTIONS_QUEUE_SIZE; n++) { action.index = n; ring.Append(action); }
+    while (ring.Pop(action)) sink += action.index;
+  }
+}
+
+
+// ---------- KnxGroupStats ----------
+
+static void GroupStatsRecord(unsigned long iterations)
+{
+  static KnxGroupStats stats;
+  KnxTelegram telegram;
+
+  telegram.SetSourceAddress(0x1102);
+  telegram.SetCommand(KNX_COMMAND_VALUE_WRITE);
+  for (unsigned long i = 0; i < iterations; i++)
+  {
+    telegram.SetTargetAddress(0x0800 + (word)(i % benchAddressesNb));
+    stats.Record(telegram, i);
+  }
+  sink += stats.GetTelegramsNb();
+}
+
+
+// ---------- KnxDevice::task() ----------
+
+// Coupler stand-in : when busy, a telegram is received at every RX task (alternatively a read request and a write
+// on 2 com objects), the response telegram is acknowledged at the next TX task
+class BenchCoupler : public KnxBusCoupler {
+    boolean _busy, _rxPending, _txPending;
+    unsigned long _rxNb;
+    type_EventCallbackFctPtr _evtCallbackFct;
+    type_AckCallbackFctPtr _ackCallbackFct;
+    KnxTelegram _readTelegram, _writeTelegram, _received;
+
+  public:
+    unsigned long sentNb;
+
+    BenchCoupler(boolean busy) : _busy(busy), _rxPending(false), _txPending(false), _rxNb(0),
+                                 _evtCallbackFct(NULL), _ackCallbackFct(NULL), sentNb(0)
+    {
+      _readTelegram.SetSourceAddress(0x1102); _readTelegram.SetTargetAddress(0x0800);
+      _readTelegram.SetCommand(KNX_COMMAND_VALUE_READ); _readTelegram.UpdateChecksum();
+      _writeTelegram.SetSourceAddress(0x1102); _writeTelegram.SetTargetAddress(0x0802);
+      _writeTelegram.SetCommand(KNX_COMMAND_VALUE_WRITE); _writeTelegram.SetFirstPayloadByte(1);
+      _writeTelegram.UpdateChecksum();
+    }
+    byte SetEvtCallback(type_EventCallbackFctPtr fct) { _evtCallbackFct = fct; return KNX_BUSCOUPLER_OK; }
+    void SetReceivedTelegram(KnxTelegram &telegram) {}
+    byte SetAckCallback(type_AckCallbackFctPtr fct) { _ackCallbackFct = fct; return KNX_BUSCOUPLER_OK; }
+    byte GetStateIndication(void) const { return 0; }
+    KnxTelegram& GetReceivedTelegram(void) { return _received; }
+    byte GetTargetedComObjectIndex(void) const { return 0; }
+    boolean IsActive(void) const { return _txPending; }
+    boolean PopReceivedTelegram(type_buscoupler_rx_telegram& rxTelegram)
+    {
+      if (!_rxPending) return false;
+      _rxPending = false;
+      if (_rxNb++ & 1) { _writeTelegram.Copy(rxTelegram.telegram); rxTelegram.comObjectIndex = 1; }
+      else { _readTelegram.Copy(rxTelegram.telegram); rxTelegram.comObjectIndex = 0; }
+      rxTelegram.timeMicros = KnxMicros();
+      return true;
+    }
+    word GetRxOverflowsNb(void) const { return 0; }
+#if defined(KNXTPUART_DEBUG_INFO) || defined(KNXTPUART_DEBUG_ERROR)
+    void SetTraceRing(KnxTraceRing *traceRing) {}
+#endif
+    byte Reset(void) { return KNX_BUSCOUPLER_OK; }
+    byte AttachComObjectsList(KnxComObject comObjectsList[], byte listSize) { return KNX_BUSCOUPLER_OK; }
+    byte AttachComObjectsList(KnxComObject** comObjectsList, byte listSize) { return KNX_BUSCOUPLER_OK; }
+    byte Init(void) { return KNX_BUSCOUPLER_OK; }
+    byte SendTelegram(KnxTelegram& sentTelegram) { _txPending = true; sentNb++; return KNX_BUSCOUPLER_OK; }
+    void RXTask(void) { if (_busy) _rxPending = true; }
+    void TXTask(void) { if (_txPending) { _txPending = false; _ackCallbackFct(ACK_RESPONSE); } }
+    boolean GetMonitoringData(type_MonitorData&) { return false; }
+    void DEBUG_SendResetCommand(void) {}
+    void DEBUG_SendStateReqCommand(void) {}
+};
+
+
+static void DeviceTask(unsigned long iterations)
+{
+  for (unsigned long i = 0; i < iterations; i++)
+  {
+    clock_.Advance(1000); // RX and TX tasks run at every iteration
+    Knx.task();
+  }
+}
+
+
+static void MeasureDeviceTask(const char *param, boolean busy)
+{
+  static KnxComObject readObject(0x0800, KNX_DPT_9_001, COM_OBJ_SENSOR);
+  static KnxComObject writeObject(0x0802, KNX_DPT_1_001, COM_OBJ_LOGIC_IN);
+  static KnxComObject* deviceObjects[] = { &readObject, &writeObject };
+  BenchCoupler *coupler = new BenchCoupler(busy);
+
+  KnxSetClock(&clock_);
+  Knx.begin(coupler, deviceObjects, 2);
+  Knx.checkInitBus();
+  Measure("device_task", param, &DeviceTask);
+  if (busy && !coupler->sentNb) printf("# device_task : no telegram sent !\n");
+  Knx.end();
+  KnxSetClock(NULL);
+}
+
+
+int main(void)
+{
+  const byte resetIndication = TPUART_RESET_INDICATION;
+  char param[32];
+
+  for (word i = 0; i < OBJECTS_MAX_NB; i++)
+    objects[i] = new KnxComObject(0x0800 + 2 * ((i * 37) % OBJECTS_MAX_NB), KNX_DPT_1_001, COM_OBJ_LOGIC_IN);
+  tpuart = new KnxTpUart(serial, PHYSICAL_ADDR, NORMAL);
+  tpuart->Reset();
+  serial.InjectRxBytes(&resetIndication, 1);
+  if (tpuart->Reset() != KNX_BUSCOUPLER_OK) { printf("TPUART reset failed\n"); return 1; }
+  tpuart->SetEvtCallback(&EventCallback);
+  tpuart->SetAckCallback(&AckCallback);
+
+  printf("benchmark;param;ns_min;ns_median;ns_max;iterations\n");
+
+  for (benchPayloadLength = 1; benchPayloadLength <= KNX_TELEGRAM_PAYLOAD_MAX_SIZE; benchPayloadLength += 7)
+  { snprintf(param, sizeof(param), "payload=%u", benchPayloadLength); Measure("telegram_build", param, &TelegramBuild); }
+  benchTelegram.SetPayloadLength(KNX_TELEGRAM_PAYLOAD_MAX_SIZE);
+  benchTelegram.UpdateChecksum();
+  Measure("telegram_checksum", "payload=15", &TelegramChecksum);
+  Measure("telegram_validity", "payload=15", &TelegramValidity);
+
+  for (byte s = 0; s < sizeof(objectsNbs); s++)
+  {
+    benchObjectsNb = objectsNbs[s];
+    snprintf(param, sizeof(param), "objects=%u", benchObjectsNb);
+    Measure("tpuart_attach_com_objects", param, &AttachComObjects);
+    comObjectsTable.Attach(objects, benchObjectsNb);
+    Measure("com_objects_table_is_address_assigned", param, &IsAddressAssigned);
+  }
+
+  for (benchFormat = 0; benchFormat < DPT_FORMATS_NB; benchFormat++)
+  {
+    if (KnxDptFieldsNb(benchFormat) != 1) continue; // multiple fields formats are not supported by ConvertToDpt()
+    snprintf(param, sizeof(param), "format=%u", benchFormat);
+    Measure("dpt_to", param, &DptToFormat);
+    Measure("dpt_from", param, &DptFromFormat);
+  }
+
+  Measure("ring_append_pop", "size=16", &RingAppendPop);
+  Measure("ring_fill_drain", "size=16", &RingFillDrain);
+
+  benchAddressesNb = 8;
+  Measure("group_stats_record", "addresses=8", &GroupStatsRecord);
+  benchAddressesNb = 1024;
+  Measure("group_stats_record", "addresses=1024", &GroupStatsRecord);
+
+  MeasureDeviceTask("idle", false);
+  MeasureDeviceTask("busy", true);
+  return 0;
+}
+
+// EOF
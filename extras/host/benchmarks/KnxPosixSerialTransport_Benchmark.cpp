@@ -0,0 +1,141 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxPosixSerialTransport_Benchmark.cpp
+// Author : Franck Marini
+// Description : Host benchmark of the Linux serial transport reception wake-up, over a pseudo-terminal pair.
+//               A writer thread playing the TPUART sends one byte at random intervals (1 to 3 ms).
+//               The reception thread either polls the transport every 400us (RX task period)
+//               or sleeps in WaitForData() (epoll) till the byte arrives.
+//               The benchmark reports the latency between the byte writing and its detection,
+//               the nb of reception thread wake-ups and its CPU time per received byte.
+//               Output format (CSV) : mode;bytes;latency_avg_us;latency_max_us;wakeups_per_byte;cpu_us_per_byte
+// Module dependencies : KnxPosixSerialTransport
+//
+// Build and run from the library root folder (single command line) :
+//   g++ -O2 -pthread -I extras/host -I . extras/host/benchmarks/KnxPosixSerialTransport_Benchmark.cpp
+//       extras/host/ArduinoHost.cpp KnxPosixSerialTransport.cpp -lutil -o KnxPosixSerialTransport_Benchmark
+//   ./KnxPosixSerialTransport_Benchmark
+
+#include "KnxPosixSerialTransport.h"
+#include <pty.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <termios.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#define BYTES_NB            300  // Nb of bytes received per measurement
+#define POLLING_PERIOD      400  // us, RX task period
+
+static int masterFd;                        // TPUART side of the pseudo-terminal pair
+static volatile unsigned long long writeTime; // time of the last byte writing (ns)
+static volatile boolean byteConsumed;       // set by the reception thread once the byte is detected
+static volatile boolean stopWriter;
+
+
+static unsigned long long NowNanosec(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+
+static unsigned long long ThreadCpuMicros(void)
+{
+  struct rusage usage;
+  getrusage(RUSAGE_THREAD, &usage);
+  return (unsigned long long)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000ULL
+         + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+
+// TPUART : one byte every 1 to 3 ms, the next byte is written once the previous one is detected
+static void *Writer(void *)
+{
+  const byte data = 0x07; // TPUART state indication
+  while (!stopWriter)
+  {
+    if (!byteConsumed) { usleep(50); continue; }
+    usleep(1000 + random(2000));
+    byteConsumed = false;
+    __sync_synchronize();
+    writeTime = NowNanosec();
+    if (write(masterFd, &data, 1) != 1) break;
+  }
+  return NULL;
+}
+
+
+static void Measure(KnxPosixSerialTransport& transport, boolean useEpoll)
+{
+  pthread_t writerThread;
+  byte data;
+  unsigned long long latency, latencySum = 0, latencyMax = 0, cpuStart;
+  unsigned long wakeupsNb = 0;
+
+  byteConsumed = true; stopWriter = false;
+  cpuStart = ThreadCpuMicros();
+  pthread_create(&writerThread, NULL, &Writer, NULL);
+  for (word n = 0; n < BYTES_NB; n++)
+  {
+    for (;;)
+    {
+      wakeupsNb++;
+      if (useEpoll) { if (transport.WaitForData(1000000)) break; }
+      else { if (transport.Available() > 0) break; usleep(POLLING_PERIOD); }
+    }
+    latency = NowNanosec() - writeTime;
+    transport.ReadBytes(&data, 1);
+    latencySum += latency;
+    if (latency > latencyMax) latencyMax = latency;
+    __sync_synchronize();
+    byteConsumed = true;
+  }
+  stopWriter = true;
+  pthread_join(writerThread, NULL);
+  printf("%s;%u;%.1f;%.1f;%.2f;%.1f\n", useEpoll ? "epoll" : "polling", BYTES_NB,
+         (double)latencySum / BYTES_NB / 1000, (double)latencyMax / 1000, (double)wakeupsNb / BYTES_NB,
+         (double)(ThreadCpuMicros() - cpuStart) / BYTES_NB);
+}
+
+
+int main(void)
+{
+  struct termios tty;
+  char slaveName[64];
+  int slaveFd;
+
+  if (openpty(&masterFd, &slaveFd, slaveName, NULL, NULL) < 0) { printf("openpty failed\n"); return 1; }
+  tcgetattr(masterFd, &tty); cfmakeraw(&tty); tcsetattr(masterFd, TCSANOW, &tty);
+
+  KnxPosixSerialTransport transport(slaveName, 19200, true); // no parity fallback, pseudo-terminal
+  if (transport.Begin() != KNX_SERIAL_TRANSPORT_OK) { printf("transport opening failed\n"); return 1; }
+
+  printf("mode;bytes;latency_avg_us;latency_max_us;wakeups_per_byte;cpu_us_per_byte\n");
+  Measure(transport, false);
+  Measure(transport, true);
+
+  transport.End();
+  close(slaveFd); close(masterFd);
+  return 0;
+}
+
+// EOF
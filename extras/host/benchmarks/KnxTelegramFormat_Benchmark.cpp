@@ -0,0 +1,130 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxTelegramFormat_Benchmark.cpp
+// Author : Franck Marini
+// Description : Host benchmark of the telegram formatting, in telegrams per second
+//               A mix of telegrams (B1, U8, F16, F32 and time of day values) is formatted in a loop by :
+//               - KnxTelegram::Info() (String concatenations, the reference)
+//               - KnxFormatTelegramText() and KnxFormatTelegramJson() into a caller buffer, value decoded per DPT
+//               - KnxFormatTelegramText() without DPT (raw payload only)
+//               Every formatter runs during 200ms, 5 times, the best run is kept.
+//               Output format (CSV) : formatter;telegrams_per_s;ns_per_telegram;chars_per_telegram
+// Module dependencies : KnxTelegramFormat, KnxTelegram, KnxDPTCodec
+//
+// Build and run from the library root folder (single command line) :
+//   g++ -O2 -I extras/host -I . extras/host/benchmarks/KnxTelegramFormat_Benchmark.cpp extras/host/ArduinoHost.cpp
+//       KnxTelegramFormat.cpp KnxTelegram.cpp KnxDPTCodec.cpp -o KnxTelegramFormat_Benchmark
+//   ./KnxTelegramFormat_Benchmark
+
+#include "KnxTelegramFormat.h"
+#include <time.h>
+
+#define TELEGRAMS_NB   5
+#define RUN_NANOSEC    200000000ULL // 200ms
+#define RUNS_NB        5
+
+enum e_Formatter { FORMATTER_INFO_STRING = 0, FORMATTER_TEXT, FORMATTER_JSON, FORMATTER_TEXT_NO_DPT, FORMATTERS_NB };
+static const char * const formatterNames[FORMATTERS_NB] = { "Info_String", "Text", "Json", "Text_no_dpt" };
+
+static KnxTelegram telegrams[TELEGRAMS_NB];
+static byte dptIds[TELEGRAMS_NB] = { KNX_DPT_1_001, KNX_DPT_5_001, KNX_DPT_9_001, KNX_DPT_14_000, KNX_DPT_10_001 };
+static volatile unsigned long sink; // keeps the output "used"
+
+
+static unsigned long long NowNanosec(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+
+static void BuildTelegrams(void)
+{
+  byte dpt[4];
+  type_KnxTimeOfDay time = { 3, 14, 5, 59 };
+
+  for (byte i = 0; i < TELEGRAMS_NB; i++)
+  {
+    telegrams[i].SetSourceAddress(0x1102 + i);
+    telegrams[i].SetTargetAddress(0x0801 + i);
+    telegrams[i].SetCommand(KNX_COMMAND_VALUE_WRITE);
+  }
+  telegrams[0].SetFirstPayloadByte(1);
+  dpt[0] = 200; telegrams[1].SetPayloadLength(2); telegrams[1].SetLongPayload(dpt, 1);
+  KnxDptEncodeF16(2150, dpt); telegrams[2].SetPayloadLength(3); telegrams[2].SetLongPayload(dpt, 2);
+  KnxDptEncodeF32(1013.25, dpt); telegrams[3].SetPayloadLength(5); telegrams[3].SetLongPayload(dpt, 4);
+  KnxDptEncodeTimeOfDay(time, dpt); telegrams[4].SetPayloadLength(4); telegrams[4].SetLongPayload(dpt, 3);
+}
+
+
+// Format the telegrams mix during RUN_NANOSEC, return the nb of formatted telegrams and the total nb of chars
+static unsigned long Run(e_Formatter formatter, unsigned long long& duration, unsigned long& charsNb)
+{
+  char text[KNX_FORMAT_TELEGRAM_MAX_SIZE];
+  unsigned long telegramsNb = 0;
+  unsigned long long startTime = NowNanosec();
+
+  charsNb = 0;
+  text[0] = 0;
+  do
+  {
+    for (word n = 0; n < 1000; n++)
+    {
+      byte i = n % TELEGRAMS_NB;
+      switch (formatter)
+      {
+        case FORMATTER_INFO_STRING : { String str; telegrams[i].Info(str); charsNb += str.length(); } break;
+        case FORMATTER_TEXT : charsNb += KnxFormatTelegramText(telegrams[i], dptIds[i], text, sizeof(text)); break;
+        case FORMATTER_JSON : charsNb += KnxFormatTelegramJson(telegrams[i], dptIds[i], text, sizeof(text)); break;
+        default : charsNb += KnxFormatTelegramText(telegrams[i], KNX_FORMAT_NO_DPT, text, sizeof(text)); break;
+      }
+      sink += text[0];
+    }
+    telegramsNb += 1000;
+    duration = NowNanosec() - startTime;
+  } while (duration < RUN_NANOSEC);
+  return telegramsNb;
+}
+
+
+int main(void)
+{
+  unsigned long long duration;
+  unsigned long telegramsNb, charsNb;
+  double bestRate, rate;
+
+  BuildTelegrams();
+  printf("formatter;telegrams_per_s;ns_per_telegram;chars_per_telegram\n");
+  for (byte f = 0; f < FORMATTERS_NB; f++)
+  {
+    bestRate = 0;
+    for (byte run = 0; run < RUNS_NB; run++)
+    {
+      telegramsNb = Run((e_Formatter)f, duration, charsNb);
+      rate = telegramsNb * 1e9 / duration;
+      if (rate > bestRate) bestRate = rate;
+    }
+    printf("%s;%.0f;%.1f;%.1f\n", formatterNames[f], bestRate, 1e9 / bestRate, (double)charsNb / telegramsNb);
+  }
+  return 0;
+}
+
+// EOF
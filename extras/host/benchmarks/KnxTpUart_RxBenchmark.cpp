@@ -0,0 +1,144 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxTpUart_RxBenchmark.cpp
+// Author : Franck Marini
+// Description : Host benchmark of the KnxTpUart RX task cost per received byte
+//               The TPUART is replaced by a HostSerial stand-in. The telegram bytes are injected
+//               in chunks (bytes arrived between 2 RX task calls) and only the RX task calls
+//               processing the bytes are timed (EOP detection is excluded).
+//               The benchmark is run with and without emulated UART driver call cost.
+//               Output format (CSV) : chunk;call_cost_ns;ns_per_byte;calls_per_byte;telegrams;acks_ok
+// Module dependencies : KnxTpUart, HostSerial
+//
+// Build and run from the library root folder (single command line) :
+//   g++ -O2 -I extras/host -I . extras/host/benchmarks/KnxTpUart_RxBenchmark.cpp extras/host/ArduinoHost.cpp KnxTpUart.cpp
+//       KnxTelegram.cpp KnxClock.cpp KnxGroupStats.cpp KnxBusHealth.cpp KnxComObject.cpp
+//       KnxComObjectTable.cpp -o KnxTpUart_RxBenchmark
+//   ./KnxTpUart_RxBenchmark
+
+#include "HostSerial.h"
+#include "KnxTpUart.h"
+
+#define PHYSICAL_ADDR   0x1101
+#define TELEGRAMS_NB    300  // Nb of telegrams received per measurement
+
+static const byte chunkSizes[] = { 1, 2, 4, 8, 23 };
+static const unsigned int callCosts[] = { 0, 1000 }; // ns, 1us is in the range of an ESP32 UART driver call
+
+static KnxComObject switchObject(0x0801, KNX_DPT_1_001, COM_OBJ_LOGIC_IN);
+static KnxComObject valueObject(0x0802, KNX_DPT_14_000, COM_OBJ_LOGIC_IN);
+static KnxComObject* comObjects[] = { &switchObject, &valueObject };
+
+static word receivedNb;
+
+static void EventCallback(e_KnxBusCouplerEvent event)
+{ if (event == BUSCOUPLER_EVENT_RECEIVED_EIB_TELEGRAM) receivedNb++; }
+
+static void AckCallback(e_BusCouplerTxAck) {}
+
+
+static unsigned long long NowNanosec(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+
+// Build the raw bytes of the n-th telegram of the benchmark sequence
+// The sequence alternates 2 addressed telegrams (B1 and F32 values) and a not addressed max sized one
+static byte BuildTelegram(word n, byte raw[])
+{
+  KnxTelegram telegram;
+  byte payload[KNX_TELEGRAM_PAYLOAD_MAX_SIZE];
+
+  telegram.SetSourceAddress(0x1102);
+  telegram.SetCommand(KNX_COMMAND_VALUE_WRITE);
+  switch (n % 3)
+  {
+    case 0 : telegram.SetTargetAddress(0x0801); telegram.SetPayloadLength(1); break;
+    case 1 : telegram.SetTargetAddress(0x0802); telegram.SetPayloadLength(5); break;
+    default : telegram.SetTargetAddress(0x0901); telegram.SetPayloadLength(KNX_TELEGRAM_PAYLOAD_MAX_SIZE - 1); break;
+  }
+  for (byte i = 0; i < sizeof(payload); i++) payload[i] = (byte)(n + i);
+  telegram.SetFirstPayloadByte(n & 1);
+  if (telegram.GetPayloadLength() > 1) telegram.SetLongPayload(payload, telegram.GetPayloadLength() - 1);
+  telegram.UpdateChecksum();
+  for (byte i = 0; i < telegram.GetTelegramLength(); i++) raw[i] = telegram.ReadRawByte(i);
+  return telegram.GetTelegramLength();
+}
+
+
+int main(void)
+{
+  HostSerial serial;
+  KnxTpUart tpuart(serial, PHYSICAL_ADDR, NORMAL);
+  type_buscoupler_rx_telegram rxTelegram;
+  byte raw[KNX_TELEGRAM_MAX_SIZE], length;
+  const byte resetIndication = TPUART_RESET_INDICATION;
+  word acksOk;
+  unsigned long totalBytes, callsNb;
+  unsigned long long startTime, rxTime;
+
+  tpuart.Reset();
+  serial.InjectRxBytes(&resetIndication, 1);
+  if (tpuart.Reset() != KNX_BUSCOUPLER_OK) { printf("TPUART reset failed\n"); return 1; }
+  tpuart.AttachComObjectsList(comObjects, 2);
+  tpuart.SetEvtCallback(&EventCallback);
+  tpuart.SetAckCallback(&AckCallback);
+  tpuart.Init();
+
+  printf("chunk;call_cost_ns;ns_per_byte;calls_per_byte;telegrams;acks_ok\n");
+  for (byte c = 0; c < sizeof(callCosts) / sizeof(callCosts[0]); c++)
+  {
+    serial.SetCallCost(callCosts[c]);
+    for (byte s = 0; s < sizeof(chunkSizes); s++)
+    {
+      receivedNb = 0; acksOk = 0; totalBytes = 0; rxTime = 0; callsNb = 0;
+      for (word n = 0; n < TELEGRAMS_NB; n++)
+      {
+        length = BuildTelegram(n, raw);
+        serial.ClearTx();
+        for (byte offset = 0; offset < length; offset += chunkSizes[s])
+        {
+          serial.InjectRxBytes(raw + offset, (length - offset < chunkSizes[s]) ? length - offset : chunkSizes[s]);
+          serial.ClearCallsNb();
+          startTime = NowNanosec();
+          tpuart.RXTask();
+          rxTime += NowNanosec() - startTime;
+          callsNb += serial.GetCallsNb();
+        }
+        totalBytes += length;
+        // the ACK service shall have been sent, with the addressed/not addressed value
+        if ((serial.TxBytesNb() == 1) && (serial.TxByte(0) == ((n % 3 == 2) ?
+             TPUART_RX_ACK_SERVICE_NOT_ADDRESSED : TPUART_RX_ACK_SERVICE_ADDRESSED))) acksOk++;
+        // EOP
+        delayMicroseconds(2100);
+        tpuart.RXTask();
+        while (tpuart.PopReceivedTelegram(rxTelegram));
+      }
+      printf("%u;%u;%.1f;%.2f;%u;%u\n", chunkSizes[s], callCosts[c], (double)rxTime / totalBytes,
+             (double)callsNb / totalBytes, receivedNb, acksOk);
+    }
+  }
+  return 0;
+}
+
+// EOF
@@ -0,0 +1,228 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxTpUart_RxFloodBenchmark.cpp
+// Author : Franck Marini
+// Description : RX flood stress benchmark of a KnxDevice on a TPUART, depending on the application loop period
+//               The TPUART is replaced by the byte accurate emulator (TpUartEmulator) and the time is virtual
+//               (KnxVirtualClock) : the device task() is called at an exact period, the library cost is not counted.
+//               The bus traffic is a Poisson flow of frames (offered bus load in % of the bus time, frames plus
+//               acknowledge and idle time) :
+//               - 1/3 of group writes addressed to the device com objects, 2/3 of not addressed frames (1 to 14 bytes)
+//               - the device writes a sensor object every 250ms : echo of its own frames and data confirms
+//               - a state request every second : state indications
+//               For each (bus load, task period) setting, 60s of bus time are simulated and the benchmark reports
+//               the addressed frames received by the application, the reception errors (checksum, incomplete frame),
+//               the frame ends missed by the driver, the ACK infos sent too late (> 1,7ms) or not sent.
+//               NB : KnxDevice::task() runs the RX task when more than 400us elapsed since the last one, i.e. every
+//               2 calls for a 400us period.
+//               NB : every time read costs 1us of virtual time. It emulates the CPU time, and lets the device leave
+//               the loop waiting for the TPUART reset answer (reset events column, e.g. after a misread byte).
+//               Output format (CSV) :
+//               load_pct;task_period_us;injected;addressed;received;rx_errors;missed_eops;late_acks;missed_acks;sent;confirmed;state_indications;resets
+// Module dependencies : KnxDevice, KnxTpUart, TpUartEmulator, KnxClock
+//
+// Build and run from the library root folder (single command line) :
+//   g++ -O2 -I extras/host -I . extras/host/benchmarks/KnxTpUart_RxFloodBenchmark.cpp extras/host/TpUartEmulator.cpp
+//       extras/host/ArduinoHost.cpp KnxDevice.cpp KnxTpUart.cpp KnxTelegram.cpp KnxClock.cpp KnxGroupStats.cpp KnxBusHealth.cpp
+//       KnxComObject.cpp KnxComObjectTable.cpp KnxDPTCodec.cpp StKnxCoupler.cpp KnxTxLatency.cpp -o KnxTpUart_RxFloodBenchmark
+//   ./KnxTpUart_RxFloodBenchmark [load_pct]
+
+#include "TpUartEmulator.h"
+#include "KnxDevice.h"
+
+#define PHYSICAL_ADDR       0x1101
+#define SETTING_DURATION    60000000ULL // us
+#define DRAIN_DURATION      100000      // us, end of a setting without injected traffic
+#define WRITE_PERIOD        250000      // us
+#define STATE_REQ_PERIOD    1000000     // us
+#define BIT_TIME            104         // us, 9600 bit/s
+#define FRAME_BUS_BITS(length) (((length) - 1) * 13 + 11 + 15 + 11 + 50) // frame, ACK gap, ACK, idle time
+
+static const byte busLoads[] = { 30, 60, 90 }; // %
+static const word taskPeriods[] = { 100, 200, 400, 450, 600, 800, 1000, 1200, 1500, 2000, 2500, 3000 }; // us
+
+static KnxComObject input0(0x0A00, KNX_DPT_5_001, COM_OBJ_LOGIC_IN);
+static KnxComObject input1(0x0A01, KNX_DPT_5_001, COM_OBJ_LOGIC_IN);
+static KnxComObject input2(0x0A02, KNX_DPT_5_001, COM_OBJ_LOGIC_IN);
+static KnxComObject input3(0x0A03, KNX_DPT_5_001, COM_OBJ_LOGIC_IN);
+static KnxComObject sensor(0x0801, KNX_DPT_9_001, COM_OBJ_SENSOR);
+static KnxComObject* comObjects[] = { &input0, &input1, &input2, &input3, &sensor };
+
+static KnxVirtualClock clock_;
+static unsigned long randomState = 1;
+static unsigned long receivedNb, rxErrorsNb, stateIndicationsNb, confirmedNb, resetsNb;
+static type_EventCallbackFctPtr deviceEvtCallback;
+static type_AckCallbackFctPtr deviceAckCallback;
+
+void knxEvents(byte index) { if (index < 4) receivedNb++; }
+
+
+// Counting of the coupler events before they reach the device
+static void CountEvents(e_KnxBusCouplerEvent event)
+{
+  if (event == BUSCOUPLER_EVENT_EIB_TELEGRAM_RECEPTION_ERROR) rxErrorsNb++;
+  if (event == BUSCOUPLER_EVENT_STATE_INDICATION) stateIndicationsNb++;
+  if (event == BUSCOUPLER_EVENT_RESET) resetsNb++;
+  deviceEvtCallback(event);
+}
+
+static void CountAcks(e_BusCouplerTxAck value)
+{
+  if (value == ACK_RESPONSE) confirmedNb++;
+  deviceAckCallback(value);
+}
+
+class CountingTpUart : public KnxTpUart {
+  public:
+    CountingTpUart(HardwareSerial& serial) : KnxTpUart(serial, PHYSICAL_ADDR, NORMAL) {}
+    byte SetEvtCallback(type_EventCallbackFctPtr fct) { deviceEvtCallback = fct; return KnxTpUart::SetEvtCallback(&CountEvents); }
+    byte SetAckCallback(type_AckCallbackFctPtr fct) { deviceAckCallback = fct; return KnxTpUart::SetAckCallback(&CountAcks); }
+};
+
+
+// Deterministic pseudo random generator (xorshift)
+static unsigned long Random(void)
+{
+  randomState ^= randomState << 13; randomState &= 0xFFFFFFFF;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5; randomState &= 0xFFFFFFFF;
+  return randomState;
+}
+
+
+// Build the next frame of the traffic, return true if it is addressed to the device
+static boolean BuildFrame(KnxTelegram& telegram)
+{
+  byte payload[KNX_TELEGRAM_PAYLOAD_MAX_SIZE];
+  boolean addressed = (Random() % 3 == 0);
+
+  telegram.ClearTelegram();
+  telegram.SetSourceAddress(0x1200 + (Random() & 0xFF));
+  telegram.SetCommand(KNX_COMMAND_VALUE_WRITE);
+  if (addressed)
+  {
+    telegram.SetTargetAddress(0x0A00 + (Random() & 3));
+    telegram.SetPayloadLength(2);
+  }
+  else
+  {
+    telegram.SetTargetAddress(0x0C00 + (Random() & 0xFF));
+    telegram.SetPayloadLength(1 + Random() % 14);
+  }
+  for (byte i = 0; i < sizeof(payload); i++) payload[i] = (byte)Random();
+  telegram.SetFirstPayloadByte(0);
+  if (telegram.GetPayloadLength() > 1) telegram.SetLongPayload(payload, telegram.GetPayloadLength() - 1);
+  telegram.UpdateChecksum();
+  return addressed;
+}
+
+
+// Move the virtual time forward to "time" (the time reads may have already moved it further)
+static void WaitUntil(unsigned long long time)
+{
+  if (clock_.GetTime() < time) clock_.SetTime(time);
+}
+
+
+// Exponential inter-arrival time for the given load (the mean frame length is 14 bytes)
+static unsigned long NextArrivalDelay(byte loadPct)
+{
+  double meanMicros = (double)FRAME_BUS_BITS(14) * BIT_TIME * 100 / loadPct;
+  double u = (Random() + 1.0) / 4294967297.0;
+  return (unsigned long)(-log(u) * meanMicros);
+}
+
+
+static void RunSetting(byte loadPct, word taskPeriod)
+{
+  TpUartEmulator emulator;
+  CountingTpUart *coupler = new CountingTpUart(emulator);
+  KnxTelegram telegram;
+  unsigned long long endTime, injectEndTime, nextTaskTime, nextInjectTime, nextWriteTime, nextStateReqTime;
+  unsigned long injectedNb = 0, addressedNb = 0, sentNb = 0;
+  word attempts;
+
+  Knx.begin(coupler, comObjects, sizeof(comObjects) / sizeof(comObjects[0]));
+  for (attempts = 0; (Knx.checkInitBus() != KNX_DEVICE_OK) && (attempts < 10000); attempts++) clock_.Advance(taskPeriod);
+  if (attempts == 10000) { printf("# TPUART init failed\n"); Knx.end(); return; }
+  receivedNb = rxErrorsNb = stateIndicationsNb = confirmedNb = resetsNb = 0;
+  emulator.ClearAckRecords();
+  emulator.ClearMissedEopsNb();
+
+  nextTaskTime = clock_.GetTime();
+  endTime = nextTaskTime + SETTING_DURATION;
+  injectEndTime = endTime - DRAIN_DURATION;
+  nextInjectTime = nextTaskTime + NextArrivalDelay(loadPct);
+  nextWriteTime = nextStateReqTime = nextTaskTime;
+
+  while (nextTaskTime < endTime)
+  {
+    if ((nextInjectTime < nextTaskTime) && (nextInjectTime < injectEndTime))
+    { // a frame starts on the bus
+      WaitUntil(nextInjectTime);
+      if (BuildFrame(telegram)) addressedNb++;
+      if (emulator.InjectBusTelegram(telegram) == TPUARTEMU_OK) injectedNb++;
+      else if (telegram.GetTargetAddress() < 0x0C00) addressedNb--; // emulator queue full
+      nextInjectTime += NextArrivalDelay(loadPct);
+      continue;
+    }
+    WaitUntil(nextTaskTime);
+    if (Knx.checkInitBus() == KNX_DEVICE_OK) Knx.task();
+    if (nextTaskTime >= nextWriteTime)
+    {
+      Knx.write(4, (float)(sentNb++ % 100));
+      nextWriteTime += WRITE_PERIOD;
+    }
+    if ((nextTaskTime >= nextStateReqTime) && !coupler->IsActive())
+    {
+      coupler->DEBUG_SendStateReqCommand();
+      nextStateReqTime += STATE_REQ_PERIOD;
+    }
+    nextTaskTime += taskPeriod;
+    if (nextTaskTime < clock_.GetTime()) nextTaskTime = clock_.GetTime(); // the device has been blocked
+  }
+
+  printf("%u;%u;%lu;%lu;%lu;%lu;%u;%lu;%lu;%lu;%lu;%lu;%lu\n", loadPct, taskPeriod, injectedNb, addressedNb, receivedNb,
+         rxErrorsNb, emulator.GetMissedEopsNb(), emulator.GetTotalLateAcksNb(), emulator.GetTotalMissedAcksNb(),
+         sentNb, confirmedNb, stateIndicationsNb, resetsNb);
+  fflush(stdout);
+  Knx.end(); // deletes the coupler
+}
+
+
+int main(int argc, char *argv[])
+{
+  byte customLoad = (argc > 1) ? atoi(argv[1]) : 0;
+
+  clock_.SetReadStep(1);
+  KnxSetClock(&clock_);
+  printf("load_pct;task_period_us;injected;addressed;received;rx_errors;missed_eops;late_acks;missed_acks;sent;confirmed;state_indications;resets\n");
+  for (byte l = 0; l < sizeof(busLoads); l++)
+  {
+    if (customLoad && (l > 0)) break;
+    for (byte p = 0; p < sizeof(taskPeriods) / sizeof(taskPeriods[0]); p++)
+      RunSetting(customLoad ? customLoad : busLoads[l], taskPeriods[p]);
+  }
+  KnxSetClock(NULL);
+  return 0;
+}
+
+// EOF
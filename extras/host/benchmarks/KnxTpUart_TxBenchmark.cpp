@@ -0,0 +1,117 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxTpUart_TxBenchmark.cpp
+// Author : Franck Marini
+// Description : Host benchmark of the KnxTpUart telegram transmission latency
+//               The TPUART is replaced by a HostSerial stand-in modelling the UART TX line at 19200 baud.
+//               The TX task is called with a fixed period, the benchmark measures for each telegram :
+//               - the handoff time : from SendTelegram() to the last service written into the UART
+//               - the on bus time : from SendTelegram() to the last character sent to the TPUART
+//               Build with -DKNXTPUART_TX_BURST to measure the "burst" mode instead of the "paced" one.
+//               Output format (CSV) : mode;task_period_us;telegram_bytes;handoff_us;on_bus_us;acks
+// Module dependencies : KnxTpUart, HostSerial
+//
+// Build and run from the library root folder (single command line) :
+//   g++ -O2 -I extras/host -I . extras/host/benchmarks/KnxTpUart_TxBenchmark.cpp extras/host/ArduinoHost.cpp KnxTpUart.cpp
+//       KnxTelegram.cpp KnxClock.cpp KnxGroupStats.cpp KnxBusHealth.cpp KnxComObject.cpp
+//       KnxComObjectTable.cpp -o KnxTpUart_TxBenchmark
+//   ./KnxTpUart_TxBenchmark
+
+#include "HostSerial.h"
+#include "KnxTpUart.h"
+
+#define PHYSICAL_ADDR   0x1101
+#if defined(KNXTPUART_TX_BURST)
+#define MODE            "burst"
+#else
+#define MODE            "paced"
+#endif
+#define TELEGRAMS_NB    10  // Nb of telegrams sent per measurement
+
+static const word taskPeriods[] = { 800, 2000, 5000 }; // us
+static const byte payloadLengths[] = { 1, KNX_TELEGRAM_PAYLOAD_MAX_SIZE - 1 }; // i.e. 9 and 23 bytes telegrams
+
+static word acksNb;
+
+static void EventCallback(e_KnxBusCouplerEvent) {}
+
+static void AckCallback(e_BusCouplerTxAck value) { if (value == ACK_RESPONSE) acksNb++; }
+
+
+int main(void)
+{
+  HostSerial serial;
+  KnxTpUart tpuart(serial, PHYSICAL_ADDR, NORMAL);
+  KnxTelegram telegram;
+  byte payload[KNX_TELEGRAM_PAYLOAD_MAX_SIZE];
+  const byte resetIndication = TPUART_RESET_INDICATION;
+  const byte dataConfirm = TPUART_DATA_CONFIRM_SUCCESS;
+  unsigned long startTime, nextTaskTime, handoffTime, onBusTime;
+
+  tpuart.Reset();
+  serial.InjectRxBytes(&resetIndication, 1);
+  if (tpuart.Reset() != KNX_BUSCOUPLER_OK) { printf("TPUART reset failed\n"); return 1; }
+  tpuart.SetEvtCallback(&EventCallback);
+  tpuart.SetAckCallback(&AckCallback);
+  tpuart.Init();
+
+  for (byte i = 0; i < sizeof(payload); i++) payload[i] = i;
+
+  printf("mode;task_period_us;telegram_bytes;handoff_us;on_bus_us;acks\n");
+  for (byte p = 0; p < sizeof(taskPeriods) / sizeof(taskPeriods[0]); p++)
+  {
+    for (byte l = 0; l < sizeof(payloadLengths); l++)
+    {
+      handoffTime = 0; onBusTime = 0; acksNb = 0;
+      for (byte n = 0; n < TELEGRAMS_NB; n++)
+      {
+        telegram.ClearTelegram();
+        telegram.SetTargetAddress(0x0801);
+        telegram.SetCommand(KNX_COMMAND_VALUE_WRITE);
+        telegram.SetPayloadLength(payloadLengths[l]);
+        telegram.SetFirstPayloadByte(n & 1);
+        if (payloadLengths[l] > 1) telegram.SetLongPayload(payload, payloadLengths[l] - 1);
+        telegram.UpdateChecksum();
+
+        // wait for the TX line to be idle
+        while ((long)(serial.GetTxLineEndMicros() - micros()) > 0);
+        serial.ClearTx();
+        startTime = micros();
+        tpuart.SendTelegram(telegram);
+        // TX task called periodically till the whole telegram is handed to the UART
+        for (nextTaskTime = startTime; serial.TxBytesNb() < 2 * telegram.GetTelegramLength(); nextTaskTime += taskPeriods[p])
+        {
+          while ((long)(nextTaskTime - micros()) > 0);
+          tpuart.TXTask();
+        }
+        handoffTime += micros() - startTime;
+        onBusTime += serial.GetTxLineEndMicros() - startTime;
+        // TPUART confirmation
+        serial.InjectRxBytes(&dataConfirm, 1);
+        tpuart.RXTask();
+      }
+      printf("%s;%u;%u;%lu;%lu;%u\n", MODE, taskPeriods[p], telegram.GetTelegramLength(),
+             handoffTime / TELEGRAMS_NB, onBusTime / TELEGRAMS_NB, acksNb);
+    }
+  }
+  return 0;
+}
+
+// EOF
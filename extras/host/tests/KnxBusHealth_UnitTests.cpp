@@ -0,0 +1,217 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxBusHealth_UnitTests.cpp
+// Author : Franck Marini
+// Description : Host tests of the bus health and load counters maintained by the TPUART driver
+//               (TPUART emulator, virtual time)
+//               - telegrams per second and bus occupancy gauges under a known load, back to 0 when idle
+//               - received telegrams, reception errors, own telegrams echo not counted as received
+//               - transmission outcomes : ACK, NACK (bus not acknowledging), timeout (TPUART not answering)
+//               - state indication errors per bit, TPUART resets
+//               - consistent snapshots read from another thread
+//               The program returns the nb of failed checks.
+// Module dependencies : KnxBusHealth, KnxTpUart, TpUartEmulator, KnxClock
+//
+// Build and run from the library root folder (single command line) :
+//   g++ -O2 -pthread -I extras/host -I . extras/host/tests/KnxBusHealth_UnitTests.cpp extras/host/TpUartEmulator.cpp
+//       extras/host/ArduinoHost.cpp KnxTpUart.cpp KnxTelegram.cpp KnxClock.cpp KnxGroupStats.cpp KnxBusHealth.cpp
+//       KnxComObject.cpp KnxComObjectTable.cpp -o KnxBusHealth_UnitTests
+//   ./KnxBusHealth_UnitTests
+
+#include "TpUartEmulator.h"
+#include "KnxTpUart.h"
+#include <pthread.h>
+#include <sched.h>
+
+#define PHYSICAL_ADDR   0x1101
+#define RX_TASK_PERIOD  400 // us
+#define TX_TASK_PERIOD  800 // us
+#define THREAD_LOOPS_NB 200000UL
+
+static word errorsNb;
+static KnxVirtualClock clock_(1000000);
+static KnxBusHealth threadHealth;
+static volatile boolean writerDone;
+
+static KnxComObject switchObject(0x0801, KNX_DPT_1_001, COM_OBJ_LOGIC_IN);
+static KnxComObject* comObjects[] = { &switchObject };
+
+static void EventCallback(e_KnxBusCouplerEvent) {}
+static void AckCallback(e_BusCouplerTxAck) {}
+
+
+static void Check(const char *label, boolean result)
+{
+  printf("%s : %s\n", label, result ? "OK" : "FAILED !!");
+  if (!result) errorsNb++;
+}
+
+
+static void RunTasks(KnxTpUart& tpuart, unsigned long durationMicros)
+{
+  for (unsigned long t = 0; t < durationMicros; t += RX_TASK_PERIOD)
+  {
+    clock_.Advance(RX_TASK_PERIOD);
+    tpuart.RXTask();
+    if ((t / RX_TASK_PERIOD) & 1) tpuart.TXTask(); // every 800us
+  }
+}
+
+
+static byte BuildFrame(byte frame[], word target)
+{
+  KnxTelegram telegram;
+
+  telegram.SetSourceAddress(0x1102);
+  telegram.SetTargetAddress(target);
+  telegram.SetCommand(KNX_COMMAND_VALUE_WRITE);
+  telegram.SetPayloadLength(2);
+  telegram.UpdateChecksum();
+  for (byte i = 0; i < telegram.GetTelegramLength(); i++) frame[i] = telegram.ReadRawByte(i);
+  return telegram.GetTelegramLength();
+}
+
+
+// Reader thread : every snapshot shall be a state the writer went through, i.e. the outcomes never exceed the
+// sent telegrams (the writer records the telegram before its outcome)
+static void *ReaderThread(void *result)
+{
+  type_bus_health health;
+  unsigned long outcomes;
+
+  *(boolean *)result = true;
+  while (!writerDone)
+  {
+    threadHealth.GetSnapshot(health);
+    outcomes = health.txOutcomesNb[ACK_RESPONSE] + health.txOutcomesNb[NACK_RESPONSE];
+    if ((outcomes > health.txTelegramsNb) || (health.txTelegramsNb > outcomes + 1)) *(boolean *)result = false;
+    sched_yield(); // single core hosts
+  }
+  return NULL;
+}
+
+
+int main(void)
+{
+  TpUartEmulator emulator;
+  KnxTpUart tpuart(emulator, PHYSICAL_ADDR, NORMAL);
+  KnxBusHealth health;
+  type_bus_health snapshot;
+  KnxTelegram telegram;
+  byte frame[KNX_TELEGRAM_MAX_SIZE], length;
+  word attempts;
+  boolean result;
+  pthread_t reader;
+
+  KnxSetClock(&clock_);
+  for (attempts = 0; (tpuart.Reset() != KNX_BUSCOUPLER_OK) && (attempts < 100); attempts++) clock_.Advance(100);
+  tpuart.AttachComObjectsList(comObjects, 1);
+  tpuart.SetEvtCallback(&EventCallback);
+  tpuart.SetAckCallback(&AckCallback);
+  Check("counters set", tpuart.SetBusHealth(&health));
+  Check("init", tpuart.Init() == KNX_BUSCOUPLER_OK);
+  RunTasks(tpuart, 10000);
+  health.Clear();
+
+  printf("--- Bus load ---\n");
+  // 20 telegrams per second during 3s, 1 of 4 addressed to the device
+  for (word n = 0; n < 60; n++)
+  {
+    length = BuildFrame(frame, (n & 3) ? 0x0901 : 0x0801);
+    emulator.InjectBusFrame(frame, length);
+    RunTasks(tpuart, 50000);
+  }
+  health.GetSnapshot(snapshot);
+  printf("%u telegrams/s, bus load %u per mille (expected %lu)\n", snapshot.rxTelegramsPerSecond,
+         snapshot.busLoadPerMille, 20 * KNX_BUS_HEALTH_FRAME_MICROS(length) / 1000);
+  Check("received telegrams", (snapshot.rxTelegramsNb == 60) && (snapshot.rxErrorsNb == 0));
+  Check("telegrams per second", (snapshot.rxTelegramsPerSecond >= 19) && (snapshot.rxTelegramsPerSecond <= 21));
+  Check("bus load", ((unsigned long)snapshot.busLoadPerMille + 20 >= 20 * KNX_BUS_HEALTH_FRAME_MICROS(length) / 1000)
+        && (snapshot.busLoadPerMille <= 20 + 20 * KNX_BUS_HEALTH_FRAME_MICROS(length) / 1000));
+  RunTasks(tpuart, 2100000);
+  health.GetSnapshot(snapshot);
+  Check("idle gauges", (snapshot.rxTelegramsPerSecond == 0) && (snapshot.busLoadPerMille == 0));
+
+  length = BuildFrame(frame, 0x0801);
+  frame[length - 1] ^= 0x01;
+  emulator.InjectBusFrame(frame, length);
+  RunTasks(tpuart, 50000);
+  health.GetSnapshot(snapshot);
+  Check("reception error", (snapshot.rxErrorsNb == 1) && (snapshot.rxTelegramsNb == 60));
+
+  printf("\n--- Transmission outcomes ---\n");
+  telegram.SetTargetAddress(0x0801);
+  telegram.SetCommand(KNX_COMMAND_VALUE_WRITE);
+  telegram.UpdateChecksum();
+  tpuart.SendTelegram(telegram);
+  RunTasks(tpuart, 200000);
+  health.GetSnapshot(snapshot);
+  Check("ACK", (snapshot.txTelegramsNb == 1) && (snapshot.txOutcomesNb[ACK_RESPONSE] == 1));
+  Check("own telegram echo not received", snapshot.rxTelegramsNb == 60);
+  emulator.SetBusAcknowledge(false);
+  tpuart.SendTelegram(telegram);
+  RunTasks(tpuart, 400000);
+  emulator.SetBusAcknowledge(true);
+  health.GetSnapshot(snapshot);
+  Check("NACK", (snapshot.txTelegramsNb == 2) && (snapshot.txOutcomesNb[NACK_RESPONSE] == 1));
+  emulator.SetResponding(false);
+  tpuart.SendTelegram(telegram);
+  RunTasks(tpuart, 700000);
+  emulator.SetResponding(true);
+  health.GetSnapshot(snapshot);
+  Check("timeout", (snapshot.txTelegramsNb == 3) && (snapshot.txOutcomesNb[NO_ANSWER_TIMEOUT] == 1));
+
+  printf("\n--- State indications and resets ---\n");
+  emulator.SetStateFlags(TPUART_STATE_INDICATION_SLAVE_COLLISION_MASK | TPUART_STATE_INDICATION_TEMP_WARNING_MASK);
+  tpuart.DEBUG_SendStateReqCommand();
+  RunTasks(tpuart, 10000);
+  tpuart.DEBUG_SendStateReqCommand();
+  RunTasks(tpuart, 10000);
+  emulator.SetStateFlags(0);
+  health.GetSnapshot(snapshot);
+  Check("state errors per bit", (snapshot.stateErrorsNb[KNX_BUS_HEALTH_SLAVE_COLLISION] == 2)
+        && (snapshot.stateErrorsNb[KNX_BUS_HEALTH_TEMPERATURE_WARNING] == 2) && (snapshot.stateErrorsNb[KNX_BUS_HEALTH_RECEIVE_ERROR] == 0)
+        && (snapshot.stateErrorsNb[KNX_BUS_HEALTH_TRANSMIT_ERROR] == 0) && (snapshot.stateErrorsNb[KNX_BUS_HEALTH_PROTOCOL_ERROR] == 0));
+  emulator.SimulateReset();
+  RunTasks(tpuart, 10000);
+  health.GetSnapshot(snapshot);
+  Check("TPUART reset", snapshot.couplerResetsNb == 1);
+  Check("not maintained when removed", tpuart.SetBusHealth(NULL));
+
+  printf("\n--- Snapshots from another thread ---\n");
+  writerDone = false;
+  pthread_create(&reader, NULL, &ReaderThread, &result);
+  for (unsigned long i = 0; i < THREAD_LOOPS_NB; i++)
+  {
+    threadHealth.RecordTxTelegram();
+    threadHealth.RecordTxOutcome((i & 1) ? ACK_RESPONSE : NACK_RESPONSE);
+    if (!(i & 0xFF)) sched_yield();
+  }
+  writerDone = true;
+  pthread_join(reader, NULL);
+  Check("consistent snapshots", result);
+
+  KnxSetClock(NULL);
+  printf("\n%u error(s)\n", errorsNb);
+  return errorsNb;
+}
+
+// EOF
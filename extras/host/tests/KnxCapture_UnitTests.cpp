@@ -0,0 +1,312 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxCapture_UnitTests.cpp
+// Author : Franck Marini
+// Description : Host tests of the bus traffic capture and replay
+//               - capture of a KnxDevice on the TPUART emulator : received and sent telegrams, acknowledges,
+//                 state indication, record times
+//               - capture of all the frames seen on the bus, replay of such a capture
+//               - capture reader : file append and memory mapping, wrong header, truncated record, 32 bits time
+//                 wrap around and older records
+//               - replay to a KnxDevice in real time (virtual clock), 10 times faster and as fast as possible
+//               The program returns the nb of failed checks.
+// Module dependencies : KnxCapture, KnxCaptureFile, KnxReplayCoupler, KnxDevice, KnxTpUart, TpUartEmulator, KnxClock
+//
+// Build and run from the library root folder (single command line) :
+//   g++ -O2 -I extras/host -I . extras/host/tests/KnxCapture_UnitTests.cpp extras/host/KnxCaptureFile.cpp
+//       extras/host/KnxReplayCoupler.cpp extras/host/TpUartEmulator.cpp extras/host/ArduinoHost.cpp KnxCapture.cpp
+//       KnxDevice.cpp KnxTpUart.cpp KnxTelegram.cpp KnxClock.cpp KnxGroupStats.cpp KnxBusHealth.cpp KnxComObject.cpp
+//       KnxComObjectTable.cpp KnxDPTCodec.cpp StKnxCoupler.cpp KnxTxLatency.cpp -o KnxCapture_UnitTests
+//   ./KnxCapture_UnitTests
+
+#include "KnxCapture.h"
+#include "KnxCaptureFile.h"
+#include "KnxReplayCoupler.h"
+#include "TpUartEmulator.h"
+#include "KnxDevice.h"
+#include <unistd.h>
+
+#define DEVICE_ADDR     0x1101
+#define TASK_PERIOD     400      // us
+#define RECORD_DURATION 1000000  // us
+#define MAX_EVENTS      64
+
+static word errorsNb;
+
+static KnxComObject input(0x0A00, KNX_DPT_5_001, COM_OBJ_LOGIC_IN);
+static KnxComObject sensor(0x0801, KNX_DPT_9_001, COM_OBJ_SENSOR);
+static KnxComObject* comObjects[] = { &input, &sensor };
+
+static KnxVirtualClock clock_(1000);
+static unsigned long long eventTimes[MAX_EVENTS]; // application events times
+static byte eventsNb;
+
+void knxEvents(byte index) { if (eventsNb < MAX_EVENTS) eventTimes[eventsNb++] = clock_.GetTime(); }
+
+
+static void Check(const char *label, boolean result)
+{
+  printf("%s : %s\n", label, result ? "OK" : "FAILED !!");
+  if (!result) errorsNb++;
+}
+
+
+// Capture sink in RAM
+class MemorySink : public KnxCaptureSink {
+  public:
+    byte buffer[16384];
+    size_t size;
+    MemorySink() { memcpy(buffer, KnxCaptureHeader, KNX_CAPTURE_HEADER_SIZE); size = KNX_CAPTURE_HEADER_SIZE; }
+    boolean Write(const byte record[], byte length)
+    {
+      if (size + length > sizeof(buffer)) return false;
+      memcpy(buffer + size, record, length);
+      size += length;
+      return true;
+    }
+};
+
+
+static void DeviceTask(void)
+{
+  if (Knx.checkInitBus() == KNX_DEVICE_OK) Knx.task();
+}
+
+
+// Device on the TPUART emulator : a frame every 50ms (addressed to the input object one time out of two),
+// a sensor write at 100, 400 and 700ms, a state request at 920ms
+static void RecordDevice(MemorySink& sink, unsigned long& recordsNb, unsigned long& lostRecordsNb,
+                         boolean allFrames = false)
+{
+  TpUartEmulator emulator;
+  KnxCaptureCoupler *capture = new KnxCaptureCoupler(new KnxTpUart(emulator, DEVICE_ADDR, NORMAL), sink, allFrames);
+  KnxTelegram telegram;
+  unsigned long long startTime = clock_.GetTime();
+  word n = 0;
+
+  Knx.begin(capture, comObjects, 2);
+  while (Knx.checkInitBus() != KNX_DEVICE_OK) clock_.Advance(TASK_PERIOD);
+  eventsNb = 0;
+  for (unsigned long t = 0; t < RECORD_DURATION; t += TASK_PERIOD)
+  {
+    if (t >= 50000UL * (n + 1))
+    {
+      telegram.ClearTelegram();
+      telegram.SetSourceAddress(0x1200);
+      telegram.SetTargetAddress((n & 1) ? 0x0C00 : 0x0A00);
+      telegram.SetCommand(KNX_COMMAND_VALUE_WRITE);
+      telegram.SetPayloadLength(2);
+      telegram.SetLongPayload((const byte *)&n, 1);
+      telegram.UpdateChecksum();
+      emulator.InjectBusTelegram(telegram);
+      n++;
+    }
+    if ((t == 100000) || (t == 400000) || (t == 700000)) Knx.write(1, (float)t / 1000);
+    if (t == 920000) capture->DEBUG_SendStateReqCommand();
+    clock_.SetTime(startTime + t);
+    DeviceTask();
+  }
+  recordsNb = capture->GetRecordsNb();
+  lostRecordsNb = capture->GetLostRecordsNb();
+  Knx.end(); // deletes the capture coupler and the TPUART coupler
+}
+
+
+// Replay the capture at the given speed, with a task call every TASK_PERIOD
+// The device writes the sensor value 3 times, a bit before the captured writes (the replay starts at the 1st record)
+// return the nb of task calls and the time until the replay end
+static unsigned long ReplayDevice(KnxCaptureReader& reader, word speed, KnxReplayCoupler*& replay,
+                                  unsigned long long& duration)
+{
+  unsigned long long startTime = clock_.GetTime();
+  unsigned long callsNb;
+
+  replay = new KnxReplayCoupler(reader, speed);
+  Knx.begin(replay, comObjects, 2);
+  eventsNb = 0;
+  for (callsNb = 0; !replay->IsFinished() && (callsNb < 100000); callsNb++)
+  {
+    DeviceTask();
+    if ((callsNb == 100) || (callsNb == 850) || (callsNb == 1600)) Knx.write(1, (float)callsNb);
+    clock_.Advance(TASK_PERIOD);
+  }
+  duration = clock_.GetTime() - startTime;
+  for (word i = 0; i < 10; i++) { DeviceTask(); clock_.Advance(TASK_PERIOD); } // last telegrams processing
+  return callsNb;
+}
+
+
+static void WriteRecord(byte buffer[], size_t& size, e_KnxCaptureRecordType type, unsigned long time)
+{
+  byte data[2] = { BUSCOUPLER_EVENT_STATE_INDICATION, 0 };
+  size += KnxCaptureBuildRecord(buffer + size, type, time, data, 2);
+}
+
+
+int main(void)
+{
+  MemorySink sink, allFramesSink;
+  KnxCaptureReader reader;
+  KnxCaptureRecord record;
+  KnxCaptureFile file;
+  KnxReplayCoupler *replay;
+  unsigned long recordsNb, allFramesRecordsNb, lostRecordsNb, callsNb;
+  unsigned long long duration;
+  word rxNb = 0, txNb = 0, ackNb = 0, stateNb = 0, framesNb = 0, notAddressedNb = 0, ownFramesNb = 0, i;
+  unsigned long long rxTimes[MAX_EVENTS], lastTime = 0, captureStart, captureEnd = 0;
+  boolean ordered = true, acked = true, matching = true;
+  byte wrapped[64];
+  size_t wrappedSize;
+  char path[] = "/tmp/KnxCaptureTestXXXXXX";
+  int fd;
+
+  KnxSetClock(&clock_);
+  clock_.SetReadStep(1);
+
+  printf("--- Capture ---\n");
+  RecordDevice(sink, recordsNb, lostRecordsNb);
+  Check("records written", (recordsNb > 0) && (lostRecordsNb == 0));
+  Check("capture header", reader.Open(sink.buffer, sink.size) == KNX_CAPTURE_FILE_OK);
+  while (reader.Next(record))
+  {
+    if (record.type == KNX_CAPTURE_RX_TELEGRAM)
+    {
+      if ((rxNb < MAX_EVENTS) && (rxNb < eventsNb)) rxTimes[rxNb] = record.timeMicros;
+      if ((rxNb < eventsNb) && (record.timeMicros >= eventTimes[rxNb])) ordered = false; // 1st byte before the event
+      if ((record.data[0] != 0) || (record.dataLength != 1 + 10) || (record.data[1 + 3] != 0x0A)) matching = false;
+      rxNb++;
+    }
+    if (record.type == KNX_CAPTURE_TX_TELEGRAM)
+    {
+      if ((record.dataLength != 11) || (record.data[1] != 0x11) || (record.data[2] != 0x01)) matching = false;
+      txNb++;
+    }
+    if (record.type == KNX_CAPTURE_TX_ACK) { if (record.data[0] != ACK_RESPONSE) acked = false; ackNb++; }
+    if ((record.type == KNX_CAPTURE_EVENT) && (record.data[0] == BUSCOUPLER_EVENT_STATE_INDICATION)) stateNb++;
+    if (record.timeMicros > captureEnd) captureEnd = record.timeMicros;
+    if (record.type != KNX_CAPTURE_RX_TELEGRAM)
+    {
+      if (record.timeMicros < lastTime) ordered = false;
+      lastTime = record.timeMicros;
+    }
+  }
+  Check("all records read", (reader.GetRecordsNb() == recordsNb) && !reader.IsTruncated());
+  Check("addressed telegrams captured", (rxNb == 10) && (eventsNb == 10));
+  Check("sent telegrams captured with the device address", (txNb == 3) && matching);
+  Check("acknowledges captured", (ackNb == 3) && acked);
+  Check("state indications captured (init and request)", stateNb == 2);
+  Check("record times", ordered);
+
+  printf("\n--- All frames capture ---\n");
+  RecordDevice(allFramesSink, allFramesRecordsNb, lostRecordsNb, true);
+  reader.Open(allFramesSink.buffer, allFramesSink.size);
+  rxNb = 0; matching = true;
+  while (reader.Next(record))
+  {
+    if (record.type == KNX_CAPTURE_RX_TELEGRAM) rxNb++;
+    if (record.type != KNX_CAPTURE_BUS_FRAME) continue;
+    framesNb++;
+    if ((record.data[1] == 0x11) && (record.data[2] == 0x01)) { ownFramesNb++; continue; } // device writes
+    if ((record.dataLength != 10) || (record.data[1] != 0x12) || (record.data[2] != 0x00)) matching = false;
+    if (record.data[3] == 0x0C) notAddressedNb++;
+  }
+  Check("all frames captured", (framesNb == 19 + 3) && (notAddressedNb == 9) && matching && (lostRecordsNb == 0)
+        && (allFramesRecordsNb == recordsNb + framesNb));
+  Check("device frames seen on the bus captured", ownFramesNb == 3);
+  Check("addressed telegrams still captured", rxNb == 10);
+  ReplayDevice(reader, KNX_REPLAY_AS_FAST_AS_POSSIBLE, replay, duration);
+  Check("bus frames skipped by the replay", (eventsNb == 10) && (replay->GetRxTelegramsNb() == 10));
+  Knx.end();
+
+  printf("\n--- Capture reader ---\n");
+  reader.Open(sink.buffer, sink.size);
+  fd = mkstemp(path);
+  close(fd);
+  unlink(path);
+  Check("file creation", file.Open(path) == KNX_CAPTURE_FILE_OK);
+  for (reader.Rewind(); reader.Next(record); )
+    file.Write(record.data - KNX_CAPTURE_RECORD_HEADER_SIZE, KNX_CAPTURE_RECORD_HEADER_SIZE + record.dataLength);
+  file.Close();
+  Check("file append", file.Open(path) == KNX_CAPTURE_FILE_OK);
+  file.Write(sink.buffer + KNX_CAPTURE_HEADER_SIZE, sink.buffer[KNX_CAPTURE_HEADER_SIZE] + 1);
+  file.Close();
+  Check("memory-mapped file", reader.Open(path) == KNX_CAPTURE_FILE_OK);
+  while (reader.Next(record));
+  Check("records of both sessions, single header",
+        (reader.GetRecordsNb() == recordsNb + 1) && (reader.GetSize() == sink.size + sink.buffer[KNX_CAPTURE_HEADER_SIZE] + 1));
+  reader.Close();
+  unlink(path);
+  Check("missing file", reader.Open(path) == KNX_CAPTURE_FILE_ERROR);
+  sink.buffer[0] = 'k';
+  Check("wrong header", reader.Open(sink.buffer, sink.size) == KNX_CAPTURE_FILE_ERROR);
+  sink.buffer[0] = 'K';
+  reader.Open(sink.buffer, sink.size - 3);
+  while (reader.Next(record));
+  Check("truncated record", reader.IsTruncated() && (reader.GetRecordsNb() == recordsNb - 1));
+  memcpy(wrapped, KnxCaptureHeader, KNX_CAPTURE_HEADER_SIZE);
+  wrappedSize = KNX_CAPTURE_HEADER_SIZE;
+  WriteRecord(wrapped, wrappedSize, KNX_CAPTURE_EVENT, 0xFFFFFF00);
+  WriteRecord(wrapped, wrappedSize, KNX_CAPTURE_EVENT, 0x00000100);
+  WriteRecord(wrapped, wrappedSize, KNX_CAPTURE_EVENT, 0x000000F0);
+  reader.Open(wrapped, wrappedSize);
+  reader.Next(record);
+  Check("1st record time", record.timeMicros == 0xFFFFFF00ULL);
+  reader.Next(record);
+  Check("32 bits time wrap around", record.timeMicros == 0x100000100ULL);
+  reader.Next(record);
+  Check("older record", record.timeMicros == 0x1000000F0ULL);
+
+  printf("\n--- Replay ---\n");
+  reader.Open(sink.buffer, sink.size);
+  reader.Next(record);
+  captureStart = record.timeMicros;
+  callsNb = ReplayDevice(reader, 1, replay, duration);
+  Check("real time : telegrams delivered", (replay->GetRxTelegramsNb() == 10) && (eventsNb == 10)
+        && (replay->GetSkippedNb() == 0) && (replay->GetCapturedTxNb() == 3));
+  matching = true;
+  for (i = 0; i < eventsNb; i++)
+  {
+    long long shift = (long long)(eventTimes[i] - eventTimes[0]) - (long long)(rxTimes[i] - rxTimes[0]);
+    if ((shift < -1000) || (shift > 1000)) matching = false;
+  }
+  Check("real time : capture pace (+/-1ms)", matching);
+  Check("real time : duration", (duration >= captureEnd - captureStart)
+        && (duration <= captureEnd - captureStart + 3 * TASK_PERIOD));
+  Check("real time : device telegrams acknowledged by the capture", (replay->GetSentNb() == 3) && (replay->GetAcksNb() == 3)
+        && (replay->GetUnmatchedAcksNb() == 0));
+  Check("real time : state indications", replay->GetEventsNb() == 2);
+  Knx.end();
+
+  callsNb = ReplayDevice(reader, 10, replay, duration);
+  Check("10 times faster", (eventsNb == 10) && (duration * 10 >= captureEnd - captureStart)
+        && (duration * 10 <= captureEnd - captureStart + 30 * TASK_PERIOD));
+  Knx.end();
+
+  callsNb = ReplayDevice(reader, KNX_REPLAY_AS_FAST_AS_POSSIBLE, replay, duration);
+  Check("as fast as possible : one record per task call", (eventsNb == 10) && (callsNb <= recordsNb * 2 + 2));
+  Knx.end();
+
+  KnxSetClock(NULL);
+  printf("\n%u error(s)\n", errorsNb);
+  return errorsNb;
+}
+
+// EOF
@@ -0,0 +1,201 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxClock_UnitTests.cpp
+// Author : Franck Marini
+// Description : Host tests of the library time source
+//               - KnxMillis()/KnxMicros() follow the Arduino time by default
+//               - virtual clock : explicit advance, time setting, back to the Arduino time
+//               - KnxDevice on a simulated bus with the virtual clock : init read request timing,
+//                 identical results of 2 runs, 10 minutes of bus time simulated in a few ms
+//               The program returns the nb of failed checks.
+// Module dependencies : KnxClock, KnxDevice, KnxBusSimulator, KnxBusSimCoupler
+//
+// Build and run from the library root folder (single command line) :
+//   g++ -O2 -I extras/host -I . extras/host/tests/KnxClock_UnitTests.cpp extras/host/KnxBusSimulator.cpp
+//       extras/host/KnxBusSimCoupler.cpp extras/host/ArduinoHost.cpp KnxDevice.cpp KnxTpUart.cpp KnxTelegram.cpp KnxClock.cpp
+//       KnxGroupStats.cpp KnxBusHealth.cpp KnxComObject.cpp KnxComObjectTable.cpp KnxDPTCodec.cpp StKnxCoupler.cpp
+//       KnxTxLatency.cpp -o KnxClock_UnitTests
+//   ./KnxClock_UnitTests
+
+#include "KnxDevice.h"
+#include "KnxBusSimulator.h"
+#include "KnxBusSimCoupler.h"
+#include <time.h>
+
+#define DEVICE_ADDR 0x1101
+
+static word errorsNb;
+
+static KnxComObject initObject(0x0901, KNX_DPT_1_001, COM_OBJ_LOGIC_IN_INIT);
+static KnxComObject sensorObject(0x0801, KNX_DPT_9_001, COM_OBJ_SENSOR);
+static KnxComObject inputObject(0x0A00, KNX_DPT_5_001, COM_OBJ_LOGIC_IN);
+static KnxComObject* comObjects[] = { &initObject, &sensorObject, &inputObject };
+
+static KnxBusSimulator *sim;
+static unsigned long writesNb, receivedNb;
+static unsigned long long nextWriteTime;
+
+void knxEvents(byte index) { receivedNb++; }
+
+
+static void Check(const char *label, boolean result)
+{
+  printf("%s : %s\n", label, result ? "OK" : "FAILED !!");
+  if (!result) errorsNb++;
+}
+
+
+// Device loop without application
+static void DeviceTask(void)
+{
+  if (Knx.checkInitBus() == KNX_DEVICE_OK) Knx.task();
+}
+
+
+// Device application loop, a sensor value is written every 300 ms
+static void DeviceLoop(void)
+{
+  if (Knx.checkInitBus() != KNX_DEVICE_OK) return;
+  Knx.task();
+  if (sim->GetTime() >= nextWriteTime)
+  {
+    Knx.write(1, (float)(writesNb++ % 50));
+    nextWriteTime += 300000;
+  }
+}
+
+
+// Results of a simulation run
+typedef struct {
+  unsigned long framesNb, deviceSentNb, receivedNb;
+  float avgLatency;
+  unsigned long long endTime;
+} type_RunResult;
+
+
+// Device plus a traffic generator targeting it and a line coupler, during "duration"
+static void RunDevice(unsigned long long duration, type_RunResult& result)
+{
+  KnxBusSimulator busSim(200, 1234);
+  KnxBusSimCoupler *coupler = new KnxBusSimCoupler(busSim, DEVICE_ADDR);
+  KnxBusTrafficGenerator inputs(busSim, 0x1202, KNX_PRIORITY_NORMAL_VALUE, 100000, 0x0A00, 1, 2);
+  KnxBusTrafficGenerator lineCoupler(busSim, 0x1000);
+
+  sim = &busSim;
+  lineCoupler.SetAcknowledge(0x0000, 0xFFFF, 2, 2);
+  busSim.Attach(*coupler);
+  busSim.Attach(inputs);
+  busSim.Attach(lineCoupler);
+  busSim.SetStepCallback(&DeviceLoop);
+  Knx.begin(coupler, comObjects, sizeof(comObjects) / sizeof(comObjects[0]));
+  writesNb = receivedNb = 0;
+  nextWriteTime = busSim.GetTime();
+  busSim.Run(duration);
+  result.framesNb = busSim.GetFramesNb();
+  result.deviceSentNb = busSim.GetParticipantStats(0).sentNb;
+  result.receivedNb = receivedNb;
+  result.avgLatency = busSim.GetLatencyStats(KNX_PRIORITY_NORMAL_VALUE).GetAverage();
+  result.endTime = busSim.GetTime();
+  Knx.end();
+}
+
+
+int main(void)
+{
+  KnxVirtualClock clock(1000);
+  KnxBusSimulator *busSim;
+  KnxBusSimCoupler *coupler;
+  KnxBusTrafficGenerator *lineCoupler;
+  type_RunResult run1, run2;
+  struct timespec start, end;
+  unsigned long delta;
+  double wallTime;
+
+  printf("--- Default clock ---\n");
+  delta = KnxMillis();
+  delta = millis() - delta;
+  Check("KnxMillis() is millis()", delta <= 1);
+  delta = KnxMicros();
+  delta = micros() - delta;
+  Check("KnxMicros() is micros()", delta <= 1000);
+
+  printf("\n--- Virtual clock ---\n");
+  KnxSetClock(&clock);
+  Check("virtual time read", (KnxMicros() == 1000) && (KnxMillis() == 1));
+  clock.Advance(2500);
+  Check("advance in usec", (KnxMicros() == 3500) && (KnxMillis() == 3));
+  clock.AdvanceMillis(1000);
+  Check("advance in ms", (KnxMicros() == 1003500) && (KnxMillis() == 1003));
+  delay(5);
+  Check("time stopped when not advanced", KnxMicros() == 1003500);
+  clock.SetTime(0xFFFFFFF6ULL);
+  clock.Advance(20);
+  Check("set time", (clock.GetTime() == 0x10000000AULL) && (KnxMicros() == (unsigned long)0x10000000AULL)
+        && (KnxMillis() == (unsigned long)(0x10000000AULL / 1000)));
+  KnxSetClock(NULL);
+  delta = KnxMillis();
+  delta = millis() - delta;
+  Check("back to the Arduino time", delta <= 1);
+
+  printf("\n--- KnxDevice init read timing ---\n");
+  // No traffic and no application write : the only device frame is the init read request,
+  // sent 500 ms after the bus init
+  busSim = new KnxBusSimulator(100);
+  coupler = new KnxBusSimCoupler(*busSim, DEVICE_ADDR);
+  lineCoupler = new KnxBusTrafficGenerator(*busSim, 0x1000);
+  lineCoupler->SetAcknowledge(0x0000, 0xFFFF, 0, 0);
+  busSim->Attach(*coupler);
+  busSim->Attach(*lineCoupler);
+  Check("simulator clock installed", KnxMicros() == (unsigned long)busSim->GetTime());
+  busSim->SetStepCallback(&DeviceTask);
+  Knx.begin(coupler, comObjects, sizeof(comObjects) / sizeof(comObjects[0]));
+  Knx.checkInitBus();
+  busSim->Run(500000);
+  Check("no init read request within 500 ms", coupler->GetRequestedFramesNb() == 0);
+  busSim->Run(2000);
+  Check("init read request in the next 2 ms", coupler->GetRequestedFramesNb() == 1);
+  busSim->Run(100000);
+  Check("init read request acknowledged", busSim->GetParticipantStats(0).sentNb == 1);
+  Knx.end();
+  delete lineCoupler;
+  delete busSim;
+  delta = KnxMillis();
+  delta = millis() - delta;
+  Check("simulator clock uninstalled", delta <= 1);
+
+  printf("\n--- Reproducibility and speed ---\n");
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  RunDevice(600000000ULL, run1);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  wallTime = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+  printf("600 s of bus time simulated in %.3f s\n", wallTime);
+  Check("device traffic", (run1.deviceSentNb >= 1999) && (run1.receivedNb > 5000));
+  Check("faster than real time", wallTime < 60);
+  RunDevice(600000000ULL, run2);
+  Check("identical runs", (run1.framesNb == run2.framesNb) && (run1.deviceSentNb == run2.deviceSentNb)
+        && (run1.receivedNb == run2.receivedNb) && (run1.avgLatency == run2.avgLatency));
+  Check("virtual time goes on from a simulation to the next one", run2.endTime == run1.endTime + 600000000ULL);
+
+  printf("\n%u error(s)\n", errorsNb);
+  return errorsNb;
+}
+
+// EOF
@@ -0,0 +1,123 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxComObjectTable_UnitTests.cpp
+// Author : Franck Marini
+// Description : Host tests of the table of the com objects attached to the bus couplers
+//               - attachment of an array of com objects and of an array of pointers
+//               - objects without communication attribute ignored, highest index kept for identical addresses
+//               - every assigned address found, the others not found, for 1 to 255 objects
+//               - attach traces
+//               The program returns the nb of failed checks.
+// Module dependencies : KnxComObjectTable, KnxComObject, KnxTraceRing
+//
+// Build and run from the library root folder (single command line) :
+//   g++ -O2 -I extras/host -I . extras/host/tests/KnxComObjectTable_UnitTests.cpp extras/host/ArduinoHost.cpp
+//       KnxComObjectTable.cpp KnxComObject.cpp KnxTelegram.cpp KnxTraceRing.cpp KnxClock.cpp
+//       -o KnxComObjectTable_UnitTests
+//   ./KnxComObjectTable_UnitTests
+
+#include "KnxComObjectTable.h"
+
+#define MAX_OBJECTS_NB 255
+
+static word errorsNb;
+
+
+static void Check(const char *label, boolean result)
+{
+  printf("%s : %s\n", label, result ? "OK" : "FAILED !!");
+  if (!result) errorsNb++;
+}
+
+
+// Every address of the list is found with the index of its object, and the addresses in between are not found
+static boolean CheckLookups(const KnxComObjectTable& table, KnxComObject** list, byte listSize)
+{
+  byte index;
+
+  for (byte i = 0; i < listSize; i++)
+  {
+    if (!table.IsAddressAssigned(list[i]->GetAddr(), index) || (index != i)) return false;
+    if (table.IsAddressAssigned(list[i]->GetAddr() + 1, index)) return false;
+  }
+  return !table.IsAddressAssigned(0x0000, index) && !table.IsAddressAssigned(0xFFFF, index);
+}
+
+
+int main(void)
+{
+  KnxComObjectTable table;
+  KnxTraceRing traces;
+  type_trace_entry entry;
+  KnxComObject objects[3] = { KnxComObject(0x0902, KNX_DPT_1_001, COM_OBJ_LOGIC_IN),
+                              KnxComObject(0x0801, KNX_DPT_1_001, COM_OBJ_SENSOR),
+                              KnxComObject(0x0A00, KNX_DPT_1_001, COM_OBJ_LOGIC_IN) };
+  KnxComObject notCom(0x0B00, KNX_DPT_1_001, KNX_COM_OBJ_R_INDICATOR);
+  KnxComObject duplicate(0x0801, KNX_DPT_1_001, COM_OBJ_LOGIC_IN);
+  KnxComObject* mixed[] = { &objects[0], &objects[1], &notCom, &duplicate };
+  static KnxComObject* list[MAX_OBJECTS_NB];
+  boolean found;
+  byte index;
+
+  printf("--- Array of com objects ---\n");
+  table.Attach(objects, 3);
+  Check("3 objects assigned", table.GetAssignedNb() == 3);
+  Check("addresses found", table.IsAddressAssigned(0x0801, index) && (index == 1)
+                           && table.IsAddressAssigned(0x0902, index) && (index == 0)
+                           && table.IsAddressAssigned(0x0A00, index) && (index == 2));
+  Check("other address not found", !table.IsAddressAssigned(0x0802, index));
+  table.Detach();
+  Check("detached", (table.GetAssignedNb() == 0) && !table.IsAddressAssigned(0x0801, index));
+
+  printf("\n--- Array of pointers ---\n");
+  table.Attach(mixed, 4);
+  Check("not com object ignored", (table.GetAssignedNb() == 2) && !table.IsAddressAssigned(0x0B00, index));
+  Check("highest index kept", table.IsAddressAssigned(0x0801, index) && (index == 3));
+  table.Attach((KnxComObject**)NULL, 0);
+  Check("empty list", table.GetAssignedNb() == 0);
+
+  printf("\n--- Lookups ---\n");
+  // objects created in a pseudo-random address order, 2 addresses apart
+  for (word i = 0; i < MAX_OBJECTS_NB; i++)
+    list[i] = new KnxComObject(0x0800 + 2 * ((i * 97) % MAX_OBJECTS_NB), KNX_DPT_1_001, COM_OBJ_LOGIC_IN);
+  found = true;
+  for (word nb = 1; nb <= MAX_OBJECTS_NB; nb++)
+  {
+    table.Attach(list, nb);
+    if ((table.GetAssignedNb() != nb) || !CheckLookups(table, list, nb)) found = false;
+  }
+  Check("1 to 255 objects", found);
+
+  printf("\n--- Traces ---\n");
+  table.Attach((KnxComObject**)NULL, 0, &traces);
+  table.Attach(&mixed[2], 1, &traces);
+  table.Attach(mixed, 4, &traces);
+  Check("empty list traced", traces.Pop(entry) && (entry.event == KNX_TRACE_COUPLER_ATTACH_EMPTY_LIST));
+  Check("no com object traced", traces.Pop(entry) && (entry.event == KNX_TRACE_COUPLER_ATTACH_NO_COM_OBJECT));
+  Check("duplicate traced", traces.Pop(entry) && (entry.event == KNX_TRACE_COUPLER_ATTACH_DUPLICATE)
+                            && (entry.args[0] == 0x0801));
+  Check("attach traced", traces.Pop(entry) && (entry.event == KNX_TRACE_COUPLER_ATTACH_OK) && (entry.args[0] == 2)
+                         && !traces.Pop(entry));
+
+  printf("\n%u failed check(s)\n", errorsNb);
+  return errorsNb;
+}
+
+// EOF
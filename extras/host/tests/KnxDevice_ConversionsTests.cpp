@@ -0,0 +1,124 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxDevice_ConversionsTests.cpp
+// Author : Franck Marini
+// Description : Host tests of the DPT <=> C types conversions of KnxDevice
+//               - the bulk conversions (ConvertFromDptArray/ConvertToDptArray) give the same results as the
+//                 scalar ones (ConvertFromDpt/ConvertToDpt), for every format supported in bulk and every C type
+//               - the signed formats (V16, V32) are sign extended
+//               The program returns the nb of failed checks.
+// Module dependencies : KnxDevice, KnxDPTCodec
+//
+// Build and run from the library root folder (single command line) :
+//   g++ -O2 -I extras/host -I . extras/host/tests/KnxDevice_ConversionsTests.cpp extras/host/ArduinoHost.cpp
+//       KnxDevice.cpp KnxTpUart.cpp KnxTelegram.cpp KnxClock.cpp KnxGroupStats.cpp KnxBusHealth.cpp KnxComObject.cpp
+//       KnxComObjectTable.cpp KnxDPTCodec.cpp StKnxCoupler.cpp KnxTxLatency.cpp -o KnxDevice_ConversionsTests
+//   ./KnxDevice_ConversionsTests
+
+#include "KnxDevice.h"
+
+#define VALUES_NB 512
+
+static word errorsNb;
+
+static const struct { byte format; byte size; const char *name; } formats[] = {
+  { KNX_DPT_FORMAT_U16, 2, "U16" }, { KNX_DPT_FORMAT_V16, 2, "V16" }, { KNX_DPT_FORMAT_U32, 4, "U32" },
+  { KNX_DPT_FORMAT_V32, 4, "V32" }, { KNX_DPT_FORMAT_F16, 2, "F16" }, { KNX_DPT_FORMAT_F32, 4, "F32" },
+  { KNX_DPT_FORMAT_B24, 3, "B24" } };
+
+static byte dpt[VALUES_NB * 4];
+
+void knxEvents(byte index) {}
+
+
+static void Check(const char *label, boolean result)
+{
+  printf("%s : %s\n", label, result ? "OK" : "FAILED !!");
+  if (!result) errorsNb++;
+}
+
+
+// Equality of 2 results, NaN being equal to NaN (F32 values built from random bytes)
+template <typename T> static boolean Same(T a, T b) { return (a == b) || ((a != a) && (b != b)); }
+
+
+// Bulk decoding and encoding of the random DPT values compared to the scalar conversions
+template <typename T> static void CheckType(const char *typeName)
+{
+  static T bulk[VALUES_NB], scalar;
+  static byte bulkDpt[VALUES_NB * 4];
+  byte scalarDpt[4];
+  char label[64];
+  word decodingErrors, encodingErrors;
+
+  for (byte f = 0; f < sizeof(formats) / sizeof(formats[0]); f++)
+  {
+    decodingErrors = 0; encodingErrors = 0;
+    ConvertFromDptArray(dpt, bulk, VALUES_NB, formats[f].format);
+    ConvertToDptArray(bulk, bulkDpt, VALUES_NB, formats[f].format);
+    for (word i = 0; i < VALUES_NB; i++)
+    {
+      ConvertFromDpt(&dpt[i * formats[f].size], scalar, formats[f].format);
+      if (!Same(bulk[i], scalar)) decodingErrors++;
+      ConvertToDpt(bulk[i], scalarDpt, formats[f].format);
+      if (memcmp(scalarDpt, &bulkDpt[i * formats[f].size], formats[f].size)) encodingErrors++;
+    }
+    snprintf(label, sizeof(label), "%s <=> %s, bulk = scalar", formats[f].name, typeName);
+    Check(label, !decodingErrors && !encodingErrors);
+  }
+}
+
+
+int main(void)
+{
+  const byte negative[4] = { 0xFF, 0xFE, 0xFF, 0xFE };
+  long longValue;
+  float floatValue;
+
+  srand(1234);
+  for (word i = 0; i < sizeof(dpt); i++) dpt[i] = (byte)rand();
+  // a few remarkable values at the beginning
+  memset(dpt, 0xFF, 4); memset(dpt + 4, 0x00, 4); dpt[8] = 0x80; dpt[9] = 0x00; dpt[10] = 0x7F; dpt[11] = 0xFF;
+
+  printf("--- Signed formats ---\n");
+  ConvertFromDpt(negative, longValue, KNX_DPT_FORMAT_V16);
+  Check("V16 0xFFFE => long", longValue == -2);
+  ConvertFromDpt(negative, floatValue, KNX_DPT_FORMAT_V16);
+  Check("V16 0xFFFE => float", floatValue == -2.0f);
+  ConvertFromDpt(negative, longValue, KNX_DPT_FORMAT_U16);
+  Check("U16 0xFFFE => long", longValue == 0xFFFE);
+  ConvertFromDpt(negative, floatValue, KNX_DPT_FORMAT_V32);
+  Check("V32 0xFFFEFFFE => float", floatValue == -65538.0f);
+
+  printf("\n--- Bulk vs scalar conversions ---\n");
+  CheckType<unsigned char>("unsigned char");
+  CheckType<char>("char");
+  CheckType<unsigned int>("unsigned int");
+  CheckType<int>("int");
+  CheckType<unsigned long>("unsigned long");
+  CheckType<long>("long");
+  CheckType<float>("float");
+  CheckType<double>("double");
+
+  printf("\n%u failed check(s)\n", errorsNb);
+  return errorsNb;
+}
+
+// EOF
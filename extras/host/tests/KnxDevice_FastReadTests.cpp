@@ -0,0 +1,210 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxDevice_FastReadTests.cpp
+// Author : Franck Marini
+// Description : Host tests of the read responses fast path of KnxDevice (TPUART emulator, virtual time)
+//               - a read is answered ahead of the writes queued in the TX action list
+//               - the response carries the com object value when it is sent (not when the read is received)
+//               - the reads of a com object received while its response is waiting are merged
+//               - no response for a com object without R attribute
+//               - beyond READ_RESPONSES_NB waiting responses, the responses are queued (none lost)
+//               The program returns the nb of failed checks.
+// Module dependencies : KnxDevice, KnxTpUart, TpUartEmulator, KnxClock
+//
+// Build and run from the library root folder (single command line) :
+//   g++ -O2 -I extras/host -I . extras/host/tests/KnxDevice_FastReadTests.cpp extras/host/TpUartEmulator.cpp
+//       extras/host/ArduinoHost.cpp KnxDevice.cpp KnxTpUart.cpp KnxTelegram.cpp KnxClock.cpp KnxGroupStats.cpp
+//       KnxBusHealth.cpp KnxComObject.cpp KnxComObjectTable.cpp KnxDPTCodec.cpp StKnxCoupler.cpp
+//       KnxTxLatency.cpp -o KnxDevice_FastReadTests
+//   ./KnxDevice_FastReadTests
+
+#include "TpUartEmulator.h"
+#include "KnxDevice.h"
+
+#define DEVICE_ADDR   0x1101
+#define TASK_PERIOD   400   // us
+#define SENSORS_NB    (READ_RESPONSES_NB + 2)
+#define FRAMES_LOG_NB 64
+
+static word errorsNb;
+static KnxVirtualClock clock_(1000);
+static TpUartEmulator *emulator;
+
+// 0 : temperature sensor, 1 : switch output (written by the application), 2 : logic input (not readable)
+// 3.. : sensors read all together, last one : setpoint (readable and written from the bus)
+static KnxComObject temperature(0x0801, KNX_DPT_9_001, COM_OBJ_SENSOR);
+static KnxComObject output(0x0901, KNX_DPT_1_001, COM_OBJ_SENSOR);
+static KnxComObject input(0x0A00, KNX_DPT_1_001, COM_OBJ_LOGIC_IN);
+static KnxComObject setpoint(0x0B00, KNX_DPT_1_001, KNX_COM_OBJ_C_INDICATOR | KNX_COM_OBJ_R_INDICATOR | KNX_COM_OBJ_W_INDICATOR);
+static KnxComObject* comObjects[3 + SENSORS_NB + 1] = { &temperature, &output, &input };
+
+// Log of the frames sent on the bus by the device
+static struct { word target; e_KnxCommand command; byte value; byte data[2]; unsigned long micros; } framesLog[FRAMES_LOG_NB];
+static word framesLogNb, framesSeenNb;
+
+void knxEvents(byte index) {}
+
+
+static void Check(const char *label, boolean result)
+{
+  printf("%s : %s\n", label, result ? "OK" : "FAILED !!");
+  if (!result) errorsNb++;
+}
+
+
+// Run the device task during the given time, logging the frames sent on the bus
+static void RunDevice(unsigned long durationMicros)
+{
+  byte frame[KNX_TELEGRAM_MAX_SIZE], length;
+  KnxTelegram telegram;
+
+  for (unsigned long t = 0; t < durationMicros; t += TASK_PERIOD)
+  {
+    clock_.Advance(TASK_PERIOD);
+    Knx.task();
+    for (; framesSeenNb < emulator->GetBusFramesNb(); framesSeenNb++)
+    {
+      length = emulator->GetBusFrame(framesSeenNb, frame);
+      for (byte i = 0; i < length; i++) telegram.WriteRawByte(frame[i], i);
+      if (framesLogNb == FRAMES_LOG_NB) continue;
+      framesLog[framesLogNb].target = telegram.GetTargetAddress();
+      framesLog[framesLogNb].command = telegram.GetCommand();
+      framesLog[framesLogNb].value = telegram.GetFirstPayloadByte();
+      telegram.GetLongPayload(framesLog[framesLogNb].data, 2);
+      framesLog[framesLogNb].micros = emulator->GetBusFrameRxMicros(framesSeenNb);
+      framesLogNb++;
+    }
+  }
+}
+
+
+static void InjectRead(word target)
+{
+  KnxTelegram telegram;
+
+  telegram.SetSourceAddress(0x1102);
+  telegram.SetTargetAddress(target);
+  telegram.SetCommand(KNX_COMMAND_VALUE_READ);
+  telegram.UpdateChecksum();
+  emulator->InjectBusTelegram(telegram);
+}
+
+
+static void InjectWrite(word target, byte value)
+{
+  KnxTelegram telegram;
+
+  telegram.SetSourceAddress(0x1102);
+  telegram.SetTargetAddress(target);
+  telegram.SetCommand(KNX_COMMAND_VALUE_WRITE);
+  telegram.SetFirstPayloadByte(value);
+  telegram.UpdateChecksum();
+  emulator->InjectBusTelegram(telegram);
+}
+
+
+// Nb of logged frames with the given target and command, and index of the first one
+static byte CountFrames(word target, e_KnxCommand command, word& firstIndex)
+{
+  byte nb = 0;
+
+  firstIndex = 0xFFFF;
+  for (word i = 0; i < framesLogNb; i++)
+  {
+    if ((framesLog[i].target != target) || (framesLog[i].command != command)) continue;
+    if (!nb) firstIndex = i;
+    nb++;
+  }
+  return nb;
+}
+
+
+// Queue writes of the output com object, and run the device till the 1st one is being sent
+static void LoadTxQueue(byte writesNb)
+{
+  for (byte i = 0; i < writesNb; i++) Knx.write(1, (boolean)(i & 1));
+  framesLogNb = 0;
+  RunDevice(15000);
+}
+
+
+int main(void)
+{
+  word index;
+  byte nb;
+
+  KnxSetClock(&clock_);
+  for (byte i = 0; i < SENSORS_NB; i++) comObjects[3 + i] = new KnxComObject(0x0810 + i, KNX_DPT_1_001, COM_OBJ_SENSOR);
+  emulator = new TpUartEmulator();
+  comObjects[3 + SENSORS_NB] = &setpoint;
+  Knx.begin(new KnxTpUart(*emulator, DEVICE_ADDR, NORMAL), comObjects, 3 + SENSORS_NB + 1);
+  while (Knx.checkInitBus() != KNX_DEVICE_OK) clock_.Advance(TASK_PERIOD);
+  RunDevice(100000);
+  Knx.write(0, 21.5f);
+  RunDevice(100000);
+
+  printf("--- Read ahead of the queued writes ---\n");
+  LoadTxQueue(12);
+  Check("TX queue loaded", (framesLogNb == 1) && Knx.isActive());
+  InjectRead(0x0801);
+  RunDevice(2000000);
+  nb = CountFrames(0x0801, KNX_COMMAND_VALUE_RESPONSE, index);
+  if (index != 0xFFFF) printf("response sent after %u frame(s)\n", index);
+  Check("one response", nb == 1);
+  Check("response ahead of the queued writes", (index != 0xFFFF) && (index <= 2) && (framesLogNb == 13));
+  Check("response value", (index != 0xFFFF) && (KnxDptDecodeF16(framesLog[index].data) == 21.5));
+
+  printf("\n--- Merged reads ---\n");
+  LoadTxQueue(12);
+  InjectRead(0x0801);
+  InjectRead(0x0801);
+  InjectRead(0x0801);
+  RunDevice(2000000);
+  nb = CountFrames(0x0801, KNX_COMMAND_VALUE_RESPONSE, index);
+  Check("reads merged into one response", (nb == 1) && (Knx.getMergedReadsNb() == 2));
+
+  printf("\n--- Value written while the response is waiting ---\n");
+  LoadTxQueue(4);
+  InjectRead(0x0B00);
+  InjectWrite(0x0B00, 1);
+  RunDevice(1000000);
+  nb = CountFrames(0x0B00, KNX_COMMAND_VALUE_RESPONSE, index);
+  Check("response with the written value", (nb == 1) && setpoint.GetValue() && (framesLog[index].value == 1));
+
+  printf("\n--- Not readable com object ---\n");
+  framesLogNb = 0;
+  InjectRead(0x0A00);
+  RunDevice(200000);
+  Check("no response", framesLogNb == 0);
+
+  printf("\n--- Waiting responses beyond the fast path ---\n");
+  LoadTxQueue(4);
+  for (byte i = 0; i < SENSORS_NB; i++) InjectRead(0x0810 + i);
+  RunDevice(3000000);
+  nb = 0;
+  for (byte i = 0; i < SENSORS_NB; i++) if (CountFrames(0x0810 + i, KNX_COMMAND_VALUE_RESPONSE, index) == 1) nb++;
+  Check("every read answered", nb == SENSORS_NB);
+  Check("device idle", !Knx.isActive());
+
+  printf("\n%u failed check(s)\n", errorsNb);
+  return errorsNb;
+}
+
+// EOF
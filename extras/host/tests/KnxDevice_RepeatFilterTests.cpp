@@ -0,0 +1,171 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxDevice_RepeatFilterTests.cpp
+// Author : Franck Marini
+// Description : Host tests of the repeated telegrams filter of KnxDevice (TPUART emulator, virtual time)
+//               - the repetitions of a processed telegram are acknowledged but not dispatched, and counted
+//               - a repetition with another payload or source, or received after the window, is dispatched
+//               - a repetition whose original was missed is dispatched once
+//               - a telegram sent again without repeat flag (e.g. a 2nd button press) is dispatched
+//               - the telegram callback (setTelegramCallback) gets the dispatched telegrams only
+//               The program returns the nb of failed checks.
+// Module dependencies : KnxDevice, KnxTpUart, TpUartEmulator, KnxClock
+//
+// Build and run from the library root folder (single command line) :
+//   g++ -O2 -I extras/host -I . extras/host/tests/KnxDevice_RepeatFilterTests.cpp extras/host/TpUartEmulator.cpp
+//       extras/host/ArduinoHost.cpp KnxDevice.cpp KnxTpUart.cpp KnxTelegram.cpp KnxClock.cpp KnxGroupStats.cpp
+//       KnxBusHealth.cpp KnxComObject.cpp KnxComObjectTable.cpp KnxDPTCodec.cpp StKnxCoupler.cpp
+//       KnxTxLatency.cpp -o KnxDevice_RepeatFilterTests
+//   ./KnxDevice_RepeatFilterTests
+
+#include "TpUartEmulator.h"
+#include "KnxDevice.h"
+
+#define DEVICE_ADDR   0x1101
+#define TASK_PERIOD   400   // us
+
+static word errorsNb;
+static KnxVirtualClock clock_(1000);
+static TpUartEmulator *emulator;
+
+static KnxComObject toggle(0x0801, KNX_DPT_1_001, COM_OBJ_LOGIC_IN);
+static KnxComObject dimming(0x0802, KNX_DPT_5_001, COM_OBJ_LOGIC_IN);
+static KnxComObject* comObjects[] = { &toggle, &dimming };
+
+static word eventsNb[2];
+static word telegramsNb;
+static word lastSource;
+
+void knxEvents(byte index) { eventsNb[index]++; }
+
+static void TelegramReceived(const KnxTelegram& telegram) { telegramsNb++; lastSource = telegram.GetSourceAddress(); }
+
+
+static void Check(const char *label, boolean result)
+{
+  printf("%s : %s\n", label, result ? "OK" : "FAILED !!");
+  if (!result) errorsNb++;
+}
+
+
+static void RunDevice(unsigned long durationMicros)
+{
+  for (unsigned long t = 0; t < durationMicros; t += TASK_PERIOD) { clock_.Advance(TASK_PERIOD); Knx.task(); }
+}
+
+
+// Inject a write telegram (original or repetition) and let the device process it
+static void InjectWrite(word source, word target, byte value, boolean repeated)
+{
+  KnxTelegram telegram;
+
+  telegram.SetSourceAddress(source);
+  telegram.SetTargetAddress(target);
+  telegram.SetCommand(KNX_COMMAND_VALUE_WRITE);
+  if (target == 0x0801) telegram.SetFirstPayloadByte(value);
+  else { telegram.SetPayloadLength(2); telegram.SetLongPayload(&value, 1); }
+  if (repeated) telegram.SetRepeated();
+  telegram.UpdateChecksum();
+  emulator->InjectBusTelegram(telegram);
+  RunDevice(40000);
+}
+
+
+// Nb of injected frames acknowledged by the driver (addressed ACK)
+static byte AckedFramesNb(void)
+{
+  byte nb = 0;
+
+  for (byte i = 0; i < emulator->GetAckRecordsNb(); i++)
+    if (emulator->GetAckRecord(i).ackService == TPUART_RX_ACK_SERVICE_ADDRESSED) nb++;
+  return nb;
+}
+
+
+int main(void)
+{
+  byte value[1];
+
+  KnxSetClock(&clock_);
+  emulator = new TpUartEmulator();
+  Knx.begin(new KnxTpUart(*emulator, DEVICE_ADDR, NORMAL), comObjects, 2);
+  Knx.setTelegramCallback(&TelegramReceived);
+  while (Knx.checkInitBus() != KNX_DEVICE_OK) clock_.Advance(TASK_PERIOD);
+  RunDevice(100000);
+
+  printf("--- Repetitions of a processed telegram ---\n");
+  emulator->ClearAckRecords();
+  InjectWrite(0x1102, 0x0801, 1, false);
+  InjectWrite(0x1102, 0x0801, 1, true);
+  InjectWrite(0x1102, 0x0801, 1, true);
+  InjectWrite(0x1102, 0x0801, 1, true);
+  Check("dispatched once", (eventsNb[0] == 1) && toggle.GetValue());
+  Check("repetitions counted", Knx.getSuppressedRepeatsNb() == 3);
+  Check("repetitions acknowledged", AckedFramesNb() == 4);
+  Check("telegram callback called once", (telegramsNb == 1) && (lastSource == 0x1102));
+
+  printf("\n--- Repetitions of other telegrams ---\n");
+  InjectWrite(0x1102, 0x0801, 0, true);
+  Check("other payload dispatched", (eventsNb[0] == 2) && !toggle.GetValue());
+  InjectWrite(0x1103, 0x0801, 0, true);
+  Check("other source dispatched", eventsNb[0] == 3);
+  InjectWrite(0x1102, 0x0802, 0, true);
+  Check("other target dispatched", eventsNb[1] == 1);
+  InjectWrite(0x1102, 0x0802, 0x80, true);
+  dimming.GetValue(value);
+  Check("other long payload dispatched", (eventsNb[1] == 2) && (value[0] == 0x80));
+  Check("nothing suppressed", Knx.getSuppressedRepeatsNb() == 3);
+  Check("telegram callback called for each one", telegramsNb == 5);
+
+  printf("\n--- Window ---\n");
+  InjectWrite(0x1104, 0x0801, 1, false);
+  RunDevice(REPEAT_FILTER_WINDOW_MICROS);
+  InjectWrite(0x1104, 0x0801, 1, true);
+  Check("late repetition dispatched", (eventsNb[0] == 5) && (Knx.getSuppressedRepeatsNb() == 3));
+
+  printf("\n--- Missed original ---\n");
+  InjectWrite(0x1105, 0x0801, 0, true);
+  InjectWrite(0x1105, 0x0801, 0, true);
+  Check("1st repetition dispatched", (eventsNb[0] == 6) && (Knx.getSuppressedRepeatsNb() == 4));
+
+  printf("\n--- Telegram sent again ---\n");
+  InjectWrite(0x1106, 0x0801, 1, false);
+  InjectWrite(0x1106, 0x0801, 1, false);
+  Check("not repeated telegrams dispatched", (eventsNb[0] == 8) && (Knx.getSuppressedRepeatsNb() == 4));
+
+  printf("\n--- Filter records overwritten ---\n");
+  InjectWrite(0x1107, 0x0801, 1, false);
+  for (byte i = 0; i < REPEAT_FILTER_NB; i++) InjectWrite(0x1200 + i, 0x0802, i, false);
+  InjectWrite(0x1107, 0x0801, 1, true);
+  Check("forgotten telegram dispatched", (eventsNb[0] == 10) && (Knx.getSuppressedRepeatsNb() == 4));
+  InjectWrite(0x1200 + REPEAT_FILTER_NB - 1, 0x0802, REPEAT_FILTER_NB - 1, true);
+  Check("newest record kept", Knx.getSuppressedRepeatsNb() == 5);
+
+  printf("\n--- Telegram callback removed ---\n");
+  Knx.setTelegramCallback(NULL);
+  telegramsNb = 0;
+  InjectWrite(0x1108, 0x0801, 0, false);
+  Check("telegram dispatched without callback", (eventsNb[0] == 11) && (telegramsNb == 0));
+
+  printf("\n%u failed check(s)\n", errorsNb);
+  return errorsNb;
+}
+
+// EOF
@@ -0,0 +1,131 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxDevice_RxQueueTests.cpp
+// Author : Franck Marini
+// Description : Host tests of the received telegrams queue of the bus couplers (TPUART emulator, virtual time)
+//               - addressed telegrams received back to back between 2 device tasks are all processed by the
+//                 next task, in the reception order
+//               - when more telegrams than the queue size are received, the oldest ones are lost and counted
+//               The program returns the nb of failed checks.
+// Module dependencies : KnxDevice, KnxTpUart, TpUartEmulator, KnxClock
+//
+// Build and run from the library root folder (single command line) :
+//   g++ -O2 -I extras/host -I . extras/host/tests/KnxDevice_RxQueueTests.cpp extras/host/TpUartEmulator.cpp
+//       extras/host/ArduinoHost.cpp KnxDevice.cpp KnxTpUart.cpp KnxTelegram.cpp KnxClock.cpp KnxGroupStats.cpp
+//       KnxBusHealth.cpp KnxComObject.cpp KnxComObjectTable.cpp KnxDPTCodec.cpp StKnxCoupler.cpp
+//       KnxTxLatency.cpp -o KnxDevice_RxQueueTests
+//   ./KnxDevice_RxQueueTests
+
+#include "TpUartEmulator.h"
+#include "KnxDevice.h"
+
+#define DEVICE_ADDR   0x1101
+#define TASK_PERIOD   400   // us
+#define FRAMES_NB     (BUSCOUPLER_RX_QUEUE_SIZE + 3)
+
+static word errorsNb;
+static KnxVirtualClock clock_(1000);
+static TpUartEmulator *emulator;
+static KnxTpUart *tpuart;
+
+static KnxComObject level(0x0801, KNX_DPT_5_010, COM_OBJ_LOGIC_IN);
+static KnxComObject* comObjects[] = { &level };
+
+static byte eventsNb;
+static byte values[FRAMES_NB];
+
+void knxEvents(byte index) { level.GetValue(&values[eventsNb++ % FRAMES_NB]); }
+
+
+static void Check(const char *label, boolean result)
+{
+  printf("%s : %s\n", label, result ? "OK" : "FAILED !!");
+  if (!result) errorsNb++;
+}
+
+
+static void RunDevice(unsigned long durationMicros)
+{
+  for (unsigned long t = 0; t < durationMicros; t += TASK_PERIOD) { clock_.Advance(TASK_PERIOD); Knx.task(); }
+}
+
+
+// Inject back to back writes of the values first..first+nb-1 (from different sources, so no repetition),
+// run only the TPUART RX task till they are all received, then a single device task
+static void InjectBurst(byte first, byte nb)
+{
+  KnxTelegram telegram;
+  byte value[1];
+
+  eventsNb = 0;
+  for (byte i = 0; i < nb; i++)
+  {
+    telegram.SetSourceAddress(0x1200 + first + i);
+    telegram.SetTargetAddress(0x0801);
+    telegram.SetCommand(KNX_COMMAND_VALUE_WRITE);
+    telegram.SetPayloadLength(2);
+    value[0] = first + i;
+    telegram.SetLongPayload(value, 1);
+    telegram.UpdateChecksum();
+    emulator->InjectBusTelegram(telegram);
+  }
+  for (unsigned long t = 0; t < nb * 30000UL; t += TASK_PERIOD) { clock_.Advance(TASK_PERIOD); tpuart->RXTask(); }
+  clock_.Advance(TASK_PERIOD);
+  Knx.task();
+}
+
+
+int main(void)
+{
+  boolean ordered;
+
+  KnxSetClock(&clock_);
+  emulator = new TpUartEmulator();
+  tpuart = new KnxTpUart(*emulator, DEVICE_ADDR, NORMAL);
+  Knx.begin(tpuart, comObjects, 1);
+  while (Knx.checkInitBus() != KNX_DEVICE_OK) clock_.Advance(TASK_PERIOD);
+  RunDevice(100000);
+
+  printf("--- Burst within the queue size ---\n");
+  emulator->ClearAckRecords();
+  InjectBurst(10, BUSCOUPLER_RX_QUEUE_SIZE);
+  Check("all frames acknowledged in time", (emulator->GetAckRecordsNb() == BUSCOUPLER_RX_QUEUE_SIZE)
+                                           && !emulator->GetLateAcksNb() && !emulator->GetMissedAcksNb());
+  Check("all telegrams processed by 1 task", eventsNb == BUSCOUPLER_RX_QUEUE_SIZE);
+  ordered = true;
+  for (byte i = 0; i < BUSCOUPLER_RX_QUEUE_SIZE; i++) if (values[i] != 10 + i) ordered = false;
+  Check("reception order kept", ordered);
+  Check("no overflow", tpuart->GetRxOverflowsNb() == 0);
+  RunDevice(100000);
+
+  printf("\n--- Burst over the queue size ---\n");
+  InjectBurst(50, FRAMES_NB);
+  Check("queue size telegrams processed", eventsNb == BUSCOUPLER_RX_QUEUE_SIZE);
+  ordered = true;
+  for (byte i = 0; i < BUSCOUPLER_RX_QUEUE_SIZE; i++) if (values[i] != 50 + FRAMES_NB - BUSCOUPLER_RX_QUEUE_SIZE + i)
+    ordered = false;
+  Check("newest telegrams kept", ordered);
+  Check("overflows counted", tpuart->GetRxOverflowsNb() == FRAMES_NB - BUSCOUPLER_RX_QUEUE_SIZE);
+
+  printf("\n%u failed check(s)\n", errorsNb);
+  return errorsNb;
+}
+
+// EOF
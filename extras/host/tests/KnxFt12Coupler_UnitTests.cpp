@@ -0,0 +1,353 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxFt12Coupler_UnitTests.cpp
+// Author : Franck Marini
+// Description : Host tests of the cEMI/FT1.2 bus coupler against an interface module emulator.
+//               The emulator plays the module on the master side of a pseudo-terminal pair, the coupler runs
+//               over KnxPosixSerialTransport on the slave side.
+//               - reset sequence (FT1.2 reset, link layer mode setting)
+//               - telegram sending : 1 frame per telegram, L_Data.con based acknowledge, NACK on confirmation error
+//               - frame repetition on missing acknowledge, timeout without any answer
+//               - reception : addressed/not addressed telegrams, repeated frames, checksum errors, RX queue overflow
+//               - module reset indication
+//               - debug traces of the reset sequence and of the frame repetitions
+//               The program returns the nb of failed checks.
+// Module dependencies : KnxFt12Coupler, KnxPosixSerialTransport, KnxTraceRing
+//
+// Build and run from the library root folder (single command line) :
+//   g++ -O2 -DKNXTPUART_DEBUG_INFO -DKNXTPUART_DEBUG_ERROR -I extras/host -I .
+//       extras/host/tests/KnxFt12Coupler_UnitTests.cpp extras/host/ArduinoHost.cpp KnxFt12Coupler.cpp
+//       KnxPosixSerialTransport.cpp KnxCemi.cpp KnxTelegram.cpp KnxClock.cpp KnxComObject.cpp KnxComObjectTable.cpp
+//       KnxTraceRing.cpp -lutil -o KnxFt12Coupler_UnitTests
+//   ./KnxFt12Coupler_UnitTests
+
+#include "KnxPosixSerialTransport.h"
+#include "KnxFt12Coupler.h"
+#include <pty.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+
+#define PHYSICAL_ADDR 0x1101
+
+static word errorsNb;
+
+static KnxComObject switchObject(0x0801, KNX_DPT_1_001, COM_OBJ_LOGIC_IN);
+static KnxComObject* comObjects[] = { &switchObject };
+static word receivedNb, resetEventsNb, acks[4];
+
+static void EventCallback(e_KnxBusCouplerEvent event)
+{
+  if (event == BUSCOUPLER_EVENT_RECEIVED_EIB_TELEGRAM) receivedNb++;
+  if (event == BUSCOUPLER_EVENT_RESET) resetEventsNb++;
+}
+
+static void AckCallback(e_BusCouplerTxAck value) { acks[value]++; }
+
+
+static void Check(const char *label, boolean result)
+{
+  printf("%s : %s\n", label, result ? "OK" : "FAILED !!");
+  if (!result) errorsNb++;
+}
+
+
+// Transport wrapper counting the driver write calls
+class CountingTransport : public KnxSerialTransport {
+    KnxSerialTransport& _transport;
+  public:
+    word writesNb;
+    CountingTransport(KnxSerialTransport& transport) : _transport(transport), writesNb(0) {}
+    byte Begin(void) { return _transport.Begin(); }
+    void End(void) { _transport.End(); }
+    int Available(void) { return _transport.Available(); }
+    int Read(void) { return _transport.Read(); }
+    word ReadBytes(byte buffer[], word length) { return _transport.ReadBytes(buffer, length); }
+    word Write(byte data) { writesNb++; return _transport.Write(data); }
+    word Write(const byte buffer[], word length) { writesNb++; return _transport.Write(buffer, length); }
+    int AvailableForWrite(void) { return _transport.AvailableForWrite(); }
+};
+
+
+// Interface module emulator (master side of the pseudo-terminal)
+class ModuleEmulator {
+    int _fd;
+    byte _frame[FT12_FRAME_MAX_SIZE];
+    byte _index, _size;
+    byte _lastCtrl;     // control field of the last frame received from the host
+    boolean _txFcb;     // frame count bit of the next frame sent to the host
+
+  public:
+    word resetsNb, framesNb, repeatedFramesNb, hostAcksNb, commMode;
+    word framesToLose;       // nb of next host frames lost (neither processed nor acknowledged)
+    boolean confirmError;    // L_Data.con sent with the error bit
+    boolean mute;            // no answer at all
+    byte lastCtrl;           // control field of the last frame received from the host
+    KnxTelegram lastTelegram;
+
+    ModuleEmulator(int fd) : _fd(fd), _index(0), _size(0), _lastCtrl(0), _txFcb(true), resetsNb(0), framesNb(0),
+      repeatedFramesNb(0), hostAcksNb(0), commMode(0xFF), framesToLose(0), confirmError(false), mute(false), lastCtrl(0) {}
+
+    void Write(const byte data[], word length) { if (write(_fd, data, length) != length) errorsNb++; }
+
+    // Build a module -> host frame around a cEMI frame, return the frame size
+    byte BuildFrame(const byte cemi[], byte length, byte frame[], boolean newFrame = true)
+    {
+      byte checksum = 0;
+      frame[0] = FT12_START_VARIABLE; frame[1] = frame[2] = length + 1; frame[3] = FT12_START_VARIABLE;
+      if (newFrame) _txFcb = !_txFcb;
+      frame[4] = FT12_CTRL_DIR_MASK | FT12_CTRL_SEND_UDATA | (_txFcb ? FT12_CTRL_FCB_MASK : 0);
+      memcpy(frame + 5, cemi, length);
+      for (byte i = 4; i < 5 + length; i++) checksum += frame[i];
+      frame[5 + length] = checksum; frame[6 + length] = FT12_END;
+      return length + 7;
+    }
+
+    void SendCemi(const byte cemi[], byte length)
+    { byte frame[FT12_FRAME_MAX_SIZE]; Write(frame, BuildFrame(cemi, length, frame)); }
+
+    void SendTelegram(const KnxTelegram& telegram)
+    { byte cemi[KNX_CEMI_MAX_SIZE]; SendCemi(cemi, KnxTelegramToCemi(telegram, KNX_CEMI_L_DATA_IND, cemi)); }
+
+    void Service(void)
+    {
+      byte data;
+      while (read(_fd, &data, 1) == 1)
+      {
+        if (mute) continue;
+        if (!_index)
+        {
+          if (data == FT12_ACK) hostAcksNb++;
+          else if ((data == FT12_START_VARIABLE) || (data == FT12_START_FIXED))
+          { _frame[0] = data; _index = 1; _size = (data == FT12_START_FIXED) ? FT12_FIXED_FRAME_SIZE : FT12_HEADER_SIZE; }
+          continue;
+        }
+        _frame[_index++] = data;
+        if ((_frame[0] == FT12_START_VARIABLE) && (_index == 4)) _size = _frame[1] + 6;
+        if (_index == _size) { _index = 0; ProcessFrame(); }
+      }
+    }
+
+    void ProcessFrame(void)
+    {
+      byte checksum = 0, answer[KNX_CEMI_MAX_SIZE + 2], length;
+      if (_frame[0] == FT12_START_FIXED)
+      { // reset request
+        if (_frame[1] == FT12_CTRL_RESET_REQ) { resetsNb++; _lastCtrl = 0; SendAck(); }
+        return;
+      }
+      length = _frame[1];
+      for (byte i = 0; i < length; i++) checksum += _frame[4 + i];
+      if ((checksum != _frame[4 + length]) || (_frame[5 + length] != FT12_END)) return;
+      if (framesToLose) { framesToLose--; return; }
+      SendAck();
+      lastCtrl = _frame[4];
+      if (_frame[4] == _lastCtrl) { repeatedFramesNb++; return; }
+      _lastCtrl = _frame[4];
+      framesNb++;
+      const byte *cemi = _frame + 5;
+      switch (cemi[0])
+      {
+        case KNX_CEMI_M_PROPWRITE_REQ :
+          if ((cemi[4] == KNX_CEMI_PID_COMM_MODE) && (length - 1 >= 8)) commMode = cemi[7];
+          memcpy(answer, cemi, 7); answer[0] = KNX_CEMI_M_PROPWRITE_CON;
+          SendCemi(answer, 7);
+          break;
+        case KNX_CEMI_L_DATA_REQ :
+          KnxCemiToTelegram(cemi, length - 1, lastTelegram);
+          memcpy(answer, cemi, length - 1); answer[0] = KNX_CEMI_L_DATA_CON;
+          if (confirmError) answer[2] |= KNX_CEMI_CTRL1_CONFIRM_ERROR_MASK;
+          SendCemi(answer, length - 1);
+          break;
+        default : break;
+      }
+    }
+
+    void SendAck(void) { byte ack = FT12_ACK; Write(&ack, 1); }
+};
+
+
+static void BuildTelegram(KnxTelegram& telegram, word target, byte value)
+{
+  telegram.ClearTelegram();
+  telegram.SetSourceAddress(0x1102);
+  telegram.SetTargetAddress(target);
+  telegram.SetCommand(KNX_COMMAND_VALUE_WRITE);
+  telegram.SetFirstPayloadByte(value);
+  telegram.UpdateChecksum();
+}
+
+
+static boolean SameTelegram(const KnxTelegram& t1, const KnxTelegram& t2)
+{
+  if (t1.GetTelegramLength() != t2.GetTelegramLength()) return false;
+  for (byte i = 0; i < t1.GetTelegramLength(); i++) if (t1.ReadRawByte(i) != t2.ReadRawByte(i)) return false;
+  return true;
+}
+
+
+// Run the coupler tasks and the emulator during "ms" milliseconds, or until the TX is done if "untilTxDone"
+static void Run(KnxFt12Coupler& coupler, ModuleEmulator& module, unsigned long ms, boolean untilTxDone = false)
+{
+  unsigned long startTime = millis();
+  while (millis() - startTime < ms)
+  {
+    coupler.RXTask(); coupler.TXTask(); module.Service();
+    if (untilTxDone && !coupler.IsActive()) break;
+    usleep(100);
+  }
+}
+
+
+int main(void)
+{
+  struct termios tty;
+  char slaveName[64];
+  int masterFd, slaveFd;
+  KnxTelegram telegram, sent;
+  type_buscoupler_rx_telegram rxTelegram;
+  KnxTraceRing traces;
+  type_trace_entry entry;
+  byte frame[FT12_FRAME_MAX_SIZE], length, ctrl, result = KNX_BUSCOUPLER_ERROR;
+  unsigned long startTime;
+  word writesNb;
+
+  if (openpty(&masterFd, &slaveFd, slaveName, NULL, NULL) < 0) { printf("openpty failed\n"); return 1; }
+  tcgetattr(masterFd, &tty); cfmakeraw(&tty); tcsetattr(masterFd, TCSANOW, &tty);
+  fcntl(masterFd, F_SETFL, fcntl(masterFd, F_GETFL) | O_NONBLOCK);
+
+  KnxPosixSerialTransport posixTransport(slaveName, 115200, true); // no parity fallback, pseudo-terminal
+  CountingTransport transport(posixTransport);
+  KnxFt12Coupler coupler(transport, PHYSICAL_ADDR);
+  ModuleEmulator module(masterFd);
+
+  printf("\n--- Reset sequence ---\n");
+  coupler.SetTraceRing(&traces);
+  startTime = millis();
+  while ((millis() - startTime < 1000) && ((result = coupler.Reset()) != KNX_BUSCOUPLER_OK)) { module.Service(); usleep(100); }
+  Check("reset completed", result == KNX_BUSCOUPLER_OK);
+  Check("FT1.2 reset request received", module.resetsNb == 1);
+  Check("link layer mode set", module.commMode == KNX_CEMI_COMM_MODE_LINK_LAYER);
+  usleep(1000); module.Service();
+  Check("PropWrite.con acknowledged", module.hostAcksNb == 1);
+  coupler.AttachComObjectsList(comObjects, 1);
+  coupler.SetEvtCallback(&EventCallback);
+  coupler.SetAckCallback(&AckCallback);
+  Check("init", coupler.Init() == KNX_BUSCOUPLER_OK);
+  Check("reset, attach and init traced", traces.Pop(entry) && (entry.event == KNX_TRACE_COUPLER_RESET_OK)
+        && traces.Pop(entry) && (entry.event == KNX_TRACE_COUPLER_ATTACH_OK)
+        && traces.Pop(entry) && (entry.event == KNX_TRACE_COUPLER_INIT_NORMAL) && !traces.Pop(entry));
+
+  printf("\n--- Telegram sending ---\n");
+  BuildTelegram(sent, 0x0901, 1);
+  writesNb = transport.writesNb;
+  startTime = micros();
+  Check("send accepted", coupler.SendTelegram(sent) == KNX_BUSCOUPLER_OK);
+  Run(coupler, module, 500, true);
+  printf("  # telegram acknowledged in %lu us, %u driver write calls (frame + L_Data.con acknowledge)\n",
+         micros() - startTime, transport.writesNb - writesNb);
+  Check("ACK_RESPONSE from L_Data.con", acks[ACK_RESPONSE] == 1);
+  Check("telegram received by the module", SameTelegram(module.lastTelegram, sent) && (module.lastTelegram.GetSourceAddress() == PHYSICAL_ADDR));
+  Check("frame written in a single call", transport.writesNb - writesNb == 2);
+  Check("L_Data.con acknowledged", module.hostAcksNb == 2);
+
+  module.confirmError = true;
+  coupler.SendTelegram(sent);
+  Run(coupler, module, 500, true);
+  Check("NACK_RESPONSE on confirmation error", acks[NACK_RESPONSE] == 1);
+  module.confirmError = false;
+
+  printf("\n--- Missing acknowledge ---\n");
+  module.framesToLose = 1;
+  startTime = millis();
+  coupler.SendTelegram(sent);
+  Run(coupler, module, 1000, true);
+  printf("  # telegram acknowledged after %lu ms\n", millis() - startTime);
+  Check("frame repeated once", (coupler.GetRepeatedFramesNb() == 1) && (acks[ACK_RESPONSE] == 2));
+  Check("repetition traced", traces.Pop(entry) && (entry.event == KNX_TRACE_COUPLER_REPEATED_FRAME) && (entry.args[0] == 1)
+        && !traces.Pop(entry));
+  ctrl = module.lastCtrl;
+  coupler.SendTelegram(sent);
+  Run(coupler, module, 500, true);
+  Check("frame count bit toggled for the next frame", (acks[ACK_RESPONSE] == 3) && ((module.lastCtrl ^ ctrl) == FT12_CTRL_FCB_MASK));
+
+  module.mute = true;
+  startTime = millis();
+  coupler.SendTelegram(sent);
+  Run(coupler, module, 1000, true);
+  printf("  # no answer timeout after %lu ms\n", millis() - startTime);
+  Check("NO_ANSWER_TIMEOUT after the repetitions", (acks[NO_ANSWER_TIMEOUT] == 1) && (coupler.GetRepeatedFramesNb() == 1 + FT12_REPEATS_NB));
+  module.mute = false;
+  Run(coupler, module, 10);
+
+  printf("\n--- Reception ---\n");
+  BuildTelegram(telegram, 0x0801, 1);
+  module.SendTelegram(telegram);
+  Run(coupler, module, 20);
+  Check("addressed telegram received", (receivedNb == 1) && coupler.PopReceivedTelegram(rxTelegram)
+        && SameTelegram(rxTelegram.telegram, telegram) && (rxTelegram.comObjectIndex == 0));
+  Check("L_Data.ind acknowledged", module.hostAcksNb == 2 + 1 + 1 + 1 + 1);
+
+  BuildTelegram(telegram, 0x0902, 1);
+  module.SendTelegram(telegram);
+  Run(coupler, module, 20);
+  Check("not addressed telegram ignored", (receivedNb == 1) && (module.hostAcksNb == 7));
+
+  BuildTelegram(telegram, 0x0801, 0);
+  length = KnxTelegramToCemi(telegram, KNX_CEMI_L_DATA_IND, frame + 40);
+  length = module.BuildFrame(frame + 40, length, frame);
+  module.Write(frame, length);
+  module.Write(frame, length); // repetition, same frame count bit
+  Run(coupler, module, 20);
+  Check("repeated frame acknowledged but ignored", (receivedNb == 2) && (module.hostAcksNb == 9));
+  length = module.BuildFrame(frame + 40, KnxTelegramToCemi(telegram, KNX_CEMI_L_DATA_IND, frame + 40), frame);
+  frame[length - 2]++; // checksum error
+  module.Write(frame, length);
+  Run(coupler, module, 20);
+  Check("frame with checksum error not acknowledged", (receivedNb == 2) && (module.hostAcksNb == 9));
+  // the module repeats the frame, with the same frame count bit
+  length = module.BuildFrame(frame + 40, KnxTelegramToCemi(telegram, KNX_CEMI_L_DATA_IND, frame + 40), frame, false);
+  module.Write(frame, length);
+  Run(coupler, module, 20);
+  Check("frame repeated after checksum error received", (receivedNb == 3) && (module.hostAcksNb == 10));
+  while (coupler.PopReceivedTelegram(rxTelegram));
+
+  for (byte i = 0; i < 20; i++) module.SendTelegram(telegram);
+  usleep(5000);
+  coupler.RXTask();
+  Check("burst handled by one RX task", receivedNb == 23);
+  Check("RX overflows counted", coupler.GetRxOverflowsNb() == 20 - BUSCOUPLER_RX_QUEUE_SIZE);
+  while (coupler.PopReceivedTelegram(rxTelegram));
+
+  printf("\n--- Module reset ---\n");
+  frame[0] = KNX_CEMI_M_RESET_IND; frame[1] = 0;
+  module.SendCemi(frame, 2);
+  Run(coupler, module, 20);
+  Check("reset event notified", resetEventsNb == 1);
+  startTime = millis();
+  while ((millis() - startTime < 1000) && ((result = coupler.Reset()) != KNX_BUSCOUPLER_OK)) { module.Service(); usleep(100); }
+  Check("reset sequence after module reset", (result == KNX_BUSCOUPLER_OK) && (module.resetsNb == 2));
+
+  close(slaveFd); close(masterFd);
+  printf("\n%u error(s)\n", errorsNb);
+  return errorsNb;
+}
+
+// EOF
@@ -0,0 +1,161 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxGroupStats_UnitTests.cpp
+// Author : Franck Marini
+// Description : Host tests of the traffic statistics per target address
+//               - counters, last source and command, first/last seen times, min/avg intervals
+//               - group and individual addresses recorded apart
+//               - table full : the telegrams of the addresses not fitting are counted as untracked
+//               - TPUART RX task recording the addressed and not addressed telegrams (TPUART emulator, virtual time)
+//               The program returns the nb of failed checks.
+// Module dependencies : KnxGroupStats, KnxTpUart, TpUartEmulator, KnxClock
+//
+// Build and run from the library root folder (single command line) :
+//   g++ -O2 -I extras/host -I . extras/host/tests/KnxGroupStats_UnitTests.cpp extras/host/TpUartEmulator.cpp
+//       extras/host/ArduinoHost.cpp KnxTpUart.cpp KnxTelegram.cpp KnxClock.cpp KnxGroupStats.cpp KnxBusHealth.cpp KnxComObject.cpp
+//       KnxComObjectTable.cpp -o KnxGroupStats_UnitTests
+//   ./KnxGroupStats_UnitTests
+
+#include "TpUartEmulator.h"
+#include "KnxTpUart.h"
+
+#define PHYSICAL_ADDR   0x1101
+#define RX_TASK_PERIOD  400 // us
+
+static word errorsNb;
+static KnxVirtualClock clock_(1000000);
+
+static KnxComObject switchObject(0x0801, KNX_DPT_1_001, COM_OBJ_LOGIC_IN);
+static KnxComObject* comObjects[] = { &switchObject };
+
+static void EventCallback(e_KnxBusCouplerEvent) {}
+static void AckCallback(e_BusCouplerTxAck) {}
+
+
+static void Check(const char *label, boolean result)
+{
+  printf("%s : %s\n", label, result ? "OK" : "FAILED !!");
+  if (!result) errorsNb++;
+}
+
+
+static void BuildTelegram(KnxTelegram& telegram, word source, word target, e_KnxCommand command)
+{
+  telegram.SetSourceAddress(source);
+  telegram.SetTargetAddress(target);
+  telegram.SetMulticast(true);
+  telegram.SetCommand(command);
+  telegram.SetPayloadLength(1);
+  telegram.UpdateChecksum();
+}
+
+
+// Find the entry of a target address, return false if not found
+static boolean FindEntry(const KnxGroupStats& stats, word address, boolean isGroup, type_group_stats_entry& entry)
+{
+  byte position = 0;
+  while (stats.GetNextEntry(position, entry))
+    if ((entry.targetAddress == address) && (((entry.flags & KNX_GROUP_STATS_GROUP_ADDRESS) != 0) == isGroup)) return true;
+  return false;
+}
+
+
+int main(void)
+{
+  KnxGroupStats stats;
+  KnxTelegram telegram;
+  type_group_stats_entry entry;
+  TpUartEmulator emulator;
+  KnxTpUart tpuart(emulator, PHYSICAL_ADDR, NORMAL);
+  byte frame[KNX_TELEGRAM_MAX_SIZE], position, entriesNb;
+  word attempts;
+
+  KnxSetClock(&clock_);
+
+  printf("--- Counters ---\n");
+  BuildTelegram(telegram, 0x1102, 0x0801, KNX_COMMAND_VALUE_WRITE);
+  stats.Record(telegram, KnxMicros());
+  clock_.Advance(50000);
+  BuildTelegram(telegram, 0x1103, 0x0801, KNX_COMMAND_VALUE_READ);
+  stats.Record(telegram, KnxMicros());
+  clock_.Advance(250000);
+  stats.Record(telegram, KnxMicros());
+  Check("entry found", FindEntry(stats, 0x0801, true, entry));
+  Check("telegrams nb", (entry.telegramsNb == 3) && (stats.GetTelegramsNb() == 3) && (stats.GetUntrackedNb() == 0));
+  Check("last source and command", (entry.lastSourceAddress == 0x1103) && (entry.lastCommand == KNX_COMMAND_VALUE_READ));
+  Check("first and last seen", (entry.firstSeenMillis == 1000) && (entry.lastSeenMillis == 1300));
+  Check("min interval", entry.minIntervalMicros == 50000);
+  Check("avg interval", KnxGroupStats::GetAverageIntervalMillis(entry) == 150);
+
+  BuildTelegram(telegram, 0x1102, 0x0801, KNX_COMMAND_VALUE_WRITE);
+  telegram.SetMulticast(false); // individual address 0.8.1
+  stats.Record(telegram, KnxMicros());
+  Check("individual address apart", FindEntry(stats, 0x0801, false, entry) && (entry.telegramsNb == 1)
+        && (entry.minIntervalMicros == KNX_GROUP_STATS_NO_INTERVAL) && (KnxGroupStats::GetAverageIntervalMillis(entry) == 0));
+  Check("group address unchanged", FindEntry(stats, 0x0801, true, entry) && (entry.telegramsNb == 3));
+
+  printf("\n--- Table full ---\n");
+  stats.Clear();
+  Check("cleared", (stats.GetTelegramsNb() == 0) && !FindEntry(stats, 0x0801, true, entry));
+  for (word address = 0; address < 1000; address++)
+  {
+    BuildTelegram(telegram, 0x1102, 0x1000 + address, KNX_COMMAND_VALUE_WRITE);
+    stats.Record(telegram, KnxMicros());
+  }
+  position = 0; entriesNb = 0;
+  while (stats.GetNextEntry(position, entry)) entriesNb++;
+  printf("%u addresses tracked\n", entriesNb);
+  Check("bounded table", entriesNb <= KNX_GROUP_STATS_SIZE);
+  Check("most of the table used", entriesNb >= KNX_GROUP_STATS_SIZE * 3 / 4);
+  Check("untracked counted", (stats.GetTelegramsNb() == 1000) && (stats.GetUntrackedNb() == 1000UL - entriesNb));
+  BuildTelegram(telegram, 0x1102, 0x1000, KNX_COMMAND_VALUE_WRITE);
+  stats.Record(telegram, KnxMicros());
+  Check("tracked address still updated", FindEntry(stats, 0x1000, true, entry) && (entry.telegramsNb == 2));
+
+  printf("\n--- TPUART RX task ---\n");
+  stats.Clear();
+  for (attempts = 0; (tpuart.Reset() != KNX_BUSCOUPLER_OK) && (attempts < 100); attempts++) clock_.Advance(100);
+  tpuart.AttachComObjectsList(comObjects, 1);
+  tpuart.SetEvtCallback(&EventCallback);
+  tpuart.SetAckCallback(&AckCallback);
+  Check("statistics set", tpuart.SetGroupStats(&stats));
+  Check("init", tpuart.Init() == KNX_BUSCOUPLER_OK);
+  BuildTelegram(telegram, 0x1102, 0x0801, KNX_COMMAND_VALUE_WRITE); // addressed
+  for (byte i = 0; i < telegram.GetTelegramLength(); i++) frame[i] = telegram.ReadRawByte(i);
+  emulator.InjectBusFrame(frame, telegram.GetTelegramLength());
+  BuildTelegram(telegram, 0x1104, 0x0905, KNX_COMMAND_VALUE_RESPONSE); // not addressed
+  for (byte i = 0; i < telegram.GetTelegramLength(); i++) frame[i] = telegram.ReadRawByte(i);
+  emulator.InjectBusFrame(frame, telegram.GetTelegramLength());
+  emulator.InjectBusFrame(frame, telegram.GetTelegramLength());
+  frame[telegram.GetTelegramLength() - 1] ^= 0x01; // wrong checksum, not recorded
+  emulator.InjectBusFrame(frame, telegram.GetTelegramLength());
+  for (unsigned long t = 0; t < 300000; t += RX_TASK_PERIOD) { clock_.Advance(RX_TASK_PERIOD); tpuart.RXTask(); }
+  Check("addressed telegram recorded", FindEntry(stats, 0x0801, true, entry) && (entry.telegramsNb == 1));
+  Check("not addressed telegrams recorded", FindEntry(stats, 0x0905, true, entry) && (entry.telegramsNb == 2)
+        && (entry.lastSourceAddress == 0x1104) && (entry.lastCommand == KNX_COMMAND_VALUE_RESPONSE));
+  Check("wrong checksum not recorded", stats.GetTelegramsNb() == 3);
+
+  KnxSetClock(NULL);
+  printf("\n%u error(s)\n", errorsNb);
+  return errorsNb;
+}
+
+// EOF
@@ -0,0 +1,275 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxIpRoutingCoupler_UnitTests.cpp
+// Author : Franck Marini
+// Description : Host tests of the cEMI conversion and of the KNXnet/IP routing coupler.
+//               Two couplers (1.1.1 and 1.1.2) and a raw UDP socket share a multicast group on the
+//               loopback interface.
+//               - cEMI <-> TP1 telegram conversion
+//               - addressed telegram reception, own telegrams and not assigned addresses filtering
+//               - TX rate limitation (KNXNETIP_ROUTING_MAX_RATE)
+//               - TX pause on ROUTING_BUSY reception
+//               - batch reception, RX queue overflow and ROUTING_BUSY sending
+//               - debug traces of the routing flow control
+//               The program returns the nb of failed checks.
+// Module dependencies : KnxIpRoutingCoupler, KnxCemi, KnxTraceRing
+//
+// Build and run from the library root folder (single command line) :
+//   g++ -O2 -DKNXTPUART_DEBUG_INFO -DKNXTPUART_DEBUG_ERROR -I extras/host -I .
+//       extras/host/tests/KnxIpRoutingCoupler_UnitTests.cpp extras/host/ArduinoHost.cpp KnxIpRoutingCoupler.cpp
+//       KnxCemi.cpp KnxTelegram.cpp KnxClock.cpp KnxGroupStats.cpp KnxComObject.cpp KnxComObjectTable.cpp
+//       KnxTraceRing.cpp -o KnxIpRoutingCoupler_UnitTests
+//   ./KnxIpRoutingCoupler_UnitTests
+
+#include "KnxIpRoutingCoupler.h"
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+// Test group and port, distinct from the real routing ones not to disturb a KNX installation
+#define TEST_MULTICAST_ADDR "239.255.23.12"
+#define TEST_PORT           13671
+#define TEST_INTERFACE_ADDR "127.0.0.1"
+
+static word errorsNb;
+
+static KnxComObject switchObjectA(0x0801, KNX_DPT_1_001, COM_OBJ_LOGIC_IN);
+static KnxComObject* comObjectsA[] = { &switchObjectA };
+static KnxComObject switchObjectB(0x0801, KNX_DPT_1_001, COM_OBJ_LOGIC_IN);
+static KnxComObject valueObjectB(0x0802, KNX_DPT_14_000, COM_OBJ_LOGIC_IN);
+static KnxComObject* comObjectsB[] = { &switchObjectB, &valueObjectB };
+
+static word receivedNbA, receivedNbB, acksNb;
+
+static void EventCallbackA(e_KnxBusCouplerEvent event) { if (event == BUSCOUPLER_EVENT_RECEIVED_EIB_TELEGRAM) receivedNbA++; }
+static void EventCallbackB(e_KnxBusCouplerEvent event) { if (event == BUSCOUPLER_EVENT_RECEIVED_EIB_TELEGRAM) receivedNbB++; }
+static void AckCallback(e_BusCouplerTxAck value) { if (value == ACK_RESPONSE) acksNb++; }
+
+
+static void Check(const char *label, boolean result)
+{
+  printf("%s : %s\n", label, result ? "OK" : "FAILED !!");
+  if (!result) errorsNb++;
+}
+
+
+static void BuildTelegram(KnxTelegram& telegram, word target, byte payloadLength, byte seed)
+{
+  byte payload[KNX_TELEGRAM_PAYLOAD_MAX_SIZE];
+
+  telegram.ClearTelegram();
+  telegram.SetSourceAddress(0x1103);
+  telegram.SetTargetAddress(target);
+  telegram.SetCommand(KNX_COMMAND_VALUE_WRITE);
+  telegram.SetPayloadLength(payloadLength);
+  telegram.SetFirstPayloadByte(seed & 1);
+  for (byte i = 0; i < sizeof(payload); i++) payload[i] = seed + i;
+  if (payloadLength > 1) telegram.SetLongPayload(payload, payloadLength - 1);
+  telegram.UpdateChecksum();
+}
+
+
+// Pop the entries till the expected event, return false if not found
+static boolean FindEvent(KnxTraceRing& ring, e_KnxTraceEvent event, type_trace_entry& entry)
+{
+  while (ring.Pop(entry)) if (entry.event == event) return true;
+  return false;
+}
+
+
+static boolean SameTelegram(const KnxTelegram& t1, const KnxTelegram& t2)
+{
+  if (t1.GetTelegramLength() != t2.GetTelegramLength()) return false;
+  for (byte i = 0; i < t1.GetTelegramLength(); i++) if (t1.ReadRawByte(i) != t2.ReadRawByte(i)) return false;
+  return true;
+}
+
+
+// Send a raw KNXnet/IP frame to the test group
+static void RawSend(int rawSocket, const byte frame[], word length)
+{
+  struct sockaddr_in group;
+  memset(&group, 0, sizeof(group));
+  group.sin_family = AF_INET;
+  group.sin_port = htons(TEST_PORT);
+  group.sin_addr.s_addr = inet_addr(TEST_MULTICAST_ADDR);
+  if (sendto(rawSocket, frame, length, 0, (struct sockaddr *)&group, sizeof(group)) != length) errorsNb++;
+}
+
+
+// Run the RX tasks of both couplers during "ms" milliseconds, the received telegrams are dropped
+static void RunRx(KnxIpRoutingCoupler& a, KnxIpRoutingCoupler& b, unsigned long ms)
+{
+  type_buscoupler_rx_telegram rxTelegram;
+  unsigned long startTime = millis();
+  do
+  {
+    a.RXTask(); b.RXTask();
+    while (a.PopReceivedTelegram(rxTelegram));
+    while (b.PopReceivedTelegram(rxTelegram));
+    delayMicroseconds(200);
+  } while (millis() - startTime < ms);
+}
+
+
+static void CemiTests(void)
+{
+  KnxTelegram telegram, converted;
+  byte cemi[KNX_CEMI_MAX_SIZE + 2], length;
+  boolean ok = true;
+
+  printf("\n--- cEMI conversion ---\n");
+  for (byte payloadLength = 1; payloadLength < KNX_TELEGRAM_PAYLOAD_MAX_SIZE; payloadLength++)
+  {
+    BuildTelegram(telegram, 0x0801, payloadLength, payloadLength);
+    telegram.ChangePriority(KNX_PRIORITY_HIGH_VALUE);
+    telegram.UpdateChecksum();
+    length = KnxTelegramToCemi(telegram, KNX_CEMI_L_DATA_IND, cemi);
+    if ((length != KNX_CEMI_HEADER_SIZE + payloadLength + 1) || (cemi[0] != KNX_CEMI_L_DATA_IND) || (cemi[8] != payloadLength)) ok = false;
+    if ((KnxCemiToTelegram(cemi, length, converted) != KNX_CEMI_OK) || !SameTelegram(converted, telegram)) ok = false;
+  }
+  Check("round trip for all payload lengths", ok);
+
+  // frame with 2 bytes of additional info
+  length = KnxTelegramToCemi(telegram, KNX_CEMI_L_DATA_IND, cemi);
+  memmove(cemi + 4, cemi + 2, length - 2);
+  cemi[1] = 2; cemi[2] = 0x03; cemi[3] = 0x00;
+  Check("additional info skipped", (KnxCemiToTelegram(cemi, length + 2, converted) == KNX_CEMI_OK) && SameTelegram(converted, telegram));
+  Check("truncated frame rejected", KnxCemiToTelegram(cemi, length, converted) == KNX_CEMI_ERROR);
+}
+
+
+static void RoutingTests(void)
+{
+  KnxIpRoutingCoupler a(0x1101, TEST_MULTICAST_ADDR, TEST_PORT, TEST_INTERFACE_ADDR);
+  KnxIpRoutingCoupler b(0x1102, TEST_MULTICAST_ADDR, TEST_PORT, TEST_INTERFACE_ADDR);
+  type_buscoupler_rx_telegram rxTelegram;
+  KnxTraceRing tracesA, tracesB;
+  type_trace_entry entry;
+  KnxTelegram telegram;
+  byte frame[KNXNETIP_HEADER_SIZE + KNX_CEMI_MAX_SIZE], length;
+  struct in_addr interface;
+  unsigned long startTime, duration;
+  unsigned char loop = 1;
+  int rawSocket;
+  word sentNb;
+
+  printf("\n--- KNXnet/IP routing coupler ---\n");
+  a.SetTraceRing(&tracesA); b.SetTraceRing(&tracesB);
+  Check("coupler A reset", a.Reset() == KNX_BUSCOUPLER_OK);
+  Check("coupler B reset", b.Reset() == KNX_BUSCOUPLER_OK);
+  a.AttachComObjectsList(comObjectsA, 1); a.SetEvtCallback(&EventCallbackA); a.SetAckCallback(&AckCallback);
+  b.AttachComObjectsList(comObjectsB, 2); b.SetEvtCallback(&EventCallbackB); b.SetAckCallback(&AckCallback);
+  Check("couplers init", (a.Init() == KNX_BUSCOUPLER_OK) && (b.Init() == KNX_BUSCOUPLER_OK));
+  Check("reset, attach and init traced", tracesA.Pop(entry) && (entry.event == KNX_TRACE_COUPLER_RESET_OK)
+        && tracesA.Pop(entry) && (entry.event == KNX_TRACE_COUPLER_ATTACH_OK) && (entry.args[0] == 1)
+        && tracesA.Pop(entry) && (entry.event == KNX_TRACE_COUPLER_INIT_NORMAL) && !tracesA.Pop(entry));
+
+  rawSocket = socket(AF_INET, SOCK_DGRAM, 0);
+  interface.s_addr = inet_addr(TEST_INTERFACE_ADDR);
+  setsockopt(rawSocket, IPPROTO_IP, IP_MULTICAST_IF, &interface, sizeof(interface));
+  setsockopt(rawSocket, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+
+  // A -> B, addressed telegram
+  BuildTelegram(telegram, 0x0802, 5, 0x40);
+  Check("send accepted", a.SendTelegram(telegram) == KNX_BUSCOUPLER_OK);
+  a.TXTask();
+  Check("telegram acknowledged once sent", (acksNb == 1) && !a.IsActive());
+  b.WaitForRxData(100000);
+  b.RXTask(); a.RXTask();
+  Check("telegram received by B", (receivedNbB == 1) && b.PopReceivedTelegram(rxTelegram) && SameTelegram(rxTelegram.telegram, telegram)
+        && (rxTelegram.comObjectIndex == 1) && (rxTelegram.telegram.GetSourceAddress() == 0x1101));
+  Check("own telegram not received by A", receivedNbA == 0);
+
+  // not assigned address
+  delay(25);
+  BuildTelegram(telegram, 0x0901, 1, 0);
+  a.SendTelegram(telegram); a.TXTask();
+  RunRx(a, b, 20);
+  Check("not assigned address ignored", (receivedNbB == 1) && (acksNb == 2));
+
+  // rate limitation : 10 telegrams sent as fast as possible
+  BuildTelegram(telegram, 0x0801, 1, 1);
+  sentNb = 0; receivedNbB = 0;
+  startTime = millis();
+  while (sentNb < 10)
+  {
+    if (a.SendTelegram(telegram) == KNX_BUSCOUPLER_OK) sentNb++;
+    while (a.IsActive()) { a.TXTask(); RunRx(a, b, 1); }
+  }
+  duration = millis() - startTime;
+  RunRx(a, b, 20);
+  printf("  10 telegrams sent in %lu ms\n", duration);
+  Check("TX rate limited", duration >= 9 * (1000 / KNXNETIP_ROUTING_MAX_RATE));
+  Check("all rate limited telegrams received", receivedNbB == 10);
+
+  // ROUTING_BUSY with a 100ms wait time
+  KnxNetIpWriteHeader(frame, KNXNETIP_ROUTING_BUSY, KNXNETIP_HEADER_SIZE + 6);
+  frame[6] = 6; frame[7] = 0; frame[8] = 0; frame[9] = 100; frame[10] = 0; frame[11] = 0;
+  RawSend(rawSocket, frame, KNXNETIP_HEADER_SIZE + 6);
+  RunRx(a, b, 5);
+  Check("ROUTING_BUSY received", a.GetReceivedBusyNb() == 1);
+  Check("ROUTING_BUSY reception traced", tracesA.Pop(entry) && (entry.event == KNX_TRACE_COUPLER_ROUTING_BUSY_RX)
+        && (entry.args[0] == 100) && (entry.args[1] == 1));
+  startTime = millis();
+  a.SendTelegram(telegram);
+  while (a.IsActive() && (millis() - startTime < 1000)) { a.TXTask(); RunRx(a, b, 1); }
+  duration = millis() - startTime;
+  printf("  TX paused during %lu ms\n", duration);
+  Check("TX paused on ROUTING_BUSY", (duration >= 95) && (duration <= 100 + KNXNETIP_ROUTING_BUSY_RANDOM_TIME + 10));
+
+  // burst of 20 telegrams read in batches by a single RX task, the RX queue overflows
+  receivedNbB = 0;
+  BuildTelegram(telegram, 0x0801, 1, 0);
+  length = KnxTelegramToCemi(telegram, KNX_CEMI_L_DATA_IND, frame + KNXNETIP_HEADER_SIZE);
+  KnxNetIpWriteHeader(frame, KNXNETIP_ROUTING_INDICATION, KNXNETIP_HEADER_SIZE + length);
+  for (byte i = 0; i < 20; i++) RawSend(rawSocket, frame, KNXNETIP_HEADER_SIZE + length);
+  delay(5);
+  b.RXTask();
+  Check("burst read by one RX task", receivedNbB == 20);
+  Check("RX overflows counted", b.GetRxOverflowsNb() == 20 - BUSCOUPLER_RX_QUEUE_SIZE);
+  a.WaitForRxData(100000);
+  a.RXTask();
+  Check("ROUTING_BUSY sent on RX overflow", a.GetReceivedBusyNb() == 2);
+  Check("ROUTING_BUSY sending traced", FindEvent(tracesB, KNX_TRACE_COUPLER_ROUTING_BUSY_TX, entry)
+        && (entry.args[0] == 20 - BUSCOUPLER_RX_QUEUE_SIZE));
+  while (b.PopReceivedTelegram(rxTelegram));
+
+  // ROUTING_LOST_MESSAGE reporting 3 lost messages
+  KnxNetIpWriteHeader(frame, KNXNETIP_ROUTING_LOST_MESSAGE, KNXNETIP_HEADER_SIZE + 4);
+  frame[6] = 4; frame[7] = 0; frame[8] = 0; frame[9] = 3;
+  RawSend(rawSocket, frame, KNXNETIP_HEADER_SIZE + 4);
+  RunRx(a, b, 5);
+  Check("ROUTING_LOST_MESSAGE traced", FindEvent(tracesA, KNX_TRACE_COUPLER_ROUTING_LOST, entry) && (entry.args[0] == 3));
+
+  close(rawSocket);
+}
+
+
+int main(void)
+{
+  CemiTests();
+  RoutingTests();
+  printf("\n%u error(s)\n", errorsNb);
+  return errorsNb;
+}
+
+// EOF
@@ -0,0 +1,332 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxIpTunnelingServer_TestClient.cpp
+// Author : Franck Marini
+// Description : Local KNXnet/IP tunneling test client for KnxIpTunnelingServer.
+//               The server runs in its own thread on the loopback interface, the clients are plain UDP sockets.
+//               - connection management (connect, connection state, disconnect, rejection when full)
+//               - sequence numbers : repeated requests acknowledged but not processed, wrong ones ignored
+//               - group reads of local com objects answered locally, writes forwarded and indicated
+//               - ACK timeout : 1 repetition (a negative ACK does not release the frame) then disconnection
+//               - group read round trip time with 1 and with all the sessions connected
+//               Measurements lines start with "#", the program returns the nb of failed checks.
+// Module dependencies : KnxIpTunnelingServer, KnxCemi
+//
+// Build and run from the library root folder (single command line) :
+//   g++ -O2 -pthread -I extras/host -I . extras/host/tests/KnxIpTunnelingServer_TestClient.cpp extras/host/ArduinoHost.cpp
+//       KnxIpTunnelingServer.cpp KnxCemi.cpp KnxTelegram.cpp KnxClock.cpp KnxComObject.cpp -o KnxIpTunnelingServer_TestClient
+//   ./KnxIpTunnelingServer_TestClient
+
+#include "KnxIpTunnelingServer.h"
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <thread>
+#include <atomic>
+
+#define TEST_PORT           13672
+#define TEST_ADDR           "127.0.0.1"
+#define DEVICE_ADDR         0x1101
+#define TUNNEL_BASE_ADDR    0x11F0
+#define RTT_ITERATIONS      2000
+
+static word errorsNb;
+
+static KnxComObject switchObject(0x0801, KNX_DPT_1_001, COM_OBJ_SENSOR);
+static KnxComObject valueObject(0x0802, KNX_DPT_9_001, KNX_COM_OBJ_C_R_T_INDICATOR | KNX_COM_OBJ_W_INDICATOR);
+static KnxComObject* comObjects[] = { &switchObject, &valueObject };
+
+static std::atomic<int> forwardedNb(0);
+
+static unsigned char TransmitCallback(KnxTelegram *) { forwardedNb++; return KNX_BUSCOUPLER_OK; }
+
+
+static void Check(const char *label, boolean result)
+{
+  printf("%s : %s\n", label, result ? "OK" : "FAILED !!");
+  if (!result) errorsNb++;
+}
+
+
+static unsigned long long NowNanosec(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long long)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+
+// Tunneling client
+class TestClient {
+  public:
+    int fd;
+    struct sockaddr_in server;
+    byte channel, txSequence, rxSequence;
+
+    TestClient() : channel(0), txSequence(0), rxSequence(0)
+    {
+      struct sockaddr_in local;
+      memset(&local, 0, sizeof(local));
+      local.sin_family = AF_INET; local.sin_addr.s_addr = inet_addr(TEST_ADDR); // ephemeral port
+      fd = socket(AF_INET, SOCK_DGRAM, 0);
+      bind(fd, (struct sockaddr *)&local, sizeof(local));
+      memset(&server, 0, sizeof(server));
+      server.sin_family = AF_INET; server.sin_port = htons(TEST_PORT); server.sin_addr.s_addr = inet_addr(TEST_ADDR);
+    }
+    ~TestClient() { close(fd); }
+
+    void Send(const byte frame[], word length) { sendto(fd, frame, length, 0, (struct sockaddr *)&server, sizeof(server)); }
+
+    // Receive a frame of the given service type, the other ones are dropped
+    // return the frame length, 0 in case of timeout
+    word Receive(word serviceType, byte frame[], int timeoutMs)
+    {
+      struct pollfd pfd = { fd, POLLIN, 0 };
+      word type;
+      ssize_t length;
+      while (poll(&pfd, 1, timeoutMs) > 0)
+      {
+        length = recv(fd, frame, KNXIPTUNNEL_FRAME_MAX_SIZE, 0);
+        if ((length > 0) && (KnxNetIpReadHeader(frame, length, type) == KNXNETIP_OK) && (type == serviceType)) return length;
+      }
+      return 0;
+    }
+
+    void WriteHpai(byte hpai[])
+    {
+      struct sockaddr_in local; socklen_t localLength = sizeof(local);
+      getsockname(fd, (struct sockaddr *)&local, &localLength);
+      hpai[0] = KNXNETIP_HPAI_SIZE; hpai[1] = KNXNETIP_IPV4_UDP;
+      memcpy(hpai + 2, &local.sin_addr.s_addr, 4); memcpy(hpai + 6, &local.sin_port, 2);
+    }
+
+    // return the CONNECT_RESPONSE status (255 if no response)
+    byte Connect(word *individualAddr = NULL)
+    {
+      byte frame[KNXIPTUNNEL_FRAME_MAX_SIZE];
+      KnxNetIpWriteHeader(frame, KNXNETIP_CONNECT_REQUEST, 26);
+      WriteHpai(frame + 6); WriteHpai(frame + 14);
+      frame[22] = 4; frame[23] = KNXNETIP_TUNNEL_CONNECTION; frame[24] = KNXNETIP_TUNNEL_LINKLAYER; frame[25] = 0;
+      Send(frame, 26);
+      if (!Receive(KNXNETIP_CONNECT_RESPONSE, frame, 500)) return 255;
+      channel = frame[6]; txSequence = 0; rxSequence = 0;
+      if (individualAddr && (frame[7] == KNXNETIP_E_NO_ERROR)) *individualAddr = (frame[18] << 8) | frame[19];
+      return frame[7];
+    }
+
+    // CONNECTIONSTATE_REQUEST or DISCONNECT_REQUEST, return the response status (255 if no response)
+    byte Request(word serviceType)
+    {
+      byte frame[KNXIPTUNNEL_FRAME_MAX_SIZE];
+      KnxNetIpWriteHeader(frame, serviceType, 16);
+      frame[6] = channel; frame[7] = 0; WriteHpai(frame + 8);
+      Send(frame, 16);
+      if (!Receive(serviceType + 1, frame, 500)) return 255;
+      return frame[7];
+    }
+
+    void SendTunnelingRequest(const byte cemi[], byte length, byte sequence)
+    {
+      byte frame[KNXIPTUNNEL_FRAME_MAX_SIZE];
+      KnxNetIpWriteHeader(frame, KNXNETIP_TUNNELING_REQUEST, 10 + length);
+      frame[6] = 4; frame[7] = channel; frame[8] = sequence; frame[9] = 0;
+      memcpy(frame + 10, cemi, length);
+      Send(frame, 10 + length);
+    }
+
+    // Send a telegram (L_Data.req) and wait for its TUNNELING_ACK, return true if acknowledged
+    boolean SendTelegram(const KnxTelegram& telegram)
+    {
+      byte cemi[KNX_CEMI_MAX_SIZE], frame[KNXIPTUNNEL_FRAME_MAX_SIZE];
+      SendTunnelingRequest(cemi, KnxTelegramToCemi(telegram, KNX_CEMI_L_DATA_REQ, cemi), txSequence);
+      if (!Receive(KNXNETIP_TUNNELING_ACK, frame, 500) || (frame[8] != txSequence)) return false;
+      txSequence++;
+      return true;
+    }
+
+    // Acknowledge a received TUNNELING_REQUEST with the given status
+    void SendAck(byte sequence, byte status)
+    {
+      byte frame[10];
+      KnxNetIpWriteHeader(frame, KNXNETIP_TUNNELING_ACK, 10);
+      frame[6] = 4; frame[7] = channel; frame[8] = sequence; frame[9] = status;
+      Send(frame, 10);
+    }
+
+    // Receive a tunneled cEMI frame and acknowledge it (if "ack" is true), return the cEMI message code (0 if none)
+    byte ReceiveTelegram(KnxTelegram& telegram, int timeoutMs, boolean ack = true)
+    {
+      byte frame[KNXIPTUNNEL_FRAME_MAX_SIZE];
+      word length = Receive(KNXNETIP_TUNNELING_REQUEST, frame, timeoutMs);
+      if (!length) return 0;
+      if (ack) SendAck(frame[8], KNXNETIP_E_NO_ERROR);
+      rxSequence = frame[8];
+      if (KnxCemiToTelegram(frame + 10, length - 10, telegram) != KNX_CEMI_OK) return 0;
+      return frame[10];
+    }
+};
+
+
+static void BuildTelegram(KnxTelegram& telegram, word target, e_KnxCommand command, byte value)
+{
+  telegram.ClearTelegram();
+  telegram.SetSourceAddress(0); // the server uses the tunnel address
+  telegram.SetTargetAddress(target);
+  telegram.SetCommand(command);
+  telegram.SetFirstPayloadByte(value);
+  telegram.UpdateChecksum();
+}
+
+
+// Group read of the switch object, returns the round trip time (ns) until the response, 0 if failed
+// The L_Data.con and the response are acknowledged, the frames indicated to the other clients are drained later
+static unsigned long long GroupReadRtt(TestClient& client)
+{
+  KnxTelegram telegram;
+  unsigned long long startTime = NowNanosec();
+  byte code;
+
+  BuildTelegram(telegram, 0x0801, KNX_COMMAND_VALUE_READ, 0);
+  if (!client.SendTelegram(telegram)) return 0;
+  do code = client.ReceiveTelegram(telegram, 500);
+  while (code == KNX_CEMI_L_DATA_CON);
+  if ((code != KNX_CEMI_L_DATA_IND) || (telegram.GetCommand() != KNX_COMMAND_VALUE_RESPONSE)) return 0;
+  return NowNanosec() - startTime;
+}
+
+
+static void Drain(TestClient& client)
+{
+  KnxTelegram telegram;
+  while (client.ReceiveTelegram(telegram, 2));
+}
+
+
+static void PrintRtt(const char *label, unsigned long long rtt[], word nb)
+{
+  unsigned long long sum = 0, min = rtt[0], max = rtt[0];
+  for (word i = 0; i < nb; i++) { sum += rtt[i]; if (rtt[i] < min) min = rtt[i]; if (rtt[i] > max) max = rtt[i]; }
+  printf("# %s : avg %.1f us, min %.1f us, max %.1f us (%u reads)\n", label, sum / 1000.0 / nb, min / 1000.0, max / 1000.0, nb);
+}
+
+
+int main(void)
+{
+  KnxIpTunnelingServer server(DEVICE_ADDR, TUNNEL_BASE_ADDR, comObjects, 2, &TransmitCallback, TEST_PORT, TEST_ADDR);
+  std::atomic<bool> stop(false);
+  static unsigned long long rtt[RTT_ITERATIONS];
+  TestClient *clients[KNXIPTUNNEL_MAX_CONNECTIONS + 1];
+  KnxTelegram telegram;
+  byte cemi[KNX_CEMI_MAX_SIZE], code, status;
+  word addr = 0, sessionsNb, readsNb;
+  int forwardedBefore;
+
+  switchObject.UpdateValue((byte)1);
+  if (server.Begin() != KNX_IPTUNNEL_OK) { printf("server begin failed\n"); return 1; }
+  std::thread serverThread([&]() { while (!stop) { server.WaitForRxData(1000); server.Task(); } });
+
+  printf("\n--- Connection management ---\n");
+  TestClient a, b;
+  Check("client A connected", (a.Connect(&addr) == KNXNETIP_E_NO_ERROR) && (a.channel == 1) && (addr == TUNNEL_BASE_ADDR));
+  Check("client B connected", (b.Connect(&addr) == KNXNETIP_E_NO_ERROR) && (b.channel == 2) && (addr == TUNNEL_BASE_ADDR + 1));
+  Check("connection state", a.Request(KNXNETIP_CONNECTIONSTATE_REQUEST) == KNXNETIP_E_NO_ERROR);
+
+  printf("\n--- Local group read ---\n");
+  BuildTelegram(telegram, 0x0801, KNX_COMMAND_VALUE_READ, 0);
+  Check("read acknowledged", a.SendTelegram(telegram));
+  code = a.ReceiveTelegram(telegram, 500);
+  Check("L_Data.con received", (code == KNX_CEMI_L_DATA_CON) && (telegram.GetSourceAddress() == TUNNEL_BASE_ADDR));
+  code = a.ReceiveTelegram(telegram, 500);
+  Check("response from the local value", (code == KNX_CEMI_L_DATA_IND) && (telegram.GetCommand() == KNX_COMMAND_VALUE_RESPONSE)
+        && (telegram.GetSourceAddress() == DEVICE_ADDR) && (telegram.GetFirstPayloadByte() == 1));
+  code = b.ReceiveTelegram(telegram, 500);
+  Check("response indicated to client B", (code == KNX_CEMI_L_DATA_IND) && (telegram.GetCommand() == KNX_COMMAND_VALUE_RESPONSE));
+  Check("read not forwarded to the bus", forwardedNb == 0);
+
+  printf("\n--- Group write ---\n");
+  BuildTelegram(telegram, 0x0900, KNX_COMMAND_VALUE_WRITE, 1);
+  Check("write acknowledged", a.SendTelegram(telegram));
+  Check("write confirmed", a.ReceiveTelegram(telegram, 500) == KNX_CEMI_L_DATA_CON);
+  code = b.ReceiveTelegram(telegram, 500);
+  Check("write indicated to client B", (code == KNX_CEMI_L_DATA_IND) && (telegram.GetTargetAddress() == 0x0900)
+        && (telegram.GetCommand() == KNX_COMMAND_VALUE_WRITE) && (telegram.GetSourceAddress() == TUNNEL_BASE_ADDR));
+  Check("write forwarded to the bus", forwardedNb == 1);
+  Check("write not indicated back to client A", a.ReceiveTelegram(telegram, 50) == 0);
+
+  printf("\n--- Sequence numbers ---\n");
+  BuildTelegram(telegram, 0x0900, KNX_COMMAND_VALUE_WRITE, 0);
+  a.SendTunnelingRequest(cemi, KnxTelegramToCemi(telegram, KNX_CEMI_L_DATA_REQ, cemi), a.txSequence - 1);
+  Check("repeated request acknowledged", a.Receive(KNXNETIP_TUNNELING_ACK, cemi, 500) && (cemi[8] == (byte)(a.txSequence - 1)));
+  a.SendTunnelingRequest(cemi, KnxTelegramToCemi(telegram, KNX_CEMI_L_DATA_REQ, cemi), a.txSequence + 5);
+  Check("out of sequence request ignored", a.Receive(KNXNETIP_TUNNELING_ACK, cemi, 100) == 0);
+  Check("repeated and ignored requests not processed", (a.ReceiveTelegram(telegram, 50) == 0) && (forwardedNb == 1));
+  Drain(b);
+
+  printf("\n--- ACK timeout ---\n");
+  BuildTelegram(telegram, 0x0900, KNX_COMMAND_VALUE_WRITE, 1);
+  a.SendTelegram(telegram); a.ReceiveTelegram(telegram, 500); // client B never acknowledges the indication
+  code = b.ReceiveTelegram(telegram, 500, false);
+  status = b.rxSequence;
+  b.SendAck(b.rxSequence, KNXNETIP_E_DATA_CONNECTION); // negative ACK, the indication is not released
+  Check("indication repeated after 1s", (b.ReceiveTelegram(telegram, 1500, false) == code) && (b.rxSequence == status));
+  Check("client B disconnected after the repetition", b.Receive(KNXNETIP_DISCONNECT_REQUEST, cemi, 1500) != 0);
+  Check("client B connection unknown", b.Request(KNXNETIP_CONNECTIONSTATE_REQUEST) == KNXNETIP_E_CONNECTION_ID);
+
+  printf("\n--- Round trip time ---\n");
+  for (readsNb = 0; readsNb < RTT_ITERATIONS; readsNb++) if (!(rtt[readsNb] = GroupReadRtt(a))) break;
+  Check("group reads with 1 session", readsNb == RTT_ITERATIONS);
+  if (readsNb) PrintRtt("group read RTT, 1 session", rtt, readsNb);
+  Check("client A disconnected", a.Request(KNXNETIP_DISCONNECT_REQUEST) == KNXNETIP_E_NO_ERROR);
+
+  printf("\n--- Concurrent sessions ---\n");
+  for (sessionsNb = 0; sessionsNb <= KNXIPTUNNEL_MAX_CONNECTIONS; sessionsNb++)
+  {
+    clients[sessionsNb] = new TestClient;
+    status = clients[sessionsNb]->Connect();
+    if (status != KNXNETIP_E_NO_ERROR) break;
+  }
+  printf("# concurrent sessions : %u (KNXIPTUNNEL_MAX_CONNECTIONS = %u)\n", sessionsNb, KNXIPTUNNEL_MAX_CONNECTIONS);
+  Check("all sessions accepted", sessionsNb == KNXIPTUNNEL_MAX_CONNECTIONS);
+  Check("extra session rejected", status == KNXNETIP_E_NO_MORE_CONNECTIONS);
+  // each read response is indicated to all the sessions, the other sessions acknowledge it after each read
+  for (readsNb = 0; readsNb < RTT_ITERATIONS / 4; readsNb++)
+  {
+    if (!(rtt[readsNb] = GroupReadRtt(*clients[readsNb % sessionsNb]))) break;
+    for (word i = 0; i < sessionsNb; i++) if (i != readsNb % sessionsNb) clients[i]->ReceiveTelegram(telegram, 100);
+  }
+  Check("group reads with all the sessions", readsNb == RTT_ITERATIONS / 4);
+  if (readsNb) PrintRtt("group read RTT, all sessions", rtt, readsNb);
+  forwardedBefore = forwardedNb;
+  for (word i = 0; i < sessionsNb; i++) Check("session disconnected", clients[i]->Request(KNXNETIP_DISCONNECT_REQUEST) == KNXNETIP_E_NO_ERROR);
+  for (word i = 0; i <= sessionsNb; i++) delete clients[i];
+
+  stop = true;
+  serverThread.join();
+  Check("no connection left", server.GetConnectionsNb() == 0);
+  Check("local reads counted", server.GetLocalReadsNb() == 1 + RTT_ITERATIONS + RTT_ITERATIONS / 4);
+  Check("forwarded telegrams counted", (server.GetForwardedNb() == forwardedBefore) && (forwardedBefore == 2));
+  Check("rejected connections counted", server.GetRejectedConnectionsNb() == 1);
+
+  printf("\n%u error(s)\n", errorsNb);
+  return errorsNb;
+}
+
+// EOF
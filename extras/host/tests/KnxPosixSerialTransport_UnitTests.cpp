@@ -0,0 +1,209 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxPosixSerialTransport_UnitTests.cpp
+// Author : Franck Marini
+// Description : Host tests of the Linux serial transport and of KnxTpUart running over it.
+//               The TPUART side is played by the master side of a pseudo-terminal pair.
+//               - termios configuration (19200 baud, 8 bits, parity even, 1 stop bit)
+//               - open error when the parity is not kept, unless the no parity fallback is allowed
+//               - non-blocking reads, epoll based wake-up with timeout
+//               - TPUART reset/init handshake, telegram reception with ACK, telegram transmission
+//               The program returns the nb of failed checks.
+// Module dependencies : KnxPosixSerialTransport, KnxTpUart
+//
+// Build and run from the library root folder (single command line) :
+//   g++ -O2 -I extras/host -I . extras/host/tests/KnxPosixSerialTransport_UnitTests.cpp extras/host/ArduinoHost.cpp
+//       KnxPosixSerialTransport.cpp KnxTpUart.cpp KnxTelegram.cpp KnxClock.cpp KnxGroupStats.cpp KnxBusHealth.cpp
+//       KnxComObject.cpp KnxComObjectTable.cpp -lutil -o KnxPosixSerialTransport_UnitTests
+//   ./KnxPosixSerialTransport_UnitTests
+
+#include "KnxPosixSerialTransport.h"
+#include "KnxTpUart.h"
+#include <pty.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+
+#define PHYSICAL_ADDR 0x1101
+
+static word errorsNb;
+static int masterFd; // TPUART side of the pseudo-terminal pair
+
+static KnxComObject switchObject(0x0801, KNX_DPT_1_001, COM_OBJ_LOGIC_IN);
+static KnxComObject* comObjects[] = { &switchObject };
+static word receivedNb, acksNb;
+
+static void EventCallback(e_KnxBusCouplerEvent event)
+{ if (event == BUSCOUPLER_EVENT_RECEIVED_EIB_TELEGRAM) receivedNb++; }
+
+static void AckCallback(e_BusCouplerTxAck value) { if (value == ACK_RESPONSE) acksNb++; }
+
+
+static void Check(const char *label, boolean result)
+{
+  printf("%s : %s\n", label, result ? "OK" : "FAILED !!");
+  if (!result) errorsNb++;
+}
+
+
+// Read the bytes sent to the TPUART, waiting up to 100ms for the expected nb of bytes
+static word MasterRead(byte buffer[], word length)
+{
+  word nb = 0;
+  unsigned long startTime = millis();
+  while ((nb < length) && (millis() - startTime < 100))
+  {
+    ssize_t r = read(masterFd, buffer + nb, length - nb);
+    if (r > 0) nb += r;
+  }
+  return nb;
+}
+
+
+static void MasterWrite(const byte buffer[], word length) { if (write(masterFd, buffer, length) != length) errorsNb++; }
+
+
+// Without the no parity fallback, a device which does not keep the parity (i.e. the pseudo-terminal) is not opened
+static void ParityTests(const char *slaveName)
+{
+  KnxPosixSerialTransport strictTransport(slaveName);
+
+  printf("\n*********** PARITY TESTS ***********\n");
+  Check("Begin error without fallback", strictTransport.Begin() == KNX_SERIAL_TRANSPORT_ERROR);
+  Check("device closed on error", strictTransport.GetFd() < 0);
+}
+
+
+static void TransportTests(KnxPosixSerialTransport& transport)
+{
+  struct termios tty;
+  byte data[4] = { 0x12, 0x34, 0x56, 0x78 }, received[4];
+  unsigned long startTime;
+
+  printf("\n*********** TRANSPORT TESTS ***********\n");
+  Check("Begin", transport.Begin() == KNX_SERIAL_TRANSPORT_OK);
+  // NB : the parity is not checked since Linux pseudo-terminals do not keep the PARENB flag
+  Check("termios readback", (tcgetattr(transport.GetFd(), &tty) == 0) && (cfgetispeed(&tty) == B19200)
+        && (cfgetospeed(&tty) == B19200) && ((tty.c_cflag & CSIZE) == CS8)
+        && !(tty.c_cflag & PARODD) && !(tty.c_cflag & CSTOPB));
+  Check("non-blocking fd", fcntl(transport.GetFd(), F_GETFL) & O_NONBLOCK);
+  Check("nothing available", (transport.Available() == 0) && (transport.Read() == -1));
+
+  startTime = micros();
+  Check("WaitForData timeout", !transport.WaitForData(5000) && (micros() - startTime >= 4000));
+
+  MasterWrite(data, 4);
+  Check("WaitForData wake-up", transport.WaitForData(1000000));
+  Check("Available", transport.Available() == 4);
+  Check("ReadBytes", (transport.ReadBytes(received, 4) == 4) && !memcmp(data, received, 4));
+
+  Check("Write", transport.Write(data, 4) == 4);
+  Check("Write received by the TPUART", (MasterRead(received, 4) == 4) && !memcmp(data, received, 4));
+  Check("AvailableForWrite", transport.AvailableForWrite() > 2 * KNX_TELEGRAM_MAX_SIZE);
+  transport.End();
+  Check("End", transport.GetFd() < 0);
+}
+
+
+static void TpUartTests(KnxPosixSerialTransport& transport)
+{
+  KnxTpUart tpuart(transport, PHYSICAL_ADDR, NORMAL);
+  KnxTelegram telegram;
+  type_buscoupler_rx_telegram rxTelegram;
+  byte buffer[2 * KNX_TELEGRAM_MAX_SIZE], nb;
+  const byte resetIndication = TPUART_RESET_INDICATION;
+  const byte dataConfirm = TPUART_DATA_CONFIRM_SUCCESS;
+  unsigned long startTime;
+
+  printf("\n*********** KNXTPUART OVER TRANSPORT TESTS ***********\n");
+  // RESET handshake
+  tpuart.Reset();
+  Check("Reset request", (MasterRead(buffer, 1) == 1) && (buffer[0] == TPUART_RESET_REQ));
+  MasterWrite(&resetIndication, 1);
+  transport.WaitForData(100000);
+  Check("Reset", tpuart.Reset() == KNX_BUSCOUPLER_OK);
+  // INIT
+  tpuart.AttachComObjectsList(comObjects, 1);
+  tpuart.SetEvtCallback(&EventCallback);
+  tpuart.SetAckCallback(&AckCallback);
+  Check("Init", tpuart.Init() == KNX_BUSCOUPLER_OK);
+  Check("Init services", (MasterRead(buffer, 4) == 4) && (buffer[0] == TPUART_SET_ADDR_REQ) && (buffer[1] == 0x11)
+        && (buffer[2] == 0x01) && (buffer[3] == TPUART_STATE_REQ));
+
+  // RECEPTION of an addressed telegram
+  telegram.ClearTelegram();
+  telegram.SetSourceAddress(0x1102);
+  telegram.SetTargetAddress(0x0801);
+  telegram.SetCommand(KNX_COMMAND_VALUE_WRITE);
+  telegram.SetFirstPayloadByte(1);
+  telegram.UpdateChecksum();
+  for (nb = 0; nb < telegram.GetTelegramLength(); nb++) buffer[nb] = telegram.ReadRawByte(nb);
+  MasterWrite(buffer, nb);
+  // the RX task is called on data wake-up, then with the RX task period till EOP
+  startTime = millis();
+  while ((!receivedNb) && (millis() - startTime < 100))
+  {
+    tpuart.WaitForRxData(1000000);
+    tpuart.RXTask();
+  }
+  Check("Telegram received", receivedNb == 1);
+  Check("Telegram queued", tpuart.PopReceivedTelegram(rxTelegram) && (rxTelegram.comObjectIndex == 0)
+        && (rxTelegram.telegram.GetTargetAddress() == 0x0801));
+  Check("ACK sent", (MasterRead(buffer, 1) == 1) && (buffer[0] == TPUART_RX_ACK_SERVICE_ADDRESSED));
+
+  // TRANSMISSION
+  telegram.SetSourceAddress(PHYSICAL_ADDR);
+  telegram.UpdateChecksum();
+  Check("SendTelegram", tpuart.SendTelegram(telegram) == KNX_BUSCOUPLER_OK);
+  // the TX task is called once per telegram byte (paced transmission)
+  nb = 0;
+  for (byte i = 0; i < telegram.GetTelegramLength(); i++) { tpuart.TXTask(); nb += MasterRead(buffer + nb, 2); }
+  Check("Telegram services", (nb == 2 * telegram.GetTelegramLength()) && (buffer[0] == TPUART_DATA_START_CONTINUE_REQ)
+        && (buffer[nb - 2] == TPUART_DATA_END_REQ + telegram.GetTelegramLength() - 1)
+        && (buffer[nb - 1] == telegram.GetChecksum()));
+  MasterWrite(&dataConfirm, 1);
+  tpuart.WaitForRxData(100000);
+  tpuart.RXTask();
+  Check("Telegram confirmed", acksNb == 1);
+}
+
+
+int main(void)
+{
+  struct termios tty;
+  char slaveName[64];
+  int slaveFd;
+
+  if (openpty(&masterFd, &slaveFd, slaveName, NULL, NULL) < 0) { printf("openpty failed\n"); return 1; }
+  // raw mode on the TPUART side too
+  tcgetattr(masterFd, &tty); cfmakeraw(&tty); tcsetattr(masterFd, TCSANOW, &tty);
+  fcntl(masterFd, F_SETFL, fcntl(masterFd, F_GETFL) | O_NONBLOCK);
+
+  ParityTests(slaveName);
+  KnxPosixSerialTransport transport(slaveName, 19200, true); // no parity fallback, pseudo-terminal
+  TransportTests(transport);
+  TpUartTests(transport);
+
+  close(slaveFd); close(masterFd);
+  printf("\n%u error(s)\n", errorsNb);
+  return errorsNb;
+}
+
+// EOF
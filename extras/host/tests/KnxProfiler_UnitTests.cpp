@@ -0,0 +1,165 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxProfiler_UnitTests.cpp
+// Author : Franck Marini
+// Description : Host tests of the CPU time profiling hooks (TPUART emulator, virtual time)
+//               - stage stats : calls nb, total, worst case, histogram buckets and percentiles
+//               - KnxDevice on the TPUART emulator : every hooked stage is counted
+//               - watchdog : a slow knxEvents() handler is flagged (with its com object), the fast ones are not
+//               The program returns the nb of failed checks.
+// Module dependencies : KnxProfiler, KnxDevice, KnxTpUart, TpUartEmulator, KnxClock
+//
+// Build and run from the library root folder (single command line) :
+//   g++ -O2 -DKNX_PROFILING -I extras/host -I . extras/host/tests/KnxProfiler_UnitTests.cpp extras/host/TpUartEmulator.cpp
+//       extras/host/ArduinoHost.cpp KnxProfiler.cpp KnxDevice.cpp KnxTpUart.cpp KnxTelegram.cpp KnxClock.cpp
+//       KnxGroupStats.cpp KnxBusHealth.cpp KnxComObject.cpp KnxComObjectTable.cpp KnxDPTCodec.cpp StKnxCoupler.cpp
+//       KnxTxLatency.cpp -o KnxProfiler_UnitTests
+//   ./KnxProfiler_UnitTests
+
+#include "TpUartEmulator.h"
+#include "KnxDevice.h"
+
+#define DEVICE_ADDR    0x1101
+#define TASK_PERIOD    400     // us
+#define TELEGRAMS_NB   10
+#define SLOW_TELEGRAM  6       // telegram for which the knxEvents() handler is slow
+#define SLOW_DURATION  2000    // us
+
+static word errorsNb;
+
+static KnxComObject input(0x0A00, KNX_DPT_1_001, COM_OBJ_LOGIC_IN);
+static KnxComObject sensor(0x0801, KNX_DPT_9_001, COM_OBJ_SENSOR);
+static KnxComObject* comObjects[] = { &input, &sensor };
+
+static KnxVirtualClock clock_(1000);
+static word eventsNb;
+static word watchdogCallsNb;
+static byte watchdogObject = 255;
+static unsigned long watchdogDuration;
+
+void knxEvents(byte index)
+{
+  if (++eventsNb == SLOW_TELEGRAM) clock_.Advance(SLOW_DURATION);
+}
+
+static void WatchdogCallback(byte objectIndex, unsigned long durationMicros)
+{
+  watchdogCallsNb++;
+  watchdogObject = objectIndex;
+  watchdogDuration = durationMicros;
+}
+
+
+static void Check(const char *label, boolean result)
+{
+  printf("%s : %s\n", label, result ? "OK" : "FAILED !!");
+  if (!result) errorsNb++;
+}
+
+
+static void TestStats(void)
+{
+  KnxProfiler profiler;
+  const type_profile_stats& stats = profiler.GetStats(KNX_PROFILE_RX_BYTES);
+
+  printf("--- Stage stats ---\n");
+  Check("empty stage", (stats.callsNb == 0) && (profiler.GetPercentile(KNX_PROFILE_RX_BYTES, 50) == 0));
+  profiler.Record(KNX_PROFILE_RX_BYTES, 0);    // bucket 0
+  profiler.Record(KNX_PROFILE_RX_BYTES, 3);    // bucket 2 : [2, 4)
+  profiler.Record(KNX_PROFILE_RX_BYTES, 3);
+  profiler.Record(KNX_PROFILE_RX_BYTES, 100);  // bucket 7 : [64, 128)
+  Check("calls, total and worst case", (stats.callsNb == 4) && (stats.totalTicks == 106) && (stats.maxTicks == 100));
+  Check("buckets", (stats.buckets[0] == 1) && (stats.buckets[2] == 2) && (stats.buckets[7] == 1));
+  Check("percentiles", (profiler.GetPercentile(KNX_PROFILE_RX_BYTES, 25) == 1)
+                       && (profiler.GetPercentile(KNX_PROFILE_RX_BYTES, 50) == 4)
+                       && (profiler.GetPercentile(KNX_PROFILE_RX_BYTES, 100) == 128));
+  profiler.Record(KNX_PROFILE_RX_BYTES, 0x10000000);
+  Check("last bucket", (stats.buckets[KNX_PROFILE_BUCKETS_NB - 1] == 1)
+                       && (profiler.GetPercentile(KNX_PROFILE_RX_BYTES, 100) == 0x10000000));
+  Check("other stages untouched", profiler.GetStats(KNX_PROFILE_RX_EOP).callsNb == 0);
+  profiler.RecordKnxEvent(3, KNX_PROFILE_WATCHDOG_MICROS);
+  Check("handler at the limit not flagged", (profiler.GetWatchdogAlertsNb() == 0)
+                                            && (profiler.GetWatchdogWorstObject() == 255)
+                                            && (profiler.GetStats(KNX_PROFILE_KNX_EVENTS).callsNb == 1));
+  profiler.SetWatchdogLimit(50);
+  profiler.RecordKnxEvent(3, 51);
+  Check("watchdog limit setting", (profiler.GetWatchdogAlertsNb() == 1) && (profiler.GetWatchdogWorstObject() == 3));
+  profiler.Clear();
+  Check("stats cleared", (stats.callsNb == 0) && (stats.maxTicks == 0) && (profiler.GetWatchdogAlertsNb() == 0));
+}
+
+
+int main(void)
+{
+  TpUartEmulator *emulator = new TpUartEmulator();
+  KnxTelegram telegram;
+  unsigned long taskCallsNb = 0;
+  boolean allCounted = true;
+
+  KnxSetClock(&clock_);
+  clock_.SetReadStep(1); // every time read lasts 1us, so that every profiled stage lasts
+  TestStats();
+
+  printf("--- Device on the TPUART emulator ---\n");
+  Knx.begin(new KnxTpUart(*emulator, DEVICE_ADDR, NORMAL), comObjects, 2);
+  while (Knx.checkInitBus() != KNX_DEVICE_OK) clock_.Advance(TASK_PERIOD);
+  KnxProf.Clear();
+  KnxProf.SetWatchdogCallback(&WatchdogCallback);
+  for (word n = 0; n < TELEGRAMS_NB; n++)
+  {
+    telegram.ClearTelegram();
+    telegram.SetSourceAddress(0x1200);
+    telegram.SetTargetAddress(0x0A00);
+    telegram.SetCommand(KNX_COMMAND_VALUE_WRITE);
+    telegram.SetFirstPayloadByte(n & 1);
+    telegram.UpdateChecksum();
+    emulator->InjectBusTelegram(telegram);
+    if (n == 0) Knx.write(1, (float)21.5); // a transmission too
+    for (word i = 0; i < 100; i++) { clock_.Advance(TASK_PERIOD); Knx.task(); taskCallsNb++; }
+  }
+  for (byte stage = KNX_PROFILE_TASK_INIT; stage <= KNX_PROFILE_TASK_TX; stage++)
+    if (KnxProf.GetStats((e_KnxProfileStage)stage).callsNb != taskCallsNb) allCounted = false;
+  Check("task steps counted at each call", allCounted);
+  Check("EOP handling counted per telegram", KnxProf.GetStats(KNX_PROFILE_RX_EOP).callsNb >= TELEGRAMS_NB);
+  Check("bytes parsing counted", KnxProf.GetStats(KNX_PROFILE_RX_BYTES).callsNb >= TELEGRAMS_NB);
+  Check("TX task counted", KnxProf.GetStats(KNX_PROFILE_TX_TASK).callsNb > 0);
+  Check("bus coupler events counted", KnxProf.GetStats(KNX_PROFILE_BUSCOUPLER_EVENTS).callsNb >= TELEGRAMS_NB);
+  Check("knxEvents() counted", (eventsNb == TELEGRAMS_NB)
+                               && (KnxProf.GetStats(KNX_PROFILE_KNX_EVENTS).callsNb == TELEGRAMS_NB));
+  Check("stage durations", (KnxProf.GetStats(KNX_PROFILE_TASK_RX).maxTicks >= SLOW_DURATION)
+                           && (KnxProf.GetStats(KNX_PROFILE_TASK_TX).maxTicks > 0)
+                           && (KnxProf.GetPercentile(KNX_PROFILE_RX_BYTES, 50) > 0));
+  printf("knxEvents() : max %lu us, p50 %lu us\n", KnxProf.GetStats(KNX_PROFILE_KNX_EVENTS).maxTicks,
+         KnxProf.GetPercentile(KNX_PROFILE_KNX_EVENTS, 50));
+
+  printf("--- Watchdog ---\n");
+  Check("slow handler flagged once", (KnxProf.GetWatchdogAlertsNb() == 1) && (watchdogCallsNb == 1));
+  Check("slow handler com object", (KnxProf.GetWatchdogWorstObject() == 0) && (watchdogObject == 0));
+  Check("slow handler duration", (KnxProf.GetWatchdogWorstMicros() >= SLOW_DURATION) && (watchdogDuration >= SLOW_DURATION)
+                                 && (watchdogDuration < SLOW_DURATION + 100));
+
+  Knx.end();
+  delete emulator;
+  printf("%u check(s) failed\n", errorsNb);
+  return errorsNb;
+}
+
+// EOF
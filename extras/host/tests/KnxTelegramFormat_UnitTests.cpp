@@ -0,0 +1,152 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxTelegramFormat_UnitTests.cpp
+// Author : Franck Marini
+// Description : Host tests of the allocation free telegram formatting (text and JSON)
+//               - individual and group addresses, commands, raw payload
+//               - values decoded as per the DPT : B1, U8, V16, F16, F32 (fixed and scientific notation),
+//                 character, time of day (list of fields)
+//               - no value for READ telegrams, unknown DPT or payload length mismatch
+//               - buffer too small
+//               The program returns the nb of failed checks.
+// Module dependencies : KnxTelegramFormat, KnxTelegram, KnxDPTCodec
+//
+// Build and run from the library root folder (single command line) :
+//   g++ -O2 -I extras/host -I . extras/host/tests/KnxTelegramFormat_UnitTests.cpp extras/host/ArduinoHost.cpp
+//       KnxTelegramFormat.cpp KnxTelegram.cpp KnxDPTCodec.cpp -o KnxTelegramFormat_UnitTests
+//   ./KnxTelegramFormat_UnitTests
+
+#include "KnxTelegramFormat.h"
+
+static word errorsNb;
+
+
+static void Check(const char *label, boolean result)
+{
+  printf("%s : %s\n", label, result ? "OK" : "FAILED !!");
+  if (!result) errorsNb++;
+}
+
+
+// Build a group telegram from 1.1.2 to 1/0/1
+static void BuildTelegram(KnxTelegram& telegram, e_KnxCommand command, const byte dpt[], byte dptLength,
+                          boolean shortValue)
+{
+  telegram.ClearTelegram();
+  telegram.SetSourceAddress(0x1102);
+  telegram.SetTargetAddress(0x0801);
+  telegram.SetCommand(command);
+  if (shortValue) telegram.SetFirstPayloadByte(dpt[0]);
+  else
+  {
+    telegram.SetPayloadLength(dptLength + 1);
+    telegram.SetLongPayload(dpt, dptLength);
+  }
+}
+
+
+// Format the telegram as text and JSON, and compare to the expected outputs
+static void CheckFormats(const char *label, const KnxTelegram& telegram, byte dptId, const char *expectedText,
+                         const char *expectedJson)
+{
+  char text[KNX_FORMAT_TELEGRAM_MAX_SIZE];
+  word length;
+  boolean result;
+
+  length = KnxFormatTelegramText(telegram, dptId, text, sizeof(text));
+  printf("%s\n", text);
+  result = !strcmp(text, expectedText) && (length == strlen(expectedText));
+  length = KnxFormatTelegramJson(telegram, dptId, text, sizeof(text));
+  printf("%s\n", text);
+  Check(label, result && !strcmp(text, expectedJson) && (length == strlen(expectedJson)));
+}
+
+
+int main(void)
+{
+  KnxTelegram telegram;
+  char text[KNX_FORMAT_TELEGRAM_MAX_SIZE];
+  byte dpt[4];
+  type_KnxTimeOfDay time = { 3, 14, 5, 59 };
+
+  printf("--- Addresses ---\n");
+  Check("physical address", (KnxFormatPhysicalAddress(0xF5FF, text, 16) == 8) && !strcmp(text, "15.5.255"));
+  Check("group address", (KnxFormatGroupAddress(0xFFFF, text, 16) == 8) && !strcmp(text, "31/7/255"));
+  Check("address buffer too small", (KnxFormatGroupAddress(0x0801, text, 5) == 0) && (text[0] == 0));
+
+  printf("\n--- Values ---\n");
+  dpt[0] = 1;
+  BuildTelegram(telegram, KNX_COMMAND_VALUE_WRITE, dpt, 1, true);
+  CheckFormats("B1 write", telegram, KNX_DPT_1_001, "1.1.2 > 1/0/1 VAL_WRITE 01 1",
+               "{\"src\":\"1.1.2\",\"dst\":\"1/0/1\",\"cmd\":\"write\",\"data\":\"01\",\"value\":1}");
+  dpt[0] = 200;
+  BuildTelegram(telegram, KNX_COMMAND_VALUE_RESPONSE, dpt, 1, false);
+  CheckFormats("U8 response", telegram, KNX_DPT_5_001, "1.1.2 > 1/0/1 VAL_RESP 00C8 200",
+               "{\"src\":\"1.1.2\",\"dst\":\"1/0/1\",\"cmd\":\"response\",\"data\":\"00C8\",\"value\":200}");
+  dpt[0] = 0xFF; dpt[1] = 0x9C; // -100
+  BuildTelegram(telegram, KNX_COMMAND_VALUE_WRITE, dpt, 2, false);
+  CheckFormats("V16 write", telegram, KNX_DPT_8_001, "1.1.2 > 1/0/1 VAL_WRITE 00FF9C -100",
+               "{\"src\":\"1.1.2\",\"dst\":\"1/0/1\",\"cmd\":\"write\",\"data\":\"00FF9C\",\"value\":-100}");
+  KnxDptEncodeF16(2150, dpt);
+  BuildTelegram(telegram, KNX_COMMAND_VALUE_WRITE, dpt, 2, false);
+  CheckFormats("F16 write", telegram, KNX_DPT_9_001, "1.1.2 > 1/0/1 VAL_WRITE 000C33 21.50",
+               "{\"src\":\"1.1.2\",\"dst\":\"1/0/1\",\"cmd\":\"write\",\"data\":\"000C33\",\"value\":21.50}");
+  KnxDptEncodeF32(-0.25, dpt);
+  BuildTelegram(telegram, KNX_COMMAND_VALUE_WRITE, dpt, 4, false);
+  CheckFormats("F32 write", telegram, KNX_DPT_14_000, "1.1.2 > 1/0/1 VAL_WRITE 00BE800000 -0.25",
+               "{\"src\":\"1.1.2\",\"dst\":\"1/0/1\",\"cmd\":\"write\",\"data\":\"00BE800000\",\"value\":-0.25}");
+  KnxDptEncodeF32(1.5e12, dpt);
+  BuildTelegram(telegram, KNX_COMMAND_VALUE_WRITE, dpt, 4, false);
+  KnxFormatTelegramJson(telegram, KNX_DPT_14_000, text, sizeof(text));
+  printf("%s\n", text);
+  Check("F32 scientific notation", strstr(text, "\"value\":1.50e12}") != NULL);
+  dpt[0] = '"';
+  BuildTelegram(telegram, KNX_COMMAND_VALUE_WRITE, dpt, 1, false);
+  CheckFormats("character", telegram, KNX_DPT_4_001, "1.1.2 > 1/0/1 VAL_WRITE 0022 \"\"\"",
+               "{\"src\":\"1.1.2\",\"dst\":\"1/0/1\",\"cmd\":\"write\",\"data\":\"0022\",\"value\":\"\\\"\"}");
+  KnxDptEncodeTimeOfDay(time, dpt);
+  BuildTelegram(telegram, KNX_COMMAND_VALUE_WRITE, dpt, 3, false);
+  CheckFormats("time of day", telegram, KNX_DPT_10_001, "1.1.2 > 1/0/1 VAL_WRITE 006E053B [3,14,5,59]",
+               "{\"src\":\"1.1.2\",\"dst\":\"1/0/1\",\"cmd\":\"write\",\"data\":\"006E053B\",\"value\":[3,14,5,59]}");
+
+  printf("\n--- No value ---\n");
+  dpt[0] = 0;
+  BuildTelegram(telegram, KNX_COMMAND_VALUE_READ, dpt, 0, true);
+  CheckFormats("read", telegram, KNX_DPT_9_001, "1.1.2 > 1/0/1 VAL_READ 00",
+               "{\"src\":\"1.1.2\",\"dst\":\"1/0/1\",\"cmd\":\"read\",\"data\":\"00\"}");
+  dpt[0] = 1;
+  BuildTelegram(telegram, KNX_COMMAND_VALUE_WRITE, dpt, 1, true);
+  CheckFormats("payload length mismatch", telegram, KNX_DPT_9_001, "1.1.2 > 1/0/1 VAL_WRITE 01",
+               "{\"src\":\"1.1.2\",\"dst\":\"1/0/1\",\"cmd\":\"write\",\"data\":\"01\"}");
+  telegram.SetMulticast(false);
+  telegram.SetTargetAddress(0x1105);
+  CheckFormats("unknown DPT, physical target", telegram, KNX_FORMAT_NO_DPT, "1.1.2 > 1.1.5 VAL_WRITE 01",
+               "{\"src\":\"1.1.2\",\"dst\":\"1.1.5\",\"cmd\":\"write\",\"data\":\"01\"}");
+
+  printf("\n--- Buffer size ---\n");
+  Check("exact size", KnxFormatTelegramText(telegram, KNX_FORMAT_NO_DPT, text, 27) == 26);
+  Check("too small", (KnxFormatTelegramText(telegram, KNX_FORMAT_NO_DPT, text, 26) == 0) && (text[0] == 0));
+  Check("no buffer", KnxFormatTelegramJson(telegram, KNX_FORMAT_NO_DPT, text, 0) == 0);
+
+  printf("\n%u failed check(s)\n", errorsNb);
+  return errorsNb;
+}
+
+// EOF
@@ -0,0 +1,213 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxTpUart_EmulatorTests.cpp
+// Author : Franck Marini
+// Description : Host tests of the TPUART driver against the TPUART emulator (no TPUART hardware needed, virtual time)
+//               - reset handshake, physical address setting and state indication
+//               - reception of addressed/not addressed telegrams with ACK info sent within 1,7ms
+//               - ACK deadline missed when the RX task period is too long
+//               - telegram sending : frame on the bus, own telegram echo ignored, data confirm success/failed
+//               - TPUART reset indication while running
+//               The program returns the nb of failed checks.
+// Module dependencies : KnxTpUart, TpUartEmulator
+//
+// Build and run from the library root folder (single command line) :
+//   g++ -O2 -I extras/host -I . extras/host/tests/KnxTpUart_EmulatorTests.cpp extras/host/TpUartEmulator.cpp
+//       extras/host/ArduinoHost.cpp KnxTpUart.cpp KnxTelegram.cpp KnxClock.cpp KnxGroupStats.cpp KnxBusHealth.cpp
+//       KnxComObject.cpp KnxComObjectTable.cpp -o KnxTpUart_EmulatorTests
+//   ./KnxTpUart_EmulatorTests
+
+#include "TpUartEmulator.h"
+#include "KnxTpUart.h"
+
+#define PHYSICAL_ADDR   0x1101
+#define RX_TASK_PERIOD  400 // us
+#define TX_TASK_PERIOD  800 // us
+#define TASK_STEP       50  // us, time step of RunTasks() (the task periods are multiples of it)
+
+static word errorsNb;
+static KnxVirtualClock clock_(1000);
+
+static KnxComObject switchObject(0x0801, KNX_DPT_1_001, COM_OBJ_LOGIC_IN);
+static KnxComObject valueObject(0x0802, KNX_DPT_9_001, COM_OBJ_LOGIC_IN);
+static KnxComObject* comObjects[] = { &switchObject, &valueObject };
+static word receivedNb, receptionErrorsNb, resetEventsNb, stateEventsNb, acks[4];
+
+static void EventCallback(e_KnxBusCouplerEvent event)
+{
+  switch (event)
+  {
+    case BUSCOUPLER_EVENT_RECEIVED_EIB_TELEGRAM : receivedNb++; break;
+    case BUSCOUPLER_EVENT_EIB_TELEGRAM_RECEPTION_ERROR : receptionErrorsNb++; break;
+    case BUSCOUPLER_EVENT_RESET : resetEventsNb++; break;
+    case BUSCOUPLER_EVENT_STATE_INDICATION : stateEventsNb++; break;
+    default : break;
+  }
+}
+
+static void AckCallback(e_BusCouplerTxAck value) { acks[value]++; }
+
+
+static void Check(const char *label, boolean result)
+{
+  printf("%s : %s\n", label, result ? "OK" : "FAILED !!");
+  if (!result) errorsNb++;
+}
+
+
+// Run the driver tasks during the given duration, both tasks are called first at the current time
+static void RunTasks(KnxTpUart& tpuart, unsigned long durationMicros, unsigned long rxPeriod = RX_TASK_PERIOD)
+{
+  type_buscoupler_rx_telegram rxTelegram;
+
+  for (unsigned long t = 0; t < durationMicros; t += TASK_STEP)
+  {
+    if (!(t % rxPeriod))
+    {
+      tpuart.RXTask();
+      while (tpuart.PopReceivedTelegram(rxTelegram));
+    }
+    if (!(t % TX_TASK_PERIOD)) tpuart.TXTask();
+    clock_.Advance(TASK_STEP);
+  }
+}
+
+
+static void ClearCounters(void)
+{
+  receivedNb = receptionErrorsNb = resetEventsNb = 0;
+  memset(acks, 0, sizeof(acks));
+}
+
+
+// Reset the TPUART and init the driver (same sequence as KnxDevice), return KNX_BUSCOUPLER_OK on success
+static byte ResetAndInit(KnxTpUart& tpuart)
+{
+  unsigned long startTime = KnxMillis();
+  byte result;
+
+  // NB : a reset request is sent again only 1s after the previous one
+  while (((result = tpuart.Reset()) != KNX_BUSCOUPLER_OK) && (KnxMillis() - startTime < 1500)) clock_.Advance(100);
+  if (result != KNX_BUSCOUPLER_OK) return result;
+  tpuart.AttachComObjectsList(comObjects, 2);
+  tpuart.SetEvtCallback(&EventCallback);
+  tpuart.SetAckCallback(&AckCallback);
+  return tpuart.Init();
+}
+
+
+static void BuildTelegram(KnxTelegram& telegram, word targetAddr, byte value)
+{
+  telegram.ClearTelegram();
+  telegram.SetSourceAddress(0x1102);
+  telegram.SetTargetAddress(targetAddr);
+  telegram.SetCommand(KNX_COMMAND_VALUE_WRITE);
+  telegram.SetFirstPayloadByte(value & 1);
+  telegram.UpdateChecksum();
+}
+
+
+int main(void)
+{
+  TpUartEmulator emulator;
+  KnxTpUart tpuart(emulator, PHYSICAL_ADDR, NORMAL);
+  KnxTelegram telegram, sent;
+  byte frame[KNX_TELEGRAM_MAX_SIZE], length;
+  byte rxOkNb, acksOkNb, lateAcksNb;
+  word targetAddr, busFramesNb;
+  boolean result;
+
+  KnxSetClock(&clock_);
+
+  // === Reset handshake and init ===
+  Check("reset and init completed", ResetAndInit(tpuart) == KNX_BUSCOUPLER_OK);
+  Check("reset request received", emulator.GetResetRequestsNb() == 1);
+  Check("UART at 19200 baud", emulator.GetBaudRate() == 19200);
+  RunTasks(tpuart, 5000);
+  Check("physical address set", emulator.GetPhysicalAddr() == PHYSICAL_ADDR);
+  Check("state indication received", (emulator.GetStateRequestsNb() == 1) && (stateEventsNb == 1));
+
+  // === Reception with 400us RX task period ===
+  rxOkNb = acksOkNb = lateAcksNb = 0;
+  for (byte i = 0; i < 10; i++)
+  {
+    targetAddr = (i % 3 == 2) ? 0x0901 : 0x0801 + (i % 2);
+    emulator.ClearAckRecords();
+    ClearCounters();
+    BuildTelegram(telegram, targetAddr, i);
+    emulator.InjectBusTelegram(telegram);
+    RunTasks(tpuart, 25000);
+    if ((receivedNb == ((targetAddr == 0x0901) ? 0 : 1)) && (receptionErrorsNb == 0)) rxOkNb++;
+    if ((emulator.GetAckRecordsNb() == 1) && (emulator.GetUnexpectedAcksNb() == 0) && (emulator.GetAckRecord(0).ackService
+        == ((targetAddr == 0x0901) ? TPUART_RX_ACK_SERVICE_NOT_ADDRESSED : TPUART_RX_ACK_SERVICE_ADDRESSED))) acksOkNb++;
+    lateAcksNb += emulator.GetLateAcksNb() + emulator.GetMissedAcksNb();
+  }
+  Check("addressed telegrams received, others ignored", rxOkNb == 10);
+  Check("ACK info addressed/not addressed sent for every telegram", acksOkNb == 10);
+  Check("ACK info within 1,7ms", lateAcksNb == 0);
+
+  // === Reception with a too long RX task period ===
+  // the RX task is called just before the address type octet is available, and then 1,95ms later
+  emulator.ClearAckRecords();
+  ClearCounters();
+  BuildTelegram(telegram, 0x0801, 1);
+  emulator.InjectBusTelegram(telegram);
+  clock_.Advance(emulator.GetAckRecord(0).addrTypeRxMicros - KnxMicros() - 20);
+  RunTasks(tpuart, 30000, 1950);
+  Check("late ACK info detected", (emulator.GetLateAcksNb() == 1) && (emulator.GetMissedAcksNb() == 0));
+  Check("telegram received", (receivedNb == 1) && (receptionErrorsNb == 0));
+
+  // === Sending ===
+  emulator.ClearAckRecords();
+  ClearCounters();
+  busFramesNb = emulator.GetBusFramesNb();
+  BuildTelegram(telegram, 0x0803, 1);
+  telegram.Copy(sent);
+  result = (tpuart.SendTelegram(sent) == KNX_BUSCOUPLER_OK);
+  RunTasks(tpuart, 60000);
+  Check("telegram accepted", result);
+  length = emulator.GetBusFrame(busFramesNb, frame);
+  result = (emulator.GetBusFramesNb() == busFramesNb + 1) && (length == sent.GetTelegramLength());
+  for (byte i = 0; result && (i < length); i++) if (frame[i] != sent.ReadRawByte(i)) result = false;
+  Check("frame sent on the bus with own source address", result && (sent.GetSourceAddress() == PHYSICAL_ADDR));
+  Check("data confirm success", (acks[ACK_RESPONSE] == 1) && (acks[NACK_RESPONSE] == 0));
+  Check("own telegram echo ignored", (receivedNb == 0) && (receptionErrorsNb == 0) && (emulator.GetUnexpectedAcksNb() == 0));
+  Check("no protocol error", emulator.GetProtocolErrorsNb() == 0);
+
+  emulator.SetBusAcknowledge(false);
+  ClearCounters();
+  result = (tpuart.SendTelegram(sent) == KNX_BUSCOUPLER_OK);
+  RunTasks(tpuart, 150000);
+  Check("telegram accepted", result);
+  Check("data confirm failed after repetitions", (acks[NACK_RESPONSE] == 1) && (acks[NO_ANSWER_TIMEOUT] == 0));
+  emulator.SetBusAcknowledge(true);
+
+  // === TPUART reset while running ===
+  ClearCounters();
+  emulator.SimulateReset();
+  RunTasks(tpuart, 5000);
+  Check("reset indication notified", resetEventsNb == 1);
+
+  printf("\n%u error(s)\n", errorsNb);
+  return errorsNb;
+}
+
+// EOF
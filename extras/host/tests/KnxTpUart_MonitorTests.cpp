@@ -0,0 +1,219 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+// File : KnxTpUart_MonitorTests.cpp
+// Author : Franck Marini
+// Description : Host tests of the TPUART bus monitor frames against the TPUART emulator (virtual time)
+//               - bus monitor activation, frames assembled by the RX task with start time and status (valid,
+//                 checksum, bus acknowledge), wrong checksum and wrong length frames
+//               - fully loaded bus drained in batches, frames lost when the ring is not drained
+//               - lock-free ring with the producer and the consumer in 2 threads
+//               The program returns the nb of failed checks.
+// Module dependencies : KnxTpUart, TpUartEmulator, KnxClock, SpscRingBuffer
+//
+// Build and run from the library root folder (single command line) :
+//   g++ -O2 -pthread -I extras/host -I . extras/host/tests/KnxTpUart_MonitorTests.cpp extras/host/TpUartEmulator.cpp
+//       extras/host/ArduinoHost.cpp KnxTpUart.cpp KnxTelegram.cpp KnxClock.cpp KnxGroupStats.cpp KnxBusHealth.cpp
+//       KnxComObject.cpp KnxComObjectTable.cpp -o KnxTpUart_MonitorTests
+//   ./KnxTpUart_MonitorTests
+
+#include "TpUartEmulator.h"
+#include "KnxTpUart.h"
+#include <pthread.h>
+#include <sched.h>
+
+#define PHYSICAL_ADDR   0x1101
+#define RX_TASK_PERIOD  400 // us
+#define FRAME_RX_DELAY  (TPUARTEMU_BUS_CHAR_TIME + TPUARTEMU_UART_CHAR_TIME) // bus start to driver availability
+#define THREAD_ITEMS_NB 1000000UL
+
+static word errorsNb;
+static KnxVirtualClock clock_(1000);
+static SpscRingBuffer<unsigned long, 64> threadRing;
+
+
+static void Check(const char *label, boolean result)
+{
+  printf("%s : %s\n", label, result ? "OK" : "FAILED !!");
+  if (!result) errorsNb++;
+}
+
+
+static void RunRxTask(KnxTpUart& tpuart, unsigned long durationMicros)
+{
+  for (unsigned long t = 0; t < durationMicros; t += RX_TASK_PERIOD)
+  {
+    clock_.Advance(RX_TASK_PERIOD);
+    tpuart.RXTask();
+  }
+}
+
+
+static void BuildFrame(byte frame[], byte payloadLength, byte n)
+{
+  KnxTelegram telegram;
+  byte payload[KNX_TELEGRAM_PAYLOAD_MAX_SIZE];
+
+  telegram.SetSourceAddress(0x1102);
+  telegram.SetTargetAddress(0x0800 + n);
+  telegram.SetCommand(KNX_COMMAND_VALUE_WRITE);
+  telegram.SetPayloadLength(payloadLength);
+  for (byte i = 0; i < sizeof(payload); i++) payload[i] = n + i;
+  if (payloadLength > 1) telegram.SetLongPayload(payload, payloadLength - 1);
+  telegram.UpdateChecksum();
+  for (byte i = 0; i < telegram.GetTelegramLength(); i++) frame[i] = telegram.ReadRawByte(i);
+}
+
+
+static boolean SameTime(unsigned long a, unsigned long b) { return (long)(a - b) <= RX_TASK_PERIOD && (long)(b - a) <= RX_TASK_PERIOD; }
+
+
+// Consumer thread : the values shall come in sequence
+static void *ConsumerThread(void *result)
+{
+  unsigned long values[16], expected = 0;
+  word nb;
+
+  while (expected < THREAD_ITEMS_NB)
+  {
+    nb = threadRing.PopBatch(values, 16);
+    if (!nb) sched_yield(); // empty ring, let the producer run (single core hosts)
+    for (word i = 0; i < nb; i++) if (values[i] != expected++) { *(boolean *)result = false; return NULL; }
+  }
+  *(boolean *)result = true;
+  return NULL;
+}
+
+
+int main(void)
+{
+  TpUartEmulator emulator;
+  KnxTpUart tpuart(emulator, PHYSICAL_ADDR, BUS_MONITOR);
+  KnxTpUart normalTpuart(emulator, PHYSICAL_ADDR, NORMAL);
+  type_MonitorFrame frames[32];
+  byte frame[KNX_TELEGRAM_MAX_SIZE];
+  unsigned long startTimes[4], injectionTimes[300], framesNb, validNb, entriesNb, drainsNb;
+  word nb, attempts;
+  boolean result;
+  pthread_t consumer;
+
+  KnxSetClock(&clock_);
+
+  printf("--- Bus monitor activation ---\n");
+  for (attempts = 0; (tpuart.Reset() != KNX_BUSCOUPLER_OK) && (attempts < 100); attempts++) clock_.Advance(100);
+  Check("reset", attempts < 100);
+  Check("init", tpuart.Init() == KNX_BUSCOUPLER_OK);
+  RunRxTask(tpuart, 2000);
+  Check("bus monitor activated", emulator.IsBusMonitor());
+  Check("no frame", tpuart.GetMonitoringFrames(frames, 32) == 0);
+  Check("no frame in normal mode", normalTpuart.GetMonitoringFrames(frames, 32) == 0);
+
+  printf("\n--- Frames ---\n");
+  BuildFrame(frame, 2, 1);
+  startTimes[0] = emulator.GetBusFreeMicros() > KnxMicros() ? emulator.GetBusFreeMicros() : KnxMicros();
+  emulator.InjectBusFrame(frame, 10);
+  startTimes[1] = emulator.GetBusFreeMicros();
+  frame[9] ^= 0x01; // wrong checksum
+  emulator.InjectBusFrame(frame, 10);
+  startTimes[2] = emulator.GetBusFreeMicros();
+  emulator.InjectBusFrame(frame, 7); // incomplete frame
+  emulator.SetBusAcknowledge(false);
+  startTimes[3] = emulator.GetBusFreeMicros();
+  BuildFrame(frame, 15, 2);
+  emulator.InjectBusFrame(frame, 23); // no acknowledge
+  emulator.SetBusAcknowledge(true);
+  RunRxTask(tpuart, 200000);
+  nb = tpuart.GetMonitoringFrames(frames, 32);
+  Check("frames and acknowledges assembled", nb == 7);
+  Check("valid frame", (frames[0].length == 10) && (frames[0].status == (KNX_MONITOR_FRAME_VALID | KNX_MONITOR_FRAME_CHECKSUM_OK))
+        && (frames[0].data[4] == 0x01));
+  Check("bus acknowledge", (frames[1].length == 1) && (frames[1].data[0] == EIB_ACK_FRAME) && (frames[1].status == KNX_MONITOR_FRAME_ACK));
+  Check("wrong checksum", (frames[2].length == 10) && (frames[2].status == KNX_MONITOR_FRAME_VALID));
+  Check("wrong length", (frames[4].length == 7) && !(frames[4].status & KNX_MONITOR_FRAME_VALID));
+  Check("max length frame", (frames[6].length == 23) && (frames[6].status == (KNX_MONITOR_FRAME_VALID | KNX_MONITOR_FRAME_CHECKSUM_OK)));
+  Check("start times", SameTime(frames[0].startTimeMicros, startTimes[0] + FRAME_RX_DELAY)
+        && SameTime(frames[2].startTimeMicros, startTimes[1] + FRAME_RX_DELAY)
+        && SameTime(frames[4].startTimeMicros, startTimes[2] + FRAME_RX_DELAY)
+        && SameTime(frames[6].startTimeMicros, startTimes[3] + FRAME_RX_DELAY));
+  Check("drained", tpuart.GetMonitoringFrames(frames, 32) == 0);
+
+  printf("\n--- Fully loaded bus ---\n");
+  // back to back max length frames during 10s, drained every 100ms
+  framesNb = validNb = entriesNb = drainsNb = 0;
+  result = true;
+  for (unsigned long t = 0; t < 10000000; t += RX_TASK_PERIOD)
+  {
+    if ((long)(KnxMicros() - emulator.GetBusFreeMicros()) >= 0)
+    {
+      injectionTimes[framesNb] = KnxMicros();
+      BuildFrame(frame, 15, framesNb++);
+      emulator.InjectBusFrame(frame, 23);
+    }
+    clock_.Advance(RX_TASK_PERIOD);
+    tpuart.RXTask();
+    if (t % 100000 == 0)
+    {
+      nb = tpuart.GetMonitoringFrames(frames, 32);
+      drainsNb++;
+      for (word i = 0; i < nb; i++)
+      {
+        if (frames[i].length == 1) continue;
+        if ((frames[i].status != (KNX_MONITOR_FRAME_VALID | KNX_MONITOR_FRAME_CHECKSUM_OK))
+            || !SameTime(frames[i].startTimeMicros, injectionTimes[validNb] + FRAME_RX_DELAY)) result = false;
+        validNb++;
+      }
+      entriesNb += nb;
+    }
+  }
+  RunRxTask(tpuart, 100000);
+  entriesNb += tpuart.GetMonitoringFrames(frames, 32);
+  printf("%lu frames, %lu frames and acknowledges got in %lu calls\n", framesNb, entriesNb, drainsNb + 1);
+  Check("all frames and acknowledges got", (entriesNb == 2 * framesNb) && (tpuart.GetMonitoringOverflowsNb() == 0));
+  Check("frames status and start times", result);
+
+  printf("\n--- Ring full ---\n");
+  for (byte i = 0; i < 20; i++)
+  {
+    BuildFrame(frame, 1, i);
+    emulator.InjectBusFrame(frame, 9);
+  }
+  RunRxTask(tpuart, 2000000);
+  nb = tpuart.GetMonitoringFrames(frames, 32);
+  Check("ring size kept", nb == KNXTPUART_MONITOR_RING_SIZE);
+  Check("lost frames counted", tpuart.GetMonitoringOverflowsNb() == 40 - KNXTPUART_MONITOR_RING_SIZE);
+  Check("oldest frames kept", (frames[0].data[4] == 0) && (frames[2].data[4] == 1));
+
+  printf("\n--- Lock-free ring with 2 threads ---\n");
+  result = false;
+  pthread_create(&consumer, NULL, &ConsumerThread, &result);
+  for (unsigned long i = 0; i < THREAD_ITEMS_NB; )
+  {
+    if (threadRing.Push(i)) i++;
+    else sched_yield(); // full ring
+  }
+  pthread_join(consumer, NULL);
+  Check("values received in sequence", result);
+
+  KnxSetClock(NULL);
+  printf("\n%u error(s)\n", errorsNb);
+  return errorsNb;
+}
+
+// EOF
@@ -0,0 +1,142 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxTpUart_TxBurstTests.cpp
+// Author : Franck Marini
+// Description : Host tests of the burst transmission of the TPUART driver (TPUART emulator, virtual time)
+//               A max sized telegram is sent with a slow TX task, and an addressed frame is injected on the bus
+//               at various times of the burst :
+//               - the ACK info of the injected frame is sent within 1,7ms
+//               - the sent telegram reaches the bus unchanged and is confirmed
+//               The program returns the nb of failed checks.
+// Module dependencies : KnxTpUart, TpUartEmulator, KnxClock
+//
+// Build and run from the library root folder (single command line) :
+//   g++ -O2 -DKNXTPUART_TX_BURST -I extras/host -I . extras/host/tests/KnxTpUart_TxBurstTests.cpp
+//       extras/host/TpUartEmulator.cpp extras/host/ArduinoHost.cpp KnxTpUart.cpp KnxTelegram.cpp KnxClock.cpp
+//       KnxGroupStats.cpp KnxBusHealth.cpp KnxComObject.cpp KnxComObjectTable.cpp -o KnxTpUart_TxBurstTests
+//   ./KnxTpUart_TxBurstTests
+
+#include "TpUartEmulator.h"
+#include "KnxTpUart.h"
+
+#define PHYSICAL_ADDR   0x1101
+#define RX_TASK_PERIOD  400 // us
+#define INJECTION_STEP  250 // us
+
+static const word txTaskPeriods[] = { 800, 2000, 5000 };
+
+static word errorsNb;
+static KnxVirtualClock clock_(1000);
+static TpUartEmulator *emulator;
+static KnxTpUart *tpuart;
+
+static KnxComObject switchObject(0x0801, KNX_DPT_1_001, COM_OBJ_LOGIC_IN);
+static KnxComObject* comObjects[] = { &switchObject };
+static word receivedNb, acks[4];
+
+static void EventCallback(e_KnxBusCouplerEvent event) { if (event == BUSCOUPLER_EVENT_RECEIVED_EIB_TELEGRAM) receivedNb++; }
+
+static void AckCallback(e_BusCouplerTxAck value) { acks[value]++; }
+
+
+static void Check(const char *label, boolean result)
+{
+  printf("%s : %s\n", label, result ? "OK" : "FAILED !!");
+  if (!result) errorsNb++;
+}
+
+
+// Run the driver tasks during the given duration
+static void RunTasks(unsigned long durationMicros, word txPeriod)
+{
+  type_buscoupler_rx_telegram rxTelegram;
+
+  for (unsigned long t = 0; t < durationMicros; t += RX_TASK_PERIOD / 4)
+  {
+    clock_.Advance(RX_TASK_PERIOD / 4);
+    if (!(t % RX_TASK_PERIOD)) { tpuart->RXTask(); while (tpuart->PopReceivedTelegram(rxTelegram)); }
+    if (!(t % txPeriod)) tpuart->TXTask();
+  }
+}
+
+
+int main(void)
+{
+  KnxTelegram sent, injected;
+  byte payload[KNX_TELEGRAM_PAYLOAD_MAX_SIZE - 2], frame[KNX_TELEGRAM_MAX_SIZE], length, i;
+  word framesNb, unchangedNb, lateNb, missedNb, checksNb;
+
+  KnxSetClock(&clock_);
+  emulator = new TpUartEmulator();
+  tpuart = new KnxTpUart(*emulator, PHYSICAL_ADDR, NORMAL);
+  while (tpuart->Reset() != KNX_BUSCOUPLER_OK) clock_.Advance(RX_TASK_PERIOD);
+  tpuart->AttachComObjectsList(comObjects, 1);
+  tpuart->SetEvtCallback(&EventCallback);
+  tpuart->SetAckCallback(&AckCallback);
+  tpuart->Init();
+  RunTasks(50000, 800);
+
+  for (i = 0; i < sizeof(payload); i++) payload[i] = 0xA0 + i;
+  sent.SetTargetAddress(0x0901);
+  sent.SetCommand(KNX_COMMAND_VALUE_WRITE);
+  sent.SetPayloadLength(sizeof(payload) + 1);
+  sent.SetLongPayload(payload, sizeof(payload));
+  sent.UpdateChecksum();
+  injected.SetSourceAddress(0x1102);
+  injected.SetTargetAddress(0x0801);
+  injected.SetCommand(KNX_COMMAND_VALUE_WRITE);
+  injected.SetFirstPayloadByte(1);
+  injected.UpdateChecksum();
+
+  for (byte p = 0; p < sizeof(txTaskPeriods) / sizeof(txTaskPeriods[0]); p++)
+  {
+    printf("--- TX task period %u us ---\n", txTaskPeriods[p]);
+    receivedNb = 0; memset(acks, 0, sizeof(acks));
+    lateNb = missedNb = unchangedNb = checksNb = 0;
+    // the frame is injected from the telegram sending start to the end of the TX burst
+    for (word delay = 0; delay < KNX_TELEGRAM_MAX_SIZE * KNXTPUART_CHAR_PAIR_MICROS; delay += INJECTION_STEP)
+    {
+      emulator->ClearAckRecords();
+      framesNb = emulator->GetBusFramesNb();
+      tpuart->SendTelegram(sent);
+      RunTasks(delay, txTaskPeriods[p]);
+      emulator->InjectBusTelegram(injected);
+      RunTasks(200000, txTaskPeriods[p]);
+      lateNb += emulator->GetLateAcksNb();
+      missedNb += emulator->GetMissedAcksNb() + (emulator->GetAckRecordsNb() != 1);
+      for (word f = framesNb; f < emulator->GetBusFramesNb(); f++)
+      {
+        length = emulator->GetBusFrame(f, frame);
+        for (i = 1; (i < length) && (frame[i] == sent.ReadRawByte(i)); i++);
+        if ((length == sent.GetTelegramLength()) && (i == length)) unchangedNb++; // control field (repeat) not checked
+      }
+      checksNb++;
+    }
+    Check("ACK info sent in time", !lateNb && !missedNb);
+    Check("injected frames received", receivedNb == checksNb);
+    Check("telegrams sent unchanged", unchangedNb == checksNb);
+    Check("telegrams confirmed", acks[ACK_RESPONSE] == checksNb);
+  }
+
+  printf("\n%u failed check(s)\n", errorsNb);
+  return errorsNb;
+}
+
+// EOF
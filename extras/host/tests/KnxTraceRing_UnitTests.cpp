@@ -0,0 +1,173 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxTraceRing_UnitTests.cpp
+// Author : Franck Marini
+// Description : Host tests of the binary trace ring (TPUART emulator, virtual time)
+//               - entries recorded with their time stamp and arguments, formatted on demand
+//               - ring full : oldest entries overwritten and counted as lost, text truncation
+//               - traces of the TPUART driver (reset, attach, init, state indication, destructor) and of the device
+//               The program returns the nb of failed checks.
+// Module dependencies : KnxTraceRing, KnxTpUart, KnxDevice, TpUartEmulator, KnxClock
+//
+// Build and run from the library root folder (single command line) :
+//   g++ -O2 -DKNXTPUART_DEBUG_INFO -DKNXTPUART_DEBUG_ERROR -DKNXDEVICE_DEBUG_INFO -I extras/host -I .
+//       extras/host/tests/KnxTraceRing_UnitTests.cpp extras/host/TpUartEmulator.cpp extras/host/ArduinoHost.cpp
+//       KnxTraceRing.cpp KnxDevice.cpp KnxTpUart.cpp KnxTelegram.cpp KnxClock.cpp KnxGroupStats.cpp KnxBusHealth.cpp
+//       KnxTxLatency.cpp KnxComObject.cpp KnxComObjectTable.cpp KnxDPTCodec.cpp
+//       StKnxCoupler.cpp -o KnxTraceRing_UnitTests
+//   ./KnxTraceRing_UnitTests
+
+#include "TpUartEmulator.h"
+#include "KnxTpUart.h"
+#include "KnxDevice.h"
+
+#define PHYSICAL_ADDR   0x1101
+#define RX_TASK_PERIOD  400 // us
+
+static word errorsNb;
+static KnxVirtualClock clock_(1000000);
+
+static KnxComObject switchObject(0x0801, KNX_DPT_1_001, COM_OBJ_LOGIC_IN);
+static KnxComObject* comObjects[] = { &switchObject };
+
+void knxEvents(byte index) {}
+
+static void EventCallback(e_KnxBusCouplerEvent) {}
+static void AckCallback(e_BusCouplerTxAck) {}
+
+
+static void Check(const char *label, boolean result)
+{
+  printf("%s : %s\n", label, result ? "OK" : "FAILED !!");
+  if (!result) errorsNb++;
+}
+
+
+static void RunTasks(KnxTpUart& tpuart, unsigned long durationMicros)
+{
+  for (unsigned long t = 0; t < durationMicros; t += RX_TASK_PERIOD)
+  {
+    clock_.Advance(RX_TASK_PERIOD);
+    tpuart.RXTask();
+    if ((t / RX_TASK_PERIOD) & 1) tpuart.TXTask(); // every 800us
+  }
+}
+
+
+// Pop the entries till the expected event, return false if not found
+static boolean FindEvent(KnxTraceRing& ring, e_KnxTraceEvent event, type_trace_entry& entry)
+{
+  while (ring.Pop(entry)) if (entry.event == event) return true;
+  return false;
+}
+
+
+int main(void)
+{
+  KnxTraceRing ring;
+  type_trace_entry entry;
+  char text[KNX_TRACE_TEXT_MAX_SIZE];
+  byte length;
+  word attempts;
+
+  KnxSetClock(&clock_);
+
+  printf("--- Record and format ---\n");
+  ring.Record(KNX_TRACE_DEVICE_WRITE_REQ, 3, 0x1102);
+  clock_.Advance(250);
+  ring.Record(KNX_TRACE_COUPLER_INIT_NORMAL);
+  Check("entries nb", (ring.GetEntriesNb() == 2) && (ring.GetLostEntriesNb() == 0));
+  Check("first entry", ring.Pop(entry) && (entry.event == KNX_TRACE_DEVICE_WRITE_REQ) && (entry.timeMicros == 1000000)
+        && (entry.args[0] == 3) && (entry.args[1] == 0x1102));
+  length = KnxTraceRing::Format(entry, text, sizeof(text));
+  printf("%s\n", text);
+  Check("formatted entry", !strcmp(text, "1000000 KNXDEVICE INFO: WRITE req., com object 3 from 1102")
+        && (length == strlen(text)));
+  Check("second entry time", ring.Pop(entry) && (entry.timeMicros == 1000250));
+  Check("empty ring", !ring.Pop(entry) && (ring.GetEntriesNb() == 0));
+  length = KnxTraceRing::Format(entry, text, 12);
+  Check("truncated text", (length == 11) && (strlen(text) == 11));
+  entry.event = KNX_TRACE_EVENTS_NB;
+  KnxTraceRing::Format(entry, text, sizeof(text));
+  Check("unknown event", strstr(text, "unknown event") != NULL);
+
+  printf("\n--- Ring full ---\n");
+  for (word i = 0; i < KNX_TRACE_RING_SIZE + 5; i++) ring.Record(KNX_TRACE_COUPLER_UNKNOWN_BYTE, i);
+  Check("lost entries", (ring.GetEntriesNb() == KNX_TRACE_RING_SIZE) && (ring.GetLostEntriesNb() == 5));
+  Check("oldest entries overwritten", ring.Pop(entry) && (entry.args[0] == 5));
+  Check("dump", (ring.Dump(Serial) == KNX_TRACE_RING_SIZE - 1) && (ring.GetLostEntriesNb() == 0)
+        && (ring.GetEntriesNb() == 0));
+  ring.Record(KNX_TRACE_COUPLER_CLOSED);
+  ring.Clear();
+  Check("clear", ring.GetEntriesNb() == 0);
+
+  printf("\n--- TPUART driver traces ---\n");
+  {
+    TpUartEmulator emulator;
+    KnxTpUart tpuart(emulator, PHYSICAL_ADDR, NORMAL);
+
+    tpuart.SetTraceRing(&ring);
+    for (attempts = 0; (tpuart.Reset() != KNX_BUSCOUPLER_OK) && (attempts < 100); attempts++) clock_.Advance(100);
+    Check("reset traced", FindEvent(ring, KNX_TRACE_COUPLER_RESET_OK, entry));
+    ring.Clear();
+    tpuart.AttachComObjectsList(comObjects, 1);
+    tpuart.SetEvtCallback(&EventCallback);
+    tpuart.SetAckCallback(&AckCallback);
+    Check("attach traced", ring.Pop(entry) && (entry.event == KNX_TRACE_COUPLER_ATTACH_OK) && (entry.args[0] == 1));
+    tpuart.Init();
+    Check("init traced", ring.Pop(entry) && (entry.event == KNX_TRACE_COUPLER_INIT_NORMAL));
+    emulator.SetStateFlags(TPUART_STATE_INDICATION_TEMP_WARNING_MASK);
+    tpuart.DEBUG_SendStateReqCommand();
+    RunTasks(tpuart, 10000);
+    Check("state indication traced", FindEvent(ring, KNX_TRACE_COUPLER_STATE_INDICATION, entry)
+          && ((entry.args[0] & ~TPUART_STATE_INDICATION_TEMP_WARNING_MASK) == TPUART_STATE_INDICATION));
+    ring.Dump(Serial);
+  }
+  Check("destructor traced", ring.Pop(entry) && ((entry.event == KNX_TRACE_COUPLER_CLOSED)
+        || (entry.event == KNX_TRACE_COUPLER_DESTROYED)));
+
+  printf("\n--- Device traces ---\n");
+  {
+    TpUartEmulator *emulator = new TpUartEmulator();
+    KnxTelegram telegram;
+
+    Knx.SetTraceRing(&ring);
+    Check("no bus coupler traced", (Knx.checkInitBus() == KNX_DEVICE_ERROR) && ring.Pop(entry)
+          && (entry.event == KNX_TRACE_DEVICE_NO_BUS_COUPLER));
+    Knx.begin(new KnxTpUart(*emulator, PHYSICAL_ADDR, NORMAL), comObjects, 1);
+    while (Knx.checkInitBus() != KNX_DEVICE_OK) clock_.Advance(RX_TASK_PERIOD);
+    Check("device init traced", FindEvent(ring, KNX_TRACE_DEVICE_INIT_OK, entry));
+    telegram.SetSourceAddress(0x1102);
+    telegram.SetTargetAddress(0x0801);
+    telegram.SetCommand(KNX_COMMAND_VALUE_WRITE);
+    telegram.SetFirstPayloadByte(1);
+    telegram.UpdateChecksum();
+    emulator->InjectBusTelegram(telegram);
+    for (word i = 0; i < 250; i++) { clock_.Advance(RX_TASK_PERIOD); Knx.task(); }
+    Check("write request traced", FindEvent(ring, KNX_TRACE_DEVICE_WRITE_REQ, entry) && (entry.args[0] == 0)
+          && (entry.args[1] == 0x1102));
+    Knx.SetTraceRing(NULL);
+  }
+
+  printf("\n%u failed check(s)\n", errorsNb);
+  return errorsNb;
+}
+
+// EOF
@@ -0,0 +1,176 @@
+//    This file is part of Arduino Knx Bus Device library.
+
+//    The Arduino Knx Bus Device library allows to turn Arduino into "self-made" KNX bus device.
+//    Copyright (C) 2014 2015 2016 Franck MARINI (fm@liwan.fr)
+
+//    The Arduino Knx Bus Device library is free software: you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation, either version 3 of the License, or
+//    (at your option) any later version.
+
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+
+//    You should have received a copy of the GNU General Public License
+//    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// File : KnxTxLatency_UnitTests.cpp
+// Author : Franck Marini
+// Description : Host tests of the TX latency histograms (TPUART emulator, virtual time)
+//               - histogram buckets, percentiles and bucket limits
+//               - KnxDevice writes : counted per priority and per com object, plausible stage latencies
+//               - telegrams built by the application counted with their own priority and no com object
+//               - not acknowledged transmissions not counted, histograms reset
+//               The program returns the nb of failed checks.
+// Module dependencies : KnxTxLatency, KnxDevice, KnxTpUart, TpUartEmulator, KnxClock
+//
+// Build and run from the library root folder (single command line) :
+//   g++ -O2 -DKNXDEVICE_TX_LATENCY -I extras/host -I . extras/host/tests/KnxTxLatency_UnitTests.cpp
+//       extras/host/TpUartEmulator.cpp extras/host/ArduinoHost.cpp KnxDevice.cpp KnxTpUart.cpp KnxTelegram.cpp
+//       KnxClock.cpp KnxGroupStats.cpp KnxBusHealth.cpp KnxComObject.cpp KnxComObjectTable.cpp KnxDPTCodec.cpp
+//       StKnxCoupler.cpp KnxTxLatency.cpp -o KnxTxLatency_UnitTests
+//   ./KnxTxLatency_UnitTests
+
+#include "TpUartEmulator.h"
+#include "KnxDevice.h"
+
+#define DEVICE_ADDR  0x1101
+#define TASK_PERIOD  400   // us
+#define WRITES_NB    20
+
+static word errorsNb;
+
+static KnxComObject input(0x0A00, KNX_DPT_1_001, COM_OBJ_LOGIC_IN);
+static KnxComObject sensor(0x0801, KNX_DPT_9_001, COM_OBJ_SENSOR);
+static KnxComObject* comObjects[] = { &input, &sensor };
+
+static KnxVirtualClock clock_(1000);
+
+void knxEvents(byte index) {}
+
+
+static void Check(const char *label, boolean result)
+{
+  printf("%s : %s\n", label, result ? "OK" : "FAILED !!");
+  if (!result) errorsNb++;
+}
+
+
+// Run the device task until the transmissions are completed (2s max)
+static void RunDevice(void)
+{
+  for (word i = 0; i < 5000; i++)
+  {
+    clock_.Advance(TASK_PERIOD);
+    Knx.task();
+    if (!Knx.isActive()) break;
+  }
+}
+
+
+static void TestHistogram(void)
+{
+  KnxLatencyHistogram histogram;
+
+  printf("--- Histogram ---\n");
+  Check("empty histogram", (histogram.GetCount() == 0) && (histogram.GetPercentile(50) == 0));
+  histogram.Add(100);   // bucket 0
+  histogram.Add(200);   // bucket 1
+  histogram.Add(200);
+  histogram.Add(5000);  // bucket 6 : [4096, 8192)
+  Check("buckets", (histogram.GetCount() == 4) && (histogram.GetBucketCount(0) == 1)
+                   && (histogram.GetBucketCount(1) == 2) && (histogram.GetBucketCount(6) == 1));
+  Check("bucket limits", (KnxLatencyHistogram::GetBucketLimit(0) == 128)
+                         && (KnxLatencyHistogram::GetBucketLimit(6) == 8192)
+                         && (KnxLatencyHistogram::GetBucketLimit(KNX_LATENCY_BUCKETS_NB - 1) == 0xFFFFFFFF));
+  Check("percentiles", (histogram.GetPercentile(0) == 128) && (histogram.GetPercentile(25) == 128)
+                       && (histogram.GetPercentile(50) == 256) && (histogram.GetPercentile(75) == 256)
+                       && (histogram.GetPercentile(99) == 8192) && (histogram.GetPercentile(100) == 8192));
+  histogram.Add(10000000); // 10s, last bucket
+  Check("last bucket", (histogram.GetBucketCount(KNX_LATENCY_BUCKETS_NB - 1) == 1)
+                       && (histogram.GetPercentile(100) == 0xFFFFFFFF));
+  histogram.Clear();
+  Check("histogram cleared", (histogram.GetCount() == 0) && (histogram.GetBucketCount(1) == 0));
+}
+
+
+int main(void)
+{
+  TpUartEmulator *emulator = new TpUartEmulator();
+  KnxTelegram telegram;
+  const KnxTxLatency& latency = Knx.getTxLatency();
+  unsigned long normalNb, totalLatency;
+
+  KnxSetClock(&clock_);
+  TestHistogram();
+
+  printf("--- Device writes ---\n");
+  Knx.begin(new KnxTpUart(*emulator, DEVICE_ADDR, NORMAL), comObjects, 2);
+  while (Knx.checkInitBus() != KNX_DEVICE_OK) clock_.Advance(TASK_PERIOD);
+  RunDevice();
+  Knx.clearTxLatency();
+  for (word i = 0; i < WRITES_NB; i++)
+  {
+    Knx.write(1, (float)i);
+    RunDevice();
+  }
+  normalNb = latency.GetStageHistogram(KNX_TX_STAGE_TOTAL, KNX_PRIORITY_NORMAL_VALUE).GetCount();
+  Check("writes counted per priority", normalNb == WRITES_NB);
+  for (byte stage = KNX_TX_STAGE_QUEUE; stage < KNX_TX_STAGE_TOTAL; stage++)
+    if (latency.GetStageHistogram((e_KnxTxLatencyStage)stage, KNX_PRIORITY_NORMAL_VALUE).GetCount() != WRITES_NB) normalNb = 0;
+  Check("all the stages counted", normalNb == WRITES_NB);
+  Check("writes counted per com object", (latency.GetObjectHistogram(1)->GetCount() == WRITES_NB)
+                                         && (latency.GetObjectHistogram(0)->GetCount() == 0)
+                                         && (latency.GetObjectHistogram(KNX_TX_LATENCY_OBJECTS_NB) == NULL));
+  // Queued and prepared within a task period, the telegram is fed in a burst to the emulator,
+  // the bus ACK comes after the frame transmission (about 1,1ms per byte at 9600 bit/s) and the ACK delay
+  printf("QUEUE p99 %lu us, PREPARE p99 %lu us, FEED p50 %lu us, CONFIRM p50 %lu us, TOTAL p99 %lu us\n",
+         Knx.getTxLatencyPercentile(KNX_TX_STAGE_QUEUE, KNX_PRIORITY_NORMAL_VALUE, 99),
+         Knx.getTxLatencyPercentile(KNX_TX_STAGE_PREPARE, KNX_PRIORITY_NORMAL_VALUE, 99),
+         Knx.getTxLatencyPercentile(KNX_TX_STAGE_FEED, KNX_PRIORITY_NORMAL_VALUE, 50),
+         Knx.getTxLatencyPercentile(KNX_TX_STAGE_CONFIRM, KNX_PRIORITY_NORMAL_VALUE, 50),
+         Knx.getTxLatencyPercentile(KNX_TX_STAGE_TOTAL, KNX_PRIORITY_NORMAL_VALUE, 99));
+  Check("queue latency", Knx.getTxLatencyPercentile(KNX_TX_STAGE_QUEUE, KNX_PRIORITY_NORMAL_VALUE, 99) <= 1024);
+  Check("prepare latency", Knx.getTxLatencyPercentile(KNX_TX_STAGE_PREPARE, KNX_PRIORITY_NORMAL_VALUE, 99) <= 128);
+  Check("confirm latency", (Knx.getTxLatencyPercentile(KNX_TX_STAGE_CONFIRM, KNX_PRIORITY_NORMAL_VALUE, 50) >= 8192)
+                           && (Knx.getTxLatencyPercentile(KNX_TX_STAGE_CONFIRM, KNX_PRIORITY_NORMAL_VALUE, 50) <= 65536));
+  totalLatency = Knx.getTxLatencyPercentile(KNX_TX_STAGE_TOTAL, KNX_PRIORITY_NORMAL_VALUE, 99);
+  Check("total latency", (totalLatency >= Knx.getTxLatencyPercentile(KNX_TX_STAGE_CONFIRM, KNX_PRIORITY_NORMAL_VALUE, 99))
+                         && (Knx.getTxObjectLatencyPercentile(1, 99) == totalLatency));
+
+  printf("--- Application telegram ---\n");
+  telegram.ClearTelegram();
+  telegram.SetSourceAddress(DEVICE_ADDR);
+  telegram.SetTargetAddress(0x0C00);
+  telegram.ChangePriority(KNX_PRIORITY_ALARM_VALUE);
+  telegram.SetCommand(KNX_COMMAND_VALUE_WRITE);
+  telegram.UpdateChecksum();
+  Knx.sendTelegram(telegram);
+  RunDevice();
+  Check("counted with its priority", (latency.GetStageHistogram(KNX_TX_STAGE_TOTAL, KNX_PRIORITY_ALARM_VALUE).GetCount() == 1)
+                                     && (latency.GetStageHistogram(KNX_TX_STAGE_TOTAL, KNX_PRIORITY_NORMAL_VALUE).GetCount()
+                                         == normalNb));
+  Check("no com object counted", (latency.GetObjectHistogram(0)->GetCount() == 0)
+                                 && (latency.GetObjectHistogram(1)->GetCount() == WRITES_NB));
+
+  printf("--- Not acknowledged ---\n");
+  emulator->SetBusAcknowledge(false);
+  Knx.write(1, (float)1000);
+  RunDevice();
+  emulator->SetBusAcknowledge(true);
+  Check("NACK not counted", latency.GetStageHistogram(KNX_TX_STAGE_TOTAL, KNX_PRIORITY_NORMAL_VALUE).GetCount() == normalNb);
+  Knx.clearTxLatency();
+  Check("histograms cleared", (Knx.getTxLatencyPercentile(KNX_TX_STAGE_TOTAL, KNX_PRIORITY_NORMAL_VALUE, 50) == 0)
+                              && (Knx.getTxObjectLatencyPercentile(1, 50) == 0)
+                              && (Knx.getTxObjectLatencyPercentile(200, 50) == 0));
+
+  Knx.end();
+  delete emulator;
+  printf("%u check(s) failed\n", errorsNb);
+  return errorsNb;
+}
+
+// EOF